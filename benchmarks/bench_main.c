@@ -0,0 +1,317 @@
+/**
+ * bench_main.c
+ *
+ * Suíte de regressão de desempenho no PC: roda o driver do MFRC522 e o
+ * caminho de publicação do firmware sobre o chip simulado, em cenários
+ * fixos, e relata por cenário:
+ *
+ *  - transações e bytes SPI, leituras/escritas de registrador;
+ *  - tempo simulado de RF (quadros no ar, espera por resposta, timeouts),
+ *    de barramento SPI e de flash, em tempo virtual (determinístico);
+ *  - tempo de CPU do PC (driver + pipeline + simulador; só serve para
+ *    comparar commits na mesma máquina);
+ *  - memória: pico de pilha do cenário (medido pintando a pilha da thread),
+ *    pico da fila pendente e bytes gravados na flash.
+ *
+ * Cada cenário roda num processo filho, com o estado estático dos módulos
+ * zerado. Saída em tabela ou, com --json, uma linha JSON por cenário com o
+ * commit, para acumular um histórico:
+ *
+ *   ./rfid_bench --json >> bench_history.jsonl
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "host_sdk.h"
+#include "mfrc522_sim.h"
+#include "bench_pipeline.h"
+#include "pipeline_stats.h"
+
+#ifndef BENCH_COMMIT
+#define BENCH_COMMIT "desconhecido"
+#endif
+
+#define STACK_SIZE      (256 * 1024)
+#define STACK_PAINT     0xA5
+
+typedef struct {
+    const char *name;
+    const char *description;
+    uint32_t scans;
+    void (*field)(uint32_t scan);   // Tags no campo e broker nesta varredura
+} scenario_t;
+
+typedef struct {
+    char name[32];
+    bench_pipeline_stats_t pipe;
+    mfrc522_sim_stats_t sim;
+    host_sdk_stats_t host;
+    uint64_t sim_ns;
+    uint64_t cpu_ns;
+    uint32_t stack_bytes;
+    char lat_json[512];
+} result_t;
+
+// --- Cenários ---
+
+static const mfrc522_sim_card_t tag_4b = { { 0x04, 0xA1, 0xB2, 0xC3 }, 4 };
+static const mfrc522_sim_card_t tag_7b = { { 0x04, 0x5E, 0x71, 0x8A, 0x2C, 0x49, 0x80 }, 7 };
+
+// UIDs que divergem em bits diferentes (anticolisão em várias rodadas)
+static const mfrc522_sim_card_t tags_colliding[5] = {
+    { { 0x11, 0x22, 0x33, 0x44 }, 4 },
+    { { 0x11, 0x22, 0x33, 0xC4 }, 4 },
+    { { 0x91, 0x22, 0x33, 0x44 }, 4 },
+    { { 0x13, 0xA2, 0x33, 0x44 }, 4 },
+    { { 0x11, 0x22, 0x3B, 0x45 }, 4 },
+};
+
+static void field_empty(uint32_t scan) {
+    (void)scan;
+    mfrc522_sim_set_field(NULL, 0);
+}
+
+static void field_single(uint32_t scan) {
+    (void)scan;
+    mfrc522_sim_set_field(&tag_4b, 1);
+}
+
+static void field_colliding(uint32_t scan) {
+    (void)scan;
+    mfrc522_sim_set_field(tags_colliding, 5);
+}
+
+static void field_7byte(uint32_t scan) {
+    (void)scan;
+    mfrc522_sim_set_field(&tag_7b, 1);
+}
+
+// AGV passando por marcadores: um por vez, 3 varreduras no campo e 3 fora;
+// broker fora do ar da varredura 20 à 159
+static void field_outage(uint32_t scan) {
+    mfrc522_sim_card_t marker = { { 0x04, 0x10, 0x00, 0x00 }, 4 };
+    marker.uid[2] = (uint8_t)(scan / 6);
+    marker.uid[3] = (uint8_t)(0x5A ^ (scan / 6));
+    mfrc522_sim_set_field(&marker, scan % 6 < 3 ? 1 : 0);
+    bench_pipeline_set_online(scan < 20 || scan >= 160);
+}
+
+static const scenario_t scenarios[] = {
+    { "empty_field", "campo vazio (REQA ate o timeout)", 100, field_empty },
+    { "single_tag", "uma tag de 4 bytes parada no campo", 100, field_single },
+    { "collision_5", "5 tags de 4 bytes ao mesmo tempo", 100, field_colliding },
+    { "uid_7byte", "uma tag de 7 bytes (2 niveis de cascata)", 100, field_7byte },
+    { "broker_outage", "marcadores em sequencia, broker fora por 70 s", 240, field_outage },
+};
+
+#define SCENARIO_COUNT (sizeof(scenarios) / sizeof(scenarios[0]))
+
+// --- Execução (processo filho) ---
+
+typedef struct {
+    const scenario_t *scenario;
+    uint32_t scans;
+    result_t *result;
+} run_arg_t;
+
+static uint64_t cpu_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void *run_scenario(void *param) {
+    run_arg_t *arg = param;
+    result_t *r = arg->result;
+
+    host_sdk_reset();
+    bench_pipeline_init();
+
+    // Só o cenário entra nas medidas (PCD_Init fica de fora)
+    mfrc522_sim_reset_stats();
+    host_sdk_reset_stats();
+    bench_pipeline_reset_stats();
+    uint64_t sim_start = host_now_ns();
+    uint64_t cpu_start = cpu_now_ns();
+
+    for (uint32_t i = 0; i < arg->scans; i++) {
+        arg->scenario->field(i);
+        bench_pipeline_iteration();
+    }
+
+    r->cpu_ns = cpu_now_ns() - cpu_start;
+    r->sim_ns = host_now_ns() - sim_start;
+    r->pipe = *bench_pipeline_stats();
+    r->sim = *mfrc522_sim_stats();
+    r->host = *host_sdk_stats();
+    pipeline_stats_format_json(r->lat_json, sizeof(r->lat_json));
+    return NULL;
+}
+
+// Roda o cenário numa thread com pilha pintada e mede o pico de uso
+static void run_child(const scenario_t *s, uint32_t scans, result_t *r) {
+    static uint8_t stack[STACK_SIZE] __attribute__((aligned(64)));
+    memset(stack, STACK_PAINT, sizeof(stack));
+
+    run_arg_t arg = { .scenario = s, .scans = scans, .result = r };
+    pthread_attr_t attr;
+    pthread_t thread;
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, stack, sizeof(stack));
+    if (pthread_create(&thread, &attr, run_scenario, &arg) != 0) {
+        run_scenario(&arg);
+    } else {
+        pthread_join(thread, NULL);
+    }
+    pthread_attr_destroy(&attr);
+
+    // A pilha cresce para baixo: o primeiro byte alterado marca o pico
+    uint32_t untouched = 0;
+    while (untouched < sizeof(stack) && stack[untouched] == STACK_PAINT) untouched++;
+    r->stack_bytes = (uint32_t)(sizeof(stack) - untouched);
+}
+
+static int run_isolated(const scenario_t *s, uint32_t scans, result_t *r) {
+    int fds[2];
+    if (pipe(fds) != 0) return -1;
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        close(fds[0]);
+        // Logs do firmware ([RFID], [QUEUE]...) não entram no relatório
+        if (freopen("/dev/null", "w", stdout) == NULL) _exit(1);
+        result_t child = {0};
+        snprintf(child.name, sizeof(child.name), "%s", s->name);
+        run_child(s, scans, &child);
+        ssize_t n = write(fds[1], &child, sizeof(child));
+        _exit(n == (ssize_t)sizeof(child) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    ssize_t got = 0;
+    while (got < (ssize_t)sizeof(*r)) {
+        ssize_t n = read(fds[0], (uint8_t *)r + got, sizeof(*r) - got);
+        if (n <= 0) break;
+        got += n;
+    }
+    close(fds[0]);
+    int status;
+    waitpid(pid, &status, 0);
+    return got == (ssize_t)sizeof(*r) && WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+// --- Relatório ---
+
+static void print_table_header(void) {
+    printf("%-14s %6s %5s %5s %5s %8s %8s %9s %9s %8s %6s %6s %7s\n",
+           "cenario", "scans", "lidas", "uids", "pub", "spi_tx", "spi/scan", "rf_ms",
+           "spi_ms", "cpu_ms", "pilha", "fila", "flash");
+}
+
+static void print_table_row(const result_t *r) {
+    const bench_pipeline_stats_t *p = &r->pipe;
+    printf("%-14s %6lu %5lu %5lu %5lu %8lu %8lu %9.1f %9.1f %8.2f %6lu %6lu %7lu\n",
+           r->name, (unsigned long)p->scans, (unsigned long)p->reads,
+           (unsigned long)p->distinct_uids, (unsigned long)p->published,
+           (unsigned long)r->sim.spi_transactions,
+           (unsigned long)(p->scans ? r->sim.spi_transactions / p->scans : 0),
+           r->sim.rf_ns / 1e6, r->host.spi_ns / 1e6, r->cpu_ns / 1e6,
+           (unsigned long)r->stack_bytes, (unsigned long)p->queue_peak,
+           (unsigned long)r->host.flash_programmed);
+}
+
+static void print_json(const result_t *r, const char *commit) {
+    const bench_pipeline_stats_t *p = &r->pipe;
+    const mfrc522_sim_stats_t *s = &r->sim;
+    const host_sdk_stats_t *h = &r->host;
+
+    printf("{\"commit\":\"%s\",\"scenario\":\"%s\",\"scans\":%lu,\"presences\":%lu,"
+           "\"reads\":%lu,\"distinct_uids\":%lu,\"events\":%lu,\"published\":%lu,"
+           "\"publish_bytes\":%lu,",
+           commit, r->name, (unsigned long)p->scans, (unsigned long)p->presences,
+           (unsigned long)p->reads, (unsigned long)p->distinct_uids, (unsigned long)p->events,
+           (unsigned long)p->published, (unsigned long)p->publish_bytes);
+    printf("\"spi_transactions\":%lu,\"spi_bytes\":%lu,\"reg_reads\":%lu,\"reg_writes\":%lu,"
+           "\"rf_frames\":%lu,\"rf_responses\":%lu,\"rf_collisions\":%lu,\"rf_timeouts\":%lu,"
+           "\"crc_ops\":%lu,",
+           (unsigned long)s->spi_transactions, (unsigned long)s->spi_bytes,
+           (unsigned long)s->register_reads, (unsigned long)s->register_writes,
+           (unsigned long)s->frames, (unsigned long)s->responses,
+           (unsigned long)s->collisions, (unsigned long)s->timeouts, (unsigned long)s->crc_ops);
+    printf("\"rf_us\":%llu,\"spi_us\":%llu,\"flash_us\":%llu,\"scan_us\":%llu,"
+           "\"scan_max_us\":%llu,\"sim_us\":%llu,\"cpu_us\":%llu,",
+           (unsigned long long)(s->rf_ns / 1000), (unsigned long long)(h->spi_ns / 1000),
+           (unsigned long long)(h->flash_ns / 1000), (unsigned long long)(p->scan_ns / 1000),
+           (unsigned long long)(p->scan_max_ns / 1000), (unsigned long long)(r->sim_ns / 1000),
+           (unsigned long long)(r->cpu_ns / 1000));
+    printf("\"stack_bytes\":%lu,\"queue_peak\":%lu,\"queue_dropped\":%lu,"
+           "\"flash_erases\":%lu,\"flash_bytes\":%lu,%s}\n",
+           (unsigned long)r->stack_bytes, (unsigned long)p->queue_peak,
+           (unsigned long)p->queue_dropped, (unsigned long)h->flash_erases,
+           (unsigned long)h->flash_programmed, r->lat_json);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "uso: %s [--json] [--commit ID] [--scans N] [cenario...]\n", prog);
+    fprintf(stderr, "cenarios:\n");
+    for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+        fprintf(stderr, "  %-14s %s (%lu varreduras)\n", scenarios[i].name,
+                scenarios[i].description, (unsigned long)scenarios[i].scans);
+    }
+}
+
+int main(int argc, char **argv) {
+    bool json = false;
+    const char *commit = BENCH_COMMIT;
+    uint32_t scans = 0;         // 0 = padrão de cada cenário
+    const char *only[SCENARIO_COUNT];
+    size_t only_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (strcmp(argv[i], "--commit") == 0 && i + 1 < argc) {
+            commit = argv[++i];
+        } else if (strcmp(argv[i], "--scans") == 0 && i + 1 < argc) {
+            scans = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (argv[i][0] != '-' && only_count < SCENARIO_COUNT) {
+            only[only_count++] = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!json) {
+        printf("Benchmark do leitor RFID (MFRC522 simulado), commit %s\n", commit);
+        printf("Tempos rf/spi: virtuais (deterministicos). cpu: PC, inclui o simulador.\n\n");
+        print_table_header();
+    }
+
+    int failures = 0;
+    for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+        const scenario_t *s = &scenarios[i];
+        bool selected = only_count == 0;
+        for (size_t k = 0; k < only_count; k++) {
+            if (strcmp(only[k], s->name) == 0) selected = true;
+        }
+        if (!selected) continue;
+
+        result_t r;
+        if (run_isolated(s, scans ? scans : s->scans, &r) != 0) {
+            fprintf(stderr, "%s: cenario falhou\n", s->name);
+            failures++;
+            continue;
+        }
+        if (json) print_json(&r, commit);
+        else print_table_row(&r);
+    }
+    return failures ? 1 : 0;
+}
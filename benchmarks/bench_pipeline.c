@@ -0,0 +1,188 @@
+#include "bench_pipeline.h"
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/spi.h"
+#include "mfrc522.h"
+#include "mfrc522_sim.h"
+#include "host_sdk.h"
+#include "rfid_config.h"
+#include "event_queue.h"
+#include "event_bus.h"
+#include "pipeline_stats.h"
+#include "tag_debounce.h"
+#include "event_json.h"
+#include "event_pipeline.h"
+
+// Mesmos limites do laço de main_mqtt.c
+#define PUBLISH_BURST       8
+#define PRIORITY_RESERVE    2
+
+#define MAX_DISTINCT        64
+
+static MFRC522Ptr_t mfrc = NULL;
+static const rfid_config_t *cfg = NULL;
+
+// Mesmos módulos de main_mqtt.c
+static tag_debounce_t debounce;
+static event_pipeline_t pipeline;
+
+// Broker simulado: PUBACKs pendentes em ordem de envio
+static bool online = true;
+static uint64_t ack_due_us[BROKER_WINDOW];
+static uint32_t in_flight = 0;
+
+static bench_pipeline_stats_t stats;
+static uint8_t distinct[MAX_DISTINCT][EVENT_UID_MAX + 1];
+
+// --- Broker ---
+
+static void broker_service(void) {
+    uint64_t now = time_us_64();
+    while (in_flight > 0 && ack_due_us[0] <= now) {
+        memmove(ack_due_us, ack_due_us + 1, (in_flight - 1) * sizeof(ack_due_us[0]));
+        in_flight--;
+    }
+}
+
+static bool broker_online(void) {
+    return online;
+}
+
+static uint32_t broker_window_free(void) {
+    return online ? BROKER_WINDOW - in_flight : 0;
+}
+
+static bool broker_publish(const char *topic, const char *payload) {
+    if (!online || in_flight == BROKER_WINDOW) return false;
+    ack_due_us[in_flight++] = time_us_64() + BROKER_RTT_US;
+    stats.published++;
+    stats.publish_bytes += (uint32_t)(strlen(topic) + strlen(payload));
+    return true;
+}
+
+void bench_pipeline_set_online(bool up) {
+    if (!up) in_flight = 0;
+    online = up;
+}
+
+// --- Caminho leitura -> publicação (espelha main_mqtt.c) ---
+
+static void record_rfid_tag(const uint8_t *uid, uint8_t uid_size) {
+    rfid_event_t ev = {0};
+    memcpy(ev.uid, uid, uid_size);
+    ev.uid_size = uid_size;
+    ev.timestamp_ms = to_ms_since_boot(get_absolute_time());
+    ev.detect_us = time_us_32();
+
+    stats.events++;
+    event_bus_produce(&ev);
+}
+
+static bool publish_rfid_tag(const rfid_event_t *ev) {
+    // Relógio comum fora do benchmark: sem ts_us
+    char payload[EVENT_JSON_MAX];
+    event_json_format(ev, NULL, payload, sizeof(payload));
+
+    if (!broker_publish(cfg->topic_rfid, payload)) return false;
+    pipeline_stats_published(ev->detect_us, time_us_32(),
+                             ev->flags & EVENT_FLAG_RESTORED, EVENT_CLASS(ev));
+    return true;
+}
+
+// Sem lotes binários: o broker simulado mede o JSON por evento
+static const event_pipeline_ops_t pipeline_ops = {
+    .online = broker_online,
+    .window_free = broker_window_free,
+    .publish = publish_rfid_tag,
+    .publish_batch = NULL,
+};
+
+static bool serial_sink_deliver(const rfid_event_t *ev, void *ctx) {
+    (void)ctx;
+    char uid_str[EVENT_JSON_UID_HEX_SIZE];
+    event_json_uid_hex(ev->uid, ev->uid_size, uid_str);
+    printf("[RFID] Tag detectada: %s\n", uid_str);
+    return true;
+}
+
+static bool mqtt_sink_deliver(const rfid_event_t *ev, void *ctx) {
+    (void)ctx;
+    event_pipeline_deliver(&pipeline, ev);
+    if (event_queue_count() > stats.queue_peak) stats.queue_peak = event_queue_count();
+    return true;
+}
+
+static event_sink_t serial_sink = { .name = "serial", .deliver = serial_sink_deliver };
+static event_sink_t mqtt_sink = { .name = "mqtt", .deliver = mqtt_sink_deliver };
+
+// --- Laço ---
+
+static void note_uid(const Uid *uid) {
+    for (uint32_t i = 0; i < stats.distinct_uids; i++) {
+        if (distinct[i][0] == uid->size && memcmp(&distinct[i][1], uid->uidByte, uid->size) == 0) {
+            return;
+        }
+    }
+    if (stats.distinct_uids < MAX_DISTINCT) {
+        distinct[stats.distinct_uids][0] = uid->size;
+        memcpy(&distinct[stats.distinct_uids][1], uid->uidByte, uid->size);
+        stats.distinct_uids++;
+    }
+}
+
+void bench_pipeline_init(void) {
+    rfid_config_load();
+    cfg = rfid_config();
+
+    event_pipeline_init(&pipeline, &pipeline_ops, PUBLISH_BURST, PRIORITY_RESERVE);
+    event_bus_register(&serial_sink);
+    event_bus_register(&mqtt_sink);
+
+    mfrc522_sim_init(MFRC522_PIN_CS, MFRC522_PIN_RST);
+    mfrc = MFRC522_Init();
+    MFRC522_SetResetHold(mfrc, 1);
+    PCD_Init(mfrc, spi0);
+    tag_debounce_init(&debounce, cfg->debounce_time_ms);
+}
+
+void bench_pipeline_iteration(void) {
+    broker_service();
+
+    // Varredura (mesma sequência do laço principal)
+    uint64_t start = host_now_ns();
+    pipeline_stats_scan(time_us_32());
+    stats.scans++;
+    if (PICC_IsNewCardPresent(mfrc)) {
+        stats.presences++;
+        if (PICC_ReadCardSerial(mfrc)) {
+            stats.reads++;
+            note_uid(&mfrc->uid);
+            if (tag_debounce_accept(&debounce, mfrc->uid.uidByte, mfrc->uid.size,
+                                    to_ms_since_boot(get_absolute_time()))) {
+                record_rfid_tag(mfrc->uid.uidByte, mfrc->uid.size);
+            }
+            PCD_StopCrypto1(mfrc);
+        }
+    }
+    uint64_t scan = host_now_ns() - start;
+    stats.scan_ns += scan;
+    if (scan > stats.scan_max_ns) stats.scan_max_ns = scan;
+
+    // Entrega aos sinks, escoamento e gravação da fila
+    event_bus_dispatch(PUBLISH_BURST);
+    event_pipeline_drain(&pipeline);
+    event_queue_persist(false);
+    stats.queue_dropped = event_queue_dropped();
+
+    sleep_ms(cfg->scan_interval_ms);
+}
+
+void bench_pipeline_reset_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+    pipeline_stats_reset();
+}
+
+const bench_pipeline_stats_t *bench_pipeline_stats(void) {
+    return &stats;
+}
@@ -0,0 +1,62 @@
+/**
+ * bench_pipeline.h
+ *
+ * Laço do firmware bare-metal (main_mqtt.c) rodando no PC sobre o
+ * MFRC522 simulado: varredura, debounce, barramento de eventos, sink MQTT,
+ * fila pendente com gravação na flash e escoamento ao broker.
+ *
+ * O broker é simulado: aceita publicações QoS 1 enquanto houver vaga na
+ * janela (MQTT_REQ_MAX_IN_FLIGHT) e confirma cada uma após BROKER_RTT_US
+ * de tempo virtual. WiFi, MQTT-SN, regras, assinatura e sinks de posição
+ * ficam de fora: só o caminho leitura -> publicação é medido.
+ */
+
+#ifndef BENCH_PIPELINE_H
+#define BENCH_PIPELINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BROKER_RTT_US       20000   // Ida e volta até o PUBACK
+#define BROKER_WINDOW       8       // MQTT_REQ_MAX_IN_FLIGHT (lib/lwipopts.h)
+
+typedef struct {
+    uint32_t scans;
+    uint32_t presences;         // PICC_IsNewCardPresent verdadeiro
+    uint32_t reads;             // PICC_ReadCardSerial com UID
+    uint32_t distinct_uids;     // UIDs diferentes lidos
+    uint32_t events;            // Leituras novas (após o debounce)
+    uint32_t published;         // Aceitas pelo broker simulado
+    uint32_t publish_bytes;     // Bytes de payload publicados
+    uint32_t queue_peak;        // Maior ocupação da fila pendente
+    uint32_t queue_dropped;
+    uint64_t scan_ns;           // Tempo virtual dentro das varreduras
+    uint64_t scan_max_ns;
+} bench_pipeline_stats_t;
+
+/**
+ * @brief Carrega a configuração padrão, registra os sinks e inicializa o
+ * leitor (PCD_Init) sobre o MFRC522 simulado.
+ */
+void bench_pipeline_init(void);
+
+/**
+ * @brief Liga ou derruba o broker simulado (queda: confirmações pendentes
+ * se perdem, como numa sessão encerrada).
+ */
+void bench_pipeline_set_online(bool online);
+
+/**
+ * @brief Uma iteração do laço principal: varredura, entrega aos sinks,
+ * escoamento da fila, gravação na flash e a espera de scan_interval_ms.
+ */
+void bench_pipeline_iteration(void);
+
+/**
+ * @brief Zera as medidas (depois da inicialização, antes do cenário).
+ */
+void bench_pipeline_reset_stats(void);
+
+const bench_pipeline_stats_t *bench_pipeline_stats(void);
+
+#endif // BENCH_PIPELINE_H
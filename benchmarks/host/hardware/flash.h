@@ -0,0 +1,28 @@
+/**
+ * hardware/flash.h (host)
+ *
+ * Flash em RAM (host_flash), lida pelo mesmo FLASH_XIP_PTR do firmware.
+ * Apagar e gravar contam bytes e avançam o relógio virtual com os tempos
+ * típicos da W25Q16 do Pico W.
+ */
+
+#ifndef HOST_HARDWARE_FLASH_H
+#define HOST_HARDWARE_FLASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef PICO_FLASH_SIZE_BYTES
+#define PICO_FLASH_SIZE_BYTES   (2 * 1024 * 1024)
+#endif
+#define FLASH_PAGE_SIZE         256u
+#define FLASH_SECTOR_SIZE       4096u
+
+extern uint8_t host_flash[PICO_FLASH_SIZE_BYTES];
+
+#define XIP_BASE                ((uintptr_t)host_flash)
+
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
+
+#endif // HOST_HARDWARE_FLASH_H
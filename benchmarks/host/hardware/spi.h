@@ -0,0 +1,32 @@
+/**
+ * hardware/spi.h (host)
+ *
+ * Barramento SPI ligado ao MFRC522 simulado: cada byte vai para
+ * mfrc522_sim_spi_byte() e avança o relógio virtual pelo baud rate.
+ */
+
+#ifndef HOST_HARDWARE_SPI_H
+#define HOST_HARDWARE_SPI_H
+
+#include "pico/stdlib.h"
+
+typedef struct spi_inst {
+    uint baudrate;
+} spi_inst_t;
+
+extern spi_inst_t host_spi[2];
+
+#define spi0 (&host_spi[0])
+#define spi1 (&host_spi[1])
+
+typedef enum {
+    SPI_LSB_FIRST = 0,
+    SPI_MSB_FIRST = 1
+} spi_order_t;
+
+uint spi_init(spi_inst_t *spi, uint baudrate);
+void spi_set_format(spi_inst_t *spi, uint data_bits, uint cpol, uint cpha, spi_order_t order);
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len);
+int spi_read_blocking(spi_inst_t *spi, uint8_t repeated_tx_data, uint8_t *dst, size_t len);
+
+#endif // HOST_HARDWARE_SPI_H
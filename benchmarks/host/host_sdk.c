@@ -0,0 +1,148 @@
+#include "host_sdk.h"
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "hardware/spi.h"
+#include "hardware/flash.h"
+#include "mfrc522_sim.h"
+
+// Tempos típicos da W25Q16JV (datasheet): apagar setor e gravar página
+#define FLASH_SECTOR_ERASE_NS   45000000ull
+#define FLASH_PAGE_PROGRAM_NS   400000ull
+
+uint8_t host_flash[PICO_FLASH_SIZE_BYTES];
+spi_inst_t host_spi[2];
+
+static uint64_t now_ns = 0;
+static host_sdk_stats_t stats;
+
+uint64_t host_now_ns(void) {
+    return now_ns;
+}
+
+void host_advance_ns(uint64_t ns) {
+    now_ns += ns;
+}
+
+void host_sdk_reset(void) {
+    memset(host_flash, 0xFF, sizeof(host_flash));
+    memset(&stats, 0, sizeof(stats));
+    now_ns = 0;
+}
+
+void host_sdk_reset_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+const host_sdk_stats_t *host_sdk_stats(void) {
+    return &stats;
+}
+
+// --- Tempo ---
+
+uint64_t time_us_64(void) {
+    return now_ns / 1000;
+}
+
+uint32_t time_us_32(void) {
+    return (uint32_t)(now_ns / 1000);
+}
+
+void sleep_us(uint64_t us) {
+    now_ns += us * 1000;
+    stats.sleep_ns += us * 1000;
+}
+
+void sleep_ms(uint32_t ms) {
+    sleep_us((uint64_t)ms * 1000);
+}
+
+void busy_wait_us(uint64_t us) {
+    now_ns += us * 1000;
+}
+
+// --- GPIO ---
+
+void gpio_init(uint gpio) {
+    (void)gpio;
+}
+
+void gpio_set_dir(uint gpio, bool out) {
+    (void)gpio;
+    (void)out;
+}
+
+void gpio_put(uint gpio, bool value) {
+    mfrc522_sim_gpio(gpio, value);
+}
+
+void gpio_set_function(uint gpio, uint fn) {
+    (void)gpio;
+    (void)fn;
+}
+
+// --- SPI ---
+
+uint spi_init(spi_inst_t *spi, uint baudrate) {
+    spi->baudrate = baudrate;
+    return baudrate;
+}
+
+void spi_set_format(spi_inst_t *spi, uint data_bits, uint cpol, uint cpha, spi_order_t order) {
+    (void)spi;
+    (void)data_bits;
+    (void)cpol;
+    (void)cpha;
+    (void)order;
+}
+
+// Um byte no barramento: 8 bits no baud configurado
+static uint8_t spi_xfer(spi_inst_t *spi, uint8_t tx) {
+    uint64_t ns = 8000000000ull / (spi->baudrate ? spi->baudrate : 1000000);
+    now_ns += ns;
+    stats.spi_ns += ns;
+    return mfrc522_sim_spi_byte(tx);
+}
+
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        (void)spi_xfer(spi, src[i]);
+    }
+    return (int)len;
+}
+
+int spi_read_blocking(spi_inst_t *spi, uint8_t repeated_tx_data, uint8_t *dst, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        dst[i] = spi_xfer(spi, repeated_tx_data);
+    }
+    return (int)len;
+}
+
+// --- Flash ---
+
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+    if (flash_offs + count > sizeof(host_flash)) return;
+    memset(host_flash + flash_offs, 0xFF, count);
+    uint32_t sectors = (uint32_t)((count + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE);
+    stats.flash_erases += sectors;
+    stats.flash_ns += sectors * FLASH_SECTOR_ERASE_NS;
+    now_ns += sectors * FLASH_SECTOR_ERASE_NS;
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count) {
+    if (flash_offs + count > sizeof(host_flash)) return;
+    // Como a NOR: gravar só leva bits de 1 para 0
+    for (size_t i = 0; i < count; i++) {
+        host_flash[flash_offs + i] &= data[i];
+    }
+    uint32_t pages = (uint32_t)((count + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE);
+    stats.flash_programmed += (uint32_t)count;
+    stats.flash_ns += pages * FLASH_PAGE_PROGRAM_NS;
+    now_ns += pages * FLASH_PAGE_PROGRAM_NS;
+}
+
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms) {
+    (void)enter_exit_timeout_ms;
+    func(param);
+    return PICO_OK;
+}
@@ -0,0 +1,43 @@
+/**
+ * host_sdk.h
+ *
+ * Estado do SDK do Pico simulado no PC (host_sdk.c): relógio virtual e
+ * contadores dos periféricos usados pelo firmware (SPI, flash, sleeps).
+ */
+
+#ifndef HOST_SDK_H
+#define HOST_SDK_H
+
+#include <stdint.h>
+
+typedef struct {
+    uint64_t spi_ns;            // Tempo de barramento SPI (bytes * 8 / baud)
+    uint64_t sleep_ns;          // Tempo em sleep_* (intervalo entre varreduras)
+    uint64_t flash_ns;          // Tempo de apagar/gravar a flash
+    uint32_t flash_erases;      // Setores apagados
+    uint32_t flash_programmed;  // Bytes gravados
+} host_sdk_stats_t;
+
+/**
+ * @brief Instante atual do relógio virtual (ns desde o "boot").
+ */
+uint64_t host_now_ns(void);
+
+/**
+ * @brief Avança o relógio virtual (RF, barramento, espera).
+ */
+void host_advance_ns(uint64_t ns);
+
+/**
+ * @brief Apaga a flash simulada (0xFF) e zera relógio e contadores.
+ */
+void host_sdk_reset(void);
+
+/**
+ * @brief Zera só os contadores (mantém relógio e flash).
+ */
+void host_sdk_reset_stats(void);
+
+const host_sdk_stats_t *host_sdk_stats(void);
+
+#endif // HOST_SDK_H
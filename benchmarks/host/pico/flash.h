@@ -0,0 +1,12 @@
+/**
+ * pico/flash.h (host)
+ */
+
+#ifndef HOST_PICO_FLASH_H
+#define HOST_PICO_FLASH_H
+
+#include <stdint.h>
+
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms);
+
+#endif // HOST_PICO_FLASH_H
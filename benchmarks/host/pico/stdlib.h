@@ -0,0 +1,62 @@
+/**
+ * pico/stdlib.h (host)
+ *
+ * Substituto mínimo do SDK do Pico para compilar o driver e os módulos
+ * independentes de hardware no PC. O tempo é virtual (host_sdk.c): só
+ * avança com o barramento SPI, o RF do MFRC522 simulado e os sleep_*, de
+ * modo que as medidas de tempo simulado são determinísticas.
+ */
+
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+#define PICO_OK                 0
+#define PICO_ERROR_GENERIC      (-1)
+
+#define GPIO_IN                 false
+#define GPIO_OUT                true
+#define GPIO_FUNC_SPI           1
+
+// Sem XIP nem RAM separada no PC
+#define __not_in_flash_func(func) func
+#define __not_in_flash(group)
+
+// --- Relógio virtual ---
+
+uint64_t time_us_64(void);
+uint32_t time_us_32(void);
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+void busy_wait_us(uint64_t us);
+
+static inline absolute_time_t get_absolute_time(void) {
+    return time_us_64();
+}
+
+static inline uint32_t to_ms_since_boot(absolute_time_t t) {
+    return (uint32_t)(t / 1000);
+}
+
+static inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) {
+    return (int64_t)(to - from);
+}
+
+static inline void tight_loop_contents(void) {
+}
+
+// --- GPIO (CS e RST vão para o MFRC522 simulado) ---
+
+void gpio_init(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_put(uint gpio, bool value);
+void gpio_set_function(uint gpio, uint fn);
+
+#endif // HOST_PICO_STDLIB_H
@@ -0,0 +1,578 @@
+#include "mfrc522_sim.h"
+#include <string.h>
+#include "host_sdk.h"
+
+// Portadora e bit a 106 kbit/s (128 ciclos da portadora)
+#define FC_HZ           13560000ull
+#define BIT_NS          (128ull * 1000000000ull / FC_HZ)
+// Tempo de guarda da tag (ISO 14443-3: 1172/fc após o último bit do PCD)
+#define FDT_NS          (1172ull * 1000000000ull / FC_HZ)
+// Coprocessador de CRC: um byte por 8 ciclos da portadora
+#define CRC_BYTE_NS     (8ull * 1000000000ull / FC_HZ)
+
+// Registradores (endereço SPI >> 1)
+#define R_COMMAND       0x01
+#define R_COMIRQ        0x04
+#define R_DIVIRQ        0x05
+#define R_ERROR         0x06
+#define R_FIFODATA      0x09
+#define R_FIFOLEVEL     0x0A
+#define R_CONTROL       0x0C
+#define R_BITFRAMING    0x0D
+#define R_COLL          0x0E
+#define R_MODE          0x11
+#define R_TXCONTROL     0x14
+#define R_CRCRESULT_H   0x21
+#define R_CRCRESULT_L   0x22
+#define R_TMODE         0x2A
+#define R_TPRESCALER    0x2B
+#define R_TRELOAD_H     0x2C
+#define R_TRELOAD_L     0x2D
+#define R_VERSION       0x37
+
+// Comandos do PCD
+#define CMD_IDLE        0x00
+#define CMD_CALCCRC     0x03
+#define CMD_TRANSCEIVE  0x0C
+#define CMD_SOFTRESET   0x0F
+
+// Bits de ComIrqReg, DivIrqReg e ErrorReg
+#define IRQ_TX          0x40
+#define IRQ_RX          0x20
+#define IRQ_IDLE        0x10
+#define IRQ_ERR         0x02
+#define IRQ_TIMER       0x01
+#define DIVIRQ_CRC      0x04
+#define ERR_COLL        0x08
+
+// Comandos das tags (ISO 14443-3 / MIFARE)
+#define PICC_REQA       0x26
+#define PICC_WUPA       0x52
+#define PICC_SEL_CL1    0x93
+#define PICC_SEL_CL2    0x95
+#define PICC_SEL_CL3    0x97
+#define PICC_HLTA       0x50
+#define PICC_READ       0x30
+#define PICC_CT         0x88
+
+typedef enum {
+    TAG_IDLE,
+    TAG_READY,
+    TAG_ACTIVE,
+    TAG_HALT
+} tag_state_t;
+
+typedef struct {
+    uint8_t uid[10];
+    uint8_t uid_size;
+    uint8_t level;              // Nível de cascata em andamento (1-3)
+    tag_state_t state;
+    uint8_t memory[64];         // 16 páginas (Ultralight)
+} sim_tag_t;
+
+// Resposta de uma tag: bits [start, end) de data (ordem LSB primeiro)
+typedef struct {
+    uint8_t data[18];
+    uint8_t start;
+    uint8_t end;
+} response_t;
+
+static uint8_t regs[64];
+static uint8_t fifo[64];
+static uint8_t fifo_len = 0;
+
+static sim_tag_t tags[MFRC522_SIM_MAX_TAGS];
+static uint8_t tag_count = 0;
+
+static uint32_t cs_gpio, rst_gpio;
+static bool rst_high = true;
+
+// Quadro SPI em andamento
+static bool cs_low = false;
+static uint32_t frame_bytes = 0;
+static uint8_t frame_reg = 0;
+static bool frame_read = false;
+
+// Transceive em andamento: resultado aplicado quando o relógio chega em done_ns
+static struct {
+    bool active;
+    uint64_t start_ns;
+    uint64_t done_ns;
+    uint8_t irq;
+    uint8_t error;
+    uint8_t coll;
+    uint8_t rx[sizeof(fifo)];
+    uint8_t rx_len;
+    uint8_t rx_last_bits;
+} op;
+
+// CalcCRC em andamento
+static struct {
+    bool active;
+    uint64_t done_ns;
+    uint16_t crc;
+} crc_op;
+
+static mfrc522_sim_stats_t stats;
+
+// --- CRC_A (ISO 14443-3, anexo B) ---
+
+static uint16_t crc_a(const uint8_t *data, uint32_t len, uint16_t preset) {
+    uint16_t crc = preset;
+    for (uint32_t i = 0; i < len; i++) {
+        uint8_t b = data[i] ^ (uint8_t)crc;
+        b ^= (uint8_t)(b << 4);
+        crc = (crc >> 8) ^ ((uint16_t)b << 8) ^ ((uint16_t)b << 3) ^ (b >> 4);
+    }
+    return crc;
+}
+
+static bool crc_ok(const uint8_t *frame, uint8_t len) {
+    if (len < 3) return false;
+    uint16_t crc = crc_a(frame, len - 2, 0x6363);
+    return frame[len - 2] == (uint8_t)crc && frame[len - 1] == (uint8_t)(crc >> 8);
+}
+
+static void append_crc(uint8_t *frame, uint8_t len) {
+    uint16_t crc = crc_a(frame, len, 0x6363);
+    frame[len] = (uint8_t)crc;
+    frame[len + 1] = (uint8_t)(crc >> 8);
+}
+
+static inline uint8_t get_bit(const uint8_t *data, uint32_t bit) {
+    return (data[bit / 8] >> (bit % 8)) & 1;
+}
+
+static inline void put_bit(uint8_t *data, uint32_t bit, uint8_t value) {
+    if (value) data[bit / 8] |= (uint8_t)(1 << (bit % 8));
+    else data[bit / 8] &= (uint8_t)~(1 << (bit % 8));
+}
+
+// Bits no ar a 106 kbit/s: SOF, dados com paridade por byte e EOF
+static uint64_t air_ns(uint32_t bits) {
+    return (bits + bits / 8 + 2) * BIT_NS;
+}
+
+// --- Tags ---
+
+static uint8_t tag_levels(const sim_tag_t *t) {
+    return t->uid_size == 4 ? 1 : t->uid_size == 7 ? 2 : 3;
+}
+
+// UID CLn + BCC do nível atual da tag
+static void tag_cln(const sim_tag_t *t, uint8_t level, uint8_t *out) {
+    const uint8_t *u = t->uid;
+    bool last = level == tag_levels(t);
+    uint8_t first = (uint8_t)(3 * (level - 1));
+
+    if (last) {
+        memcpy(out, u + first, 4);
+    } else {
+        out[0] = PICC_CT;
+        memcpy(out + 1, u + first, 3);
+    }
+    out[4] = out[0] ^ out[1] ^ out[2] ^ out[3];
+}
+
+static void tag_power_on(sim_tag_t *t, const mfrc522_sim_card_t *card) {
+    memset(t, 0, sizeof(*t));
+    memcpy(t->uid, card->uid, card->uid_size);
+    t->uid_size = card->uid_size;
+    t->state = TAG_IDLE;
+    t->level = 1;
+    // Páginas 0-2 com o UID (Ultralight), o resto com um padrão fixo
+    memcpy(t->memory, t->uid, t->uid_size);
+    for (uint32_t i = 12; i < sizeof(t->memory); i++) {
+        t->memory[i] = (uint8_t)(i * 7 + t->uid[0]);
+    }
+}
+
+/**
+ * Um quadro do PCD chega à tag. Devolve true se ela responde.
+ * tx_bits é o total de bits válidos do quadro.
+ */
+static bool tag_receive(sim_tag_t *t, const uint8_t *frame, uint8_t len, uint32_t tx_bits,
+                        response_t *resp) {
+    uint8_t cmd = frame[0];
+    memset(resp, 0, sizeof(*resp));
+
+    // Quadro curto (7 bits): REQA/WUPA
+    if (len == 1 && tx_bits == 7) {
+        bool wake = (cmd == PICC_REQA && t->state == TAG_IDLE) ||
+                    (cmd == PICC_WUPA && (t->state == TAG_IDLE || t->state == TAG_HALT));
+        if (!wake) {
+            if (t->state == TAG_READY || t->state == TAG_ACTIVE) t->state = TAG_IDLE;
+            return false;
+        }
+        t->state = TAG_READY;
+        t->level = 1;
+        resp->data[0] = t->uid_size == 4 ? 0x04 : t->uid_size == 7 ? 0x44 : 0x84;  // ATQA
+        resp->data[1] = 0x00;
+        resp->end = 16;
+        return true;
+    }
+
+    if (t->state == TAG_READY) {
+        uint8_t sel = (uint8_t)(PICC_SEL_CL1 + 2 * (t->level - 1));
+        if (cmd != sel || len < 2) {
+            t->state = TAG_IDLE;
+            return false;
+        }
+        uint8_t cln[5];
+        tag_cln(t, t->level, cln);
+        uint8_t nvb = frame[1];
+
+        if (nvb == 0x70) {
+            // SELECT: UID completo do nível, BCC e CRC_A
+            if (len != 9 || tx_bits != 72 || !crc_ok(frame, 9)) return false;
+            if (memcmp(frame + 2, cln, 5) != 0) {
+                t->state = TAG_IDLE;
+                return false;
+            }
+            bool more = t->level < tag_levels(t);
+            resp->data[0] = more ? 0x04 : (t->uid_size == 4 ? 0x08 : 0x00);  // SAK
+            append_crc(resp->data, 1);
+            resp->end = 24;
+            if (more) t->level++;
+            else t->state = TAG_ACTIVE;
+            return true;
+        }
+
+        // ANTICOLISÃO: responde com o restante se os bits conhecidos casam
+        uint32_t known = (uint32_t)((nvb >> 4) - 2) * 8 + (nvb & 0x07);
+        if ((nvb >> 4) < 2 || known >= 40 || tx_bits < 16 + known) return false;
+        for (uint32_t i = 0; i < known; i++) {
+            if (get_bit(frame + 2, i) != get_bit(cln, i)) return false;
+        }
+        memcpy(resp->data, cln, 5);
+        resp->start = (uint8_t)known;
+        resp->end = 40;
+        return true;
+    }
+
+    if (t->state == TAG_ACTIVE) {
+        if (cmd == PICC_HLTA && len == 4 && frame[1] == 0 && crc_ok(frame, 4)) {
+            t->state = TAG_HALT;
+            return false;
+        }
+        if (cmd == PICC_READ && len == 4 && crc_ok(frame, 4)) {
+            if (t->uid_size == 4) {
+                // Classic sem autenticação: NAK de 4 bits
+                resp->data[0] = 0x04;
+                resp->end = 4;
+                return true;
+            }
+            for (uint32_t i = 0; i < 16; i++) {
+                resp->data[i] = t->memory[(frame[1] * 4u + i) % sizeof(t->memory)];
+            }
+            append_crc(resp->data, 16);
+            resp->end = 144;
+            return true;
+        }
+        t->state = TAG_IDLE;
+    }
+    return false;
+}
+
+// --- Chip ---
+
+static void chip_reset(void) {
+    static const struct { uint8_t reg, value; } defaults[] = {
+        { R_COMMAND, 0x20 }, { 0x02, 0x80 }, { R_COMIRQ, 0x14 }, { 0x07, 0x21 },
+        { 0x0B, 0x08 }, { R_CONTROL, 0x10 }, { R_COLL, 0x80 }, { R_MODE, 0x3F },
+        { R_TXCONTROL, 0x80 }, { 0x16, 0x10 }, { 0x17, 0x84 }, { 0x18, 0x84 },
+        { 0x19, 0x4D }, { 0x1C, 0x62 }, { 0x1F, 0xEB }, { R_CRCRESULT_H, 0xFF },
+        { R_CRCRESULT_L, 0xFF }, { 0x24, 0x26 }, { 0x26, 0x48 }, { 0x27, 0x88 },
+        { 0x28, 0x20 }, { 0x29, 0x20 }, { R_VERSION, 0x92 },
+    };
+    memset(regs, 0, sizeof(regs));
+    for (uint32_t i = 0; i < sizeof(defaults) / sizeof(defaults[0]); i++) {
+        regs[defaults[i].reg] = defaults[i].value;
+    }
+    fifo_len = 0;
+    op.active = false;
+    crc_op.active = false;
+}
+
+// Período do timer com TAuto: (TReload + 1) * (2 * TPrescaler + 1) / fc
+static uint64_t timer_ns(void) {
+    uint32_t prescaler = ((uint32_t)(regs[R_TMODE] & 0x0F) << 8) | regs[R_TPRESCALER];
+    uint32_t reload = ((uint32_t)regs[R_TRELOAD_H] << 8) | regs[R_TRELOAD_L];
+    return (uint64_t)(reload + 1) * (2 * prescaler + 1) * 1000000000ull / FC_HZ;
+}
+
+// Aplica o que terminou até agora (chamada antes de cada byte SPI)
+static void chip_update(void) {
+    uint64_t now = host_now_ns();
+
+    if (op.active && now >= op.done_ns) {
+        op.active = false;
+        stats.rf_ns += op.done_ns - op.start_ns;
+        regs[R_COMIRQ] |= op.irq;
+        regs[R_ERROR] = op.error;
+        regs[R_COLL] = (regs[R_COLL] & 0x80) | op.coll;
+        regs[R_CONTROL] = (regs[R_CONTROL] & ~0x07) | op.rx_last_bits;
+        memcpy(fifo, op.rx, op.rx_len);
+        fifo_len = op.rx_len;
+    }
+    if (crc_op.active && now >= crc_op.done_ns) {
+        crc_op.active = false;
+        regs[R_CRCRESULT_L] = (uint8_t)crc_op.crc;
+        regs[R_CRCRESULT_H] = (uint8_t)(crc_op.crc >> 8);
+        regs[R_DIVIRQ] |= DIVIRQ_CRC;
+    }
+}
+
+// Comando interrompido (Idle ou outro comando): o tempo de RF gasto conta
+static void cancel_op(void) {
+    if (op.active) {
+        stats.rf_ns += host_now_ns() - op.start_ns;
+        op.active = false;
+    }
+    crc_op.active = false;
+}
+
+static void start_calc_crc(void) {
+    static const uint16_t presets[] = { 0x0000, 0x6363, 0xA671, 0xFFFF };
+    crc_op.crc = crc_a(fifo, fifo_len, presets[regs[R_MODE] & 0x03]);
+    crc_op.done_ns = host_now_ns() + fifo_len * CRC_BYTE_NS;
+    crc_op.active = true;
+    fifo_len = 0;
+    stats.crc_ops++;
+}
+
+// StartSend com Transceive: envia a FIFO e calcula a resposta do campo
+static void start_transceive(void) {
+    uint8_t frame[sizeof(fifo)];
+    uint8_t len = fifo_len;
+    uint8_t tx_last_bits = regs[R_BITFRAMING] & 0x07;
+    uint8_t rx_align = (regs[R_BITFRAMING] >> 4) & 0x07;
+    uint32_t tx_bits = len ? (len - 1u) * 8 + (tx_last_bits ? tx_last_bits : 8) : 0;
+
+    memcpy(frame, fifo, len);
+    fifo_len = 0;
+    stats.frames++;
+
+    memset(&op, 0, sizeof(op));
+    op.active = true;
+    op.start_ns = host_now_ns();
+    uint64_t tx_end = op.start_ns + air_ns(tx_bits);
+
+    // Antena desligada: nenhuma tag é alimentada
+    uint8_t responders = 0;
+    response_t resp[MFRC522_SIM_MAX_TAGS];
+    if (len > 0 && (regs[R_TXCONTROL] & 0x03)) {
+        for (uint8_t i = 0; i < tag_count; i++) {
+            if (tag_receive(&tags[i], frame, len, tx_bits, &resp[responders])) {
+                responders++;
+            }
+        }
+    }
+
+    if (responders == 0) {
+        stats.timeouts++;
+        if (regs[R_TMODE] & 0x80) {
+            op.done_ns = tx_end + timer_ns();
+            op.irq = IRQ_TX | IRQ_TIMER;
+        } else {
+            op.done_ns = UINT64_MAX;    // Sem TAuto: o driver desiste sozinho
+        }
+        return;
+    }
+    stats.responses++;
+
+    // Sobreposição bit a bit: o primeiro bit divergente é a colisão, e os
+    // seguintes chegam zerados (ValuesAfterColl = 0, como o driver configura)
+    uint8_t start = resp[0].start, end = 0;
+    for (uint8_t i = 0; i < responders; i++) {
+        if (resp[i].end > end) end = resp[i].end;
+    }
+    uint8_t merged[sizeof(resp[0].data)] = {0};
+    int collision = -1;
+    for (uint32_t bit = start; bit < end; bit++) {
+        uint8_t value = get_bit(resp[0].data, bit);
+        for (uint8_t i = 1; i < responders && collision < 0; i++) {
+            if (get_bit(resp[i].data, bit) != value) collision = (int)bit;
+        }
+        if (collision >= 0) break;
+        put_bit(merged, bit, value);
+    }
+
+    // Bits recebidos entram na FIFO a partir da posição RxAlign
+    uint32_t rx_bits = end - start;
+    for (uint32_t bit = 0; bit < rx_bits; bit++) {
+        put_bit(op.rx, rx_align + bit, get_bit(merged, start + bit));
+    }
+    op.rx_len = (uint8_t)((rx_align + rx_bits + 7) / 8);
+    op.rx_last_bits = (uint8_t)((rx_align + rx_bits) % 8);
+    op.irq = IRQ_TX | IRQ_RX;
+
+    if (collision >= 0) {
+        // CollPos conta desde o início do UID do nível (o que PICC_Select espera)
+        uint32_t pos = (uint32_t)collision + 1;
+        op.coll = pos > 32 ? 0x20 : (uint8_t)(pos & 0x1F);
+        op.error = ERR_COLL;
+        op.irq |= IRQ_ERR;
+        stats.collisions++;
+    }
+    op.done_ns = tx_end + FDT_NS + air_ns(rx_bits);
+}
+
+static void write_command(uint8_t value) {
+    uint8_t cmd = value & 0x0F;
+    cancel_op();
+    regs[R_COMMAND] = value & 0x3F & ~0x10;  // PowerDown volta a 0 na hora
+
+    switch (cmd) {
+    case CMD_SOFTRESET:
+        chip_reset();
+        regs[R_COMMAND] = 0x20;
+        break;
+    case CMD_CALCCRC:
+        start_calc_crc();
+        break;
+    case CMD_TRANSCEIVE:
+        break;                          // Espera o StartSend
+    default:
+        // Idle, Mem, Receive, MFAuthent...: terminam na hora
+        if (cmd != CMD_IDLE) regs[R_COMIRQ] |= IRQ_IDLE;
+        regs[R_COMMAND] &= ~0x0F;
+        break;
+    }
+}
+
+static void reg_write(uint8_t reg, uint8_t value) {
+    stats.register_writes++;
+    switch (reg) {
+    case R_COMMAND:
+        write_command(value);
+        break;
+    case R_COMIRQ:
+    case R_DIVIRQ:
+        // Set1/Set2: 1 liga os bits marcados, 0 os limpa
+        if (value & 0x80) regs[reg] |= value & 0x7F;
+        else regs[reg] &= ~value;
+        break;
+    case R_FIFODATA:
+        if (fifo_len < sizeof(fifo)) fifo[fifo_len++] = value;
+        else regs[R_ERROR] |= 0x10;     // BufferOvfl
+        break;
+    case R_FIFOLEVEL:
+        if (value & 0x80) {
+            fifo_len = 0;
+            regs[R_ERROR] &= ~0x10;
+        }
+        break;
+    case R_BITFRAMING:
+        regs[reg] = value & 0x7F;
+        if ((value & 0x80) && (regs[R_COMMAND] & 0x0F) == CMD_TRANSCEIVE) {
+            start_transceive();
+        }
+        break;
+    case R_VERSION:
+    case R_ERROR:
+        break;                          // Somente leitura
+    default:
+        regs[reg] = value;
+        break;
+    }
+}
+
+static uint8_t reg_read(uint8_t reg) {
+    stats.register_reads++;
+    switch (reg) {
+    case R_FIFODATA: {
+        if (fifo_len == 0) return 0;
+        uint8_t value = fifo[0];
+        memmove(fifo, fifo + 1, --fifo_len);
+        return value;
+    }
+    case R_FIFOLEVEL:
+        return fifo_len;
+    case R_COMIRQ:
+    case R_DIVIRQ:
+        return regs[reg] & 0x7F;
+    default:
+        return regs[reg];
+    }
+}
+
+// --- Interface com host_sdk.c ---
+
+void mfrc522_sim_init(uint32_t cs_pin, uint32_t rst_pin) {
+    cs_gpio = cs_pin;
+    rst_gpio = rst_pin;
+    rst_high = true;
+    cs_low = false;
+    tag_count = 0;
+    chip_reset();
+    mfrc522_sim_reset_stats();
+}
+
+void mfrc522_sim_set_field(const mfrc522_sim_card_t *cards, uint8_t count) {
+    sim_tag_t next[MFRC522_SIM_MAX_TAGS];
+    if (count > MFRC522_SIM_MAX_TAGS) count = MFRC522_SIM_MAX_TAGS;
+
+    for (uint8_t i = 0; i < count; i++) {
+        bool kept = false;
+        for (uint8_t j = 0; j < tag_count && !kept; j++) {
+            if (tags[j].uid_size == cards[i].uid_size &&
+                memcmp(tags[j].uid, cards[i].uid, cards[i].uid_size) == 0) {
+                next[i] = tags[j];
+                kept = true;
+            }
+        }
+        if (!kept) tag_power_on(&next[i], &cards[i]);
+    }
+    memcpy(tags, next, count * sizeof(sim_tag_t));
+    tag_count = count;
+}
+
+const mfrc522_sim_stats_t *mfrc522_sim_stats(void) {
+    return &stats;
+}
+
+void mfrc522_sim_reset_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+void mfrc522_sim_gpio(uint32_t pin, bool value) {
+    if (pin == rst_gpio) {
+        // Borda de subida do NRSTPD: reset completo
+        if (value && !rst_high) chip_reset();
+        rst_high = value;
+    }
+    if (pin != cs_gpio) return;
+
+    if (!value) {
+        // CS desce de novo sem subir (leitura aninhada do driver): novo quadro
+        if (cs_low && frame_bytes > 0) stats.spi_transactions++;
+        cs_low = true;
+        frame_bytes = 0;
+    } else {
+        if (cs_low && frame_bytes > 0) stats.spi_transactions++;
+        cs_low = false;
+        frame_bytes = 0;
+    }
+}
+
+uint8_t mfrc522_sim_spi_byte(uint8_t tx) {
+    if (!cs_low || !rst_high) return 0xFF;
+    chip_update();
+    stats.spi_bytes++;
+
+    if (frame_bytes++ == 0) {
+        // Primeiro byte: endereço (bit 7 = leitura)
+        frame_reg = (tx >> 1) & 0x3F;
+        frame_read = (tx & 0x80) != 0;
+        return 0x00;
+    }
+    if (frame_read) {
+        // Leitura em rajada: cada byte enviado é o próximo endereço
+        uint8_t value = reg_read(frame_reg);
+        frame_reg = (tx >> 1) & 0x3F;
+        return value;
+    }
+    reg_write(frame_reg, tx);
+    return 0x00;
+}
@@ -0,0 +1,70 @@
+/**
+ * mfrc522_sim.h
+ *
+ * MFRC522 simulado no nível de registradores, para rodar o driver
+ * (lib/mfrc522.c) sem hardware.
+ *
+ * O protocolo SPI (endereço, rajadas de FIFO), a FIFO, as IRQs, o
+ * coprocessador de CRC e o timer seguem o datasheet; cada quadro enviado
+ * pela antena chega às tags do campo, que seguem a máquina de estados da
+ * ISO 14443-3 (IDLE, READY, ACTIVE, HALT) com anticolisão bit a bit e
+ * níveis de cascata (UIDs de 4, 7 e 10 bytes). Respostas de várias tags
+ * se sobrepõem bit a bit: o primeiro bit divergente vira CollErr/CollPos.
+ *
+ * O tempo de RF (quadro no ar a 106 kbit/s, tempo de guarda da tag e
+ * timeout do timer) avança o relógio virtual de host_sdk.h, junto com o
+ * tempo de barramento de cada byte SPI; o laço de espera do driver gasta,
+ * portanto, o mesmo número de leituras de ComIrqReg que no leitor real.
+ *
+ * Simplificações: sem autenticação MIFARE Classic (MFAuthent termina sem
+ * Crypto1; READ numa Classic recebe NAK), sem CRC de recepção pelo chip
+ * (o driver confere o CRC pelo CalcCRC) e sem erros de paridade.
+ */
+
+#ifndef MFRC522_SIM_H
+#define MFRC522_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MFRC522_SIM_MAX_TAGS    8
+
+// Tag colocada no campo (UID de 4, 7 ou 10 bytes)
+typedef struct {
+    uint8_t uid[10];
+    uint8_t uid_size;
+} mfrc522_sim_card_t;
+
+typedef struct {
+    uint32_t spi_transactions;  // Quadros SPI (CS baixo com ao menos um byte)
+    uint32_t spi_bytes;
+    uint32_t register_reads;    // Bytes de dado lidos (rajadas contam cada byte)
+    uint32_t register_writes;
+    uint32_t frames;            // Quadros transmitidos pela antena
+    uint32_t responses;         // Quadros com resposta de alguma tag
+    uint32_t collisions;
+    uint32_t timeouts;          // Sem resposta: TimerIRq
+    uint32_t crc_ops;           // Comandos CalcCRC
+    uint64_t rf_ns;             // No ar + espera pela resposta ou timeout
+} mfrc522_sim_stats_t;
+
+/**
+ * @brief Liga o chip simulado aos pinos de CS e RST do driver e o deixa
+ * no estado de reset, com o campo vazio.
+ */
+void mfrc522_sim_init(uint32_t cs_pin, uint32_t rst_pin);
+
+/**
+ * @brief Define as tags presentes no campo. Tags que continuam no campo
+ * mantêm o estado (ACTIVE, HALT...); as novas entram em IDLE.
+ */
+void mfrc522_sim_set_field(const mfrc522_sim_card_t *cards, uint8_t count);
+
+const mfrc522_sim_stats_t *mfrc522_sim_stats(void);
+void mfrc522_sim_reset_stats(void);
+
+// Chamadas por host_sdk.c (GPIO e barramento SPI)
+void mfrc522_sim_gpio(uint32_t pin, bool value);
+uint8_t mfrc522_sim_spi_byte(uint8_t tx);
+
+#endif // MFRC522_SIM_H
@@ -0,0 +1,209 @@
+# Relatório de uso de RAM e flash por módulo, a partir do map do linker.
+#
+# Cada seção de entrada do map (.text.*, .rodata.*, .data.*, .bss.*, ...) é
+# atribuída a um módulo pelo caminho do objeto que a contém. Seções em RAM
+# que não são .bss/.noinit também contam na flash (cópia de carga).
+# Buffers alocados em tempo de execução (ex: os 16 KB de resposta do
+# servidor HTTP) não aparecem no map: eles entram apenas no "livre para
+# heap". O heap do lwIP (MEM_LIBC_MALLOC=0 em lwipopts.h) é estático e
+# conta em lwip_pools.
+#
+# Uso: cmake -DMAP=<arquivo.elf.map> [-DRAM_BUDGET=n] [-DFLASH_BUDGET=n]
+#            [-DMODULE_BUDGETS=<modulo:ram=n:flash=n;...>] -P footprint_report.cmake
+#
+# Termina com erro se algum orçamento for ultrapassado.
+
+cmake_minimum_required(VERSION 3.13)
+
+if(NOT EXISTS "${MAP}")
+    message(FATAL_ERROR "[FOOTPRINT] Map nao encontrado: ${MAP}")
+endif()
+
+# RP2040: 256 KB de SRAM principal + 2 x 4 KB de scratch (pilhas)
+set(RAM_TOTAL 270336)
+if(NOT DEFINED RAM_BUDGET)
+    set(RAM_BUDGET 0)
+endif()
+if(NOT DEFINED FLASH_BUDGET)
+    set(FLASH_BUDGET 0)
+endif()
+
+# Módulos, testados em ordem: nome e regex sobre "<seção> <objeto>"
+set(modules
+    "stacks|^\\.stack"
+    "mfrc522|/lib/mfrc522"
+    "http|pico_http_server"
+    "mqtt|/lwip/src/apps/mqtt"
+    "lwip_pools|/lwip/src/core/(mem|memp)\\.c"
+    "lwip|/lwip/"
+    "cyw43|cyw43"
+    "app|\\.dir/(main_mqtt\\.c|lib/)"
+    "libc|\\.a\\("
+    "sdk|pico-sdk|pico_|hardware_|boot2"
+)
+set(module_names)
+foreach(entry IN LISTS modules)
+    string(REGEX REPLACE "\\|.*" "" name "${entry}")
+    list(APPEND module_names ${name})
+    set(ram_${name} 0)
+    set(flash_${name} 0)
+endforeach()
+list(APPEND module_names other)
+set(ram_other 0)
+set(flash_other 0)
+
+# Maiores objetos em RAM (nome da seção, normalmente .bss.<símbolo>)
+set(ram_items)
+
+file(STRINGS "${MAP}" map_lines)
+
+set(in_map FALSE)
+set(pending "")
+foreach(line IN LISTS map_lines)
+    if(NOT in_map)
+        if(line MATCHES "^Linker script and memory map")
+            set(in_map TRUE)
+        endif()
+        continue()
+    endif()
+
+    # Seção de entrada numa linha, ou nome longo com endereço na linha seguinte
+    if(line MATCHES "^ ([.A-Za-z_][^ ]*) +0x([0-9a-fA-F]+) +0x([0-9a-fA-F]+) (.+)$")
+        set(section "${CMAKE_MATCH_1}")
+        set(addr "${CMAKE_MATCH_2}")
+        set(size "${CMAKE_MATCH_3}")
+        set(object "${CMAKE_MATCH_4}")
+        set(pending "")
+    elseif(pending AND line MATCHES "^ +0x([0-9a-fA-F]+) +0x([0-9a-fA-F]+) (.+)$")
+        set(section "${pending}")
+        set(addr "${CMAKE_MATCH_1}")
+        set(size "${CMAKE_MATCH_2}")
+        set(object "${CMAKE_MATCH_3}")
+        set(pending "")
+    elseif(line MATCHES "^ ([.A-Za-z_][^ ]*)$")
+        set(pending "${CMAKE_MATCH_1}")
+        continue()
+    else()
+        set(pending "")
+        continue()
+    endif()
+
+    math(EXPR addr "0x${addr}")
+    math(EXPR size "0x${size}")
+    if(size EQUAL 0 OR addr EQUAL 0)
+        continue()  # Seções descartadas ou de depuração
+    endif()
+
+    set(in_ram FALSE)
+    set(in_flash FALSE)
+    if(addr GREATER_EQUAL 536870912 AND addr LESS 805306368)        # 0x20000000
+        set(in_ram TRUE)
+        if(NOT section MATCHES "^(\\.s?bss|\\.noinit|\\.uninitialized|\\.stack|\\.heap|COMMON)")
+            set(in_flash TRUE)  # .data e .time_critical: copiados da flash
+        endif()
+    elseif(addr GREATER_EQUAL 268435456 AND addr LESS 536870912)    # 0x10000000
+        set(in_flash TRUE)
+    else()
+        continue()
+    endif()
+
+    set(module other)
+    foreach(entry IN LISTS modules)
+        string(FIND "${entry}" "|" sep)
+        string(SUBSTRING "${entry}" 0 ${sep} name)
+        math(EXPR sep "${sep} + 1")
+        string(SUBSTRING "${entry}" ${sep} -1 pattern)
+        if("${section} ${object}" MATCHES "${pattern}")
+            set(module ${name})
+            break()
+        endif()
+    endforeach()
+
+    if(in_ram)
+        math(EXPR ram_${module} "${ram_${module}} + ${size}")
+        if(size GREATER_EQUAL 512)
+            list(APPEND ram_items "${size}|${section}|${module}")
+        endif()
+    endif()
+    if(in_flash)
+        math(EXPR flash_${module} "${flash_${module}} + ${size}")
+    endif()
+endforeach()
+
+if(NOT in_map)
+    message(FATAL_ERROR "[FOOTPRINT] Formato de map desconhecido: ${MAP}")
+endif()
+
+# ---- Relatório ----
+set(ram_total 0)
+set(flash_total 0)
+message(STATUS "[FOOTPRINT] modulo              RAM      flash")
+foreach(name IN LISTS module_names)
+    math(EXPR ram_total "${ram_total} + ${ram_${name}}")
+    math(EXPR flash_total "${flash_total} + ${flash_${name}}")
+    if(ram_${name} EQUAL 0 AND flash_${name} EQUAL 0)
+        continue()
+    endif()
+    set(blank "                        ")
+    string(LENGTH "${name}${ram_${name}}" n)
+    math(EXPR pad "23 - ${n}")
+    string(SUBSTRING "${blank}" 0 ${pad} spaces)
+    message(STATUS "[FOOTPRINT] ${name}${spaces}${ram_${name}}  ${flash_${name}}")
+endforeach()
+math(EXPR ram_free "${RAM_TOTAL} - ${ram_total}")
+message(STATUS "[FOOTPRINT] total RAM: ${ram_total} bytes (livre para heap: ${ram_free})")
+message(STATUS "[FOOTPRINT] total flash: ${flash_total} bytes")
+
+# Maiores buffers estáticos em RAM
+list(SORT ram_items COMPARE NATURAL ORDER DESCENDING)
+list(LENGTH ram_items n_items)
+if(n_items GREATER 8)
+    list(SUBLIST ram_items 0 8 ram_items)
+endif()
+foreach(item IN LISTS ram_items)
+    string(REPLACE "|" ";" fields "${item}")
+    list(GET fields 0 size)
+    list(GET fields 1 section)
+    list(GET fields 2 module)
+    message(STATUS "[FOOTPRINT]   ${size} bytes  ${section} (${module})")
+endforeach()
+
+# ---- Orçamentos ----
+set(violations)
+if(RAM_BUDGET GREATER 0 AND ram_total GREATER RAM_BUDGET)
+    list(APPEND violations "RAM total ${ram_total} > ${RAM_BUDGET}")
+endif()
+if(FLASH_BUDGET GREATER 0 AND flash_total GREATER FLASH_BUDGET)
+    list(APPEND violations "flash total ${flash_total} > ${FLASH_BUDGET}")
+endif()
+
+# MODULE_BUDGETS chega com ',' no lugar de ';' (lista dentro de -D)
+string(REPLACE "," ";" module_budgets "${MODULE_BUDGETS}")
+foreach(budget IN LISTS module_budgets)
+    if(budget STREQUAL "")
+        continue()
+    endif()
+    if(NOT budget MATCHES "^([a-z_0-9]+)((:(ram|flash)=[0-9]+)+)$")
+        message(FATAL_ERROR "[FOOTPRINT] Orcamento invalido: ${budget}")
+    endif()
+    set(name "${CMAKE_MATCH_1}")
+    if(NOT name IN_LIST module_names)
+        message(FATAL_ERROR "[FOOTPRINT] Modulo desconhecido no orcamento: ${name}")
+    endif()
+    foreach(kind ram flash)
+        if(budget MATCHES ":${kind}=([0-9]+)")
+            set(limit ${CMAKE_MATCH_1})
+            if(${kind}_${name} GREATER limit)
+                list(APPEND violations "${name} ${kind} ${${kind}_${name}} > ${limit}")
+            endif()
+        endif()
+    endforeach()
+endforeach()
+
+if(violations)
+    foreach(v IN LISTS violations)
+        message(STATUS "[FOOTPRINT] ESTOURO: ${v}")
+    endforeach()
+    message(FATAL_ERROR "[FOOTPRINT] Orcamento de memoria excedido")
+endif()
+message(STATUS "[FOOTPRINT] Dentro do orcamento")
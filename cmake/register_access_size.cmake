@@ -0,0 +1,24 @@
+# Imprime o tamanho (bytes de código) das funções de acesso a registradores
+# do MFRC522, para comparar a configuração estática com a de runtime.
+#
+# Uso: cmake -DNM=<arm-none-eabi-nm> -DELF=<arquivo.elf> -P register_access_size.cmake
+
+execute_process(
+    COMMAND ${NM} --print-size --size-sort --radix=d ${ELF}
+    OUTPUT_VARIABLE nm_output
+    RESULT_VARIABLE nm_result
+)
+if(NOT nm_result EQUAL 0)
+    message(WARNING "nm falhou para ${ELF}")
+    return()
+endif()
+
+string(REPLACE "\n" ";" nm_lines "${nm_output}")
+set(total 0)
+foreach(line IN LISTS nm_lines)
+    if(line MATCHES "^[0-9]+ ([0-9]+) [tTwW] (PCD_(Write|Read)N?Register|cs_(de)?select)$")
+        message(STATUS "[MFRC522] ${CMAKE_MATCH_2}: ${CMAKE_MATCH_1} bytes")
+        math(EXPR total "${total} + ${CMAKE_MATCH_1}")
+    endif()
+endforeach()
+message(STATUS "[MFRC522] Total acesso a registradores: ${total} bytes")
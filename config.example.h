@@ -3,10 +3,19 @@
  *
  * Arquivo de exemplo de configuração
  *
+ * As configurações agora ficam na flash (veja lib/rfid_config.h) e podem
+ * ser alteradas pelo console serial sem recompilar:
+ *   cfg set wifi_ssid MinhaRede
+ *   cfg set wifi_password MinhaSenha
+ *   cfg save
+ *   cfg reboot
+ *
+ * Este arquivo só define os valores PADRÃO usados quando a flash ainda
+ * não tem configuração gravada (primeiro boot ou após "cfg defaults").
+ *
  * INSTRUÇÕES:
- * 1. Copie este arquivo para "config.h"
- * 2. Preencha suas credenciais
- * 3. No main_mqtt.c, substitua as defines por #include "config.h"
+ * 1. Copie este arquivo para "config.h" (é incluído automaticamente)
+ * 2. Preencha os padrões da sua instalação
  */
 
 #ifndef CONFIG_H
@@ -20,10 +29,33 @@
 #define MQTT_BROKER_IP  "192.168.1.100"      // IP do computador com o broker
 #define MQTT_BROKER_PORT 1883
 #define MQTT_CLIENT_ID  "PicoW-RFID-Reader"
+#define TIME_SERVER_IP  MQTT_BROKER_IP       // Servidor NTP comum aos leitores
 
 // ========== TÓPICOS MQTT ==========
 #define MQTT_TOPIC_RFID     "agv/rfid"
 #define MQTT_TOPIC_STATUS   "agv/sensors/rfid/status"
+#define MQTT_TOPIC_MAP      "agv/map"
+#define MQTT_TOPIC_POSITION "agv/position"
+#define MQTT_TOPIC_RULES    "agv/rules"
+#define MQTT_TOPIC_BATCH    "agv/rfid/batch"
+#define MQTT_TOPIC_CMD      "agv/rfid/cmd"
+#define MQTT_TOPIC_REPLY    "agv/rfid/reply"
+#define MQTT_TOPIC_OTA      "agv/rfid/ota"
+#define MQTT_TOPIC_CRASH    "agv/rfid/crash"
+
+// ========== ASSINATURA DOS EVENTOS ==========
+#define AUTH_MODE   0       // 0 = sem MAC, 1 = HMAC-SHA256, 2 = SipHash-2-4
+#define AUTH_KEY    ""      // Chave em hexadecimal (ex: openssl rand -hex 32)
+
+// ========== FILA PENDENTE EM LOTES ==========
+#define BATCH_CODEC 0       // 0 = JSON por evento, 1 = delta + dicionário, 2 = + LZSS
+
+// ========== OPERAÇÕES REMOTAS EM CARTÕES ==========
+#define CARD_OPS    0       // 0 = desligado, 1 = só leitura, 2 = leitura e escrita
+
+// ========== ATUALIZAÇÃO REMOTA (firmware com RFID_OTA) ==========
+#define OTA_ENABLED     0   // 1 = aceita pedidos em MQTT_TOPIC_OTA
+#define OTA_CONFIRM_S   60  // Rede e leitor OK por este tempo: imagem nova confirmada
 
 // ========== PINAGEM RFID MFRC522 ==========
 #define PIN_MISO    4
@@ -0,0 +1,110 @@
+#include "agv_tracker.h"
+#include <stdio.h>
+#include "tag_map.h"
+#include "rfid_config.h"
+#include "time_sync.h"
+
+static bool has_last = false;
+static uint32_t last_mm;
+static uint32_t last_detect_us;
+static int8_t direction = 0;
+static uint32_t speed_mm_s = 0;
+
+/**
+ * Distância e sentido de 'from' para 'to'. No percurso fechado, o caminho
+ * mais curto (o AGV não pula meia volta entre dois marcadores).
+ */
+static uint32_t travel(uint32_t from, uint32_t to, int8_t *dir) {
+    uint32_t loop = tag_map_loop_mm();
+
+    if (from == to) {
+        *dir = 0;
+        return 0;
+    }
+    if (loop) {
+        uint32_t forward = (to % loop + loop - from % loop) % loop;
+        uint32_t backward = loop - forward;
+        *dir = forward <= backward ? 1 : -1;
+        return forward <= backward ? forward : backward;
+    }
+    *dir = to > from ? 1 : -1;
+    return to > from ? to - from : from - to;
+}
+
+bool agv_tracker_update(const rfid_event_t *ev, agv_position_t *pos) {
+    uint32_t mm;
+    if (!tag_map_lookup(ev->uid, ev->uid_size, &mm)) return false;
+
+    pos->segment_mm = 0;
+    pos->segment_ms = 0;
+
+    if (has_last) {
+        int8_t dir;
+        uint32_t dist = travel(last_mm, mm, &dir);
+        uint32_t dt_ms = (ev->detect_us - last_detect_us) / 1000;
+
+        pos->segment_mm = dist;
+        pos->segment_ms = dt_ms;
+
+        if (dist == 0) {
+            speed_mm_s = 0;         // Mesmo marcador de novo: parado
+        } else {
+            direction = dir;
+            speed_mm_s = (dt_ms > 0 && dt_ms <= AGV_SEGMENT_MAX_MS)
+                         ? (uint32_t)((uint64_t)dist * 1000 / dt_ms) : 0;
+        }
+    }
+
+    has_last = true;
+    last_mm = mm;
+    last_detect_us = ev->detect_us;
+
+    pos->position_mm = mm;
+    pos->direction = direction;
+    pos->speed_mm_s = speed_mm_s;
+    pos->eta_ms = 0;
+    pos->has_next = direction != 0 && tag_map_next(mm, direction, &pos->next_mm);
+
+    if (pos->has_next && speed_mm_s > 0) {
+        int8_t dir;
+        uint32_t remaining = travel(mm, pos->next_mm, &dir);
+        if (tag_map_loop_mm() && dir != direction) {
+            remaining = tag_map_loop_mm() - remaining;  // Mais de meia volta à frente
+        }
+        pos->eta_ms = (uint32_t)((uint64_t)remaining * 1000 / speed_mm_s);
+    }
+    return true;
+}
+
+int agv_tracker_format_json(const rfid_event_t *ev, const agv_position_t *pos,
+                            char *buf, size_t len) {
+    char uid_str[EVENT_UID_MAX * 2 + 1];
+    for (uint8_t i = 0; i < ev->uid_size; i++) {
+        snprintf(uid_str + i * 2, 3, "%02X", ev->uid[i]);
+    }
+    uid_str[ev->uid_size * 2] = '\0';
+
+    int n = snprintf(buf, len,
+                     "{\"agv\":\"%s\",\"tag\":\"%s\",\"pos_mm\":%lu,\"dir\":%d,"
+                     "\"speed_mm_s\":%lu,\"segment_mm\":%lu,\"segment_ms\":%lu",
+                     rfid_config()->mqtt_client_id, uid_str,
+                     (unsigned long)pos->position_mm, pos->direction,
+                     (unsigned long)pos->speed_mm_s, (unsigned long)pos->segment_mm,
+                     (unsigned long)pos->segment_ms);
+    if (n < 0 || (size_t)n >= len) return n;
+
+    if (pos->has_next) {
+        n += snprintf(buf + n, len - n, ",\"next_mm\":%lu,\"eta_ms\":%lu",
+                      (unsigned long)pos->next_mm, (unsigned long)pos->eta_ms);
+        if ((size_t)n >= len) return n;
+    }
+
+    // Com o relógio comum, velocidades entre leitores diferentes
+    uint64_t ts_us;
+    if (time_sync_event_unix_us(ev, &ts_us)) {
+        n += snprintf(buf + n, len - n, ",\"ts_us\":%llu", (unsigned long long)ts_us);
+        if ((size_t)n >= len) return n;
+    }
+    return n + snprintf(buf + n, len - n, ",\"timestamp\":%lu}",
+                        (unsigned long)ev->timestamp_ms);
+}
@@ -0,0 +1,56 @@
+/**
+ * agv_tracker.h
+ *
+ * Posição, velocidade e ETA do AGV calculadas no próprio leitor (embarcado
+ * no AGV) a partir dos marcadores do trilho (tag_map.h):
+ *
+ *  - posição: a do último marcador lido;
+ *  - sentido: do marcador anterior para o atual (no percurso fechado, o
+ *    caminho mais curto);
+ *  - velocidade do trecho: distância entre os dois marcadores / tempo entre
+ *    as leituras (detect_us);
+ *  - ETA: distância até o próximo marcador no mesmo sentido / velocidade.
+ *
+ * O resultado segue pronto no tópico topic_position, para que o painel não
+ * precise cruzar cada leitura com o mapa.
+ */
+
+#ifndef AGV_TRACKER_H
+#define AGV_TRACKER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "event_queue.h"
+
+// Trechos mais lentos que isso (ex: AGV parado) não dão velocidade
+#define AGV_SEGMENT_MAX_MS      60000
+
+typedef struct {
+    uint32_t position_mm;
+    int8_t direction;           // +1, -1 ou 0 (desconhecido)
+    uint32_t segment_mm;        // Distância do último trecho
+    uint32_t segment_ms;        // Duração do último trecho
+    uint32_t speed_mm_s;        // 0 = desconhecida
+    bool has_next;
+    uint32_t next_mm;           // Próximo marcador no sentido atual
+    uint32_t eta_ms;            // Até o próximo marcador (0 = desconhecido)
+} agv_position_t;
+
+/**
+ * @brief Atualiza a estimativa com uma leitura.
+ * @return false se o UID não é um marcador do mapa (nada muda).
+ */
+bool agv_tracker_update(const rfid_event_t *ev, agv_position_t *pos);
+
+/**
+ * @brief Escreve o evento de posição em JSON.
+ * Ex: {"agv":"PicoW-1","tag":"04AABBCC","pos_mm":1200,"dir":1,
+ *      "speed_mm_s":850,"next_mm":3400,"eta_ms":2588,"timestamp":93412}
+ * "ts_us" (relógio comum, ver time_sync.h) aparece quando sincronizado.
+ * @return O número de caracteres escritos (como snprintf).
+ */
+int agv_tracker_format_json(const rfid_event_t *ev, const agv_position_t *pos,
+                            char *buf, size_t len);
+
+#endif // AGV_TRACKER_H
@@ -0,0 +1,230 @@
+#include "auth_crypto.h"
+#include <string.h>
+
+// No RP2040 a compressão roda da RAM: sem esperas do cache XIP no laço
+#if PICO_ON_DEVICE
+#include "pico/platform.h"
+#define AUTH_FAST_FUNC(f) __not_in_flash_func(f)
+#else
+#define AUTH_FAST_FUNC(f) f
+#endif
+
+// ========== SHA-256 ==========
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR(x, n)  (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void AUTH_FAST_FUNC(sha256_compress)(uint32_t h[8], const uint8_t *p) {
+    uint32_t w[16];
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+    uint32_t e = h[4], f = h[5], g = h[6], hh = h[7];
+
+    // Mensagem expandida numa janela de 16 palavras (64 B de pilha, não 256)
+    for (int i = 0; i < 64; i++) {
+        uint32_t wi;
+        if (i < 16) {
+            wi = ((uint32_t)p[4 * i] << 24) | ((uint32_t)p[4 * i + 1] << 16) |
+                 ((uint32_t)p[4 * i + 2] << 8) | p[4 * i + 3];
+        } else {
+            uint32_t w15 = w[(i - 15) & 15], w2 = w[(i - 2) & 15];
+            uint32_t s0 = ROTR(w15, 7) ^ ROTR(w15, 18) ^ (w15 >> 3);
+            uint32_t s1 = ROTR(w2, 17) ^ ROTR(w2, 19) ^ (w2 >> 10);
+            wi = w[i & 15] + s0 + w[(i - 7) & 15] + s1;
+        }
+        w[i & 15] = wi;
+
+        uint32_t t1 = hh + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) +
+                      K[i] + wi;
+        uint32_t t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        hh = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+}
+
+void sha256_init(sha256_ctx_t *ctx) {
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(ctx->h, iv, sizeof(iv));
+    ctx->used = 0;
+    ctx->total = 0;
+}
+
+void sha256_update(sha256_ctx_t *ctx, const void *data, size_t len) {
+    const uint8_t *p = data;
+    ctx->total += len;
+
+    if (ctx->used) {
+        size_t take = SHA256_BLOCK_SIZE - ctx->used;
+        if (take > len) take = len;
+        memcpy(ctx->block + ctx->used, p, take);
+        ctx->used += take;
+        p += take;
+        len -= take;
+        if (ctx->used < SHA256_BLOCK_SIZE) return;
+        sha256_compress(ctx->h, ctx->block);
+        ctx->used = 0;
+    }
+    while (len >= SHA256_BLOCK_SIZE) {
+        sha256_compress(ctx->h, p);
+        p += SHA256_BLOCK_SIZE;
+        len -= SHA256_BLOCK_SIZE;
+    }
+    memcpy(ctx->block, p, len);
+    ctx->used = len;
+}
+
+void sha256_final(sha256_ctx_t *ctx, uint8_t digest[SHA256_DIGEST_SIZE]) {
+    uint64_t bits = ctx->total * 8;
+
+    ctx->block[ctx->used++] = 0x80;
+    if (ctx->used > SHA256_BLOCK_SIZE - 8) {
+        memset(ctx->block + ctx->used, 0, SHA256_BLOCK_SIZE - ctx->used);
+        sha256_compress(ctx->h, ctx->block);
+        ctx->used = 0;
+    }
+    memset(ctx->block + ctx->used, 0, SHA256_BLOCK_SIZE - 8 - ctx->used);
+    for (int i = 0; i < 8; i++) {
+        ctx->block[SHA256_BLOCK_SIZE - 1 - i] = (uint8_t)(bits >> (8 * i));
+    }
+    sha256_compress(ctx->h, ctx->block);
+
+    for (int i = 0; i < 8; i++) {
+        digest[4 * i] = (uint8_t)(ctx->h[i] >> 24);
+        digest[4 * i + 1] = (uint8_t)(ctx->h[i] >> 16);
+        digest[4 * i + 2] = (uint8_t)(ctx->h[i] >> 8);
+        digest[4 * i + 3] = (uint8_t)ctx->h[i];
+    }
+}
+
+// ========== HMAC-SHA256 ==========
+
+void hmac_sha256_setkey(hmac_sha256_key_t *key, const uint8_t *secret, size_t len) {
+    uint8_t k[SHA256_BLOCK_SIZE] = {0};
+    uint8_t pad[SHA256_BLOCK_SIZE];
+
+    if (len > SHA256_BLOCK_SIZE) {
+        sha256_ctx_t ctx;
+        sha256_init(&ctx);
+        sha256_update(&ctx, secret, len);
+        sha256_final(&ctx, k);
+    } else {
+        memcpy(k, secret, len);
+    }
+
+    for (int i = 0; i < SHA256_BLOCK_SIZE; i++) pad[i] = k[i] ^ 0x36;
+    sha256_init(&key->inner);
+    sha256_update(&key->inner, pad, sizeof(pad));
+
+    for (int i = 0; i < SHA256_BLOCK_SIZE; i++) pad[i] = k[i] ^ 0x5c;
+    sha256_init(&key->outer);
+    sha256_update(&key->outer, pad, sizeof(pad));
+
+    memset(k, 0, sizeof(k));
+    memset(pad, 0, sizeof(pad));
+}
+
+void hmac_sha256_begin(const hmac_sha256_key_t *key, sha256_ctx_t *ctx) {
+    *ctx = key->inner;
+}
+
+void hmac_sha256_end(const hmac_sha256_key_t *key, sha256_ctx_t *ctx,
+                     uint8_t mac[SHA256_DIGEST_SIZE]) {
+    uint8_t inner[SHA256_DIGEST_SIZE];
+    sha256_final(ctx, inner);
+
+    sha256_ctx_t outer = key->outer;
+    sha256_update(&outer, inner, sizeof(inner));
+    sha256_final(&outer, mac);
+}
+
+// ========== SipHash-2-4 ==========
+
+#define ROTL64(x, n) (((x) << (n)) | ((x) >> (64 - (n))))
+
+static void AUTH_FAST_FUNC(sip_round)(uint64_t v[4]) {
+    v[0] += v[1]; v[1] = ROTL64(v[1], 13); v[1] ^= v[0]; v[0] = ROTL64(v[0], 32);
+    v[2] += v[3]; v[3] = ROTL64(v[3], 16); v[3] ^= v[2];
+    v[0] += v[3]; v[3] = ROTL64(v[3], 21); v[3] ^= v[0];
+    v[2] += v[1]; v[1] = ROTL64(v[1], 17); v[1] ^= v[2]; v[2] = ROTL64(v[2], 32);
+}
+
+static void sip_block(uint64_t v[4], uint64_t m) {
+    v[3] ^= m;
+    sip_round(v);
+    sip_round(v);
+    v[0] ^= m;
+}
+
+static uint64_t load64_le(const uint8_t *p) {
+    uint64_t m = 0;
+    for (int i = 7; i >= 0; i--) m = (m << 8) | p[i];
+    return m;
+}
+
+void siphash_setkey(siphash_key_t *key, const uint8_t secret[SIPHASH_KEY_SIZE]) {
+    uint64_t k0 = load64_le(secret);
+    uint64_t k1 = load64_le(secret + 8);
+    key->v[0] = k0 ^ 0x736f6d6570736575ull;
+    key->v[1] = k1 ^ 0x646f72616e646f6dull;
+    key->v[2] = k0 ^ 0x6c7967656e657261ull;
+    key->v[3] = k1 ^ 0x7465646279746573ull;
+}
+
+void siphash_begin(const siphash_key_t *key, siphash_ctx_t *ctx) {
+    memcpy(ctx->v, key->v, sizeof(ctx->v));
+    ctx->tail = 0;
+    ctx->total = 0;
+}
+
+void siphash_update(siphash_ctx_t *ctx, const void *data, size_t len) {
+    const uint8_t *p = data;
+
+    // Completa o bloco pendente byte a byte; o miolo vai de 8 em 8
+    while (len && (ctx->total & 7)) {
+        ctx->tail |= (uint64_t)*p++ << (8 * (ctx->total & 7));
+        ctx->total++;
+        len--;
+        if ((ctx->total & 7) == 0) {
+            sip_block(ctx->v, ctx->tail);
+            ctx->tail = 0;
+        }
+    }
+    while (len >= 8) {
+        sip_block(ctx->v, load64_le(p));
+        p += 8;
+        len -= 8;
+        ctx->total += 8;
+    }
+    while (len--) {
+        ctx->tail |= (uint64_t)*p++ << (8 * (ctx->total & 7));
+        ctx->total++;
+    }
+}
+
+uint64_t siphash_end(siphash_ctx_t *ctx) {
+    sip_block(ctx->v, ctx->tail | (ctx->total << 56));
+    ctx->v[2] ^= 0xff;
+    for (int i = 0; i < 4; i++) sip_round(ctx->v);
+    return ctx->v[0] ^ ctx->v[1] ^ ctx->v[2] ^ ctx->v[3];
+}
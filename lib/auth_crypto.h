@@ -0,0 +1,80 @@
+/**
+ * auth_crypto.h
+ *
+ * Primitivas de autenticação de mensagens usadas por event_auth:
+ * HMAC-SHA256 (RFC 2104 / FIPS 180-4) e SipHash-2-4.
+ *
+ * As chaves são preparadas uma única vez ("key schedule"): no HMAC, os
+ * blocos K^ipad e K^opad já saem comprimidos (estados intermediários), de
+ * modo que cada mensagem curta custa só as compressões do próprio texto
+ * mais uma do bloco externo; no SipHash, o estado inicial v0..v3 já vem
+ * misturado com a chave.
+ *
+ * C puro, sem dependências do SDK: o mesmo arquivo é compilado no
+ * firmware e na ferramenta de verificação (tools/event_verify.c).
+ */
+
+#ifndef AUTH_CRYPTO_H
+#define AUTH_CRYPTO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SHA256_DIGEST_SIZE      32
+#define SHA256_BLOCK_SIZE       64
+#define SIPHASH_KEY_SIZE        16
+
+// --- SHA-256 ---
+
+typedef struct {
+    uint32_t h[8];
+    uint8_t block[SHA256_BLOCK_SIZE];
+    uint32_t used;              // Bytes pendentes em 'block'
+    uint64_t total;             // Bytes processados desde o início
+} sha256_ctx_t;
+
+void sha256_init(sha256_ctx_t *ctx);
+void sha256_update(sha256_ctx_t *ctx, const void *data, size_t len);
+void sha256_final(sha256_ctx_t *ctx, uint8_t digest[SHA256_DIGEST_SIZE]);
+
+// --- HMAC-SHA256 ---
+
+// Estados após os blocos K^ipad e K^opad (a chave em si não é guardada)
+typedef struct {
+    sha256_ctx_t inner;
+    sha256_ctx_t outer;
+} hmac_sha256_key_t;
+
+/**
+ * @brief Prepara a chave (qualquer tamanho; maiores que 64 bytes são
+ * resumidas antes, como manda a RFC 2104).
+ */
+void hmac_sha256_setkey(hmac_sha256_key_t *key, const uint8_t *secret, size_t len);
+
+/**
+ * @brief Inicia uma mensagem a partir do estado preparado. O texto é
+ * passado em partes com sha256_update(ctx, ...).
+ */
+void hmac_sha256_begin(const hmac_sha256_key_t *key, sha256_ctx_t *ctx);
+
+void hmac_sha256_end(const hmac_sha256_key_t *key, sha256_ctx_t *ctx,
+                     uint8_t mac[SHA256_DIGEST_SIZE]);
+
+// --- SipHash-2-4 ---
+
+typedef struct {
+    uint64_t v[4];              // Estado inicial já misturado com a chave
+} siphash_key_t;
+
+typedef struct {
+    uint64_t v[4];
+    uint64_t tail;              // Bytes ainda sem bloco completo de 8
+    uint64_t total;
+} siphash_ctx_t;
+
+void siphash_setkey(siphash_key_t *key, const uint8_t secret[SIPHASH_KEY_SIZE]);
+void siphash_begin(const siphash_key_t *key, siphash_ctx_t *ctx);
+void siphash_update(siphash_ctx_t *ctx, const void *data, size_t len);
+uint64_t siphash_end(siphash_ctx_t *ctx);
+
+#endif // AUTH_CRYPTO_H
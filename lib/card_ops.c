@@ -0,0 +1,823 @@
+#include "card_ops.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/critical_section.h"
+#include "pico/flash.h"
+#include "hardware/flash.h"
+#include "flash_layout.h"
+#include "rfid_config.h"
+#include "event_auth.h"
+#include "link_supervisor.h"
+#include "tag_map.h"
+
+#define TIMEOUT_DEFAULT_S   30
+#define TIMEOUT_MAX_S       600
+#define READ_BLOCKS_MAX     (CARD_OPS_DATA_MAX / 2 / 16)    // 64 bytes por leitura
+#define FIRST_USER_PAGE     4       // Ultralight/NTAG: 0-3 são UID, lock e CC
+#define UL_LAST_USER_PAGE   15      // Ultralight sem GET_VERSION (e parte do Ultralight C)
+#define UL_GET_VERSION      0x60    // Ultralight EV1 e NTAG21x
+
+#define CTR_SLOTS           (FLASH_CARD_CTR_SIZE / sizeof(uint64_t))
+#define CTR_EMPTY           UINT64_MAX
+#define CTR_MAGIC           0x3152544344524143ull   // "CARDCTR1", na primeira posição
+
+typedef enum {
+    OP_INFO,
+    OP_READ,
+    OP_WRITE,
+    OP_NDEF,
+    OP_VALUE,
+    OP_SETVALUE,
+    OP_INC,
+    OP_DEC,
+} card_op_t;
+
+static const char *const op_names[] = {
+    "info", "read", "write", "ndef", "value", "setvalue", "inc", "dec"
+};
+
+typedef enum {
+    SLOT_FREE,
+    SLOT_PENDING,       // Aguardando o cartão (lwIP -> RF)
+    SLOT_RUNNING,       // Com o caminho de RF
+    SLOT_DONE,          // Resposta pronta (RF -> publicação)
+} slot_state_t;
+
+typedef struct {
+    uint8_t state;
+    char req[16];
+    uint8_t op;
+    uint8_t uid[EVENT_UID_MAX];     // Cartão alvo (0 = o próximo)
+    uint8_t uid_size;
+    uint8_t addr;                   // Bloco (Classic) ou página (Ultralight)
+    uint8_t count;
+    MIFARE_Key key;
+    uint8_t key_cmd;                // PICC_CMD_MF_AUTH_KEY_A ou _B
+    uint8_t pwd[4];
+    bool has_pwd;
+    int32_t value;
+    uint8_t data[CARD_OPS_DATA_MAX];    // Escrita: entrada; leitura: resultado
+    uint8_t data_len;
+    uint32_t deadline_ms;
+    uint64_t ctr;                   // Contador do comando (0 sem auth_mode)
+
+    // Resultado
+    const char *status;
+    const char *error;
+    uint8_t card_uid[EVENT_UID_MAX];
+    uint8_t card_uid_size;
+    uint8_t card_type;
+    bool has_value;
+} card_cmd_t;
+
+static card_cmd_t slots[CARD_OPS_MAX];
+static uint64_t last_ctr = 0;           // Último contador aceito (lwIP)
+static uint64_t saved_ctr = 0;          // Último contador gravado na flash
+static uint64_t unsaved_ctr = 0;        // Contador que não pôde ser gravado
+
+static uint32_t executed = 0;
+static uint32_t failed = 0;
+static uint32_t expired = 0;
+static uint32_t rejected = 0;
+
+// Comandos chegam pelo lwIP, rodam no RF e saem pela publicação
+static critical_section_t ops_lock;
+static bool lock_ready = false;
+
+static void lock(void) {
+    if (!lock_ready) {
+        critical_section_init(&ops_lock);
+        lock_ready = true;
+    }
+    critical_section_enter_blocking(&ops_lock);
+}
+
+static void unlock(void) {
+    critical_section_exit(&ops_lock);
+}
+
+static uint32_t now_ms(void) {
+    return to_ms_since_boot(get_absolute_time());
+}
+
+// --- Comando ---
+
+static bool item_is(const char *key, size_t key_len, const char *name) {
+    return strlen(name) == key_len && memcmp(key, name, key_len) == 0;
+}
+
+static bool parse_long(const char *s, size_t len, long min, long max, long *out) {
+    char num[16];
+    if (len == 0 || len >= sizeof(num)) return false;
+    memcpy(num, s, len);
+    num[len] = '\0';
+    char *end;
+    *out = strtol(num, &end, 10);
+    return *end == '\0' && *out >= min && *out <= max;
+}
+
+static int parse_hex(const char *s, size_t len, uint8_t *out, size_t size) {
+    if (len == 0 || len % 2 || len / 2 > size) return -1;
+    for (size_t i = 0; i < len; i += 2) {
+        // strtoul aceitaria sinal ("+f", "-1") e espaços
+        if (!isxdigit((unsigned char)s[i]) || !isxdigit((unsigned char)s[i + 1])) return -1;
+        char byte[3] = { s[i], s[i + 1], '\0' };
+        out[i / 2] = (uint8_t)strtoul(byte, NULL, 16);
+    }
+    return (int)(len / 2);
+}
+
+/**
+ * Mensagem NDEF de um registro curto (URI ou texto) em TLV, como o tipo 2
+ * do NFC Forum grava a partir da página 4.
+ */
+static bool encode_ndef(card_cmd_t *cmd, bool uri, const char *value, size_t len) {
+    static const struct {
+        const char *prefix;
+        uint8_t code;
+    } prefixes[] = {
+        { "https://www.", 0x02 }, { "http://www.", 0x01 }, { "https://", 0x04 }, { "http://", 0x03 },
+    };
+    uint8_t payload_head[3];
+    size_t head_len;
+
+    if (uri) {
+        payload_head[0] = 0x00;
+        for (size_t i = 0; i < sizeof(prefixes) / sizeof(prefixes[0]); i++) {
+            size_t plen = strlen(prefixes[i].prefix);
+            if (len >= plen && memcmp(value, prefixes[i].prefix, plen) == 0) {
+                payload_head[0] = prefixes[i].code;
+                value += plen;
+                len -= plen;
+                break;
+            }
+        }
+        head_len = 1;
+    } else {
+        payload_head[0] = 0x02;         // UTF-8, idioma de 2 letras
+        payload_head[1] = 'p';
+        payload_head[2] = 't';
+        head_len = 3;
+    }
+
+    size_t payload_len = head_len + len;
+    size_t record_len = 4 + payload_len;
+    if (record_len + 3 > sizeof(cmd->data)) return false;
+
+    uint8_t *p = cmd->data;
+    *p++ = 0x03;                        // TLV: mensagem NDEF
+    *p++ = (uint8_t)record_len;
+    *p++ = 0xD1;                        // MB | ME | SR, TNF conhecido
+    *p++ = 0x01;
+    *p++ = (uint8_t)payload_len;
+    *p++ = uri ? 'U' : 'T';
+    memcpy(p, payload_head, head_len);
+    p += head_len;
+    memcpy(p, value, len);
+    p += len;
+    *p++ = 0xFE;                        // TLV terminador
+
+    size_t n = p - cmd->data;
+    while (n % 4) cmd->data[n++] = 0x00;
+    cmd->data_len = (uint8_t)n;
+    return true;
+}
+
+/**
+ * Preenche 'cmd' com os itens do texto. Em erro, 'cmd->error' diz por quê.
+ * @return false se o comando é inválido.
+ */
+static bool parse_command(const char *text, size_t len, card_cmd_t *cmd, const char **reader,
+                          size_t *reader_len) {
+    size_t pos = 0;
+    long v;
+
+    memset(cmd, 0, sizeof(*cmd));
+    memset(cmd->key.keybyte, 0xFF, MF_KEY_SIZE);
+    cmd->key_cmd = PICC_CMD_MF_AUTH_KEY_A;
+    cmd->count = 1;
+    cmd->op = 0xFF;
+    cmd->deadline_ms = now_ms() + TIMEOUT_DEFAULT_S * 1000;
+    *reader = NULL;
+    *reader_len = 0;
+
+    while (pos < len) {
+        size_t end = pos;
+        while (end < len && text[end] != ';' && text[end] != '\n') end++;
+        const char *item = text + pos;
+        size_t item_len = end - pos;
+        pos = end + 1;
+        while (item_len && (item[item_len - 1] == ' ' || item[item_len - 1] == '\r')) item_len--;
+        if (item_len == 0) continue;
+
+        const char *eq = memchr(item, '=', item_len);
+        if (eq == NULL) {
+            cmd->error = "item sem '='";
+            return false;
+        }
+        size_t key_len = eq - item;
+        const char *val = eq + 1;
+        size_t val_len = item_len - key_len - 1;
+
+        if (item_is(item, key_len, "req")) {
+            if (val_len >= sizeof(cmd->req)) val_len = sizeof(cmd->req) - 1;
+            memcpy(cmd->req, val, val_len);
+        } else if (item_is(item, key_len, "reader")) {
+            *reader = val;
+            *reader_len = val_len;
+        } else if (item_is(item, key_len, "op")) {
+            for (size_t i = 0; i < sizeof(op_names) / sizeof(op_names[0]); i++) {
+                if (item_is(val, val_len, op_names[i])) cmd->op = (uint8_t)i;
+            }
+        } else if (item_is(item, key_len, "uid")) {
+            cmd->uid_size = tag_map_parse_uid(val, val_len, cmd->uid);
+            if (cmd->uid_size == 0) {
+                cmd->error = "uid invalido";
+                return false;
+            }
+        } else if (item_is(item, key_len, "timeout")) {
+            if (!parse_long(val, val_len, 1, TIMEOUT_MAX_S, &v)) {
+                cmd->error = "timeout invalido";
+                return false;
+            }
+            cmd->deadline_ms = now_ms() + (uint32_t)v * 1000;
+        } else if (item_is(item, key_len, "block") || item_is(item, key_len, "page")) {
+            if (!parse_long(val, val_len, 0, 255, &v)) {
+                cmd->error = "endereco invalido";
+                return false;
+            }
+            cmd->addr = (uint8_t)v;
+        } else if (item_is(item, key_len, "count")) {
+            if (!parse_long(val, val_len, 1, 16, &v)) {
+                cmd->error = "count invalido";
+                return false;
+            }
+            cmd->count = (uint8_t)v;
+        } else if (item_is(item, key_len, "key")) {
+            if (parse_hex(val, val_len, cmd->key.keybyte, MF_KEY_SIZE) != MF_KEY_SIZE) {
+                cmd->error = "key deve ter 6 bytes";
+                return false;
+            }
+        } else if (item_is(item, key_len, "keytype")) {
+            if (!item_is(val, val_len, "A") && !item_is(val, val_len, "B")) {
+                cmd->error = "keytype deve ser A ou B";
+                return false;
+            }
+            cmd->key_cmd = val[0] == 'B' ? PICC_CMD_MF_AUTH_KEY_B : PICC_CMD_MF_AUTH_KEY_A;
+        } else if (item_is(item, key_len, "pwd")) {
+            if (parse_hex(val, val_len, cmd->pwd, sizeof(cmd->pwd)) != sizeof(cmd->pwd)) {
+                cmd->error = "pwd deve ter 4 bytes";
+                return false;
+            }
+            cmd->has_pwd = true;
+        } else if (item_is(item, key_len, "data")) {
+            int n = parse_hex(val, val_len, cmd->data, READ_BLOCKS_MAX * 16);
+            if (n <= 0) {
+                cmd->error = "data invalido (hexadecimal, ate 64 bytes)";
+                return false;
+            }
+            cmd->data_len = (uint8_t)n;
+        } else if (item_is(item, key_len, "value") || item_is(item, key_len, "delta")) {
+            if (!parse_long(val, val_len, -2147483647L, 2147483647L, &v)) {
+                cmd->error = "valor invalido";
+                return false;
+            }
+            cmd->value = (int32_t)v;
+        } else if (item_is(item, key_len, "uri") || item_is(item, key_len, "text")) {
+            if (!encode_ndef(cmd, item[0] == 'u', val, val_len)) {
+                cmd->error = "mensagem NDEF grande demais";
+                return false;
+            }
+        } else if (item_is(item, key_len, "ctr") || item_is(item, key_len, "mac")) {
+            // Conferidos em card_ops_submit
+        } else {
+            cmd->error = "item desconhecido";
+            return false;
+        }
+    }
+
+    if (cmd->op == 0xFF) {
+        cmd->error = "op invalida";
+        return false;
+    }
+    if ((cmd->op == OP_WRITE || cmd->op == OP_NDEF) && cmd->data_len == 0) {
+        cmd->error = cmd->op == OP_NDEF ? "ndef exige uri= ou text=" : "write exige data=";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Com auth_mode, o comando termina em ";ctr=N;mac=HEX" (event_auth_check_command)
+ * e o contador cresce sempre (replay).
+ * @return O comprimento do texto assinado, o único interpretado; -1 se recusado.
+ */
+static int check_auth(const char *topic, const char *text, uint32_t len, uint64_t *ctr) {
+    int signed_len = event_auth_check_command(topic, text, len, ctr);
+    if (signed_len < 0) return -1;
+
+    lock();
+    bool fresh = *ctr > last_ctr;
+    if (fresh) last_ctr = *ctr;
+    unlock();
+    return fresh ? signed_len : -1;
+}
+
+// --- Contador na flash ---
+
+/**
+ * O setor é um log de contadores de 64 bits, como a época de event_auth:
+ * cada comando aceito programa a próxima posição apagada, e o setor só é
+ * apagado a cada 511 comandos. Programar só zera bits, então uma gravação
+ * interrompida deixa um valor maior ou igual ao pretendido. A primeira
+ * posição guarda CTR_MAGIC: sem ela (setor de uma imagem antiga), o log
+ * conta como vazio e é apagado na primeira gravação.
+ */
+static uint64_t ctr_page[FLASH_PAGE_SIZE / sizeof(uint64_t)];
+static uint32_t ctr_page_offset;
+static bool ctr_erase;
+
+// Executada com o outro core e as interrupções pausados por flash_safe_execute
+static void program_ctr(void *param) {
+    (void)param;
+    if (ctr_erase) {
+        flash_range_erase(FLASH_CARD_CTR_OFFSET, FLASH_CARD_CTR_SIZE);
+    }
+    flash_range_program(ctr_page_offset, (const uint8_t *)ctr_page, FLASH_PAGE_SIZE);
+}
+
+// Posições ocupadas, com a da marca; 0 se o setor não tem o log
+static uint32_t ctr_used(void) {
+    const uint64_t *log = (const uint64_t *)FLASH_XIP_PTR(FLASH_CARD_CTR_OFFSET);
+    if (log[0] != CTR_MAGIC) return 0;
+    uint32_t used = 1;
+    while (used < CTR_SLOTS && log[used] != CTR_EMPTY) used++;
+    return used;
+}
+
+static int save_ctr(uint64_t ctr) {
+    uint32_t slot = ctr_used();
+    ctr_erase = slot == 0 || slot == CTR_SLOTS;
+
+    // Posições em 0xFF não alteram as já gravadas da mesma página
+    const uint32_t per_page = FLASH_PAGE_SIZE / sizeof(uint64_t);
+    memset(ctr_page, 0xFF, sizeof(ctr_page));
+    if (ctr_erase) {
+        ctr_page[0] = CTR_MAGIC;
+        slot = 1;
+    }
+    ctr_page[slot % per_page] = ctr;
+    ctr_page_offset = FLASH_CARD_CTR_OFFSET + (slot / per_page) * FLASH_PAGE_SIZE;
+
+    int rc = flash_safe_execute(program_ctr, NULL, 1000);
+    if (rc != PICO_OK) {
+        printf("[CARD] ERRO ao gravar o contador na flash! Codigo: %d\n", rc);
+        return -1;
+    }
+    return 0;
+}
+
+void card_ops_init(void) {
+    uint32_t used = ctr_used();
+    if (used > 1) {
+        const uint64_t *log = (const uint64_t *)FLASH_XIP_PTR(FLASH_CARD_CTR_OFFSET);
+        last_ctr = saved_ctr = log[used - 1];
+    }
+}
+
+static bool is_write(uint8_t op) {
+    return op == OP_WRITE || op == OP_NDEF || op == OP_SETVALUE || op == OP_INC || op == OP_DEC;
+}
+
+int card_ops_submit(const char *topic, const char *text, uint32_t len) {
+    const rfid_config_t *cfg = rfid_config();
+    card_cmd_t cmd;
+    const char *reader;
+    size_t reader_len;
+    uint64_t ctr = 0;
+
+    if (event_auth_enabled()) {
+        int signed_len = check_auth(topic, text, len, &ctr);
+        if (signed_len < 0) {
+            printf("[CARD] Comando recusado: MAC invalido, itens apos o MAC ou contador repetido\n");
+            rejected++;
+            return -1;
+        }
+        len = (uint32_t)signed_len;
+    }
+
+    bool valid = parse_command(text, len, &cmd, &reader, &reader_len);
+    cmd.ctr = ctr;
+
+    // Comando para outro leitor: nem responde
+    if (reader != NULL && (reader_len != strlen(cfg->mqtt_client_id) ||
+                           memcmp(reader, cfg->mqtt_client_id, reader_len) != 0)) {
+        return 0;
+    }
+
+    if (valid && is_write(cmd.op) && cfg->card_ops < 2) {
+        valid = false;
+        cmd.error = "escritas desligadas (card_ops 1)";
+    }
+    if (!valid) {
+        cmd.status = "invalid";
+        rejected++;
+    }
+
+    lock();
+    int slot = -1;
+    for (int i = 0; i < CARD_OPS_MAX; i++) {
+        if (slots[i].state == SLOT_FREE) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot >= 0) {
+        slots[slot] = cmd;
+        slots[slot].state = valid ? SLOT_PENDING : SLOT_DONE;
+    }
+    unlock();
+
+    if (slot < 0) {
+        printf("[CARD] Comando '%s' descartado: %d comandos ja pendentes\n", cmd.req, CARD_OPS_MAX);
+        rejected++;
+        return -1;
+    }
+    if (!valid) {
+        printf("[CARD] Comando '%s' invalido: %s\n", cmd.req, cmd.error);
+        return -1;
+    }
+    printf("[CARD] Comando '%s' (%s) aguardando cartao\n", cmd.req, op_names[cmd.op]);
+    return 0;
+}
+
+// --- Execução (caminho de RF) ---
+
+static bool is_classic(uint8_t type) {
+    return type == PICC_TYPE_MIFARE_MINI || type == PICC_TYPE_MIFARE_1K ||
+           type == PICC_TYPE_MIFARE_4K;
+}
+
+// Bloco trailer do setor (chaves e bits de acesso): 4 blocos por setor até
+// o 127, 16 a partir do 128 (MIFARE 4K)
+static uint8_t sector_trailer(uint8_t block) {
+    return block < 128 ? (block | 0x03) : (block | 0x0F);
+}
+
+static StatusCode authenticate(MFRC522Ptr_t mfrc, card_cmd_t *cmd, uint8_t block,
+                               int *authed_trailer) {
+    uint8_t trailer = sector_trailer(block);
+    if (*authed_trailer == trailer) return STATUS_OK;
+    StatusCode st = PCD_Authenticate(mfrc, cmd->key_cmd, trailer, &cmd->key, &mfrc->uid);
+    if (st == STATUS_OK) *authed_trailer = trailer;
+    return st;
+}
+
+static StatusCode run_classic(MFRC522Ptr_t mfrc, card_cmd_t *cmd) {
+    int authed = -1;
+    uint8_t buf[18];
+    StatusCode st = STATUS_OK;
+    long value;
+
+    switch (cmd->op) {
+        case OP_READ:
+            if (cmd->count > READ_BLOCKS_MAX) {
+                cmd->error = "count ate 4 blocos";
+                return STATUS_INVALID;
+            }
+            cmd->data_len = 0;
+            for (uint8_t i = 0; i < cmd->count && st == STATUS_OK; i++) {
+                uint8_t size = sizeof(buf);
+                st = authenticate(mfrc, cmd, cmd->addr + i, &authed);
+                if (st == STATUS_OK) st = MIFARE_Read(mfrc, cmd->addr + i, buf, &size);
+                if (st == STATUS_OK) {
+                    memcpy(cmd->data + cmd->data_len, buf, 16);
+                    cmd->data_len += 16;
+                }
+            }
+            return st;
+
+        case OP_WRITE:
+            if (cmd->data_len % 16 != 0) {
+                cmd->error = "data deve ter 16 bytes por bloco";
+                return STATUS_INVALID;
+            }
+            for (uint8_t i = 0; i < cmd->data_len / 16; i++) {
+                uint8_t block = cmd->addr + i;
+                if (block == 0 || block == sector_trailer(block)) {
+                    cmd->error = "bloco 0 e trailers de setor nao sao escritos";
+                    return STATUS_INVALID;
+                }
+            }
+            for (uint8_t i = 0; i < cmd->data_len / 16 && st == STATUS_OK; i++) {
+                st = authenticate(mfrc, cmd, cmd->addr + i, &authed);
+                if (st == STATUS_OK) st = MIFARE_Write(mfrc, cmd->addr + i, cmd->data + 16 * i, 16);
+            }
+            cmd->data_len = 0;
+            return st;
+
+        case OP_VALUE:
+        case OP_SETVALUE:
+        case OP_INC:
+        case OP_DEC:
+            if (cmd->addr == 0 || cmd->addr == sector_trailer(cmd->addr)) {
+                cmd->error = "bloco 0 e trailers de setor nao guardam valor";
+                return STATUS_INVALID;
+            }
+            cmd->data_len = 0;
+            st = authenticate(mfrc, cmd, cmd->addr, &authed);
+            if (st == STATUS_OK && cmd->op == OP_SETVALUE) {
+                st = MIFARE_SetValue(mfrc, cmd->addr, cmd->value);
+            } else if (st == STATUS_OK && (cmd->op == OP_INC || cmd->op == OP_DEC)) {
+                st = cmd->op == OP_INC ? MIFARE_Increment(mfrc, cmd->addr, cmd->value)
+                                       : MIFARE_Decrement(mfrc, cmd->addr, cmd->value);
+                if (st == STATUS_OK) st = MIFARE_Transfer(mfrc, cmd->addr);
+            }
+            if (st == STATUS_OK) st = MIFARE_GetValue(mfrc, cmd->addr, &value);
+            if (st == STATUS_OK) {
+                cmd->value = (int32_t)value;
+                cmd->has_value = true;
+            }
+            return st;
+
+        case OP_NDEF:
+            cmd->error = "ndef so em Ultralight/NTAG";
+            return STATUS_INVALID;
+
+        default:
+            return STATUS_OK;
+    }
+}
+
+/**
+ * Última página de dados do usuário, pelo GET_VERSION (tamanho da memória).
+ * Depois dela ficam o lock dinâmico, CFG0/CFG1, PWD e PACK (NTAG21x e
+ * Ultralight EV1), que travariam a tag ou trocariam a senha para sempre.
+ * Sem GET_VERSION (Ultralight, Ultralight C) ou com tamanho desconhecido,
+ * vale a área do Ultralight, que existe em todos.
+ * @return 0 se o cartão não voltou a responder.
+ */
+static uint8_t ultralight_last_user_page(MFRC522Ptr_t mfrc) {
+    uint8_t cmd[3] = { UL_GET_VERSION };
+    uint8_t version[10];
+    uint8_t size = sizeof(version);
+
+    if (PCD_CalculateCRC(mfrc, cmd, 1, &cmd[1]) == STATUS_OK &&
+        PCD_TransceiveData(mfrc, cmd, sizeof(cmd), version, &size, NULL, 0, true) == STATUS_OK &&
+        size >= 8 && version[1] == 0x04 && (version[2] == 0x03 || version[2] == 0x04)) {
+        switch (version[6]) {
+            case 0x0B: return 15;       // Ultralight EV1 MF0UL11, NTAG210
+            case 0x0E: return 35;       // Ultralight EV1 MF0UL21, NTAG212
+            case 0x0F: return 39;       // NTAG213
+            case 0x11: return 129;      // NTAG215
+            case 0x13: return 225;      // NTAG216
+            default: return UL_LAST_USER_PAGE;
+        }
+    }
+
+    // Recusado (NAK ou silêncio): a tag volta ao IDLE e precisa ser selecionada de novo
+    uint8_t atqa[2];
+    uint8_t atqa_size = sizeof(atqa);
+    if (PICC_WakeupA(mfrc, atqa, &atqa_size) != STATUS_OK ||
+        PICC_Select(mfrc, &mfrc->uid, 0) != STATUS_OK) {
+        return 0;
+    }
+    return UL_LAST_USER_PAGE;
+}
+
+static StatusCode run_ultralight(MFRC522Ptr_t mfrc, card_cmd_t *cmd) {
+    uint8_t buf[18];
+    uint8_t pack[2];
+    StatusCode st = STATUS_OK;
+    uint8_t last_page = 0;
+
+    // Antes da senha: se o GET_VERSION falhar, a seleção refeita perde a autenticação
+    if (cmd->op == OP_WRITE || cmd->op == OP_NDEF) {
+        last_page = ultralight_last_user_page(mfrc);
+        if (last_page == 0) return STATUS_TIMEOUT;
+    }
+
+    if (cmd->has_pwd) {
+        st = PCD_NTAG216_AUTH(mfrc, cmd->pwd, pack);
+        if (st != STATUS_OK) return st;
+    }
+
+    switch (cmd->op) {
+        case OP_READ:
+            // Cada READ devolve 4 páginas
+            cmd->data_len = 0;
+            for (uint8_t page = 0; page < cmd->count && st == STATUS_OK; page += 4) {
+                uint8_t size = sizeof(buf);
+                st = MIFARE_Read(mfrc, cmd->addr + page, buf, &size);
+                if (st == STATUS_OK) {
+                    uint8_t n = (uint8_t)(cmd->count - page < 4 ? cmd->count - page : 4) * 4;
+                    memcpy(cmd->data + cmd->data_len, buf, n);
+                    cmd->data_len += n;
+                }
+            }
+            return st;
+
+        case OP_NDEF:
+            cmd->addr = FIRST_USER_PAGE;
+            // fall through
+        case OP_WRITE: {
+            if (cmd->data_len % 4 != 0) {
+                cmd->error = "data deve ter 4 bytes por pagina";
+                return STATUS_INVALID;
+            }
+            if (cmd->addr < FIRST_USER_PAGE) {
+                cmd->error = "paginas 0-3 nao sao escritas";
+                return STATUS_INVALID;
+            }
+            uint8_t pages = cmd->data_len / 4;
+            if (cmd->addr + pages - 1 > last_page) {
+                cmd->error = "so paginas de dados do usuario (lock, CFG, PWD e PACK protegidos)";
+                return STATUS_INVALID;
+            }
+            // A primeira página por último: uma escrita interrompida não
+            // deixa um TLV válido apontando para dados pela metade
+            for (uint8_t i = 1; i <= pages && st == STATUS_OK; i++) {
+                uint8_t p = i % pages;
+                st = MIFARE_Ultralight_Write(mfrc, cmd->addr + p, cmd->data + 4 * p, 4);
+            }
+            cmd->data_len = 0;
+            return st;
+        }
+
+        case OP_INFO:
+            return STATUS_OK;
+
+        default:
+            cmd->error = "operacoes de valor so em MIFARE Classic";
+            return STATUS_INVALID;
+    }
+}
+
+static void execute(MFRC522Ptr_t mfrc, card_cmd_t *cmd) {
+    cmd->card_uid_size = mfrc->uid.size;
+    memcpy(cmd->card_uid, mfrc->uid.uidByte, mfrc->uid.size);
+    cmd->card_type = PICC_GetType(mfrc->uid.sak);
+
+    StatusCode st;
+    if (is_classic(cmd->card_type)) {
+        st = run_classic(mfrc, cmd);
+    } else if (cmd->card_type == PICC_TYPE_MIFARE_UL) {
+        st = run_ultralight(mfrc, cmd);
+    } else if (cmd->op == OP_INFO) {
+        st = STATUS_OK;
+    } else {
+        cmd->error = "tipo de cartao nao suportado";
+        st = STATUS_INVALID;
+    }
+
+    if (st == STATUS_OK) {
+        cmd->status = "ok";
+        executed++;
+    } else {
+        cmd->status = "error";
+        if (cmd->error == NULL) cmd->error = GetStatusCodeName(st);
+        cmd->data_len = 0;
+        failed++;
+    }
+}
+
+bool card_ops_on_card(MFRC522Ptr_t mfrc) {
+    card_cmd_t *cmd = NULL;
+
+    lock();
+    for (int i = 0; i < CARD_OPS_MAX && cmd == NULL; i++) {
+        card_cmd_t *s = &slots[i];
+        // Só executa com o contador já na flash (card_ops_publish)
+        if (s->state == SLOT_PENDING && s->ctr <= saved_ctr &&
+            (s->uid_size == 0 ||
+             (s->uid_size == mfrc->uid.size && memcmp(s->uid, mfrc->uid.uidByte, s->uid_size) == 0))) {
+            s->state = SLOT_RUNNING;
+            cmd = s;
+        }
+    }
+    unlock();
+    if (cmd == NULL) return false;
+
+    // Fora do lock: as trocas com o cartão levam alguns ms
+    execute(mfrc, cmd);
+
+    lock();
+    cmd->state = SLOT_DONE;
+    unlock();
+    return true;
+}
+
+// --- Resposta ---
+
+static void hex_string(const uint8_t *data, size_t len, char *out) {
+    for (size_t i = 0; i < len; i++) sprintf(out + 2 * i, "%02X", data[i]);
+    out[2 * len] = '\0';
+}
+
+static int format_reply(const card_cmd_t *cmd, char *buf, size_t size) {
+    char uid[2 * EVENT_UID_MAX + 1];
+    char data[2 * CARD_OPS_DATA_MAX + 1];
+    hex_string(cmd->card_uid, cmd->card_uid_size, uid);
+    hex_string(cmd->data, cmd->data_len, data);
+
+    int len = snprintf(buf, size, "{\"req\":\"%s\",\"op\":\"%s\",\"status\":\"%s\"",
+                       cmd->req, cmd->op < sizeof(op_names) / sizeof(op_names[0]) ?
+                       op_names[cmd->op] : "?", cmd->status);
+    if (cmd->card_uid_size > 0) {
+        len += snprintf(buf + len, size - len, ",\"uid\":\"%s\",\"type\":\"%s\"", uid,
+                        PICC_GetTypeName((PICC_Type)cmd->card_type));
+    }
+    if (cmd->data_len > 0) {
+        len += snprintf(buf + len, size - len, ",\"data\":\"%s\"", data);
+    }
+    if (cmd->has_value) {
+        len += snprintf(buf + len, size - len, ",\"value\":%ld", (long)cmd->value);
+    }
+    if (cmd->error != NULL) {
+        len += snprintf(buf + len, size - len, ",\"error\":\"%s\"", cmd->error);
+    }
+    len += snprintf(buf + len, size - len, ",\"client\":\"%s\",\"reader\":\"PicoW\"}",
+                    rfid_config()->mqtt_client_id);
+    return len;
+}
+
+void card_ops_publish(void) {
+    const rfid_config_t *cfg = rfid_config();
+    uint32_t now = now_ms();
+
+    // Contador do último comando aceito na flash antes de qualquer execução:
+    // nenhum comando (nem os expirados ou de outro leitor) volta após um reboot
+    lock();
+    uint64_t ctr = last_ctr;
+    unlock();
+    if (ctr > saved_ctr && ctr != unsaved_ctr) {
+        if (save_ctr(ctr) == 0) {
+            lock();     // 64 bits: lido pelo caminho de RF no outro core
+            saved_ctr = ctr;
+            unlock();
+        } else {
+            unsaved_ctr = ctr;
+        }
+    }
+
+    for (int i = 0; i < CARD_OPS_MAX; i++) {
+        card_cmd_t *cmd = &slots[i];
+
+        lock();
+        if (cmd->state == SLOT_PENDING && cmd->ctr > saved_ctr && cmd->ctr <= unsaved_ctr) {
+            cmd->status = "error";
+            cmd->error = "contador nao gravado na flash";
+            cmd->state = SLOT_DONE;
+            failed++;
+        }
+        if (cmd->state == SLOT_PENDING && (int32_t)(now - cmd->deadline_ms) >= 0) {
+            cmd->status = "timeout";
+            cmd->error = "nenhum cartao no campo";
+            cmd->state = SLOT_DONE;
+            expired++;
+        }
+        bool done = cmd->state == SLOT_DONE;
+        unlock();
+        if (!done || !link_supervisor_online()) continue;
+
+        char payload[384 + EVENT_AUTH_OVERHEAD];
+        int len = format_reply(cmd, payload, sizeof(payload) - EVENT_AUTH_OVERHEAD);
+        event_auth_sign(cfg->topic_reply, payload, len, sizeof(payload));
+
+        if (!link_supervisor_publish(cfg->topic_reply, payload, 1)) break;
+        printf("[CARD] Resposta em %s: %s\n", cfg->topic_reply, payload);
+
+        lock();
+        cmd->state = SLOT_FREE;
+        unlock();
+    }
+}
+
+void card_ops_print(void) {
+    const rfid_config_t *cfg = rfid_config();
+    static const char *const modes[] = { "desligado", "so leitura", "leitura e escrita" };
+
+    printf("[CARD] Modo: %s, comandos em %s, respostas em %s\n",
+           modes[cfg->card_ops < 3 ? cfg->card_ops : 0], cfg->topic_cmd, cfg->topic_reply);
+    printf("[CARD] %lu executados, %lu com erro, %lu expirados, %lu recusados\n",
+           (unsigned long)executed, (unsigned long)failed, (unsigned long)expired,
+           (unsigned long)rejected);
+
+    // Cópia sob o lock; o printf fica fora dele
+    card_cmd_t pending[CARD_OPS_MAX];
+    int n = 0;
+    lock();
+    for (int i = 0; i < CARD_OPS_MAX; i++) {
+        if (slots[i].state == SLOT_PENDING) pending[n++] = slots[i];
+    }
+    unlock();
+
+    uint32_t now = now_ms();
+    for (int i = 0; i < n; i++) {
+        printf("[CARD] Pendente '%s': %s, expira em %ld s\n", pending[i].req,
+               op_names[pending[i].op], (long)(int32_t)(pending[i].deadline_ms - now) / 1000);
+    }
+}
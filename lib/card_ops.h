@@ -0,0 +1,83 @@
+/**
+ * card_ops.h
+ *
+ * Operações remotas em cartões: o backend publica um comando em
+ * 'topic_cmd' e o leitor o executa no próximo cartão que entrar no campo
+ * (ou num UID específico), pelo caminho de RF, publicando o resultado em
+ * 'topic_reply'. Provisionamento e auditoria sem acesso físico ao leitor.
+ *
+ * Comando em texto "chave=valor" separados por ';' (como o mapa de tags):
+ *
+ *   req=42;op=read;block=4;count=2;key=FFFFFFFFFFFF
+ *   req=43;op=write;uid=04AABBCCDDEEFF;page=4;data=DEADBEEF
+ *   req=44;op=ndef;uri=https://exemplo.com/agv/7
+ *   req=45;op=inc;block=5;delta=10;keytype=B;key=A0A1A2A3A4A5
+ *
+ *  - req: identificador devolvido na resposta (até 15 caracteres);
+ *  - reader: só no leitor com este mqtt_client_id (padrão: todos);
+ *  - uid: só neste cartão (padrão: o próximo); timeout: segundos (30);
+ *  - op: info | read | write | ndef | value | setvalue | inc | dec.
+ *    MIFARE Classic: block, count (até 4 blocos), key e keytype (A/B, padrão
+ *    FFFFFFFFFFFF/A), data (16 bytes por bloco), value, delta.
+ *    Ultralight/NTAG: page, count (até 16), data (4 bytes por página), pwd
+ *    (NTAG21x), ndef com uri= ou text=.
+ *
+ * Blocos de setor (trailer e bloco 0) e páginas 0-3 nunca são escritos; no
+ * Ultralight/NTAG, só as páginas de dados do usuário do chip detectado (o
+ * lock dinâmico, CFG0/CFG1, PWD e PACK do NTAG21x ficam de fora).
+ * card_ops 1 aceita só info/read/value; 2 aceita também as escritas. Com
+ * auth_mode, o comando termina em ";ctr=N;mac=HEX" (MAC de event_auth sobre
+ * tópico + '\n' + o texto antes de ";mac=") e ctr cresce a cada comando
+ * (ex: tempo Unix em µs no backend). Nada depois do MAC é aceito, e só o
+ * texto assinado é interpretado. O último contador aceito vai para a flash
+ * antes de o comando ser executado, então um comando capturado não é
+ * aceito de novo nem depois de reiniciar.
+ *
+ * Resposta (JSON, assinada como os eventos):
+ *   {"req":"42","op":"read","status":"ok","uid":"04AABBCC","type":"MIFARE 1KB",
+ *    "data":"...","client":"PicoW-1","reader":"PicoW"}
+ */
+
+#ifndef CARD_OPS_H
+#define CARD_OPS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "mfrc522.h"
+
+#define CARD_OPS_MAX        4       // Comandos aguardando cartão
+#define CARD_OPS_DATA_MAX   128     // Mensagem NDEF; leituras e data= até 64 bytes
+
+/**
+ * @brief Carrega da flash o último contador aceito (com auth_mode).
+ */
+void card_ops_init(void);
+
+/**
+ * @brief Recebe um comando (contexto do lwIP). Comandos inválidos ou não
+ * permitidos já saem com a resposta de erro.
+ * @return 0 se aceito, -1 se recusado.
+ */
+int card_ops_submit(const char *topic, const char *text, uint32_t len);
+
+/**
+ * @brief Executa o comando pendente que vale para o cartão selecionado
+ * (chamar pelo caminho de RF logo após PICC_ReadCardSerial, antes de
+ * PCD_StopCrypto1).
+ * @return true se algum comando foi executado.
+ */
+bool card_ops_on_card(MFRC522Ptr_t mfrc);
+
+/**
+ * @brief Grava o contador dos comandos aceitos e publica as respostas
+ * prontas e as de comandos que expiraram (contexto de publicação).
+ */
+void card_ops_publish(void);
+
+/**
+ * @brief Imprime os comandos pendentes e os contadores (comando 'cards').
+ */
+void card_ops_print(void);
+
+#endif // CARD_OPS_H
@@ -0,0 +1,313 @@
+#include "crash_dump.h"
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "pico/critical_section.h"
+#include "hardware/flash.h"
+#include "hardware/structs/timer.h"
+#include "flash_layout.h"
+#include "rfid_config.h"
+#include "supervisor.h"
+#include "event_auth.h"
+#include "link_supervisor.h"
+
+#define CRASH_MAGIC         0x48535243u // "CRSH"
+#define RECORD_PAGES        ((sizeof(crash_record_t) + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE)
+#define SENT_MARK_OFFSET    (RECORD_PAGES * FLASH_PAGE_SIZE)    // Byte 0x00: já publicado
+
+_Static_assert(SENT_MARK_OFFSET + FLASH_PAGE_SIZE <= FLASH_CRASH_SIZE,
+               "registro de crash maior que o setor");
+
+// Limites da imagem em execução (script do linker do SDK)
+extern char __flash_binary_start;
+extern char __flash_binary_end;
+
+static const char *const trace_names[CRASH_TRACE_COUNT] = {
+    [CRASH_TRACE_BOOT] = "boot",
+    [CRASH_TRACE_TAG] = "tag",
+    [CRASH_TRACE_LINK] = "link",
+    [CRASH_TRACE_RX] = "rx",
+};
+
+// Registro da falha: fora da área que o crt0 zera, sobrevive ao reset.
+// Com RFID_OTA, o bootloader usa o começo da RAM; se um dia alcançar este
+// registro, o CRC falha e o crash só aparece como reset_reason
+static crash_record_t __uninitialized_ram(fault_record);
+
+// r4-r11 no momento da falha (gravados pelo tratador em assembly)
+uint32_t crash_high_regs[8];
+
+// Anel de rastreio: só o boot atual (a cópia vai para o registro na falha)
+static crash_trace_t trace_ring[CRASH_TRACE_LEN];
+static uint32_t trace_head = 0;     // Total de eventos registrados
+
+static critical_section_t trace_lock;
+static bool lock_ready = false;
+
+// Registro em RAM para gravar na flash (página inteira)
+static uint8_t flash_buf[RECORD_PAGES * FLASH_PAGE_SIZE];
+
+// --- Rastreio ---
+
+void crash_trace(crash_trace_id_t id, uint32_t arg) {
+    if (!lock_ready) {
+        critical_section_init(&trace_lock);
+        lock_ready = true;
+    }
+    critical_section_enter_blocking(&trace_lock);
+    crash_trace_t *e = &trace_ring[trace_head % CRASH_TRACE_LEN];
+    e->ms = to_ms_since_boot(get_absolute_time());
+    e->id = (uint8_t)id;
+    e->core = (uint8_t)get_core_num();
+    e->reserved = 0;
+    e->arg = arg;
+    trace_head++;
+    critical_section_exit(&trace_lock);
+}
+
+// --- Captura (contexto de HardFault) ---
+
+static bool in_ram(uint32_t addr, uint32_t size) {
+    return addr >= SRAM_BASE && addr <= SRAM_END - size;
+}
+
+/**
+ * Monta o registro e reinicia. Sem printf, locks nem flash: o sistema
+ * pode estar em qualquer estado (inclusive com o outro core rodando).
+ */
+void __attribute__((used, noreturn)) crash_fault(const uint32_t *frame, uint32_t exc_return) {
+    crash_record_t *rec = &fault_record;
+    memset(rec, 0, sizeof(*rec));
+
+    rec->uptime_ms = (uint32_t)(timer_hw->timerawl / 1000);
+    rec->image_size = (uint32_t)(&__flash_binary_end - &__flash_binary_start);
+    rec->exc_return = exc_return;
+    rec->core = (uint8_t)get_core_num();
+    rec->phase = (uint8_t)supervisor_get_phase();
+    memcpy(&rec->r[4], crash_high_regs, sizeof(crash_high_regs));
+
+    // Quadro empilhado pelo hardware: r0-r3, r12, lr, pc, xPSR
+    if (in_ram((uint32_t)frame, 8 * sizeof(uint32_t))) {
+        memcpy(&rec->r[0], frame, 4 * sizeof(uint32_t));
+        rec->r[12] = frame[4];
+        rec->lr = frame[5];
+        rec->pc = frame[6];
+        rec->xpsr = frame[7];
+
+        // sp da função que falhou: depois do quadro (e do alinhamento, bit 9)
+        rec->sp = (uint32_t)(frame + 8) + ((rec->xpsr & (1u << 9)) ? 4 : 0);
+        const uint32_t *stack = (const uint32_t *)rec->sp;
+        while (rec->stack_words < CRASH_STACK_WORDS &&
+               in_ram((uint32_t)&stack[rec->stack_words], sizeof(uint32_t))) {
+            rec->stack[rec->stack_words] = stack[rec->stack_words];
+            rec->stack_words++;
+        }
+    }
+
+    uint32_t head = trace_head;
+    uint32_t count = head < CRASH_TRACE_SAVED ? head : CRASH_TRACE_SAVED;
+    for (uint32_t i = 0; i < count; i++) {
+        rec->trace[i] = trace_ring[(head - count + i) % CRASH_TRACE_LEN];
+    }
+    rec->trace_count = (uint8_t)count;
+
+    rec->magic = CRASH_MAGIC;
+    rec->crc = rfid_crc32(rec, offsetof(crash_record_t, crc));
+    supervisor_fault_reset();
+}
+
+/**
+ * Substitui o tratador padrão do SDK (que só para no bkpt): separa a pilha
+ * ativa (MSP ou PSP, bit 2 do EXC_RETURN), guarda r4-r11 e segue em C
+ */
+void __attribute__((naked)) isr_hardfault(void) {
+    __asm volatile(
+        "movs r0, #4\n"
+        "mov r1, lr\n"
+        "tst r0, r1\n"
+        "beq 1f\n"
+        "mrs r0, psp\n"
+        "b 2f\n"
+        "1:\n"
+        "mrs r0, msp\n"
+        "2:\n"
+        "ldr r2, =crash_high_regs\n"
+        "stmia r2!, {r4-r7}\n"
+        "mov r4, r8\n"
+        "mov r5, r9\n"
+        "mov r6, r10\n"
+        "mov r7, r11\n"
+        "stmia r2!, {r4-r7}\n"
+        "ldr r2, =crash_fault\n"
+        "bx r2\n"
+        ".ltorg\n");
+}
+
+void crash_dump_test(void) {
+    printf("[CRASH] Provocando HardFault (instrucao indefinida)...\n");
+    sleep_ms(100);  // Deixa o printf sair
+    __asm volatile("udf #0");
+}
+
+// --- Flash ---
+
+static const crash_record_t *stored_record(void) {
+    const crash_record_t *rec = (const crash_record_t *)FLASH_XIP_PTR(FLASH_CRASH_OFFSET);
+    if (rec->magic != CRASH_MAGIC ||
+        rfid_crc32(rec, offsetof(crash_record_t, crc)) != rec->crc) {
+        return NULL;
+    }
+    return rec;
+}
+
+static bool stored_sent(void) {
+    return FLASH_XIP_PTR(FLASH_CRASH_OFFSET)[SENT_MARK_OFFSET] == 0x00;
+}
+
+// Executadas com o outro core e as interrupções pausados por flash_safe_execute
+static void program_record(void *param) {
+    (void)param;
+    flash_range_erase(FLASH_CRASH_OFFSET, FLASH_CRASH_SIZE);
+    flash_range_program(FLASH_CRASH_OFFSET, flash_buf, sizeof(flash_buf));
+}
+
+static void program_sent_mark(void *param) {
+    (void)param;
+    flash_range_program(FLASH_CRASH_OFFSET + SENT_MARK_OFFSET, flash_buf, FLASH_PAGE_SIZE);
+}
+
+bool crash_dump_init(void) {
+    crash_record_t rec = fault_record;
+    bool crashed = rec.magic == CRASH_MAGIC &&
+                   rfid_crc32(&rec, offsetof(crash_record_t, crc)) == rec.crc;
+    fault_record.magic = 0;
+    crash_trace(CRASH_TRACE_BOOT, crashed);
+    if (!crashed) return false;
+
+    const crash_record_t *prev = stored_record();
+    rec.seq = prev != NULL ? prev->seq + 1 : 1;
+    rec.crc = rfid_crc32(&rec, offsetof(crash_record_t, crc));
+
+    memset(flash_buf, 0xFF, sizeof(flash_buf));
+    memcpy(flash_buf, &rec, sizeof(rec));
+    int rc = flash_safe_execute(program_record, NULL, 1000);
+    if (rc != PICO_OK) {
+        printf("[CRASH] ERRO ao gravar o registro na flash! Codigo: %d\n", rc);
+    }
+
+    printf("[CRASH] HardFault no boot anterior: pc=0x%08lx lr=0x%08lx core %u, fase %s\n",
+           (unsigned long)rec.pc, (unsigned long)rec.lr, rec.core,
+           supervisor_phase_name((supervisor_phase_t)rec.phase));
+    return true;
+}
+
+// --- Saída ---
+
+static int format_record(const crash_record_t *rec, char *buf, size_t len) {
+    int n = snprintf(buf, len,
+                     "{\"crash\":%lu,\"uptime_ms\":%lu,\"core\":%u,\"phase\":\"%s\","
+                     "\"image_size\":%lu,\"pc\":\"0x%08lx\",\"lr\":\"0x%08lx\","
+                     "\"sp\":\"0x%08lx\",\"xpsr\":\"0x%08lx\",\"exc_return\":\"0x%08lx\",\"r\":[",
+                     (unsigned long)rec->seq, (unsigned long)rec->uptime_ms, rec->core,
+                     supervisor_phase_name((supervisor_phase_t)rec->phase),
+                     (unsigned long)rec->image_size, (unsigned long)rec->pc,
+                     (unsigned long)rec->lr, (unsigned long)rec->sp, (unsigned long)rec->xpsr,
+                     (unsigned long)rec->exc_return);
+    for (int i = 0; i < 13 && n < (int)len; i++) {
+        n += snprintf(buf + n, len - n, "%s\"0x%lx\"", i ? "," : "", (unsigned long)rec->r[i]);
+    }
+    if (n < (int)len) n += snprintf(buf + n, len - n, "],\"stack\":\"");
+
+    // Palavras da pilha em hexadecimal, na ordem dos endereços
+    uint32_t words = rec->stack_words < CRASH_STACK_WORDS ? rec->stack_words : CRASH_STACK_WORDS;
+    for (uint32_t i = 0; i < words && n < (int)len; i++) {
+        n += snprintf(buf + n, len - n, "%08lx", (unsigned long)rec->stack[i]);
+    }
+    if (n < (int)len) n += snprintf(buf + n, len - n, "\",\"trace\":[");
+
+    uint32_t count = rec->trace_count < CRASH_TRACE_SAVED ? rec->trace_count : CRASH_TRACE_SAVED;
+    for (uint32_t i = 0; i < count && n < (int)len; i++) {
+        const crash_trace_t *e = &rec->trace[i];
+        n += snprintf(buf + n, len - n, "%s[%lu,\"%s\",%lu]", i ? "," : "",
+                      (unsigned long)e->ms,
+                      e->id < CRASH_TRACE_COUNT ? trace_names[e->id] : "?",
+                      (unsigned long)e->arg);
+    }
+    if (n < (int)len) n += snprintf(buf + n, len - n, "]");
+    return n;
+}
+
+int crash_dump_format_json(char *buf, size_t len) {
+    const crash_record_t *rec = stored_record();
+    if (rec == NULL) return snprintf(buf, len, "{}");
+
+    int n = format_record(rec, buf, len);
+    if (n < (int)len) n += snprintf(buf + n, len - n, ",\"sent\":%s}",
+                                    stored_sent() ? "true" : "false");
+    return n;
+}
+
+void crash_dump_publish(void) {
+    const rfid_config_t *cfg = rfid_config();
+    const crash_record_t *rec = stored_record();
+
+    if (rec == NULL || stored_sent() || cfg->topic_crash[0] == '\0' ||
+        !link_supervisor_online()) {
+        return;
+    }
+
+    // Estático: maior que a pilha do core 0 permite
+    static char payload[1024 + EVENT_AUTH_OVERHEAD];
+    size_t size = sizeof(payload) - EVENT_AUTH_OVERHEAD;
+    int len = format_record(rec, payload, size);
+    if (len < (int)size) {
+        len += snprintf(payload + len, size - len, ",\"client\":\"%s\",\"reader\":\"PicoW\"}",
+                        cfg->mqtt_client_id);
+    }
+    if (len >= (int)size) return;
+    event_auth_sign(cfg->topic_crash, payload, len, sizeof(payload));
+
+    if (!link_supervisor_publish(cfg->topic_crash, payload, 1)) return;
+
+    // Bits em 1 não mudam ao gravar: só o byte da marca vai a zero
+    memset(flash_buf, 0xFF, FLASH_PAGE_SIZE);
+    flash_buf[0] = 0x00;
+    int rc = flash_safe_execute(program_sent_mark, NULL, 1000);
+    if (rc != PICO_OK) {
+        printf("[CRASH] ERRO ao marcar o registro como enviado! Codigo: %d\n", rc);
+    }
+    printf("[CRASH] Registro #%lu publicado em %s\n", (unsigned long)rec->seq, cfg->topic_crash);
+}
+
+void crash_dump_print(void) {
+    const crash_record_t *rec = stored_record();
+    if (rec == NULL) {
+        printf("[CRASH] Nenhum HardFault registrado\n");
+        return;
+    }
+
+    printf("[CRASH] #%lu: core %u, fase %s, %lu ms apos o boot (%s)\n",
+           (unsigned long)rec->seq, rec->core,
+           supervisor_phase_name((supervisor_phase_t)rec->phase),
+           (unsigned long)rec->uptime_ms, stored_sent() ? "publicado" : "aguardando o broker");
+    printf("[CRASH] pc=0x%08lx lr=0x%08lx sp=0x%08lx xpsr=0x%08lx exc_return=0x%08lx\n",
+           (unsigned long)rec->pc, (unsigned long)rec->lr, (unsigned long)rec->sp,
+           (unsigned long)rec->xpsr, (unsigned long)rec->exc_return);
+    for (int i = 0; i < 13; i += 4) {
+        printf("[CRASH]");
+        for (int j = i; j < i + 4 && j < 13; j++) {
+            printf(" r%-2d=0x%08lx", j, (unsigned long)rec->r[j]);
+        }
+        printf("\n");
+    }
+
+    uint32_t count = rec->trace_count < CRASH_TRACE_SAVED ? rec->trace_count : CRASH_TRACE_SAVED;
+    for (uint32_t i = 0; i < count; i++) {
+        const crash_trace_t *e = &rec->trace[i];
+        printf("[CRASH]   %8lu ms core %u %-4s %lu\n", (unsigned long)e->ms, e->core,
+               e->id < CRASH_TRACE_COUNT ? trace_names[e->id] : "?", (unsigned long)e->arg);
+    }
+    printf("[CRASH] Funcoes: tools/crash_symbolize com o ELF deste build (imagem de %lu bytes)\n",
+           (unsigned long)rec->image_size);
+}
@@ -0,0 +1,105 @@
+/**
+ * crash_dump.h
+ *
+ * Registro de HardFault para análise em campo, sem depurador.
+ *
+ * O tratador de HardFault copia os registradores, o topo da pilha, os
+ * últimos eventos do anel de rastreio e a fase do supervisor para uma
+ * área da RAM que o crt0 não zera, e reinicia (motivo "crash"). No boot
+ * seguinte, crash_dump_init() passa o registro para a flash
+ * (FLASH_CRASH_OFFSET), e ele é publicado uma vez em 'topic_crash'. Na
+ * variante FreeRTOS, o registro também fica em GET /api/crash.
+ *
+ * JSON (mesmo formato no MQTT e no HTTP):
+ *   {"crash":3,"uptime_ms":81234,"core":0,"phase":"publish","image_size":612352,
+ *    "pc":"0x1000a1f4","lr":"0x10009e3b","sp":"0x20041e80","xpsr":"0x21000003",
+ *    "exc_return":"0xfffffff9","r":["0x0",...r0-r12],"stack":"HEX",
+ *    "trace":[[81200,"tag",77770435],...],"client":"PicoW-1","reader":"PicoW"}
+ *
+ * tools/crash_symbolize.c traduz pc, lr e os endereços da pilha para
+ * funções do ELF do mesmo build (image_size confere o build).
+ */
+
+#ifndef CRASH_DUMP_H
+#define CRASH_DUMP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define CRASH_STACK_WORDS   32      // Palavras copiadas a partir do sp da falha
+#define CRASH_TRACE_LEN     32      // Anel de rastreio em RAM
+#define CRASH_TRACE_SAVED   8       // Últimos eventos guardados no registro
+
+// Eventos do anel de rastreio
+typedef enum {
+    CRASH_TRACE_BOOT,       // arg: 1 se o boot anterior terminou em HardFault
+    CRASH_TRACE_TAG,        // arg: 4 primeiros bytes do UID
+    CRASH_TRACE_LINK,       // arg: 1 = WiFi no ar, 0 = caiu
+    CRASH_TRACE_RX,         // arg: tamanho da mensagem MQTT recebida
+    CRASH_TRACE_COUNT
+} crash_trace_id_t;
+
+typedef struct {
+    uint32_t ms;
+    uint8_t id;
+    uint8_t core;
+    uint16_t reserved;
+    uint32_t arg;
+} crash_trace_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;               // Número do crash (conta na flash)
+    uint32_t uptime_ms;
+    uint32_t image_size;        // Tamanho do firmware: confere o ELF do símbolo
+    uint32_t r[13];             // r0-r12
+    uint32_t sp;
+    uint32_t lr;
+    uint32_t pc;
+    uint32_t xpsr;
+    uint32_t exc_return;
+    uint8_t core;
+    uint8_t phase;              // supervisor_phase_t
+    uint8_t stack_words;
+    uint8_t trace_count;
+    uint32_t stack[CRASH_STACK_WORDS];
+    crash_trace_t trace[CRASH_TRACE_SAVED];     // Do mais antigo ao mais recente
+    uint32_t crc;               // CRC-32 dos campos anteriores
+} crash_record_t;
+
+/**
+ * @brief Guarda na flash o registro deixado por um HardFault no boot
+ * anterior. Chamar logo após supervisor_init().
+ * @return true se houve crash no boot anterior.
+ */
+bool crash_dump_init(void);
+
+/**
+ * @brief Registra um evento no anel de rastreio (qualquer contexto).
+ */
+void crash_trace(crash_trace_id_t id, uint32_t arg);
+
+/**
+ * @brief Publica o registro ainda não enviado em 'topic_crash' (chamar no
+ * laço principal ou na tarefa que grava a flash).
+ */
+void crash_dump_publish(void);
+
+/**
+ * @brief Escreve o último registro como JSON (página /api/crash).
+ * @return O número de caracteres escritos; "{}" se não houver registro.
+ */
+int crash_dump_format_json(char *buf, size_t len);
+
+/**
+ * @brief Imprime o último registro (comando 'crash').
+ */
+void crash_dump_print(void);
+
+/**
+ * @brief Provoca um HardFault para testar a captura (comando 'crash test').
+ */
+void crash_dump_test(void);
+
+#endif // CRASH_DUMP_H
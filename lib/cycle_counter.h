@@ -0,0 +1,36 @@
+/**
+ * cycle_counter.h
+ *
+ * Contador de ciclos de CPU baseado no SysTick do Cortex-M0+.
+ *
+ * O RP2040 não tem o DWT->CYCCNT dos Cortex-M3/M4; o SysTick, com fonte
+ * no clock do processador, conta ciclos de forma decrescente em 24 bits
+ * (~126 ms a 133 MHz), suficiente para medir acessos e rajadas SPI.
+ */
+
+#ifndef CYCLE_COUNTER_H
+#define CYCLE_COUNTER_H
+
+#include <stdint.h>
+#include "hardware/structs/systick.h"
+
+#define CYCLE_COUNTER_MASK 0x00FFFFFFu
+
+// Liga o SysTick em modo livre, clock do processador, sem interrupção
+static inline void cycle_counter_init(void) {
+    systick_hw->csr = 0;
+    systick_hw->rvr = CYCLE_COUNTER_MASK;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 0x5;  // ENABLE | CLKSOURCE (processador)
+}
+
+static inline uint32_t cycle_counter_read(void) {
+    return systick_hw->cvr;
+}
+
+// Ciclos decorridos entre duas leituras (contador decrescente)
+static inline uint32_t cycle_counter_elapsed(uint32_t start, uint32_t end) {
+    return (start - end) & CYCLE_COUNTER_MASK;
+}
+
+#endif // CYCLE_COUNTER_H
@@ -0,0 +1,347 @@
+#include "event_auth.h"
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "hardware/flash.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+#include "cycle_counter.h"
+#include "flash_layout.h"
+#include "auth_crypto.h"
+#include "rfid_config.h"
+
+#define KEY_MAX         32
+#define KEY_MIN         16      // 128 bits: mínimo para os dois algoritmos
+#define HMAC_TAG_SIZE   16      // HMAC truncado (RFC 2104 seção 5)
+
+#define EPOCH_SLOTS     (FLASH_AUTH_EPOCH_SIZE / sizeof(uint32_t))
+#define EPOCH_EMPTY     0xFFFFFFFFu
+
+static uint8_t mode = EVENT_AUTH_OFF;
+static hmac_sha256_key_t hmac_key;
+static siphash_key_t sip_key;
+
+static uint32_t epoch = 0;
+static uint32_t seq = 0;
+
+static uint32_t signed_count = 0;
+static uint32_t cost_last_us = 0;
+static uint32_t cost_max_us = 0;
+
+static const char *mode_name(uint8_t m) {
+    switch (m) {
+        case EVENT_AUTH_HMAC_SHA256: return "HMAC-SHA256/128";
+        case EVENT_AUTH_SIPHASH:     return "SipHash-2-4";
+        default:                     return "desligado";
+    }
+}
+
+static int parse_key(const char *hex, uint8_t *key) {
+    size_t len = strlen(hex);
+    if (len % 2 != 0 || len / 2 > KEY_MAX) return -1;
+
+    for (size_t i = 0; i < len / 2; i++) {
+        unsigned int byte;
+        if (sscanf(hex + 2 * i, "%2x", &byte) != 1) return -1;
+        key[i] = (uint8_t)byte;
+    }
+    return (int)(len / 2);
+}
+
+// --- Época de boot ---
+
+/**
+ * O setor é um log de palavras de 32 bits: cada boot programa a próxima
+ * palavra apagada com a época anterior + 1 (apagar só a cada 1024 boots).
+ * Programar só zera bits, então uma gravação interrompida deixa um valor
+ * maior ou igual ao pretendido e a época nunca volta atrás.
+ */
+static uint32_t epoch_page[FLASH_PAGE_SIZE / sizeof(uint32_t)];
+static uint32_t epoch_page_offset;
+static bool epoch_erase;
+
+// Executada com o outro core e as interrupções pausados por flash_safe_execute
+static void program_epoch(void *param) {
+    (void)param;
+    if (epoch_erase) {
+        flash_range_erase(FLASH_AUTH_EPOCH_OFFSET, FLASH_AUTH_EPOCH_SIZE);
+    }
+    flash_range_program(epoch_page_offset, (const uint8_t *)epoch_page, FLASH_PAGE_SIZE);
+}
+
+static int advance_epoch(void) {
+    const uint32_t *slots = (const uint32_t *)FLASH_XIP_PTR(FLASH_AUTH_EPOCH_OFFSET);
+    uint32_t used = 0;
+    while (used < EPOCH_SLOTS && slots[used] != EPOCH_EMPTY) used++;
+
+    uint32_t next = (used ? slots[used - 1] : 0) + 1;
+    uint32_t slot = used;
+    epoch_erase = used == EPOCH_SLOTS;
+    if (epoch_erase) slot = 0;
+
+    // Palavras em 0xFF não alteram as já gravadas da mesma página
+    const uint32_t per_page = FLASH_PAGE_SIZE / sizeof(uint32_t);
+    memset(epoch_page, 0xFF, sizeof(epoch_page));
+    epoch_page[slot % per_page] = next;
+    epoch_page_offset = FLASH_AUTH_EPOCH_OFFSET + (slot / per_page) * FLASH_PAGE_SIZE;
+
+    int rc = flash_safe_execute(program_epoch, NULL, 1000);
+    if (rc != PICO_OK) {
+        printf("[AUTH] ERRO ao gravar a epoca na flash! Codigo: %d\n", rc);
+        return -1;
+    }
+    epoch = next;
+    seq = 0;
+    return 0;
+}
+
+// --- Assinatura ---
+
+// MAC binário; retorna o tamanho (HMAC_TAG_SIZE ou 8)
+static size_t compute_mac_raw(const char *topic, const void *msg, size_t len, uint8_t *mac) {
+    if (mode == EVENT_AUTH_HMAC_SHA256) {
+        uint8_t digest[SHA256_DIGEST_SIZE];
+        sha256_ctx_t ctx;
+        hmac_sha256_begin(&hmac_key, &ctx);
+        sha256_update(&ctx, topic, strlen(topic));
+        sha256_update(&ctx, "\n", 1);
+        sha256_update(&ctx, msg, len);
+        hmac_sha256_end(&hmac_key, &ctx, digest);
+        memcpy(mac, digest, HMAC_TAG_SIZE);
+        return HMAC_TAG_SIZE;
+    }
+    siphash_ctx_t ctx;
+    siphash_begin(&sip_key, &ctx);
+    siphash_update(&ctx, topic, strlen(topic));
+    siphash_update(&ctx, "\n", 1);
+    siphash_update(&ctx, msg, len);
+    uint64_t h = siphash_end(&ctx);
+    // Big-endian: mesmos bytes do texto hexadecimal
+    for (int i = 0; i < 8; i++) mac[i] = (uint8_t)(h >> (56 - 8 * i));
+    return 8;
+}
+
+static void compute_mac(const char *topic, const char *msg, size_t len, char *hex) {
+    uint8_t mac[HMAC_TAG_SIZE];
+    size_t mac_len = compute_mac_raw(topic, msg, len, mac);
+    for (size_t i = 0; i < mac_len; i++) {
+        snprintf(hex + 2 * i, 3, "%02x", mac[i]);
+    }
+}
+
+int event_auth_init(void) {
+    const rfid_config_t *cfg = rfid_config();
+    uint8_t key[KEY_MAX];
+
+    mode = EVENT_AUTH_OFF;
+    if (cfg->auth_mode == EVENT_AUTH_OFF) return 0;
+
+    int key_len = parse_key(cfg->auth_key, key);
+    if (key_len < KEY_MIN) {
+        printf("[AUTH] ERRO: auth_key deve ter de %d a %d bytes em hexadecimal; "
+               "mensagens seguem SEM assinatura\n", KEY_MIN, KEY_MAX);
+        return -1;
+    }
+
+    if (cfg->auth_mode == EVENT_AUTH_HMAC_SHA256) {
+        hmac_sha256_setkey(&hmac_key, key, key_len);
+    } else {
+        siphash_setkey(&sip_key, key);     // Primeiros 16 bytes
+    }
+    memset(key, 0, sizeof(key));
+
+    if (advance_epoch() != 0) return -1;
+    mode = cfg->auth_mode;
+    printf("[AUTH] Eventos assinados com %s (epoca %lu)\n", mode_name(mode),
+           (unsigned long)epoch);
+    return 0;
+}
+
+bool event_auth_enabled(void) {
+    return mode != EVENT_AUTH_OFF;
+}
+
+int event_auth_sign(const char *topic, char *buf, size_t len, size_t size) {
+    if (mode == EVENT_AUTH_OFF) return (int)len;
+    if (len == 0 || buf[len - 1] != '}' || len + EVENT_AUTH_OVERHEAD > size) return -1;
+
+    uint32_t start = time_us_32();
+    uint64_t ctr = ((uint64_t)epoch << 32) | seq;
+
+    // Substitui o '}' final; o MAC cobre tudo até aqui
+    size_t n = len - 1;
+    n += snprintf(buf + n, size - n, ",\"id\":\"%s\",\"ctr\":%llu",
+                  rfid_config()->mqtt_client_id, (unsigned long long)ctr);
+
+    char mac_hex[2 * HMAC_TAG_SIZE + 1];
+    compute_mac(topic, buf, n, mac_hex);
+    n += snprintf(buf + n, size - n, ",\"mac\":\"%s\"}", mac_hex);
+
+    // 2^32 mensagens no mesmo boot: abre uma época nova
+    if (++seq == 0) advance_epoch();
+
+    cost_last_us = time_us_32() - start;
+    if (cost_last_us > cost_max_us) cost_max_us = cost_last_us;
+    signed_count++;
+    return (int)n;
+}
+
+bool event_auth_check(const char *topic, const char *msg, size_t len, const char *mac_hex) {
+    if (mode == EVENT_AUTH_OFF) return false;
+
+    char expected[2 * HMAC_TAG_SIZE + 1];
+    compute_mac(topic, msg, len, expected);
+    size_t n = strlen(expected);
+    if (strlen(mac_hex) != n) return false;
+
+    // Tempo constante: não revela quantos dígitos conferem
+    uint8_t diff = 0;
+    for (size_t i = 0; i < n; i++) {
+        char c = mac_hex[i];
+        if (c >= 'A' && c <= 'F') c = (char)(c - 'A' + 'a');
+        diff |= (uint8_t)(expected[i] ^ c);
+    }
+    return diff == 0;
+}
+
+static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static bool is_hex(char c) {
+    return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+int event_auth_check_command(const char *topic, const char *text, size_t len, uint64_t *ctr) {
+    if (mode == EVENT_AUTH_OFF) return -1;
+
+    // Fim de linha de quem publicou não faz parte do comando
+    while (len > 0 && (text[len - 1] == '\n' || text[len - 1] == '\r' || text[len - 1] == ' ')) {
+        len--;
+    }
+
+    // ";mac=HEX" no fim: qualquer outro caractere depois do MAC recusa o comando
+    size_t mac = len;
+    while (mac > 0 && is_hex(text[mac - 1])) mac--;
+    size_t mac_len = len - mac;
+    if (mac_len == 0 || mac_len > 2 * HMAC_TAG_SIZE || mac < 5 ||
+        memcmp(text + mac - 5, ";mac=", 5) != 0) {
+        return -1;
+    }
+    size_t signed_len = mac - 5;
+
+    // ";ctr=N" logo antes, dentro do texto assinado
+    size_t digits = signed_len;
+    while (digits > 0 && is_digit(text[digits - 1])) digits--;
+    if (digits == signed_len || signed_len - digits > 20 || digits < 5 ||
+        memcmp(text + digits - 5, ";ctr=", 5) != 0) {
+        return -1;
+    }
+    uint64_t value = 0;
+    for (size_t i = digits; i < signed_len; i++) {
+        uint64_t next = value * 10 + (uint64_t)(text[i] - '0');
+        if (next / 10 != value) return -1;     // Maior que 64 bits
+        value = next;
+    }
+
+    char mac_hex[2 * HMAC_TAG_SIZE + 1];
+    memcpy(mac_hex, text + mac, mac_len);
+    mac_hex[mac_len] = '\0';
+    if (!event_auth_check(topic, text, signed_len, mac_hex)) return -1;
+
+    *ctr = value;
+    return (int)signed_len;
+}
+
+int event_auth_sign_bin(const char *topic, uint8_t *buf, size_t len, size_t size) {
+    if (mode == EVENT_AUTH_OFF) return (int)len;
+    if (len + EVENT_AUTH_BIN_OVERHEAD > size) return -1;
+
+    uint32_t start = time_us_32();
+    uint64_t ctr = ((uint64_t)epoch << 32) | seq;
+
+    size_t n = len;
+    for (int i = 0; i < 8; i++) buf[n++] = (uint8_t)(ctr >> (8 * i));
+    size_t mac_len = compute_mac_raw(topic, buf, n, buf + n);
+    n += mac_len;
+    buf[n++] = (uint8_t)mac_len;
+
+    if (++seq == 0) advance_epoch();
+
+    cost_last_us = time_us_32() - start;
+    if (cost_last_us > cost_max_us) cost_max_us = cost_last_us;
+    signed_count++;
+    return (int)n;
+}
+
+// --- Medição ---
+
+static uint32_t bench_cycles(uint8_t m, bool rekey, const char *topic, const char *msg,
+                             uint32_t iterations) {
+    static const uint8_t test_key[KEY_MAX] = {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+        0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f
+    };
+    char hex[2 * HMAC_TAG_SIZE + 1];
+    size_t len = strlen(msg);
+    uint64_t total = 0;
+
+    // Estado de produção preservado: mede com a chave de teste
+    uint8_t saved_mode = mode;
+    hmac_sha256_key_t saved_hmac = hmac_key;
+    siphash_key_t saved_sip = sip_key;
+
+    mode = m;
+    hmac_sha256_setkey(&hmac_key, test_key, sizeof(test_key));
+    siphash_setkey(&sip_key, test_key);
+
+    uint32_t irq = save_and_disable_interrupts();
+    for (uint32_t i = 0; i < iterations; i++) {
+        uint32_t start = cycle_counter_read();
+        if (rekey) hmac_sha256_setkey(&hmac_key, test_key, sizeof(test_key));
+        compute_mac(topic, msg, len, hex);
+        total += cycle_counter_elapsed(start, cycle_counter_read());
+    }
+    restore_interrupts(irq);
+
+    mode = saved_mode;
+    hmac_key = saved_hmac;
+    sip_key = saved_sip;
+    return (uint32_t)(total / iterations);
+}
+
+void event_auth_bench(uint32_t iterations) {
+    const char *topic = rfid_config()->topic_rfid;
+    const char *msg = "{\"tag\":\"04AABBCCDD\",\"timestamp\":93412,\"reader\":\"PicoW\","
+                      "\"ts_us\":1760000000123456,\"id\":\"PicoW-RFID-Reader\","
+                      "\"ctr\":55834574849";
+    uint32_t mhz = clock_get_hz(clk_sys) / 1000000;
+
+    if (iterations == 0) iterations = 1;
+    cycle_counter_init();
+
+    uint32_t hmac = bench_cycles(EVENT_AUTH_HMAC_SHA256, false, topic, msg, iterations);
+    uint32_t naive = bench_cycles(EVENT_AUTH_HMAC_SHA256, true, topic, msg, iterations);
+    uint32_t sip = bench_cycles(EVENT_AUTH_SIPHASH, false, topic, msg, iterations);
+
+    printf("[AUTH] Custo por evento (%u bytes assinados, %lu repeticoes, %lu MHz):\n",
+           (unsigned)(strlen(topic) + 1 + strlen(msg)), (unsigned long)iterations,
+           (unsigned long)mhz);
+    printf("[AUTH] %-30s %8s %8s\n", "Algoritmo", "ciclos", "us");
+    printf("[AUTH] %-30s %8lu %8lu\n", "HMAC-SHA256 (chave preparada)",
+           (unsigned long)hmac, (unsigned long)(hmac / mhz));
+    printf("[AUTH] %-30s %8lu %8lu\n", "HMAC-SHA256 (chave a cada msg)",
+           (unsigned long)naive, (unsigned long)(naive / mhz));
+    printf("[AUTH] %-30s %8lu %8lu\n", "SipHash-2-4",
+           (unsigned long)sip, (unsigned long)(sip / mhz));
+}
+
+void event_auth_print(void) {
+    printf("[AUTH] Modo: %s\n", mode_name(mode));
+    if (mode == EVENT_AUTH_OFF) return;
+    printf("[AUTH] Epoca %lu, sequencia %lu, %lu mensagens assinadas\n",
+           (unsigned long)epoch, (unsigned long)seq, (unsigned long)signed_count);
+    printf("[AUTH] Custo da assinatura: ultima %lu us, maxima %lu us\n",
+           (unsigned long)cost_last_us, (unsigned long)cost_max_us);
+}
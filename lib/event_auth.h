@@ -0,0 +1,95 @@
+/**
+ * event_auth.h
+ *
+ * Autenticação dos eventos publicados (agv/rfid e agv/position) sem TLS:
+ * cada mensagem ganha um contador e um MAC calculado com a chave
+ * compartilhada entre leitores e consumidores ('cfg set auth_key').
+ *
+ *   {"tag":"04AABBCC",...,"id":"PicoW-1","ctr":55834574849,"mac":"9f1c..."}
+ *
+ *  - mac: HMAC-SHA256 truncado em 128 bits (auth_mode 1) ou SipHash-2-4,
+ *    64 bits (auth_mode 2, mais barato no Cortex-M0+: ver auth bench), em hexadecimal,
+ *    sobre  tópico + '\n' + JSON até antes de ,"mac"  (o tópico entra no
+ *    MAC: uma mensagem de posição não passa por leitura de tag);
+ *  - ctr: (época de boot << 32) | sequência. A época é gravada na flash a
+ *    cada boot, então o contador nunca se repete para o mesmo 'id' e o
+ *    consumidor descarta contadores já vistos (replay).
+ *
+ * Verificação no PC: tools/event_verify.c.
+ * Usar de um único contexto (loop principal ou tarefa de publicação).
+ */
+
+#ifndef EVENT_AUTH_H
+#define EVENT_AUTH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define EVENT_AUTH_OFF          0
+#define EVENT_AUTH_HMAC_SHA256  1
+#define EVENT_AUTH_SIPHASH      2
+
+// Maior acréscimo feito por event_auth_sign (id, ctr e mac)
+#define EVENT_AUTH_OVERHEAD     112
+// Trailer de event_auth_sign_bin: ctr (8), MAC (até 16) e tamanho do MAC (1)
+#define EVENT_AUTH_BIN_OVERHEAD 25
+
+/**
+ * @brief Prepara a chave do modo configurado e avança a época de boot na
+ * flash. Sem auth_mode (ou com chave inválida) as mensagens seguem sem MAC.
+ * @return 0 em caso de sucesso (ou desligado), -1 se a chave é inválida.
+ */
+int event_auth_init(void);
+
+bool event_auth_enabled(void);
+
+/**
+ * @brief Assina o objeto JSON em 'buf' (terminado em '}'), acrescentando
+ * id, ctr e mac no lugar da chave final.
+ * @param len Comprimento atual de 'buf'.
+ * @param size Tamanho do buffer (len + EVENT_AUTH_OVERHEAD basta).
+ * @return O novo comprimento, ou -1 se não coube (buf fica inalterado).
+ * Desligado, retorna 'len' sem mexer em nada.
+ */
+int event_auth_sign(const char *topic, char *buf, size_t len, size_t size);
+
+/**
+ * @brief Confere o MAC (hexadecimal) de uma mensagem recebida, calculado
+ * como o de event_auth_sign sobre tópico + '\n' + os 'len' bytes de 'msg'.
+ * O contador (replay) fica com quem recebe.
+ * @return false se não confere ou se a autenticação está desligada.
+ */
+bool event_auth_check(const char *topic, const char *msg, size_t len, const char *mac_hex);
+
+/**
+ * @brief Confere um comando em texto assinado pelo backend (card_ops.h,
+ * ota.h), que termina em ";ctr=N;mac=HEX": o MAC é o último item (só um
+ * fim de linha depois dele) e cobre tópico + '\n' + o texto antes de
+ * ";mac=", que termina no contador. Itens depois do MAC não são aceitos.
+ * @param ctr Recebe o contador (o replay fica com quem recebe).
+ * @return O comprimento do texto assinado (o único que deve ser
+ * interpretado), ou -1 se o formato ou o MAC não conferem.
+ */
+int event_auth_check_command(const char *topic, const char *text, size_t len, uint64_t *ctr);
+
+/**
+ * @brief Assina um quadro binário (lib/event_codec.h): acrescenta o
+ * contador (u64, little-endian), o MAC sobre tópico + '\n' + quadro +
+ * contador, e o tamanho do MAC no último byte.
+ * @return O novo comprimento, ou -1 se não coube. Desligado, retorna 'len'.
+ */
+int event_auth_sign_bin(const char *topic, uint8_t *buf, size_t len, size_t size);
+
+/**
+ * @brief Mede o custo por evento de cada algoritmo, em ciclos e µs
+ * (comando 'auth bench'). Usa o SysTick: só no firmware bare-metal.
+ */
+void event_auth_bench(uint32_t iterations);
+
+/**
+ * @brief Imprime modo, época, mensagens assinadas e custo medido (comando 'auth').
+ */
+void event_auth_print(void);
+
+#endif // EVENT_AUTH_H
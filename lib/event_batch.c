@@ -0,0 +1,155 @@
+#include "event_batch.h"
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "event_codec.h"
+#include "event_queue.h"
+#include "event_auth.h"
+#include "time_sync.h"
+#include "rules.h"
+#include "link_supervisor.h"
+#include "pipeline_stats.h"
+#include "rfid_config.h"
+
+static uint8_t frame[EVENT_CODEC_FRAME_MAX + EVENT_AUTH_BIN_OVERHEAD];
+static rfid_event_t batch[EVENT_CODEC_BATCH_MAX];
+
+static uint32_t frames_sent = 0;
+static uint32_t events_sent = 0;
+static uint32_t bytes_sent = 0;
+static uint32_t json_bytes = 0;     // O que os mesmos eventos ocupariam em JSON
+static uint32_t encode_last_us = 0;
+static uint32_t encode_max_us = 0;
+
+static const char *mode_name(uint8_t m) {
+    switch (m) {
+        case EVENT_CODEC_DELTA: return "delta + dicionario";
+        case EVENT_CODEC_LZ:    return "delta + dicionario + LZSS";
+        default:                return "desligado (JSON por evento)";
+    }
+}
+
+uint32_t event_batch_publish(void) {
+    const rfid_config_t *cfg = rfid_config();
+    if (cfg->batch_codec == EVENT_CODEC_OFF || cfg->transport != 0 ||
+        event_queue_class_count(EVENT_CLASS_BULK) < EVENT_BATCH_MIN) {
+        return 0;
+    }
+
+    uint32_t count = event_queue_peek_batch(batch, EVENT_CODEC_BATCH_MAX);
+
+    // Eventos com rota vão no tópico da rota: o lote para antes deles
+    for (uint32_t i = 0; i < count; i++) {
+        if (batch[i].flags & EVENT_ROUTE_MASK) {
+            count = i;
+            break;
+        }
+    }
+    if (count < EVENT_BATCH_MIN) return 0;
+
+    uint32_t start = time_us_32();
+
+    // Base no relógio comum: o decodificador reconstrói ts_us dos demais
+    uint64_t base_unix_us = 0;
+    time_sync_stats_t ts;
+    time_sync_get_stats(&ts);
+    if (!time_sync_to_unix_us((uint64_t)batch[0].timestamp_ms * 1000, &base_unix_us)) {
+        base_unix_us = 0;
+    }
+
+    size_t len;
+    count = event_codec_encode(batch, count, cfg->batch_codec, base_unix_us, ts.drift_ppb,
+                               cfg->mqtt_client_id, event_auth_enabled(), frame, &len);
+    if (count == 0) return 0;
+    int signed_len = event_auth_sign_bin(cfg->topic_batch, frame, len, sizeof(frame));
+    if (signed_len < 0) return 0;
+
+    encode_last_us = time_us_32() - start;
+    if (encode_last_us > encode_max_us) encode_max_us = encode_last_us;
+
+    if (!link_supervisor_publish_bin(cfg->topic_batch, frame, (size_t)signed_len, 1)) {
+        return 0;   // Janela cheia: o chamador tenta o evento da cabeça em JSON
+    }
+    event_queue_pop_n(count);
+
+    uint32_t now = time_us_32();
+    uint32_t json = 0;
+    bool synced = base_unix_us != 0;
+    for (uint32_t i = 0; i < count; i++) {
+        json += event_codec_json_size(&batch[i], synced);
+        pipeline_stats_published(batch[i].detect_us, now, batch[i].flags & EVENT_FLAG_RESTORED,
+                                 EVENT_CLASS_BULK);
+    }
+    frames_sent++;
+    events_sent += count;
+    bytes_sent += (uint32_t)signed_len;
+    json_bytes += json;
+
+    printf("[BATCH] %lu eventos em %d bytes (JSON: %lu) -> %s\n", (unsigned long)count,
+           signed_len, (unsigned long)json, cfg->topic_batch);
+    return count;
+}
+
+int event_batch_format_json(char *buf, size_t len) {
+    return snprintf(buf, len,
+                    "\"batch\":{\"frames\":%lu,\"events\":%lu,\"bytes\":%lu,\"json\":%lu,"
+                    "\"enc_us_max\":%lu}",
+                    (unsigned long)frames_sent, (unsigned long)events_sent,
+                    (unsigned long)bytes_sent, (unsigned long)json_bytes,
+                    (unsigned long)encode_max_us);
+}
+
+void event_batch_print(void) {
+    const rfid_config_t *cfg = rfid_config();
+    printf("[BATCH] Modo: %s, topico %s\n", mode_name(cfg->batch_codec), cfg->topic_batch);
+    printf("[BATCH] %lu quadros, %lu eventos, %lu bytes (JSON: %lu bytes)\n",
+           (unsigned long)frames_sent, (unsigned long)events_sent,
+           (unsigned long)bytes_sent, (unsigned long)json_bytes);
+    if (bytes_sent > 0) {
+        printf("[BATCH] Compressao %lu.%lux\n", (unsigned long)(json_bytes / bytes_sent),
+               (unsigned long)(json_bytes * 10 / bytes_sent % 10));
+    }
+    printf("[BATCH] Codificacao: ultima %lu us, maxima %lu us\n",
+           (unsigned long)encode_last_us, (unsigned long)encode_max_us);
+}
+
+// --- Medição ---
+
+void event_batch_bench(uint32_t frames) {
+    static rfid_event_t trace[EVENT_CODEC_BATCH_MAX];
+    uint32_t mhz = clock_get_hz(clk_sys) / 1000000;
+
+    if (frames == 0) frames = 1;
+    printf("[BATCH] Traco sintetico, %lu quadros de %d eventos, %lu MHz:\n",
+           (unsigned long)frames, EVENT_CODEC_BATCH_MAX, (unsigned long)mhz);
+    printf("[BATCH] %-28s %8s %8s %10s %8s\n", "Modo", "JSON", "quadro", "us/quadro", "ciclos/ev");
+
+    for (uint8_t m = EVENT_CODEC_DELTA; m <= EVENT_CODEC_LZ; m++) {
+        uint32_t json = 0, bytes = 0, events = 0;
+        uint64_t total_us = 0;
+
+        for (uint32_t f = 0; f < frames; f++) {
+            // Mesmo traço nos dois modos; eventos ao vivo (com ts_us no JSON)
+            event_codec_synth_trace(trace, EVENT_CODEC_BATCH_MAX, 12, f + 1);
+            for (uint32_t i = 0; i < EVENT_CODEC_BATCH_MAX; i++) trace[i].flags = 0;
+
+            size_t len;
+            uint32_t start = time_us_32();
+            uint32_t n = event_codec_encode(trace, EVENT_CODEC_BATCH_MAX, m, 1, 0, "PicoW-RFID-Reader",
+                                            false, frame, &len);
+            total_us += time_us_32() - start;
+
+            for (uint32_t i = 0; i < n; i++) json += event_codec_json_size(&trace[i], true);
+            bytes += (uint32_t)len;
+            events += n;
+        }
+
+        uint32_t per_frame = (uint32_t)(total_us / frames);
+        printf("[BATCH] %-28s %8lu %8lu %10lu %8lu  (%lu.%lux)\n", mode_name(m),
+               (unsigned long)(json / frames), (unsigned long)(bytes / frames),
+               (unsigned long)per_frame,
+               (unsigned long)(total_us * mhz / (events ? events : 1)),
+               (unsigned long)(json / bytes), (unsigned long)(json * 10 / bytes % 10));
+    }
+}
@@ -0,0 +1,50 @@
+/**
+ * event_batch.h
+ *
+ * Escoamento da fila pendente em lotes: com batch_codec ligado e pelo
+ * menos EVENT_BATCH_MIN eventos comuns na fila (volta de uma queda longa),
+ * o publicador manda quadros binários de lib/event_codec.h em 'topic_batch'
+ * em vez de um JSON por evento. Online, com a fila vazia, nada muda.
+ *
+ * Só no transporte MQTT/TCP (o MQTT-SN segue com um datagrama por evento).
+ * Eventos com rota de regra (rules.h) saem um a um no tópico da rota.
+ * Decodificação no PC: tools/event_decode.c.
+ */
+
+#ifndef EVENT_BATCH_H
+#define EVENT_BATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Abaixo disso o JSON por evento basta
+#define EVENT_BATCH_MIN     16
+
+/**
+ * @brief Publica um quadro com os próximos eventos comuns da fila e os
+ * remove. Chamar do contexto que escoa a fila, com o evento comum da
+ * cabeça já obtido por event_queue_peek().
+ * @return O número de eventos publicados; 0 se o lote não se aplica ou
+ * não foi aceito (o chamador segue com o JSON do evento da cabeça).
+ */
+uint32_t event_batch_publish(void);
+
+/**
+ * @brief Escreve os contadores como campo JSON (sem chaves externas).
+ * Ex: "batch":{"frames":12,"events":768,"bytes":6210,"json":58900,"enc_us_max":930}
+ * @return O número de caracteres escritos (como snprintf).
+ */
+int event_batch_format_json(char *buf, size_t len);
+
+/**
+ * @brief Imprime modo, quadros, taxa de compressão e custo (comando 'batch').
+ */
+void event_batch_print(void);
+
+/**
+ * @brief Mede compressão e custo de codificação no traço sintético de
+ * event_codec_synth_trace, nos dois modos (comando 'batch bench').
+ */
+void event_batch_bench(uint32_t frames);
+
+#endif // EVENT_BATCH_H
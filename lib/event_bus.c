@@ -0,0 +1,97 @@
+#include "event_bus.h"
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+_Static_assert((EVENT_BUS_CAPACITY & (EVENT_BUS_CAPACITY - 1)) == 0,
+               "EVENT_BUS_CAPACITY deve ser potencia de 2");
+
+// Folga entre o produtor e o sink mais atrasado: o slot lido durante uma
+// entrega não pode ser sobrescrito por uma leitura nova no outro core
+#define BUS_GUARD   4
+#define BUS_WINDOW  (EVENT_BUS_CAPACITY - BUS_GUARD)
+
+static rfid_event_t ring[EVENT_BUS_CAPACITY];
+static volatile uint32_t write_seq = 0;     // Eventos produzidos
+
+static event_sink_t *sinks[EVENT_BUS_MAX_SINKS];
+static uint8_t sink_count = 0;
+
+int event_bus_register(event_sink_t *sink) {
+    if (sink_count == EVENT_BUS_MAX_SINKS) {
+        printf("[BUS] ERRO: limite de sinks atingido (%s)\n", sink->name);
+        return -1;
+    }
+    sink->cursor = write_seq;
+    sink->delivered = 0;
+    sink->dropped = 0;
+    sink->lag_max = 0;
+    sinks[sink_count++] = sink;
+    return 0;
+}
+
+void event_bus_produce(const rfid_event_t *ev) {
+    uint32_t seq = write_seq;
+    ring[seq & (EVENT_BUS_CAPACITY - 1)] = *ev;
+    __dmb();    // Evento visível antes do novo write_seq
+    write_seq = seq + 1;
+}
+
+uint32_t event_bus_dispatch(uint32_t budget) {
+    uint32_t seq = write_seq;
+    __dmb();    // Lê os eventos depois de write_seq
+    uint32_t total = 0;
+
+    for (uint8_t i = 0; i < sink_count; i++) {
+        event_sink_t *s = sinks[i];
+
+        uint32_t lag = seq - s->cursor;
+        if (lag > s->lag_max) s->lag_max = lag;
+        if (lag > BUS_WINDOW) {
+            // Produtor alcançou o sink: pula para o mais antigo ainda válido
+            s->dropped += lag - BUS_WINDOW;
+            s->cursor = seq - BUS_WINDOW;
+        }
+
+        uint32_t n = 0;
+        while (s->cursor != seq && n < budget) {
+            if (!s->deliver(&ring[s->cursor & (EVENT_BUS_CAPACITY - 1)], s->ctx)) {
+                break;  // Contrapressão: mesmo evento na próxima rodada
+            }
+            s->cursor++;
+            n++;
+        }
+        s->delivered += n;
+        total += n;
+    }
+    return total;
+}
+
+uint32_t event_bus_produced(void) {
+    return write_seq;
+}
+
+void event_bus_print(void) {
+    uint32_t seq = write_seq;
+    printf("[BUS] %lu eventos produzidos, anel de %u\n",
+           (unsigned long)seq, EVENT_BUS_CAPACITY);
+    for (uint8_t i = 0; i < sink_count; i++) {
+        const event_sink_t *s = sinks[i];
+        printf("[BUS] %-8s entregues: %lu  pendentes: %lu  atraso max: %lu  perdidos: %lu\n",
+               s->name, (unsigned long)s->delivered, (unsigned long)(seq - s->cursor),
+               (unsigned long)s->lag_max, (unsigned long)s->dropped);
+    }
+}
+
+int event_bus_format_json(char *buf, size_t len) {
+    int n = snprintf(buf, len, "\"bus\":{");
+    for (uint8_t i = 0; i < sink_count && n >= 0 && (size_t)n < len; i++) {
+        n += snprintf(buf + n, len - n, "%s\"%s\":{\"lag\":%lu,\"drop\":%lu}",
+                      i ? "," : "", sinks[i]->name,
+                      (unsigned long)sinks[i]->lag_max, (unsigned long)sinks[i]->dropped);
+    }
+    if (n >= 0 && (size_t)n < len) {
+        n += snprintf(buf + n, len - n, "}");
+    }
+    return n;
+}
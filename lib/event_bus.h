@@ -0,0 +1,92 @@
+/**
+ * event_bus.h
+ *
+ * Barramento de eventos de tag: cada leitura é gravada uma única vez num
+ * buffer circular compartilhado e entregue a vários consumidores ("sinks":
+ * MQTT, serial, HTTP...), cada um com o seu próprio cursor.
+ *
+ * O caminho de RF só copia o evento (20 bytes) para o anel: formatação,
+ * publicação e gravação ficam nos sinks, chamados fora do RF por
+ * event_bus_dispatch(). Acrescentar uma saída não muda o custo da leitura.
+ *
+ * Contrapressão: um sink que não pode receber agora retorna false e o
+ * evento fica para a próxima rodada (o cursor não anda). Se o produtor
+ * alcançar um sink lento, esse sink perde os eventos mais antigos
+ * (contados em 'dropped'); os demais não são afetados. Quem precisa de
+ * entrega garantida guarda o evento por conta própria (o sink MQTT usa a
+ * fila persistente de event_queue).
+ *
+ * Um produtor (tarefa/loop de RF) e um consumidor (quem chama
+ * event_bus_dispatch), que podem estar em cores diferentes.
+ *
+ * Sinks existentes (nos mains): serial (texto), posição do AGV, MQTT e,
+ * no FreeRTOS, o GET /events do HTTP. SSE, UDP e diário na flash ainda
+ * não foram feitos.
+ */
+
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "event_queue.h"
+
+#define EVENT_BUS_CAPACITY      32    // Eventos no anel (potência de 2)
+#define EVENT_BUS_MAX_SINKS     6
+
+/**
+ * Entrega um evento ao sink. Retorna false para contrapressão (tenta o
+ * mesmo evento na próxima rodada). O ponteiro só vale durante a chamada.
+ */
+typedef bool (*event_sink_deliver_fn)(const rfid_event_t *ev, void *ctx);
+
+typedef struct {
+    const char *name;
+    event_sink_deliver_fn deliver;
+    void *ctx;
+
+    // Mantidos pelo barramento
+    uint32_t cursor;            // Próximo evento (número de sequência)
+    uint32_t delivered;
+    uint32_t dropped;           // Perdidos por atraso (anel sobrescrito)
+    uint32_t lag_max;           // Maior atraso visto, em eventos
+} event_sink_t;
+
+/**
+ * @brief Registra um sink. Ele recebe apenas eventos produzidos depois do
+ * registro. O sink deve continuar válido (estático) enquanto registrado.
+ * @return 0 em caso de sucesso, -1 se já há EVENT_BUS_MAX_SINKS.
+ */
+int event_bus_register(event_sink_t *sink);
+
+/**
+ * @brief Publica um evento no anel (caminho de RF: só uma cópia, nunca
+ * bloqueia).
+ */
+void event_bus_produce(const rfid_event_t *ev);
+
+/**
+ * @brief Entrega os eventos pendentes a cada sink, até 'budget' por sink.
+ * @return O número total de entregas feitas.
+ */
+uint32_t event_bus_dispatch(uint32_t budget);
+
+/**
+ * @brief Eventos produzidos desde o boot.
+ */
+uint32_t event_bus_produced(void);
+
+/**
+ * @brief Imprime o estado de cada sink no serial (comando 'bus').
+ */
+void event_bus_print(void);
+
+/**
+ * @brief Escreve o estado dos sinks como campo JSON (sem chaves externas).
+ * Ex: "bus":{"mqtt":{"lag":1,"drop":0},"serial":{"lag":1,"drop":0}}
+ * @return O número de caracteres escritos (como snprintf).
+ */
+int event_bus_format_json(char *buf, size_t len);
+
+#endif // EVENT_BUS_H
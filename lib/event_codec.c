@@ -0,0 +1,430 @@
+#include "event_codec.h"
+#include <stdio.h>
+#include <string.h>
+
+// Token de cada evento na etapa 1
+#define TOKEN_NEW       0x80    // UID literal segue (e entra no dicionário)
+#define TOKEN_FLAGS     0x40    // Byte de flags segue (mudou desde o anterior)
+#define TOKEN_SLOT      0x3F
+
+// Pior caso de um evento: token, flags, tamanho + UID e varint de 5 bytes
+#define EVENT_MAX_BYTES (3 + EVENT_UID_MAX + 5)
+
+// LZSS: casamentos de 3 a 18 bytes até 4 KB atrás, em 2 bytes
+#define LZ_MIN          3
+#define LZ_MAX          18
+#define LZ_WINDOW       4096
+#define LZ_HASH_BITS    8
+#define LZ_CHAIN        8       // Candidatos testados por posição
+
+_Static_assert(EVENT_CODEC_DICT_SIZE - 1 <= TOKEN_SLOT, "dicionario maior que o token");
+
+static uint8_t body[EVENT_CODEC_BODY_MAX];
+static uint16_t lz_head[1 << LZ_HASH_BITS];
+static uint16_t lz_prev[EVENT_CODEC_BODY_MAX];
+
+// --- Etapa 1: delta + dicionário ---
+
+static size_t put_varint(uint8_t *p, uint32_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static int get_varint(const uint8_t *p, size_t len, size_t *pos, uint32_t *v) {
+    *v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (*pos >= len) return -1;
+        uint8_t b = p[(*pos)++];
+        *v |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return 0;
+    }
+    return -1;
+}
+
+// Diferenças negativas (eventos restaurados de um boot anterior) em zigzag
+static uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+typedef struct {
+    uint8_t uid[EVENT_UID_MAX];
+    uint8_t size;
+} dict_entry_t;
+
+static int dict_find(const dict_entry_t *dict, uint32_t used, const rfid_event_t *ev) {
+    for (uint32_t i = 0; i < used; i++) {
+        if (dict[i].size == ev->uid_size && memcmp(dict[i].uid, ev->uid, ev->uid_size) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static uint32_t encode_body(const rfid_event_t *events, uint32_t count, size_t *body_len) {
+    static dict_entry_t dict[EVENT_CODEC_DICT_SIZE];
+    uint32_t dict_used = 0, dict_next = 0;
+    uint32_t prev_ts = events[0].timestamp_ms;
+    uint8_t prev_flags = 0;
+    size_t n = 0;
+    uint32_t i;
+
+    for (i = 0; i < count && n + EVENT_MAX_BYTES <= sizeof(body); i++) {
+        const rfid_event_t *ev = &events[i];
+        uint8_t *token = &body[n++];
+        int slot = dict_find(dict, dict_used, ev);
+
+        *token = 0;
+        if (ev->flags != prev_flags) {
+            *token |= TOKEN_FLAGS;
+            body[n++] = ev->flags;
+            prev_flags = ev->flags;
+        }
+        if (slot < 0) {
+            // Dicionário cheio: substitui em rodízio
+            slot = (int)dict_next;
+            dict_next = (dict_next + 1) % EVENT_CODEC_DICT_SIZE;
+            if (dict_used < EVENT_CODEC_DICT_SIZE) dict_used++;
+            memcpy(dict[slot].uid, ev->uid, ev->uid_size);
+            dict[slot].size = ev->uid_size;
+
+            *token |= TOKEN_NEW;
+            body[n++] = ev->uid_size;
+            memcpy(&body[n], ev->uid, ev->uid_size);
+            n += ev->uid_size;
+        }
+        *token |= (uint8_t)slot;
+
+        n += put_varint(&body[n], zigzag((int32_t)(ev->timestamp_ms - prev_ts)));
+        prev_ts = ev->timestamp_ms;
+    }
+    *body_len = n;
+    return i;
+}
+
+static int decode_body(const uint8_t *p, size_t len, uint32_t count, uint32_t base_ts,
+                       rfid_event_t *events, uint32_t max) {
+    dict_entry_t dict[EVENT_CODEC_DICT_SIZE];
+    uint32_t ts = base_ts;
+    uint8_t flags = 0;
+    size_t pos = 0;
+
+    memset(dict, 0, sizeof(dict));
+    for (uint32_t i = 0; i < count; i++) {
+        if (pos >= len || i >= max) return -1;
+        uint8_t token = p[pos++];
+        uint8_t slot = token & TOKEN_SLOT;
+        if (slot >= EVENT_CODEC_DICT_SIZE) return -1;
+
+        if (token & TOKEN_FLAGS) {
+            if (pos >= len) return -1;
+            flags = p[pos++];
+        }
+        if (token & TOKEN_NEW) {
+            if (pos >= len || p[pos] == 0 || p[pos] > EVENT_UID_MAX ||
+                pos + 1 + p[pos] > len) {
+                return -1;
+            }
+            dict[slot].size = p[pos];
+            memcpy(dict[slot].uid, &p[pos + 1], p[pos]);
+            pos += 1 + p[pos];
+        } else if (dict[slot].size == 0) {
+            return -1;
+        }
+
+        uint32_t delta;
+        if (get_varint(p, len, &pos, &delta) != 0) return -1;
+        ts += (uint32_t)unzigzag(delta);
+
+        rfid_event_t *ev = &events[i];
+        memset(ev, 0, sizeof(*ev));
+        memcpy(ev->uid, dict[slot].uid, dict[slot].size);
+        ev->uid_size = dict[slot].size;
+        ev->flags = flags;
+        ev->timestamp_ms = ts;
+    }
+    return pos == len ? (int)count : -1;
+}
+
+// --- Etapa 2: LZSS ---
+
+static uint32_t lz_hash(const uint8_t *p) {
+    return ((p[0] << 5) ^ (p[1] << 2) ^ p[2] ^ (p[0] >> 3)) & ((1 << LZ_HASH_BITS) - 1);
+}
+
+/**
+ * Grupos de até 8 itens precedidos de um byte de controle (bit = 1:
+ * casamento de 2 bytes, 12 bits de distância e 4 de comprimento).
+ * @return O tamanho comprimido, ou 0 se não coube em 'size'.
+ */
+static size_t lz_compress(const uint8_t *in, size_t len, uint8_t *out, size_t size) {
+    size_t o = 0, i = 0, ctrl_pos = 0;
+    int item = 8;
+
+    memset(lz_head, 0, sizeof(lz_head));
+    while (i < len) {
+        if (item == 8) {
+            if (o >= size) return 0;
+            ctrl_pos = o++;
+            out[ctrl_pos] = 0;
+            item = 0;
+        }
+
+        size_t best_len = 0, best_dist = 0;
+        if (i + LZ_MIN <= len) {
+            uint32_t h = lz_hash(&in[i]);
+            uint32_t cand = lz_head[h];     // Posição + 1 (0 = nenhuma)
+            for (int chain = 0; cand && chain < LZ_CHAIN; chain++) {
+                size_t c = cand - 1;
+                if (i - c > LZ_WINDOW) break;
+                size_t l = 0;
+                while (l < LZ_MAX && i + l < len && in[c + l] == in[i + l]) l++;
+                if (l > best_len) {
+                    best_len = l;
+                    best_dist = i - c;
+                    if (l == LZ_MAX) break;
+                }
+                cand = lz_prev[c];
+            }
+        }
+
+        size_t step = best_len >= LZ_MIN ? best_len : 1;
+        if (best_len >= LZ_MIN) {
+            if (o + 2 > size) return 0;
+            uint32_t d = (uint32_t)best_dist - 1;
+            out[o++] = (uint8_t)d;
+            out[o++] = (uint8_t)(((d >> 8) << 4) | (best_len - LZ_MIN));
+            out[ctrl_pos] |= (uint8_t)(1 << item);
+        } else {
+            if (o >= size) return 0;
+            out[o++] = in[i];
+        }
+        item++;
+
+        // Indexa todas as posições consumidas
+        for (size_t k = 0; k < step; k++, i++) {
+            if (i + LZ_MIN <= len) {
+                uint32_t h = lz_hash(&in[i]);
+                lz_prev[i] = lz_head[h];
+                lz_head[h] = (uint16_t)(i + 1);
+            }
+        }
+    }
+    return o;
+}
+
+static int lz_decompress(const uint8_t *in, size_t len, uint8_t *out, size_t out_len) {
+    size_t i = 0, o = 0;
+    while (o < out_len) {
+        if (i >= len) return -1;
+        uint8_t ctrl = in[i++];
+        for (int item = 0; item < 8 && o < out_len; item++) {
+            if (ctrl & (1 << item)) {
+                if (i + 2 > len) return -1;
+                size_t dist = (in[i] | ((size_t)(in[i + 1] >> 4) << 8)) + 1;
+                size_t l = (in[i + 1] & 0x0F) + LZ_MIN;
+                i += 2;
+                if (dist > o || o + l > out_len) return -1;
+                for (size_t k = 0; k < l; k++, o++) out[o] = out[o - dist];
+            } else {
+                if (i >= len) return -1;
+                out[o++] = in[i++];
+            }
+        }
+    }
+    return i == len ? 0 : -1;
+}
+
+// --- Quadro ---
+
+static void put32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint32_t get32(const uint8_t *p) {
+    return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+uint32_t event_codec_encode(const rfid_event_t *events, uint32_t count, uint8_t mode,
+                            uint64_t base_unix_us, int32_t drift_ppb, const char *reader_id,
+                            bool sign, uint8_t *frame, size_t *frame_len) {
+    size_t id_len = strlen(reader_id);
+    if (count == 0 || mode == EVENT_CODEC_OFF || id_len > 32) return 0;
+    if (count > EVENT_CODEC_BATCH_MAX) count = EVENT_CODEC_BATCH_MAX;
+
+    size_t body_len;
+    count = encode_body(events, count, &body_len);
+
+    uint8_t flags = sign ? EVENT_CODEC_FLAG_SIGNED : 0;
+    if (base_unix_us) flags |= EVENT_CODEC_FLAG_CLOCK;
+
+    size_t n = 0;
+    frame[n++] = EVENT_CODEC_MAGIC;
+    frame[n++] = EVENT_CODEC_VERSION;
+    uint8_t *flags_pos = &frame[n++];
+    frame[n++] = (uint8_t)count;
+    put32(&frame[n], events[0].timestamp_ms);
+    n += 4;
+    if (base_unix_us) {
+        put32(&frame[n], (uint32_t)base_unix_us);
+        put32(&frame[n + 4], (uint32_t)(base_unix_us >> 32));
+        put32(&frame[n + 8], (uint32_t)drift_ppb);
+        n += 12;
+    }
+    frame[n++] = (uint8_t)id_len;
+    memcpy(&frame[n], reader_id, id_len);
+    n += id_len;
+    frame[n++] = (uint8_t)body_len;
+    frame[n++] = (uint8_t)(body_len >> 8);
+
+    // LZ só quando ganha; senão o corpo vai como está
+    size_t lz_len = 0;
+    if (mode == EVENT_CODEC_LZ) {
+        lz_len = lz_compress(body, body_len, &frame[n], EVENT_CODEC_FRAME_MAX - n);
+    }
+    if (lz_len > 0 && lz_len < body_len) {
+        flags |= EVENT_CODEC_FLAG_LZ;
+        n += lz_len;
+    } else {
+        memcpy(&frame[n], body, body_len);
+        n += body_len;
+    }
+    *flags_pos = flags;
+    *frame_len = n;
+    return count;
+}
+
+int event_codec_decode(const uint8_t *frame, size_t len, event_codec_header_t *hdr,
+                       rfid_event_t *events, uint32_t max) {
+    size_t n = 0;
+    if (len < 10 || frame[0] != EVENT_CODEC_MAGIC || frame[1] != EVENT_CODEC_VERSION) return -1;
+
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->flags = frame[2];
+    hdr->count = frame[3];
+    hdr->base_ts_ms = get32(&frame[4]);
+    n = 8;
+    if (hdr->flags & EVENT_CODEC_FLAG_CLOCK) {
+        if (n + 12 > len) return -1;
+        hdr->base_unix_us = get32(&frame[n]) | ((uint64_t)get32(&frame[n + 4]) << 32);
+        hdr->drift_ppb = (int32_t)get32(&frame[n + 8]);
+        n += 12;
+    }
+    if (n >= len || frame[n] > 32 || n + 1 + frame[n] + 2 > len) return -1;
+    memcpy(hdr->id, &frame[n + 1], frame[n]);
+    hdr->id[frame[n]] = '\0';
+    n += 1 + frame[n];
+    size_t body_len = frame[n] | ((size_t)frame[n + 1] << 8);
+    n += 2;
+    if (body_len > EVENT_CODEC_BODY_MAX) return -1;
+
+    // O corpo comprimido vai até o trailer da assinatura:
+    // contador (8), MAC e o tamanho do MAC no último byte
+    size_t end = len;
+    if (hdr->flags & EVENT_CODEC_FLAG_SIGNED) {
+        size_t trailer = 8 + (size_t)frame[len - 1] + 1;
+        if (len < n + trailer) return -1;
+        end = len - trailer;
+    }
+    hdr->signed_len = end;
+
+    uint8_t plain[EVENT_CODEC_BODY_MAX];
+    const uint8_t *p = &frame[n];
+    if (hdr->flags & EVENT_CODEC_FLAG_LZ) {
+        if (lz_decompress(&frame[n], end - n, plain, body_len) != 0) return -1;
+        p = plain;
+    } else if (end - n != body_len) {
+        return -1;
+    }
+    return decode_body(p, body_len, hdr->count, hdr->base_ts_ms, events, max);
+}
+
+bool event_codec_unix_us(const event_codec_header_t *hdr, const rfid_event_t *ev,
+                         uint64_t *unix_us) {
+    if (!(hdr->flags & EVENT_CODEC_FLAG_CLOCK) || (ev->flags & EVENT_FLAG_RESTORED)) return false;
+    int64_t dt_us = (int64_t)(int32_t)(ev->timestamp_ms - hdr->base_ts_ms) * 1000;
+    *unix_us = hdr->base_unix_us + dt_us + dt_us * hdr->drift_ppb / 1000000000;
+    return true;
+}
+
+// --- Medição ---
+
+size_t event_codec_json_size(const rfid_event_t *ev, bool with_ts) {
+    // Mesmo formato de publish_rfid_tag; ts_us tem 16 dígitos até 2286
+    int n = snprintf(NULL, 0, "{\"tag\":\"\",\"timestamp\":%lu,\"reader\":\"PicoW\"}",
+                     (unsigned long)ev->timestamp_ms);
+    n += 2 * ev->uid_size;
+    if (ev->flags & EVENT_FLAG_RESTORED) {
+        n += (int)strlen(",\"restored\":true");
+    } else if (with_ts) {
+        n += (int)strlen(",\"ts_us\":") + 16;
+    }
+    return (size_t)n;
+}
+
+static uint32_t lcg(uint32_t *state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+void event_codec_synth_trace(rfid_event_t *events, uint32_t count, uint32_t markers,
+                             uint32_t seed) {
+    uint32_t rnd = seed;
+    uint32_t ts = 1000 + lcg(&rnd) % 1000;
+    uint32_t marker = 0;
+    uint32_t lap_speed = 100;   // % do tempo nominal de cada trecho
+
+    if (markers == 0) markers = 1;
+    for (uint32_t i = 0; i < count; i++) {
+        rfid_event_t *ev = &events[i];
+        memset(ev, 0, sizeof(*ev));
+        ev->flags = EVENT_FLAG_RESTORED;    // Fila de uma queda: boot anterior
+
+        uint32_t kind = lcg(&rnd) % 100;
+        if (kind < 25) {
+            // Inventário: etiquetas de 4 bytes vistas ao longo do caminho
+            uint32_t tag = lcg(&rnd) % 40;
+            ev->uid_size = 4;
+            ev->uid[0] = 0x3A;
+            ev->uid[1] = (uint8_t)(tag * 37);
+            ev->uid[2] = (uint8_t)(tag * 11 + 5);
+            ev->uid[3] = (uint8_t)tag;
+            ts += 200 + lcg(&rnd) % 1500;
+        } else {
+            // Marcador do trilho (NTAG, 7 bytes); trechos de 4 a 9 s
+            ev->uid_size = 7;
+            ev->uid[0] = 0x04;
+            ev->uid[1] = 0xA0 | (uint8_t)(marker >> 4);
+            ev->uid[2] = (uint8_t)(marker * 29);
+            ev->uid[3] = 0x5C;
+            ev->uid[4] = (uint8_t)(marker * 53 + 1);
+            ev->uid[5] = 0x7E;
+            ev->uid[6] = 0x80;
+            uint32_t nominal = 4000 + (marker * 977) % 5000;
+            ts += nominal * lap_speed / 100 + lcg(&rnd) % 60;
+
+            // Parada no marcador: releituras a cada ~3 s
+            if (kind >= 95 && i + 1 < count) {
+                rfid_event_t *again = &events[++i];
+                *again = *ev;
+                again->timestamp_ms = ts + 3000 + lcg(&rnd) % 500;
+                ev->timestamp_ms = ts;
+                ts = again->timestamp_ms;
+                ev = again;
+            }
+            if (++marker == markers) {
+                marker = 0;
+                lap_speed = 90 + lcg(&rnd) % 21;
+            }
+        }
+        ev->timestamp_ms = ts;
+    }
+}
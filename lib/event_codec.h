@@ -0,0 +1,103 @@
+/**
+ * event_codec.h
+ *
+ * Quadros binários compactos para escoar a fila pendente depois de uma
+ * queda longa: em vez de um JSON de ~70 bytes por leitura, um quadro
+ * com dezenas de eventos publicado em 'topic_batch'.
+ *
+ * Duas etapas (batch_codec):
+ *  1. delta + dicionário: timestamp como diferença para o evento anterior
+ *     (varint zigzag, em ms) e UID como índice num dicionário de
+ *     EVENT_CODEC_DICT_SIZE entradas montado no próprio quadro;
+ *  2. LZSS (opcional, estilo heatshrink) sobre o resultado da etapa 1:
+ *     pega as sequências repetidas de marcadores de um AGV em circuito.
+ *
+ * Quadro (little-endian):
+ *   magic 0xEB, versão, flags, count, base_ts_ms (u32)
+ *   [CLOCK: base_unix_us (u64) e drift_ppb (i32) para reconstruir ts_us]
+ *   id_len, id (mqtt_client_id), body_len (u16, etapa 1), corpo
+ *   [SIGNED: contador (u64), MAC e tamanho do MAC (u8), acrescentados por
+ *    event_auth_sign_bin; o MAC cobre o tópico, o quadro e o contador]
+ *
+ * Código C puro (sem SDK): o mesmo arquivo decodifica no PC
+ * (tools/event_decode.c) e mede a compressão em traços. O codificador usa
+ * buffers estáticos: chamar de um único contexto (o que escoa a fila).
+ */
+
+#ifndef EVENT_CODEC_H
+#define EVENT_CODEC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "event_queue.h"
+
+#define EVENT_CODEC_MAGIC       0xEB
+#define EVENT_CODEC_VERSION     1
+#define EVENT_CODEC_BATCH_MAX   64      // Eventos por quadro
+#define EVENT_CODEC_BODY_MAX    896     // Corpo da etapa 1
+#define EVENT_CODEC_FRAME_MAX   1024    // Quadro sem a assinatura
+#define EVENT_CODEC_DICT_SIZE   64
+
+// batch_codec
+#define EVENT_CODEC_OFF         0
+#define EVENT_CODEC_DELTA       1       // Delta + dicionário
+#define EVENT_CODEC_LZ          2       // Delta + dicionário + LZSS
+
+// Flags do quadro
+#define EVENT_CODEC_FLAG_LZ     0x01
+#define EVENT_CODEC_FLAG_SIGNED 0x02
+#define EVENT_CODEC_FLAG_CLOCK  0x04
+
+typedef struct {
+    uint8_t flags;
+    uint8_t count;
+    uint32_t base_ts_ms;
+    uint64_t base_unix_us;      // Com EVENT_CODEC_FLAG_CLOCK
+    int32_t drift_ppb;
+    char id[33];
+    size_t signed_len;          // Tamanho do quadro sem o trailer da assinatura
+} event_codec_header_t;
+
+/**
+ * @brief Codifica eventos num quadro, até o limite de tamanho.
+ * @param base_unix_us Instante Unix (µs) de events[0].timestamp_ms no relógio
+ * comum, ou 0 sem sincronização.
+ * @param sign Marca o quadro como assinado (o chamador acrescenta o trailer
+ * com event_auth_sign_bin).
+ * @param frame Buffer de EVENT_CODEC_FRAME_MAX bytes.
+ * @return O número de eventos que couberam (0 em caso de erro);
+ * o tamanho do quadro em *frame_len.
+ */
+uint32_t event_codec_encode(const rfid_event_t *events, uint32_t count, uint8_t mode,
+                            uint64_t base_unix_us, int32_t drift_ppb, const char *reader_id,
+                            bool sign, uint8_t *frame, size_t *frame_len);
+
+/**
+ * @brief Decodifica um quadro. ts_us dos eventos: ver event_codec_unix_us().
+ * @return O número de eventos, ou -1 se o quadro é inválido.
+ */
+int event_codec_decode(const uint8_t *frame, size_t len, event_codec_header_t *hdr,
+                       rfid_event_t *events, uint32_t max);
+
+/**
+ * @brief Instante Unix (µs) de um evento decodificado (não restaurado, em
+ * quadro com relógio). Resolução de 1 ms.
+ */
+bool event_codec_unix_us(const event_codec_header_t *hdr, const rfid_event_t *ev,
+                         uint64_t *unix_us);
+
+/**
+ * @brief Tamanho do JSON individual equivalente (medida de compressão).
+ */
+size_t event_codec_json_size(const rfid_event_t *ev, bool with_ts);
+
+/**
+ * @brief Traço sintético para medições: AGV em circuito por 'markers'
+ * marcadores com variação de velocidade, intercalado com leituras de
+ * inventário (UIDs de 4 e 7 bytes).
+ */
+void event_codec_synth_trace(rfid_event_t *events, uint32_t count, uint32_t markers,
+                             uint32_t seed);
+
+#endif // EVENT_CODEC_H
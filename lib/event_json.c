@@ -0,0 +1,29 @@
+#include "event_json.h"
+#include <stdio.h>
+
+void event_json_uid_hex(const uint8_t *uid, uint8_t uid_size, char *out) {
+    static const char hex[] = "0123456789ABCDEF";
+
+    if (uid_size > EVENT_UID_MAX) uid_size = EVENT_UID_MAX;
+    // Sem sprintf por byte: roda a cada leitura, no caminho de publicação
+    for (uint8_t i = 0; i < uid_size; i++) {
+        out[i * 2] = hex[uid[i] >> 4];
+        out[i * 2 + 1] = hex[uid[i] & 0x0F];
+    }
+    out[uid_size * 2] = '\0';
+}
+
+int event_json_format(const rfid_event_t *ev, const uint64_t *ts_us, char *buf, size_t len) {
+    char uid_str[EVENT_JSON_UID_HEX_SIZE];
+    const char *restored = (ev->flags & EVENT_FLAG_RESTORED) ? ",\"restored\":true" : "";
+
+    event_json_uid_hex(ev->uid, ev->uid_size, uid_str);
+    if (ts_us != NULL) {
+        return snprintf(buf, len,
+                        "{\"tag\":\"%s\",\"timestamp\":%lu,\"reader\":\"PicoW\",\"ts_us\":%llu%s}",
+                        uid_str, (unsigned long)ev->timestamp_ms,
+                        (unsigned long long)*ts_us, restored);
+    }
+    return snprintf(buf, len, "{\"tag\":\"%s\",\"timestamp\":%lu,\"reader\":\"PicoW\"%s}",
+                    uid_str, (unsigned long)ev->timestamp_ms, restored);
+}
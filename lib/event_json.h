@@ -0,0 +1,45 @@
+/**
+ * event_json.h
+ *
+ * Payload JSON de uma leitura, publicado em topic_rfid (ou na rota da
+ * regra que casou):
+ *
+ *   {"tag":"04A1B2C3","timestamp":123456,"reader":"PicoW"}
+ *
+ * com ,"ts_us":N quando o relógio comum está sincronizado (time_sync.h) e
+ * ,"restored":true nos eventos restaurados da flash. A assinatura
+ * (event_auth.h) é acrescentada depois, por quem publica.
+ *
+ * Sem acesso a hardware: usado pelos dois firmwares, pelo RFID_BENCH e
+ * pelos benchmarks, testado no PC (tests/).
+ */
+
+#ifndef EVENT_JSON_H
+#define EVENT_JSON_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "event_queue.h"
+
+// UID em hexadecimal maiúsculo, com o terminador
+#define EVENT_JSON_UID_HEX_SIZE  (EVENT_UID_MAX * 2 + 1)
+
+// Maior payload (UID de 10 bytes, ts_us e restored), com o terminador
+#define EVENT_JSON_MAX           160
+
+/**
+ * @brief Converte o UID para hexadecimal maiúsculo (ex: "A1B2C3D4").
+ * @param out Pelo menos EVENT_JSON_UID_HEX_SIZE bytes.
+ */
+void event_json_uid_hex(const uint8_t *uid, uint8_t uid_size, char *out);
+
+/**
+ * @brief Monta o payload de uma leitura.
+ * @param ts_us Instante no relógio comum (us desde a época Unix), ou NULL
+ * se o relógio não está sincronizado.
+ * @return O número de caracteres do payload (como snprintf; >= len se não
+ * coube).
+ */
+int event_json_format(const rfid_event_t *ev, const uint64_t *ts_us, char *buf, size_t len);
+
+#endif // EVENT_JSON_H
@@ -0,0 +1,51 @@
+#include "event_pipeline.h"
+#include <string.h>
+
+void event_pipeline_init(event_pipeline_t *p, const event_pipeline_ops_t *ops,
+                         uint32_t burst, uint32_t priority_reserve) {
+    memset(p, 0, sizeof(*p));
+    p->ops = ops;
+    p->burst = burst;
+    p->priority_reserve = priority_reserve;
+}
+
+bool event_pipeline_deliver(event_pipeline_t *p, const rfid_event_t *ev) {
+    bool direct = (ev->flags & EVENT_FLAG_PRIORITY) ||
+                  (event_queue_count() == 0 && p->ops->window_free() > p->priority_reserve);
+    if (direct && p->ops->online() && p->ops->publish(ev)) {
+        p->direct++;
+        return true;
+    }
+
+    p->queued++;
+    if (!event_queue_push(ev)) {
+        p->dropped++;
+        return false;
+    }
+    return true;
+}
+
+uint32_t event_pipeline_drain(event_pipeline_t *p) {
+    const rfid_event_t *ev;
+    uint32_t sent = 0;
+
+    while (p->ops->online() && (ev = event_queue_peek()) != NULL) {
+        bool priority = ev->flags & EVENT_FLAG_PRIORITY;
+        if (!priority && (sent >= p->burst || p->ops->window_free() <= p->priority_reserve)) {
+            break;
+        }
+
+        uint32_t batched = 0;
+        if (!priority && p->ops->publish_batch != NULL) {
+            batched = p->ops->publish_batch();  // Já remove os eventos do lote
+        }
+        if (batched == 0) {
+            if (!p->ops->publish(ev)) break;   // Janela cheia: tenta na próxima rodada
+            event_queue_pop();
+            batched = 1;
+        }
+        p->drained += batched;
+        sent++;
+    }
+    return sent;
+}
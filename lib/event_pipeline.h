@@ -0,0 +1,67 @@
+/**
+ * event_pipeline.h
+ *
+ * Política de publicação das leituras, entre o barramento de eventos e o
+ * transporte (sink MQTT e escoamento da fila pendente):
+ *
+ *  - Entrega: publica direto se o evento é prioritário ou se não há fila
+ *    pendente e a janela de publicações tem folga além da reserva; senão
+ *    (ou se o transporte recusar) guarda na fila da sua classe. Nunca
+ *    aplica contrapressão: a fila na flash é quem absorve as quedas.
+ *  - Escoamento: enquanto conectado, os prioritários saem primeiro e fora
+ *    do limite da rodada; os comuns saem até 'burst' por rodada e param
+ *    antes de ocupar a reserva da janela. Com a fila comum longa, um lote
+ *    binário (event_batch.h) pode substituir o JSON por evento.
+ *
+ * O transporte e a montagem do payload vêm de quem usa (ops), então a
+ * política roda igual no firmware bare-metal, na variante FreeRTOS, nos
+ * benchmarks sobre o broker simulado e nos testes no PC (tests/).
+ */
+
+#ifndef EVENT_PIPELINE_H
+#define EVENT_PIPELINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "event_queue.h"
+
+typedef struct {
+    bool (*online)(void);                   // Transporte conectado
+    uint32_t (*window_free)(void);          // Vagas na janela de publicações
+    bool (*publish)(const rfid_event_t *ev);  // Monta e publica um evento
+    uint32_t (*publish_batch)(void);        // Lote da fila comum (NULL: sem lotes);
+                                            // eventos publicados, 0 se não se aplica
+} event_pipeline_ops_t;
+
+typedef struct {
+    const event_pipeline_ops_t *ops;
+    uint32_t burst;             // Eventos comuns por rodada de escoamento
+    uint32_t priority_reserve;  // Vagas da janela nunca ocupadas por comuns
+    uint32_t direct;            // Publicados direto na entrega
+    uint32_t queued;            // Guardados na fila pendente
+    uint32_t drained;           // Publicados pelo escoamento (inclui lotes)
+    uint32_t dropped;           // Descartes da fila cheia na entrega
+} event_pipeline_t;
+
+/**
+ * @brief Inicializa a política com o transporte e os limites.
+ * @param burst Máximo de envios comuns por rodada (PUBLISH_BURST).
+ * @param priority_reserve Vagas da janela reservadas aos prioritários.
+ */
+void event_pipeline_init(event_pipeline_t *p, const event_pipeline_ops_t *ops,
+                         uint32_t burst, uint32_t priority_reserve);
+
+/**
+ * @brief Entrega de um evento (corpo do sink MQTT).
+ * @return false se o evento foi para a fila cheia e o mais antigo da
+ * classe foi descartado; true se publicado ou enfileirado sem perda.
+ */
+bool event_pipeline_deliver(event_pipeline_t *p, const rfid_event_t *ev);
+
+/**
+ * @brief Uma rodada de escoamento da fila pendente.
+ * @return O número de envios aceitos (eventos ou lotes).
+ */
+uint32_t event_pipeline_drain(event_pipeline_t *p);
+
+#endif // EVENT_PIPELINE_H
@@ -0,0 +1,263 @@
+#include "event_queue.h"
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "hardware/flash.h"
+#include "flash_layout.h"
+#include "rfid_config.h"
+
+#define EVENT_QUEUE_MAGIC       0x45565451u  // "EVTQ"
+#define EVENT_QUEUE_VERSION     2   // v2: campo detect_us
+
+// Intervalo mínimo entre gravações na flash
+#define PERSIST_INTERVAL_MS     10000
+
+// Cabeçalho do snapshot gravado no setor da fila
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t crc;       // CRC-32 dos 'count' eventos seguintes
+} event_queue_header_t;
+
+#define TOTAL_CAPACITY  (EVENT_QUEUE_CAPACITY + EVENT_QUEUE_PRIORITY_CAPACITY)
+
+_Static_assert(sizeof(event_queue_header_t) +
+               TOTAL_CAPACITY * sizeof(rfid_event_t) <= FLASH_EVENT_QUEUE_SIZE,
+               "fila de eventos nao cabe no setor reservado");
+
+// Uma fila circular por classe de evento
+typedef struct {
+    rfid_event_t *ring;
+    uint32_t capacity;
+    uint32_t head;              // Próximo a sair
+    uint32_t count;
+    uint32_t dropped;
+} lane_t;
+
+static rfid_event_t bulk_ring[EVENT_QUEUE_CAPACITY];
+static rfid_event_t priority_ring[EVENT_QUEUE_PRIORITY_CAPACITY];
+
+static lane_t lanes[EVENT_CLASS_COUNT] = {
+    [EVENT_CLASS_BULK] = { .ring = bulk_ring, .capacity = EVENT_QUEUE_CAPACITY },
+    [EVENT_CLASS_PRIORITY] = { .ring = priority_ring, .capacity = EVENT_QUEUE_PRIORITY_CAPACITY },
+};
+static lane_t *peeked = NULL;   // Fila do evento retornado pelo último peek
+static uint32_t peeked_n = 0;   // Eventos do peek (a partir da cabeça)
+static uint32_t count = 0;      // Total das filas
+
+static bool dirty = false;      // Fila mudou desde o último snapshot
+static uint32_t flash_count = 0;  // Eventos no snapshot gravado
+static absolute_time_t last_persist;
+
+// Trava opcional (variante FreeRTOS): só nas operações sobre as filas,
+// nunca durante a publicação ou a gravação na flash
+static void (*lock_fn)(void) = NULL;
+static void (*unlock_fn)(void) = NULL;
+
+static void lock(void) {
+    if (lock_fn) lock_fn();
+}
+
+static void unlock(void) {
+    if (unlock_fn) unlock_fn();
+}
+
+void event_queue_set_lock(void (*lock_hook)(void), void (*unlock_hook)(void)) {
+    lock_fn = lock_hook;
+    unlock_fn = unlock_hook;
+}
+
+static bool lane_push(lane_t *lane, const rfid_event_t *ev) {
+    bool kept_all = true;
+    if (lane->count == lane->capacity) {
+        lane->head = (lane->head + 1) % lane->capacity;
+        lane->count--;
+        lane->dropped++;
+        count--;
+        kept_all = false;
+        // A cabeça do peek saiu: pop não remove outro evento
+        if (peeked == lane && --peeked_n == 0) peeked = NULL;
+    }
+    lane->ring[(lane->head + lane->count) % lane->capacity] = *ev;
+    lane->count++;
+    count++;
+    return kept_all;
+}
+
+bool event_queue_push(const rfid_event_t *ev) {
+    lock();
+    dirty = true;
+    bool kept_all = lane_push(&lanes[EVENT_CLASS(ev)], ev);
+    unlock();
+    return kept_all;
+}
+
+const rfid_event_t *event_queue_peek(void) {
+    lock();
+    peeked = lanes[EVENT_CLASS_PRIORITY].count ? &lanes[EVENT_CLASS_PRIORITY]
+           : lanes[EVENT_CLASS_BULK].count ? &lanes[EVENT_CLASS_BULK] : NULL;
+    peeked_n = 1;
+    const rfid_event_t *ev = peeked ? &peeked->ring[peeked->head] : NULL;
+    unlock();
+    return ev;
+}
+
+uint32_t event_queue_peek_batch(rfid_event_t *out, uint32_t max) {
+    lane_t *lane = &lanes[EVENT_CLASS_BULK];
+    lock();
+    if (lanes[EVENT_CLASS_PRIORITY].count || lane->count == 0) {
+        unlock();
+        return 0;
+    }
+
+    uint32_t n = lane->count < max ? lane->count : max;
+    for (uint32_t i = 0; i < n; i++) {
+        out[i] = lane->ring[(lane->head + i) % lane->capacity];
+    }
+    peeked = lane;
+    peeked_n = n;
+    unlock();
+    return n;
+}
+
+void event_queue_pop(void) {
+    event_queue_pop_n(1);
+}
+
+void event_queue_pop_n(uint32_t n) {
+    lock();
+    if (peeked != NULL) {
+        if (n > peeked_n) n = peeked_n;
+        peeked->head = (peeked->head + n) % peeked->capacity;
+        peeked->count -= n;
+        peeked = NULL;
+        count -= n;
+        dirty = true;
+    }
+    unlock();
+}
+
+uint32_t event_queue_count(void) {
+    return count;
+}
+
+uint32_t event_queue_dropped(void) {
+    return lanes[EVENT_CLASS_BULK].dropped + lanes[EVENT_CLASS_PRIORITY].dropped;
+}
+
+uint32_t event_queue_class_count(uint8_t cls) {
+    return cls < EVENT_CLASS_COUNT ? lanes[cls].count : 0;
+}
+
+uint32_t event_queue_class_dropped(uint8_t cls) {
+    return cls < EVENT_CLASS_COUNT ? lanes[cls].dropped : 0;
+}
+
+uint32_t event_queue_restore(void) {
+    const uint8_t *sector = FLASH_XIP_PTR(FLASH_EVENT_QUEUE_OFFSET);
+    event_queue_header_t hdr;
+    memcpy(&hdr, sector, sizeof(hdr));
+
+    last_persist = get_absolute_time();
+
+    if (hdr.magic != EVENT_QUEUE_MAGIC || hdr.version != EVENT_QUEUE_VERSION ||
+        hdr.count == 0 || hdr.count > TOTAL_CAPACITY) {
+        return 0;
+    }
+
+    const uint8_t *payload = sector + sizeof(hdr);
+    if (rfid_crc32(payload, hdr.count * sizeof(rfid_event_t)) != hdr.crc) {
+        printf("[QUEUE] ERRO: CRC invalido, fila salva descartada\n");
+        return 0;
+    }
+
+    // Cada evento volta para a fila da sua classe (a flag vai junto)
+    for (uint32_t i = 0; i < hdr.count; i++) {
+        rfid_event_t ev;
+        memcpy(&ev, payload + i * sizeof(rfid_event_t), sizeof(ev));
+        ev.flags |= EVENT_FLAG_RESTORED;
+        lane_push(&lanes[EVENT_CLASS(&ev)], &ev);
+    }
+    flash_count = hdr.count;
+
+    // O snapshot continua na flash até a fila ser salva de novo
+    printf("[QUEUE] %lu eventos restaurados da flash\n", (unsigned long)count);
+    return count;
+}
+
+// --- Gravação ---
+
+// Registro montado em RAM: cabeçalho + eventos em ordem, arredondado em páginas
+static uint8_t record[FLASH_EVENT_QUEUE_SIZE];
+static uint32_t record_size;
+
+// Executada com o outro core e as interrupções pausados por flash_safe_execute
+static void program_sector(void *param) {
+    (void)param;
+    flash_range_erase(FLASH_EVENT_QUEUE_OFFSET, FLASH_EVENT_QUEUE_SIZE);
+    flash_range_program(FLASH_EVENT_QUEUE_OFFSET, record, record_size);
+}
+
+int event_queue_persist(bool force) {
+    lock();
+    if (!dirty) {
+        unlock();
+        return 0;
+    }
+
+    // Online a fila esvazia logo após cada leitura: nada a gravar
+    if (count == 0 && flash_count == 0) {
+        dirty = false;
+        unlock();
+        return 0;
+    }
+
+    absolute_time_t now = get_absolute_time();
+    if (!force && absolute_time_diff_us(last_persist, now) / 1000 < PERSIST_INTERVAL_MS) {
+        unlock();
+        return 0;
+    }
+
+    // Snapshot com a trava; a gravação (lenta) fica fora dela
+    uint32_t saved = count;
+    event_queue_header_t hdr = {
+        .magic = EVENT_QUEUE_MAGIC,
+        .version = EVENT_QUEUE_VERSION,
+        .count = (uint16_t)saved
+    };
+
+    // Prioritários primeiro, cada fila em ordem
+    uint8_t *events = record + sizeof(hdr);
+    uint32_t n = 0;
+    for (int cls = EVENT_CLASS_COUNT - 1; cls >= 0; cls--) {
+        const lane_t *lane = &lanes[cls];
+        for (uint32_t i = 0; i < lane->count; i++) {
+            memcpy(events + n++ * sizeof(rfid_event_t),
+                   &lane->ring[(lane->head + i) % lane->capacity], sizeof(rfid_event_t));
+        }
+    }
+    dirty = false;
+    last_persist = now;
+    unlock();
+
+    hdr.crc = rfid_crc32(events, saved * sizeof(rfid_event_t));
+    memcpy(record, &hdr, sizeof(hdr));
+
+    uint32_t used = sizeof(hdr) + saved * sizeof(rfid_event_t);
+    record_size = (used + FLASH_PAGE_SIZE - 1) & ~(FLASH_PAGE_SIZE - 1);
+    memset(record + used, 0xFF, record_size - used);
+
+    int rc = flash_safe_execute(program_sector, NULL, 1000);
+    lock();
+    if (rc != PICO_OK) {
+        dirty = true;   // Tenta de novo no próximo intervalo
+        unlock();
+        printf("[QUEUE] ERRO ao gravar na flash! Codigo: %d\n", rc);
+        return -1;
+    }
+    flash_count = saved;
+    unlock();
+    return 0;
+}
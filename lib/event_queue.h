@@ -0,0 +1,114 @@
+/**
+ * event_queue.h
+ *
+ * Fila de eventos de tag pendentes de publicação.
+ *
+ * Leituras feitas sem conexão MQTT ficam num buffer circular em RAM e são
+ * publicadas em ordem quando o broker volta. A fila é salva num setor da
+ * flash (com limite de frequência, para poupar a flash) e restaurada no
+ * boot, de modo que um reset do watchdog não perde leituras.
+ *
+ * Duas classes, cada uma com a sua fila: eventos prioritários (marcados
+ * por regra: pontos de parada, cruzamentos) saem sempre antes dos comuns,
+ * e a fila comum cheia nunca descarta um prioritário.
+ *
+ * Push, peek e pop vêm de um único contexto (quem publica). Com uma trava
+ * definida por event_queue_set_lock(), outro contexto pode gravar a fila
+ * (ex: o gancho de pré-reset) sem ver um estado pela metade; o evento do
+ * peek só muda com o pop de quem publica, então é lido sem a trava.
+ * Gravações na flash de contextos diferentes ficam a cargo de quem chama.
+ */
+
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define EVENT_QUEUE_CAPACITY    128   // Eventos comuns (20 bytes cada)
+#define EVENT_QUEUE_PRIORITY_CAPACITY 16  // Eventos prioritários
+#define EVENT_UID_MAX           10
+
+// Flags de evento
+#define EVENT_FLAG_RESTORED     0x01  // Veio da flash (timestamp do boot anterior)
+#define EVENT_FLAG_PRIORITY     0x02  // Classe prioritária (ver rules.h)
+
+// Classes de evento (índice das filas e das medidas de latência)
+#define EVENT_CLASS_BULK        0
+#define EVENT_CLASS_PRIORITY    1
+#define EVENT_CLASS_COUNT       2
+#define EVENT_CLASS(ev)         (((ev)->flags & EVENT_FLAG_PRIORITY) ? EVENT_CLASS_PRIORITY \
+                                                                     : EVENT_CLASS_BULK)
+
+// Evento de leitura de tag
+typedef struct {
+    uint8_t uid[EVENT_UID_MAX];
+    uint8_t uid_size;
+    uint8_t flags;
+    uint32_t timestamp_ms;      // ms desde o boot em que foi lido
+    uint32_t detect_us;         // time_us_32() da leitura (medida de latência)
+} rfid_event_t;
+
+/**
+ * @brief Define a trava das filas (NULL: um único contexto, sem trava).
+ *
+ * Tomada só durante cada operação e a cópia do snapshot, nunca durante a
+ * publicação nem a gravação na flash.
+ */
+void event_queue_set_lock(void (*lock_hook)(void), void (*unlock_hook)(void));
+
+/**
+ * @brief Enfileira um evento na fila da sua classe. Com a fila cheia,
+ * descarta o mais antigo da mesma classe.
+ * @return false se um evento antigo foi descartado.
+ */
+bool event_queue_push(const rfid_event_t *ev);
+
+/**
+ * @brief Retorna o próximo evento sem removê-lo (NULL se vazia): o mais
+ * antigo dos prioritários ou, se não há nenhum, o mais antigo dos comuns.
+ */
+const rfid_event_t *event_queue_peek(void);
+
+/**
+ * @brief Remove o evento retornado pelo último peek (após publicação aceita).
+ */
+void event_queue_pop(void);
+
+/**
+ * @brief Copia até 'max' eventos comuns do início da fila, para um quadro
+ * em lote (lib/event_codec.h). Retorna 0 enquanto há prioritários.
+ * @return O número de eventos copiados.
+ */
+uint32_t event_queue_peek_batch(rfid_event_t *out, uint32_t max);
+
+/**
+ * @brief Remove os 'n' primeiros eventos do último peek (os que couberam
+ * no quadro publicado).
+ */
+void event_queue_pop_n(uint32_t n);
+
+// Total das duas classes
+uint32_t event_queue_count(void);
+uint32_t event_queue_dropped(void);
+
+uint32_t event_queue_class_count(uint8_t cls);
+uint32_t event_queue_class_dropped(uint8_t cls);
+
+/**
+ * @brief Restaura a fila salva na flash (chamar uma vez no boot).
+ * @return O número de eventos restaurados.
+ */
+uint32_t event_queue_restore(void);
+
+/**
+ * @brief Salva a fila na flash se mudou e se passou o intervalo mínimo.
+ *
+ * Uma fila vazia só é gravada para apagar um snapshot anterior, então
+ * com o broker conectado a flash não é escrita a cada leitura.
+ * @param force Ignora o intervalo mínimo (ex: antes de um reset).
+ * @return 0 se salvou ou não havia nada a salvar, -1 em caso de falha.
+ */
+int event_queue_persist(bool force);
+
+#endif // EVENT_QUEUE_H
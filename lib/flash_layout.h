@@ -0,0 +1,69 @@
+/**
+ * flash_layout.h
+ *
+ * Mapa das regiões reservadas no final da flash do Pico W.
+ *
+ * O firmware ocupa o início da flash; as regiões de dados ficam no final,
+ * alinhadas em setores (4 KB), e crescem "para baixo" a partir do topo.
+ * Todos os offsets são relativos ao início da flash (não ao XIP_BASE).
+ */
+
+#ifndef FLASH_LAYOUT_H
+#define FLASH_LAYOUT_H
+
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+
+// Último setor: configuração de runtime (rfid_config)
+#define FLASH_CONFIG_OFFSET     (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+#define FLASH_CONFIG_SIZE       FLASH_SECTOR_SIZE
+
+// Penúltimo setor: fila de eventos pendentes (event_queue)
+#define FLASH_EVENT_QUEUE_OFFSET (FLASH_CONFIG_OFFSET - FLASH_SECTOR_SIZE)
+#define FLASH_EVENT_QUEUE_SIZE   FLASH_SECTOR_SIZE
+
+// Antepenúltimo setor: mapa tag -> posição dos marcadores do trilho (tag_map)
+#define FLASH_TAG_MAP_OFFSET    (FLASH_EVENT_QUEUE_OFFSET - FLASH_SECTOR_SIZE)
+#define FLASH_TAG_MAP_SIZE      FLASH_SECTOR_SIZE
+
+// Quarto setor a partir do fim: época de boot dos contadores de event_auth
+#define FLASH_AUTH_EPOCH_OFFSET (FLASH_TAG_MAP_OFFSET - FLASH_SECTOR_SIZE)
+#define FLASH_AUTH_EPOCH_SIZE   FLASH_SECTOR_SIZE
+
+// Quinto setor a partir do fim: tabela de regras de borda (rules)
+#define FLASH_RULES_OFFSET      (FLASH_AUTH_EPOCH_OFFSET - FLASH_SECTOR_SIZE)
+#define FLASH_RULES_SIZE        FLASH_SECTOR_SIZE
+
+// Sexto setor a partir do fim: registro e marcas da atualização OTA (ota_slots)
+#define FLASH_OTA_CONTROL_OFFSET (FLASH_RULES_OFFSET - FLASH_SECTOR_SIZE)
+#define FLASH_OTA_CONTROL_SIZE   FLASH_SECTOR_SIZE
+
+// Sétimo setor a partir do fim: rascunho da troca de slots do bootloader
+#define FLASH_OTA_SCRATCH_OFFSET (FLASH_OTA_CONTROL_OFFSET - FLASH_SECTOR_SIZE)
+
+// Oitavo setor a partir do fim: último HardFault registrado (crash_dump)
+#define FLASH_CRASH_OFFSET      (FLASH_OTA_SCRATCH_OFFSET - FLASH_SECTOR_SIZE)
+#define FLASH_CRASH_SIZE        FLASH_SECTOR_SIZE
+
+// Nono setor a partir do fim: contadores dos comandos de cartão aceitos (card_ops)
+#define FLASH_CARD_CTR_OFFSET   (FLASH_CRASH_OFFSET - FLASH_SECTOR_SIZE)
+#define FLASH_CARD_CTR_SIZE     FLASH_SECTOR_SIZE
+
+// Início das regiões de dados: o firmware (ou o slot B) termina antes
+#define FLASH_DATA_OFFSET       FLASH_CARD_CTR_OFFSET
+
+// Com RFID_OTA (CMake), o bootloader ocupa o início da flash, o firmware
+// roda no slot A e o slot B recebe a imagem nova. O CMake define o tamanho
+// do slot para o script do linker; o padrão divide o espaço livre ao meio
+#define FLASH_OTA_BOOT_SIZE     (32 * 1024)
+#ifndef FLASH_OTA_SLOT_SIZE
+#define FLASH_OTA_SLOT_SIZE     (((FLASH_DATA_OFFSET - FLASH_OTA_BOOT_SIZE) / 2) & \
+                                 ~(FLASH_SECTOR_SIZE - 1))
+#endif
+#define FLASH_OTA_SLOT_A_OFFSET FLASH_OTA_BOOT_SIZE
+#define FLASH_OTA_SLOT_B_OFFSET (FLASH_OTA_SLOT_A_OFFSET + FLASH_OTA_SLOT_SIZE)
+
+// Ponteiro de leitura direta (XIP) para uma região da flash
+#define FLASH_XIP_PTR(offset)   ((const uint8_t *)(XIP_BASE + (offset)))
+
+#endif // FLASH_LAYOUT_H
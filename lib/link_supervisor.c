@@ -0,0 +1,160 @@
+#include "link_supervisor.h"
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "wifi_link.h"
+#include "mqtt_link.h"
+#include "mqttsn_link.h"
+#include "rfid_config.h"
+#include "crash_dump.h"
+
+static link_supervisor_stats_t stats;
+static bool net_ready = false;
+static bool link_was_up = false;
+
+// Retorno do link aguardando a primeira publicação
+static bool recovery_pending = false;
+static uint64_t recovery_start_us;
+
+// Transporte escolhido no boot (cfg transport); trocar exige reinício
+static bool use_mqttsn = false;
+
+static void transport_connect(void) {
+    if (use_mqttsn) {
+        mqttsn_link_connect();
+    } else {
+        mqtt_link_connect();
+    }
+}
+
+static void transport_disconnect(void) {
+    if (use_mqttsn) {
+        mqttsn_link_disconnect();
+    } else {
+        mqtt_link_disconnect();
+    }
+}
+
+static uint64_t transport_last_done_us(void) {
+    if (use_mqttsn) {
+        mqttsn_link_stats_t sn;
+        mqttsn_link_get_stats(&sn);
+        return sn.last_done_us;
+    }
+    mqtt_link_stats_t mqtt;
+    mqtt_link_get_stats(&mqtt);
+    return mqtt.last_done_us;
+}
+
+int link_supervisor_init(void (*on_mqtt_connected)(void)) {
+    use_mqttsn = rfid_config()->transport == 1;  // 1 = MQTT-SN (UDP)
+    if (use_mqttsn) {
+        mqttsn_link_init(on_mqtt_connected);
+    } else {
+        mqtt_link_init(on_mqtt_connected);
+    }
+    net_ready = wifi_link_init() == 0;
+    return net_ready ? 0 : -1;
+}
+
+void link_supervisor_service(void) {
+    if (!net_ready) return;
+
+    wifi_link_service();
+    bool up = wifi_link_is_up();
+
+    if (up != link_was_up) {
+        link_was_up = up;
+        crash_trace(CRASH_TRACE_LINK, up);
+
+        if (!up) {
+            // Sessão sem rota: encerra já, a fila guarda os eventos
+            stats.link_losses++;
+            recovery_pending = false;
+            printf("[LINK] Link perdido: leitura e fila continuam, MQTT suspenso\n");
+            transport_disconnect();
+        } else {
+            wifi_link_stats_t wifi;
+            wifi_link_get_stats(&wifi);
+            recovery_start_us = wifi.up_at_us;
+            recovery_pending = true;
+            transport_connect();  // Sem esperar reconnect_delay_ms
+        }
+    }
+
+    if (use_mqttsn) {
+        mqttsn_link_service(up);
+    } else {
+        mqtt_link_service(up);
+    }
+
+    if (recovery_pending) {
+        uint64_t done_us = transport_last_done_us();
+        if (done_us > recovery_start_us) {
+            uint32_t ttfp = (uint32_t)((done_us - recovery_start_us) / 1000);
+            recovery_pending = false;
+            stats.recoveries++;
+            stats.ttfp_last_ms = ttfp;
+            if (ttfp > stats.ttfp_max_ms) stats.ttfp_max_ms = ttfp;
+            printf("[LINK] Primeira publicacao %lu ms apos o link voltar\n",
+                   (unsigned long)ttfp);
+        }
+    }
+}
+
+bool link_supervisor_online(void) {
+    return use_mqttsn ? mqttsn_link_is_connected() : mqtt_link_is_connected();
+}
+
+bool link_supervisor_publish(const char *topic, const char *payload, uint8_t qos) {
+    if (use_mqttsn) {
+        return mqttsn_link_publish(topic, payload, qos);
+    }
+    return mqtt_link_publish(topic, payload, qos);
+}
+
+bool link_supervisor_publish_bin(const char *topic, const void *data, size_t len, uint8_t qos) {
+    // MQTT-SN (UDP) fica com um datagrama por evento
+    if (use_mqttsn) return false;
+    return mqtt_link_publish_bin(topic, data, len, qos);
+}
+
+uint32_t link_supervisor_window_free(void) {
+    return use_mqttsn ? mqttsn_link_window_free() : mqtt_link_window_free();
+}
+
+void link_supervisor_get_stats(link_supervisor_stats_t *out) {
+    *out = stats;
+}
+
+int link_supervisor_format_json(char *buf, size_t len) {
+    int n = use_mqttsn ? mqttsn_link_format_json(buf, len) : mqtt_link_format_json(buf, len);
+    if (n < 0 || (size_t)n >= len) return n;
+
+    return n + snprintf(buf + n, len - n,
+                        ",\"recovery\":{\"losses\":%lu,\"ttfp_ms\":%lu,\"ttfp_max_ms\":%lu}",
+                        (unsigned long)stats.link_losses, (unsigned long)stats.ttfp_last_ms,
+                        (unsigned long)stats.ttfp_max_ms);
+}
+
+void link_supervisor_print(void) {
+    if (use_mqttsn) {
+        mqttsn_link_stats_t sn;
+        mqttsn_link_get_stats(&sn);
+        printf("[LINK] MQTT-SN ida e volta (QoS 1): media %lu us, maxima %lu us (%lu acks)\n",
+               (unsigned long)sn.rtt_avg_us, (unsigned long)sn.rtt_max_us,
+               (unsigned long)sn.acks);
+        printf("[LINK] MQTT-SN: %lu enviadas, %lu retransmissoes, %lu perdidas, %lu bytes\n",
+               (unsigned long)sn.sent, (unsigned long)sn.retransmits,
+               (unsigned long)sn.lost, (unsigned long)sn.bytes_tx);
+    } else {
+        mqtt_link_stats_t mqtt;
+        mqtt_link_get_stats(&mqtt);
+        printf("[LINK] MQTT ida e volta (QoS 1): media %lu us, maxima %lu us (%lu acks)\n",
+               (unsigned long)mqtt.rtt_avg_us, (unsigned long)mqtt.rtt_max_us,
+               (unsigned long)mqtt.acks);
+    }
+    printf("[LINK] Quedas: %lu  retornos medidos: %lu\n",
+           (unsigned long)stats.link_losses, (unsigned long)stats.recoveries);
+    printf("[LINK] Tempo ate a primeira publicacao: ultimo %lu ms, maximo %lu ms\n",
+           (unsigned long)stats.ttfp_last_ms, (unsigned long)stats.ttfp_max_ms);
+}
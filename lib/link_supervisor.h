@@ -0,0 +1,89 @@
+/**
+ * link_supervisor.h
+ *
+ * Recuperação do enlace sem reinício: coordena o WiFi (wifi_link) e o
+ * transporte dos eventos a partir do estado do link. O transporte é o
+ * cliente MQTT/TCP (mqtt_link) ou, com 'cfg set transport 1', o MQTT-SN
+ * por UDP (mqttsn_link); o resto do firmware publica por aqui.
+ *
+ *  - Boot não bloqueante: o leitor começa a varrer e a registrar eventos
+ *    na fila enquanto o WiFi conecta em segundo plano.
+ *  - Queda do link: a sessão MQTT é encerrada na hora (os eventos seguem
+ *    para a fila e para a flash) e o WiFi reconecta com backoff.
+ *  - Retorno do link: o MQTT reconecta imediatamente, sem esperar o
+ *    reconnect_delay_ms, e a fila é escoada pelo loop normal.
+ *
+ * A medida principal é o tempo até a primeira publicação: do instante em
+ * que o link volta a ter IP até a primeira publicação concluída.
+ */
+
+#ifndef LINK_SUPERVISOR_H
+#define LINK_SUPERVISOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct {
+    uint32_t link_losses;       // Quedas do link WiFi
+    uint32_t recoveries;        // Retornos medidos até a primeira publicação
+    uint32_t ttfp_last_ms;      // Tempo até a primeira publicação (último retorno)
+    uint32_t ttfp_max_ms;
+} link_supervisor_stats_t;
+
+/**
+ * @brief Inicia o WiFi (assíncrono) e prepara o transporte da configuração.
+ * @param on_mqtt_connected Chamada a cada conexão aceita pelo broker.
+ * @return 0 em caso de sucesso, -1 se o cyw43 não iniciou (sem rede; não
+ * chamar cyw43_arch_poll()).
+ */
+int link_supervisor_init(void (*on_mqtt_connected)(void));
+
+/**
+ * @brief Acompanha o link e o broker. Chamar a cada iteração do loop
+ * principal (ou da tarefa de rede), depois de cyw43_arch_poll().
+ */
+void link_supervisor_service(void);
+
+/**
+ * @brief Indica se o transporte está conectado ao broker (ou gateway).
+ */
+bool link_supervisor_online(void);
+
+/**
+ * @brief Publica pelo transporte ativo.
+ * @return true se a mensagem foi aceita para envio.
+ */
+bool link_supervisor_publish(const char *topic, const char *payload, uint8_t qos);
+
+/**
+ * @brief Publica um payload binário; só no transporte MQTT/TCP.
+ * @return false no MQTT-SN ou se não foi aceito.
+ */
+bool link_supervisor_publish_bin(const char *topic, const void *data, size_t len, uint8_t qos);
+
+/**
+ * @brief Publicações QoS 1 que o transporte ativo ainda aceita antes de
+ * recusar por janela cheia (0 se desconectado).
+ */
+uint32_t link_supervisor_window_free(void);
+
+/**
+ * @brief Copia as medidas de recuperação.
+ */
+void link_supervisor_get_stats(link_supervisor_stats_t *stats);
+
+/**
+ * @brief Escreve as medidas do transporte e da recuperação como campos
+ * JSON (sem chaves externas).
+ * Ex: "mqtt_rtt_us":{...},"recovery":{"losses":2,"ttfp_ms":640,"ttfp_max_ms":2100}
+ * @return O número de caracteres escritos (como snprintf).
+ */
+int link_supervisor_format_json(char *buf, size_t len);
+
+/**
+ * @brief Imprime as medidas no serial (parte do comando 'wifi').
+ */
+void link_supervisor_print(void);
+
+#endif // LINK_SUPERVISOR_H
@@ -12,33 +12,67 @@
 #ifndef LWIP_SOCKET
 #define LWIP_SOCKET 0
 #endif
-#if PICO_CYW43_ARCH_POLL
-#define MEM_LIBC_MALLOC 1
-#else
-// MEM_LIBC_MALLOC is incompatible with non polling versions
+// Heap próprio do lwIP (MEM_SIZE) em vez do malloc da libc: o consumo fica
+// limitado pelo perfil e aparece nas estatísticas (MEM_STATS). Também é o
+// único modo compatível com as variantes não-poll do cyw43_arch.
 #define MEM_LIBC_MALLOC 0
-#endif
 #define MEM_ALIGNMENT 4
-#define MEM_SIZE 32000 // Aumentado de 16000 para 32000
+
+// ---- Perfis de memória (LWIP_MEM_PROFILE, escolhido no CMake) ----
+// Dimensione a partir do comando 'net' no serial (máximos de uso e falhas).
+#define LWIP_MEM_PROFILE_MQTT        1  // Só cliente MQTT: mensagens pequenas
+#define LWIP_MEM_PROFILE_MQTT_HTTP   2  // MQTT + servidor HTTP (páginas de até 16 KB)
+#define LWIP_MEM_PROFILE_THROUGHPUT  3  // Valores antigos: janelas de 16 x MSS
+
+#ifndef LWIP_MEM_PROFILE
+#define LWIP_MEM_PROFILE LWIP_MEM_PROFILE_MQTT
+#endif
+
+#if LWIP_MEM_PROFILE == LWIP_MEM_PROFILE_MQTT
+#define MEM_SIZE 8000
+#define MEMP_NUM_TCP_SEG 16
+#define PBUF_POOL_SIZE 16
+#define TCP_WND (4 * TCP_MSS)
+#define TCP_SND_BUF (4 * TCP_MSS)
+#elif LWIP_MEM_PROFILE == LWIP_MEM_PROFILE_MQTT_HTTP
+#define MEM_SIZE 16000
+#define MEMP_NUM_TCP_SEG 32
+#define MEMP_NUM_TCP_PCB 8 // Conexões HTTP simultâneas + MQTT
+#define PBUF_POOL_SIZE 24
+#define TCP_WND (8 * TCP_MSS)
+#define TCP_SND_BUF (8 * TCP_MSS)
+#elif LWIP_MEM_PROFILE == LWIP_MEM_PROFILE_THROUGHPUT
+#define MEM_SIZE 32000
 #define MEMP_NUM_TCP_SEG 64
+#define PBUF_POOL_SIZE 48
+#define TCP_WND (16 * TCP_MSS)
+#define TCP_SND_BUF (16 * TCP_MSS)
+#else
+#error "LWIP_MEM_PROFILE invalido"
+#endif
+
+// Cliente MQTT: buffer de saída para rajadas da fila de eventos
+// (até 8 publicações QoS 1 em andamento) e para o status com telemetria
+#define MQTT_OUTPUT_RINGBUF_SIZE 1280
+#define MQTT_REQ_MAX_IN_FLIGHT 8
+
 #define MEMP_NUM_ARP_QUEUE 10
-#define PBUF_POOL_SIZE 48 // Aumentado de 32 para 48
 #define MEMP_NUM_SYS_TIMEOUT 16 // Pool de timeouts para MQTT e reconexões
 #define LWIP_ARP 1
 #define LWIP_ETHERNET 1
 #define LWIP_ICMP 1
 #define LWIP_RAW 1
-#define TCP_WND (16 * TCP_MSS)
 #define TCP_MSS 1460
-#define TCP_SND_BUF (16 * TCP_MSS)
 #define TCP_SND_QUEUELEN ((4 * (TCP_SND_BUF) + (TCP_MSS - 1)) / (TCP_MSS))
 #define LWIP_NETIF_STATUS_CALLBACK 1
 #define LWIP_NETIF_LINK_CALLBACK 1
 #define LWIP_NETIF_HOSTNAME 1
 #define LWIP_NETCONN 0
-#define MEM_STATS 0
+// Estatísticas de heap e pools sempre ativas (telemetria em net_stats.c)
+#define LWIP_STATS 1
+#define MEM_STATS 1
+#define MEMP_STATS 1
 #define SYS_STATS 0
-#define MEMP_STATS 0
 #define LINK_STATS 0
 // #define ETH_PAD_SIZE                2
 #define LWIP_CHKSUM_ALGORITHM 3
@@ -52,10 +86,27 @@
 #define DHCP_DOES_ARP_CHECK 0
 #define LWIP_DHCP_DOES_ACD_CHECK 0
 
+// Variante FreeRTOS (NO_SYS=0): thread tcpip do lwIP. A aplicação continua
+// usando a API raw, protegida por cyw43_arch_lwip_begin()/end().
+#if !NO_SYS
+#define TCPIP_THREAD_STACKSIZE 1024
+#define DEFAULT_THREAD_STACKSIZE 1024
+#define DEFAULT_RAW_RECVMBOX_SIZE 8
+#define TCPIP_MBOX_SIZE 8
+#define LWIP_TIMEVAL_PRIVATE 0
+#define LWIP_TCPIP_CORE_LOCKING_INPUT 1
+#endif
+
 #ifndef NDEBUG
 #define LWIP_DEBUG 1
-#define LWIP_STATS 1
 #define LWIP_STATS_DISPLAY 1
+#else
+// Em release, apenas os contadores de memória
+#define ETHARP_STATS 0
+#define IP_STATS 0
+#define ICMP_STATS 0
+#define UDP_STATS 0
+#define TCP_STATS 0
 #endif
 
 #define ETHARP_DEBUG LWIP_DBG_OFF
@@ -0,0 +1,118 @@
+#include "mem_monitor.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <malloc.h>
+#include <unistd.h>
+#include "pico/stdlib.h"
+
+#define STACK_PAINT   0x5AA5C33Cu
+
+// Símbolos do linker script do SDK (memmap_default.ld)
+extern uint32_t __StackBottom, __StackTop;        // Core 0 (SCRATCH_Y)
+extern uint32_t __StackOneBottom, __StackOneTop;  // Core 1 (SCRATCH_X)
+extern char __end__, __HeapLimit;                 // Região do heap
+
+// malloc/free sem o wrapper do pico_malloc, que entra em panic ao falhar
+// (PICO_MALLOC_PANIC): a busca do maior bloco precisa ver NULL
+extern void *__real_malloc(size_t size);
+extern void __real_free(void *ptr);
+
+static uint32_t heap_free_min = UINT32_MAX;
+static bool warned[2] = {false, false};
+
+static inline uint32_t current_sp(void) {
+    uint32_t sp;
+    __asm volatile ("mov %0, sp" : "=r" (sp));
+    return sp;
+}
+
+void mem_monitor_init(void) {
+    // Core 0: só abaixo do SP atual (com margem para este quadro)
+    uint32_t *limit = (uint32_t *)(current_sp() - 64);
+    for (uint32_t *p = &__StackBottom; p < limit; p++) {
+        *p = STACK_PAINT;
+    }
+
+    // Core 1 ainda não foi lançado: pinta a pilha inteira
+    for (uint32_t *p = &__StackOneBottom; p < &__StackOneTop; p++) {
+        *p = STACK_PAINT;
+    }
+}
+
+// Conta as palavras intactas a partir da base (a pilha cresce para baixo)
+static void stack_usage(uint32_t *bottom, uint32_t *top, mem_stack_usage_t *u) {
+    uint32_t *p = bottom;
+    while (p < top && *p == STACK_PAINT) p++;
+    u->size = (uint32_t)((top - bottom) * sizeof(uint32_t));
+    u->peak = (uint32_t)((top - p) * sizeof(uint32_t));
+}
+
+// Busca binária pelo maior malloc que ainda funciona (resolução de 64 bytes)
+static uint32_t largest_block(uint32_t upper) {
+    uint32_t lo = 0, hi = upper + 1;
+    while (hi - lo > 64) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        void *p = __real_malloc(mid);
+        if (p != NULL) {
+            __real_free(p);
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+void mem_monitor_sample(mem_usage_t *usage) {
+    stack_usage(&__StackBottom, &__StackTop, &usage->stack[0]);
+    stack_usage(&__StackOneBottom, &__StackOneTop, &usage->stack[1]);
+
+    for (int core = 0; core < 2; core++) {
+        const mem_stack_usage_t *s = &usage->stack[core];
+        if (!warned[core] && s->peak + MEM_MONITOR_STACK_WARN_BYTES > s->size) {
+            printf("[MEM] AVISO: pilha do core %d com %ld bytes de folga\n",
+                   core, (long)s->size - (long)s->peak);
+            warned[core] = true;
+        }
+    }
+
+    // Livre = blocos liberados dentro da arena + espaço ainda não usado pelo sbrk
+    struct mallinfo mi = mallinfo();
+    char *brk = (char *)sbrk(0);
+    usage->heap_size = (uint32_t)(&__HeapLimit - &__end__);
+    usage->heap_free = (uint32_t)(&__HeapLimit - brk) + (uint32_t)mi.fordblks;
+    usage->heap_largest = largest_block(usage->heap_free);
+
+    if (usage->heap_free < heap_free_min) {
+        heap_free_min = usage->heap_free;
+    }
+    usage->heap_free_min = heap_free_min;
+}
+
+int mem_monitor_format_json(const mem_usage_t *usage, char *buf, size_t len) {
+    return snprintf(buf, len,
+                    "\"stack0\":{\"peak\":%lu,\"size\":%lu},"
+                    "\"stack1\":{\"peak\":%lu,\"size\":%lu},"
+                    "\"malloc\":{\"free\":%lu,\"min_free\":%lu,\"largest\":%lu}",
+                    (unsigned long)usage->stack[0].peak, (unsigned long)usage->stack[0].size,
+                    (unsigned long)usage->stack[1].peak, (unsigned long)usage->stack[1].size,
+                    (unsigned long)usage->heap_free, (unsigned long)usage->heap_free_min,
+                    (unsigned long)usage->heap_largest);
+}
+
+void mem_monitor_print(void) {
+    mem_usage_t u;
+    mem_monitor_sample(&u);
+
+    for (int core = 0; core < 2; core++) {
+        printf("[MEM] pilha core %d: pico=%lu de %lu bytes\n", core,
+               (unsigned long)u.stack[core].peak, (unsigned long)u.stack[core].size);
+    }
+
+    // Fragmentação: quanto do livre não está no maior bloco
+    uint32_t frag = u.heap_free ? 100 - (u.heap_largest * 100) / u.heap_free : 0;
+    printf("[MEM] heap: livre=%lu (min %lu) maior bloco=%lu de %lu, fragmentacao=%lu%%\n",
+           (unsigned long)u.heap_free, (unsigned long)u.heap_free_min,
+           (unsigned long)u.heap_largest, (unsigned long)u.heap_size,
+           (unsigned long)frag);
+}
@@ -0,0 +1,56 @@
+/**
+ * mem_monitor.h
+ *
+ * Monitoramento de pilhas e heap em tempo de execução.
+ *
+ * As pilhas dos dois cores são pintadas com um padrão no boot; a marca
+ * d'água (maior profundidade já usada) é o primeiro ponto onde o padrão
+ * foi sobrescrito. O heap da libc é medido pelo mallinfo() e pelo maior
+ * bloco que ainda pode ser alocado, o que revela fragmentação.
+ */
+
+#ifndef MEM_MONITOR_H
+#define MEM_MONITOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Pilha com menos folga que isso gera aviso no serial
+#define MEM_MONITOR_STACK_WARN_BYTES  256
+
+typedef struct {
+    uint32_t size;          // Tamanho reservado no linker script
+    uint32_t peak;          // Maior uso observado (bytes)
+} mem_stack_usage_t;
+
+typedef struct {
+    mem_stack_usage_t stack[2];   // Core 0 e core 1
+    uint32_t heap_size;           // Região total do heap
+    uint32_t heap_free;           // Livre (blocos liberados + não usado)
+    uint32_t heap_free_min;       // Menor "livre" desde o boot
+    uint32_t heap_largest;        // Maior bloco alocável agora
+} mem_usage_t;
+
+/**
+ * @brief Pinta as pilhas dos dois cores. Chamar no início do main(),
+ * antes de lançar o core 1.
+ */
+void mem_monitor_init(void);
+
+/**
+ * @brief Mede pilhas e heap (a busca do maior bloco faz algumas alocações).
+ */
+void mem_monitor_sample(mem_usage_t *usage);
+
+/**
+ * @brief Escreve a última amostra como campos JSON (sem chaves externas).
+ * @return O número de caracteres escritos (como snprintf).
+ */
+int mem_monitor_format_json(const mem_usage_t *usage, char *buf, size_t len);
+
+/**
+ * @brief Mede e imprime no serial (comando 'mem').
+ */
+void mem_monitor_print(void);
+
+#endif // MEM_MONITOR_H
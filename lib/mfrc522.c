@@ -5,6 +5,26 @@
 */
 
 #include "mfrc522.h"
+#if MFRC522_FAST_SPI
+#include "hardware/structs/sio.h"
+#endif
+#if MFRC522_PIO_SPI
+#include "mfrc522_pio.h"
+#endif
+
+/*
+ * Register accessors run from RAM only with the FIFO fast path: the SDK
+ * spi_*_blocking calls of the plain path live in flash anyway, so RAM
+ * placement there would spend SRAM without removing the XIP cache misses.
+ */
+#if MFRC522_FAST_SPI
+#define PCD_RAM_FUNC(name) __not_in_flash_func(name)
+#else
+#define PCD_RAM_FUNC(name) name
+#endif
+
+// SPI bit rate used by PCD_Init()
+#define PCD_SPI_BAUDRATE 1000000
 
 // ADT object allocation counter
 static int MFRC_Instance_Counter = 0;
@@ -15,6 +35,9 @@ static int MFRC_Instance_Counter = 0;
 MFRC522Ptr_t MFRC522_Init() {
 	// allocate instance struct array
 	static struct MFRC522_T mfrc_Instances[MFRC_MAX_INSTANCES];
+	if (MFRC_Instance_Counter >= MFRC_MAX_INSTANCES) {
+		return NULL;
+	}
 	//      static Chip_SSP_DATA_SETUP_T dataSetup_Instances[MFRC_MAX_INSTANCES];
 	//		struct MFRC522_T mfrc_struct;
 	//		Chip_SSP_DATA_SETUP_T data_setup;
@@ -27,6 +50,16 @@ MFRC522Ptr_t MFRC522_Init() {
 	}
 
 	mfrc_Instances[MFRC_Instance_Counter]._chipSelectPin = cs_pin;
+	mfrc_Instances[MFRC_Instance_Counter]._sckPin = sck_pin;
+	mfrc_Instances[MFRC_Instance_Counter]._mosiPin = mosi_pin;
+	mfrc_Instances[MFRC_Instance_Counter]._misoPin = miso_pin;
+	mfrc_Instances[MFRC_Instance_Counter]._resetPin = RESET_PIN;
+	mfrc_Instances[MFRC_Instance_Counter]._resetHoldMs = 1000;
+#if MFRC522_PIO_SPI
+	mfrc_Instances[MFRC_Instance_Counter].usePio = false;
+	mfrc_Instances[MFRC_Instance_Counter].pio = MFRC522_PIO_INSTANCE;
+	mfrc_Instances[MFRC_Instance_Counter].sm = -1;
+#endif
 
 	// update instance counter
 	MFRC_Instance_Counter++;
@@ -34,88 +67,310 @@ MFRC522Ptr_t MFRC522_Init() {
 	return &(mfrc_Instances[MFRC_Instance_Counter - 1]);
 } 
 
+/**
+ * Overrides the pin assignment (e.g. from the runtime configuration store).
+ */
+void MFRC522_SetPins(MFRC522Ptr_t mfrc, uint cs, uint sck, uint mosi, uint miso, uint rst) {
+#if MFRC522_STATIC_CONFIG
+	// Pins are fixed at compile time
+	(void)mfrc; (void)cs; (void)sck; (void)mosi; (void)miso; (void)rst;
+#else
+	mfrc->_chipSelectPin = cs;
+	mfrc->_sckPin = sck;
+	mfrc->_mosiPin = mosi;
+	mfrc->_misoPin = miso;
+	mfrc->_resetPin = rst;
+#endif
+}
+
+/**
+ * Sets the NRSTPD low time used by PCD_Init().
+ */
+void MFRC522_SetResetHold(MFRC522Ptr_t mfrc, uint32_t ms) {
+	mfrc->_resetHoldMs = ms;
+}
+
+/**
+ * Selects the bus by number (0 = spi0, 1 = spi1, MFRC522_BUS_PIO).
+ */
+bool MFRC522_SetBus(MFRC522Ptr_t mfrc, uint bus) {
+#if MFRC522_STATIC_CONFIG
+	// Register access is compiled for MFRC522_SPI_BUS only
+	(void)mfrc;
+	return bus == MFRC522_SPI_BUS;
+#else
+	if (bus == MFRC522_BUS_PIO) {
+#if MFRC522_PIO_SPI
+		MFRC522_SetPioBus(mfrc, MFRC522_PIO_INSTANCE);
+		return true;
+#else
+		return false;
+#endif
+	}
+	if (bus > 1) {
+		return false;
+	}
+#if MFRC522_PIO_SPI
+	mfrc->usePio = false;
+#endif
+	mfrc->spi = bus == 1 ? spi1 : spi0;
+	return true;
+#endif
+}
+
+#if MFRC522_PIO_SPI
+/**
+ * Selects the PIO bus; PCD_Init() then claims the state machine.
+ */
+void MFRC522_SetPioBus(MFRC522Ptr_t mfrc, PIO pio) {
+#if !MFRC522_STATIC_CONFIG
+	mfrc->usePio = true;
+#endif
+	mfrc->pio = pio;
+}
+
+/**
+ * Routes the reader pins to a PIO state machine running mfrc522_spi.pio.
+ */
+bool PCD_AttachPioBus(MFRC522Ptr_t mfrc, PIO pio) {
+	if (mfrc->sm < 0 || mfrc->pio != pio) {
+		int sm = mfrc522_pio_init(pio, mfrc->_chipSelectPin, mfrc->_sckPin,
+								  mfrc->_mosiPin, mfrc->_misoPin, PCD_SPI_BAUDRATE);
+		if (sm < 0) {
+			return false;
+		}
+		mfrc->pio = pio;
+		mfrc->sm = sm;
+	} else {
+		mfrc522_pio_attach_pins(pio, mfrc->_chipSelectPin, mfrc->_sckPin,
+								mfrc->_mosiPin, mfrc->_misoPin);
+	}
+#if !MFRC522_STATIC_CONFIG
+	mfrc->usePio = true;
+#endif
+	return true;
+}
+#endif // MFRC522_PIO_SPI
+
+/**
+ * Routes the reader pins to a hardware SPI peripheral, CS driven by SIO.
+ */
+void PCD_AttachSpiBus(MFRC522Ptr_t mfrc, spi_inst_t *spi) {
+	mfrc->spi = spi;
+
+    gpio_init(mfrc->_chipSelectPin);
+    gpio_set_dir(mfrc->_chipSelectPin, GPIO_OUT);
+    gpio_put(mfrc->_chipSelectPin, 1);
+
+    spi_init(spi, PCD_SPI_BAUDRATE);
+
+    spi_set_format(spi, 8, 0, 0, SPI_MSB_FIRST);
+
+    gpio_set_function(mfrc->_sckPin, GPIO_FUNC_SPI);
+    gpio_set_function(mfrc->_mosiPin, GPIO_FUNC_SPI);
+    gpio_set_function(mfrc->_misoPin, GPIO_FUNC_SPI);
+
+#if MFRC522_PIO_SPI && !MFRC522_STATIC_CONFIG
+	mfrc->usePio = false;
+#endif
+}
+
 
 
 /*******************************************************************************
 * Basic interface functions for communicating with the MFRC522
 *******************************************************************************/
 
+#if MFRC522_FAST_SPI
+/*
+ * Fast path: drives the PL022 SPI FIFO and the SIO GPIO registers directly.
+ * The address and data/dummy bytes are pushed back to back (the TX FIFO is
+ * 8 entries deep) and the RX FIFO is drained as the bytes come back, so a
+ * register access is a single full-duplex frame with no SDK call overhead.
+ * The RX FIFO is always left empty, which the next access relies on.
+ */
+static inline void pcd_fast_cs_low(uint cs) {
+	sio_hw->gpio_clr = 1u << cs;
+}
+
+static inline void pcd_fast_cs_high(uint cs) {
+	sio_hw->gpio_set = 1u << cs;
+}
+
+// Clocks out two bytes in one frame and returns the second byte received
+static inline uint8_t pcd_fast_xfer2(spi_hw_t *hw, uint cs, uint8_t b0, uint8_t b1) {
+	pcd_fast_cs_low(cs);
+	hw->dr = b0;
+	hw->dr = b1;
+	while (!(hw->sr & SPI_SSPSR_RNE_BITS)) {
+	}
+	(void)hw->dr;
+	while (!(hw->sr & SPI_SSPSR_RNE_BITS)) {
+	}
+	uint8_t value = (uint8_t)hw->dr;
+	pcd_fast_cs_high(cs);
+	return value;
+}
+
+/*
+ * Streams tx[0..len-1] in one frame, storing received bytes in rx (may be
+ * NULL). At most 8 bytes are kept in flight so the RX FIFO never overflows.
+ */
+static inline void pcd_fast_stream(spi_hw_t *hw, const uint8_t *tx, uint8_t tx_fill,
+								   uint8_t *rx, uint len) {
+	uint sent = 0;
+	uint received = 0;
+	while (received < len) {
+		if (sent < len && (sent - received) < 8 && (hw->sr & SPI_SSPSR_TNF_BITS)) {
+			hw->dr = tx ? tx[sent] : tx_fill;
+			sent++;
+		}
+		if (hw->sr & SPI_SSPSR_RNE_BITS) {
+			uint8_t value = (uint8_t)hw->dr;
+			if (rx) {
+				rx[received] = value;
+			}
+			received++;
+		}
+	}
+}
+#endif // MFRC522_FAST_SPI
+
 /**
  * Writes a uint8_t to the specified register in the MFRC522 chip.
  * The interface is described in the datasheet section 8.1.2.
+ * Runs from RAM with MFRC522_FAST_SPI: it is called thousands of times per
+ * card read and must not stall on XIP cache misses.
  */
-void PCD_WriteRegister(MFRC522Ptr_t mfrc, uint8_t reg, uint8_t value) {
+void PCD_RAM_FUNC(PCD_WriteRegister)(MFRC522Ptr_t mfrc, uint8_t reg, uint8_t value) {
+#if MFRC522_PIO_SPI
+	if (PCD_USES_PIO(mfrc)) {
+		mfrc522_pio_frame(mfrc->pio, mfrc->sm, 0x00 | reg, &value, 0, NULL, 1);
+		return;
+	}
+#endif
+#if MFRC522_FAST_SPI
+	pcd_fast_xfer2(spi_get_hw(PCD_SPI(mfrc)), PCD_CS_PIN(mfrc), 0x00 | reg, value);
+#else
 	uint8_t msg[2];
 	msg[0] = 0x00 | reg;
 	msg[1] = value;
 
-	cs_select(mfrc->_chipSelectPin);
-	spi_write_blocking(mfrc->spi, msg, 2);
-	cs_deselect(mfrc->_chipSelectPin);
+	cs_select(PCD_CS_PIN(mfrc));
+	spi_write_blocking(PCD_SPI(mfrc), msg, 2);
+	cs_deselect(PCD_CS_PIN(mfrc));
+#endif
 }
 
 /**
  * Writes a number of uint8_ts to the specified register in the MFRC522 chip.
  * The interface is described in the datasheet section 8.1.2.
  */
-void PCD_WriteNRegister(
+void PCD_RAM_FUNC(PCD_WriteNRegister)(
 	MFRC522Ptr_t mfrc,
 	uint8_t reg,   ///< The register to write to. One of the PCD_Register enums.
 	uint8_t count, ///< The number of uint8_ts to write to the register
 	uint8_t *values ///< The values to write. uint8_t array.
 	) {
-	uint8_t msg[count + 1]; //Values and address
-	msg[0] = 0x00 | reg;
-
-	uint8_t i;
-	for(i = 0; i < count; i++) {
-		msg[i + 1] = values[i];
+#if MFRC522_PIO_SPI
+	if (PCD_USES_PIO(mfrc)) {
+		mfrc522_pio_frame(mfrc->pio, mfrc->sm, 0x00 | reg, values, 0, NULL, count);
+		return;
 	}
-
-	cs_select(mfrc->_chipSelectPin);
-	spi_write_blocking(mfrc->spi, msg, count + 1);
-	cs_deselect(mfrc->_chipSelectPin);
+#endif
+#if MFRC522_FAST_SPI
+	spi_hw_t *hw = spi_get_hw(PCD_SPI(mfrc));
+	const uint8_t address = 0x00 | reg;
+
+	pcd_fast_cs_low(PCD_CS_PIN(mfrc));
+	pcd_fast_stream(hw, &address, 0, NULL, 1);
+	pcd_fast_stream(hw, values, 0, NULL, count);
+	pcd_fast_cs_high(PCD_CS_PIN(mfrc));
+#else
+	// Address and values go out back to back under the same CS,
+	// so no stack copy (formerly a VLA of count + 1 bytes) is needed
+	const uint8_t address = 0x00 | reg;
+
+	cs_select(PCD_CS_PIN(mfrc));
+	spi_write_blocking(PCD_SPI(mfrc), &address, 1);
+	spi_write_blocking(PCD_SPI(mfrc), values, count);
+	cs_deselect(PCD_CS_PIN(mfrc));
+#endif
 }
 
 /**
  * Reads a uint8_t from the specified register in the MFRC522 chip.
  * The interface is described in the datasheet section 8.1.2.
+ * Runs from RAM, see PCD_WriteRegister().
  */
-uint8_t PCD_ReadRegister(
+uint8_t PCD_RAM_FUNC(PCD_ReadRegister)(
 	MFRC522Ptr_t mfrc, 
 	uint8_t reg ///< The register to read from. One of the PCD_Register enums
 	) {
+#if MFRC522_PIO_SPI
+	if (PCD_USES_PIO(mfrc)) {
+		uint8_t value;
+		mfrc522_pio_frame(mfrc->pio, mfrc->sm, 0x80 | reg, NULL, 0, &value, 1);
+		return value;
+	}
+#endif
+#if MFRC522_FAST_SPI
+	// Address byte and dummy byte in one 2-byte full-duplex frame
+	return pcd_fast_xfer2(spi_get_hw(PCD_SPI(mfrc)), PCD_CS_PIN(mfrc), 0x80 | reg, 0x00);
+#else
 	uint8_t buf = 0;
 	const uint8_t msg = 0x80 | reg;
 	
-	cs_select(mfrc->_chipSelectPin);
-	spi_write_blocking(mfrc->spi, &msg, 1);
-	spi_read_blocking(mfrc->spi, 0, &buf, 1);
-	cs_deselect(mfrc->_chipSelectPin);
+	cs_select(PCD_CS_PIN(mfrc));
+	spi_write_blocking(PCD_SPI(mfrc), &msg, 1);
+	spi_read_blocking(PCD_SPI(mfrc), 0, &buf, 1);
+	cs_deselect(PCD_CS_PIN(mfrc));
 	return buf;
+#endif
 }
 
 /**
  * Reads a number of uint8_ts from the specified register in the MFRC522 chip.
  * The interface is described in the datasheet section 8.1.2.
  */
-void PCD_ReadNRegister(
+void PCD_RAM_FUNC(PCD_ReadNRegister)(
 	MFRC522Ptr_t mfrc,
 	uint8_t reg, ///< The register to read from. One of the PCD_Register enums.
 	uint8_t count,   ///< The number of uint8_ts to read
 	uint8_t *values, ///< uint8_t array to store the values in.
 	uint8_t rxAlign ///< Only bit positions rxAlign..7 in values[0] are updated.
 	) {
-	uint8_t buf = 0;
+	if (count == 0) {
+		return;
+	}
 	const uint8_t msg = 0x80 | reg;
-	
-	cs_select(mfrc->_chipSelectPin);
+	const uint8_t first = values[0];
+
+#if MFRC522_PIO_SPI
+	if (PCD_USES_PIO(mfrc)) {
+		// Burst read in one frame: address repeated, 0x00 terminator
+		mfrc522_pio_frame(mfrc->pio, mfrc->sm, msg, NULL, msg, values, count);
+	} else
+#endif
+	{
+#if MFRC522_FAST_SPI
+	// Burst read (datasheet 8.1.2.1): the address is repeated for every byte
+	// and the data comes back one byte later, terminated by a 0x00.
+	spi_hw_t *hw = spi_get_hw(PCD_SPI(mfrc));
+
+	pcd_fast_cs_low(PCD_CS_PIN(mfrc));
+	pcd_fast_stream(hw, NULL, msg, NULL, 1);
+	pcd_fast_stream(hw, NULL, msg, values, count - 1);
+	pcd_fast_stream(hw, NULL, 0x00, &values[count - 1], 1);
+	pcd_fast_cs_high(PCD_CS_PIN(mfrc));
+#else
+	cs_select(PCD_CS_PIN(mfrc));
 
 	// uint8_t i;
 	// for(i = 0; i < count; i++) {
 	// 	uint8_t value = 0;
-	// 	spi_write_blocking(mfrc->spi, &msg, 1);
-	// 	spi_read_blocking(mfrc->spi, 0, &value, 1);
+	// 	spi_write_blocking(PCD_SPI(mfrc), &msg, 1);
+	// 	spi_read_blocking(PCD_SPI(mfrc), 0, &value, 1);
 	// 	values[i] = value;
 	// }
 
@@ -124,13 +379,21 @@ void PCD_ReadNRegister(
 		values[i] = PCD_ReadRegister(mfrc, msg);
 	}
 
-	cs_deselect(mfrc->_chipSelectPin);
+	cs_deselect(PCD_CS_PIN(mfrc));
+#endif
+	}
+
+	// Only update bit positions rxAlign..7 in values[0]
+	if (rxAlign) {
+		uint8_t mask = (uint8_t)(0xFF << rxAlign);
+		values[0] = (first & ~mask) | (values[0] & mask);
+	}
 }
 
 /**
  * Sets the bits given in mask in register reg.
  */
-void PCD_SetRegisterBitMask(
+void PCD_RAM_FUNC(PCD_SetRegisterBitMask)(
 	MFRC522Ptr_t mfrc,
 	uint8_t reg, ///< The register to update. One of the PCD_Register enums.
 	uint8_t mask ///< The bits to set.
@@ -143,7 +406,7 @@ void PCD_SetRegisterBitMask(
 /**
  * Clears the bits given in mask from register reg.
  */
-void PCD_ClearRegisterBitMask(
+void PCD_RAM_FUNC(PCD_ClearRegisterBitMask)(
 	MFRC522Ptr_t mfrc,
 	uint8_t reg, ///< The register to update. One of the PCD_Register enums.
 	uint8_t mask ///< The bits to clear.
@@ -210,25 +473,28 @@ PCD_CalculateCRC(MFRC522Ptr_t mfrc,
 /**
  * Initializes the MFRC522 chip.
  */
-void PCD_Init(MFRC522Ptr_t mfrc, spi_inst_t *spi) {
-
-	mfrc->spi = spi0;
-	gpio_put(RESET_PIN, 0);
-    sleep_ms(1000);
-    gpio_put(RESET_PIN, 1);
+bool PCD_Init(MFRC522Ptr_t mfrc, spi_inst_t *spi) {
+
+#if MFRC522_STATIC_CONFIG
+	spi = PCD_SPI(mfrc);
+#endif
+	gpio_put(mfrc->_resetPin, 0);
+    sleep_ms(mfrc->_resetHoldMs);
+    gpio_put(mfrc->_resetPin, 1);
 	sleep_ms(50);
 
-    gpio_init(cs_pin);
-    gpio_set_dir(cs_pin, GPIO_OUT);
-    gpio_put(cs_pin, 1);
-
-    spi_init(spi0, 1000000);
-
-    spi_set_format(spi0, 8, 0, 0, SPI_MSB_FIRST);
-
-    gpio_set_function(sck_pin, GPIO_FUNC_SPI);
-    gpio_set_function(mosi_pin, GPIO_FUNC_SPI);
-    gpio_set_function(miso_pin, GPIO_FUNC_SPI);
+#if MFRC522_PIO_SPI
+	if (PCD_USES_PIO(mfrc)) {
+		// No hardware SPI fallback: the pins were picked for PIO and may not
+		// be SPI pins, and a static PIO build only has PIO register access
+		if (!PCD_AttachPioBus(mfrc, mfrc->pio)) {
+			return false;
+		}
+	} else
+#endif
+	{
+		PCD_AttachSpiBus(mfrc, spi);
+	}
 
 	PCD_WriteRegister(mfrc, CommandReg, PCD_SoftReset);
 
@@ -260,6 +526,7 @@ void PCD_Init(MFRC522Ptr_t mfrc, spi_inst_t *spi) {
 											// (ISO 14443-3 part 6.2.4)
 	PCD_AntennaOn(mfrc); // Enable the antenna driver pins TX1 and TX2 (they
 						 // were disabled by the reset)
+	return true;
 } // End PCD_Init()
 
 /**
@@ -1574,6 +1841,7 @@ const char *PICC_GetTypeName(PICC_Type piccType ///< One of the PICC_Type enums.
 	}
 } // End PICC_GetTypeName()
 
+#if MFRC522_FEATURE_DUMP
 /**
  * Dumps debug info about the connected PCD to Serial.
  * Shows all known firmware versions
@@ -1972,6 +2240,7 @@ void PICC_DumpMifareUltralightToSerial(MFRC522Ptr_t mfrc) {
 		}
 	}
 } // End PICC_DumpMifareUltralightToSerial()
+#endif // MFRC522_FEATURE_DUMP
 
 /**
  * Calculates the bit pattern needed for the specified access bits. In the [C1
@@ -2001,6 +2270,7 @@ void MIFARE_SetAccessBits(
 	accessBitBuffer[2] = c3 << 4 | c2;
 } // End MIFARE_SetAccessBits()
 
+#if MFRC522_FEATURE_UID_BACKDOOR
 /**
  * Performs the "magic sequence" needed to get Chinese UID changeable
  * Mifare cards to allow writing to sector 0, where the card UID is stored.
@@ -2226,6 +2496,7 @@ bool MIFARE_UnbrickUidSector(MFRC522Ptr_t mfrc, bool logErrors) {
 	}
 	return true;
 }
+#endif // MFRC522_FEATURE_UID_BACKDOOR
 
 /*******************************************************************************
 * Convenience functions - does not add extra functionality
@@ -22,6 +22,10 @@
 #include <string.h>
 #include "pico/stdlib.h"
 #include "hardware/spi.h"
+#include "mfrc522_config.h"
+#if MFRC522_PIO_SPI
+#include "hardware/pio.h"
+#endif
 
 /*******************************************************************************
  * Configuration Constants
@@ -33,16 +37,36 @@
 // SPI bit rate defined as 4MHz in the original library
 #define MFRC522_BIT_RATE 4000000
 
-// Maximum number of ADT object allocations
-#define MFRC_MAX_INSTANCES 2
-
-// GPIO pin assignments for MFRC522
-#define RESET_PIN 0               // GP0 - Reset
-
-static const uint cs_pin = 5;     // GP5 - Chip Select (SDA)
-static const uint sck_pin = 2;    // GP2 - SPI Clock
-static const uint mosi_pin = 3;   // GP3 - SPI Master Out Slave In
-static const uint miso_pin = 4;   // GP4 - SPI Master In Slave Out
+// GPIO pin assignments for MFRC522 (defaults, see mfrc522_config.h)
+#define RESET_PIN MFRC522_PIN_RST             // GP0 - Reset
+
+static const uint cs_pin = MFRC522_PIN_CS;     // GP5 - Chip Select (SDA)
+static const uint sck_pin = MFRC522_PIN_SCK;   // GP2 - SPI Clock
+static const uint mosi_pin = MFRC522_PIN_MOSI; // GP3 - SPI Master Out Slave In
+static const uint miso_pin = MFRC522_PIN_MISO; // GP4 - SPI Master In Slave Out
+
+/**
+ * Bus and chip select used by the register access functions.
+ * With MFRC522_STATIC_CONFIG these are constants, so the compiler folds
+ * the SPI instance and CS pin into the register access code instead of
+ * loading them from the ADT object on every access.
+ */
+#if MFRC522_STATIC_CONFIG
+#if MFRC522_SPI_BUS == 1
+#define PCD_SPI(mfrc)     spi1
+#else
+#define PCD_SPI(mfrc)     spi0
+#endif
+#define PCD_CS_PIN(mfrc)  ((uint)MFRC522_PIN_CS)
+#define PCD_USES_PIO(mfrc) (MFRC522_SPI_BUS == MFRC522_BUS_PIO)
+#else
+#define PCD_SPI(mfrc)     ((mfrc)->spi)
+#define PCD_CS_PIN(mfrc)  ((mfrc)->_chipSelectPin)
+#define PCD_USES_PIO(mfrc) ((mfrc)->usePio)
+#endif
+
+// PIO block used by the PIO bus when selected at compile time
+#define MFRC522_PIO_INSTANCE pio0
 
 // Size of the MFRC522 FIFO buffer
 static const uint8_t FIFO_SIZE = 64;
@@ -266,6 +290,16 @@ struct MFRC522_T {
 	Uid uid;                    // Used by PICC_ReadCardSerial()
 	spi_inst_t *spi;            // Select SPI0 or SPI1
 	uint _chipSelectPin;        // Chip select pin
+	uint _sckPin;               // SPI clock pin
+	uint _mosiPin;              // SPI MOSI pin
+	uint _misoPin;              // SPI MISO pin
+	uint _resetPin;             // Reset pin (NRSTPD)
+	uint32_t _resetHoldMs;      // NRSTPD low time used by PCD_Init()
+#if MFRC522_PIO_SPI
+	bool usePio;                // Register access goes through the PIO bus
+	PIO pio;                    // PIO block of the bus state machine
+	int sm;                     // State machine index (-1 => not claimed)
+#endif
 	uint8_t Tx_Buf[BUFFER_SIZE]; // Transmit buffer
 	uint8_t Rx_Buf[BUFFER_SIZE]; // Receive buffer
 };
@@ -283,6 +317,48 @@ typedef struct MFRC522_T *MFRC522Ptr_t;
  */
 MFRC522Ptr_t MFRC522_Init(void);
 
+/**
+ * @brief Overrides the default pin assignment of an ADT object
+ * Must be called before PCD_Init(). Defaults are the constants above.
+ * Ignored when MFRC522_STATIC_CONFIG is set.
+ */
+void MFRC522_SetPins(MFRC522Ptr_t mfrc, uint cs, uint sck, uint mosi, uint miso, uint rst);
+
+/**
+ * @brief Sets how long PCD_Init() holds NRSTPD low (default 1000 ms)
+ * The datasheet only requires 100 ns; a warm restart uses a short hold.
+ */
+void MFRC522_SetResetHold(MFRC522Ptr_t mfrc, uint32_t ms);
+
+/**
+ * @brief Selects the bus of an ADT object by number (0 = spi0, 1 = spi1,
+ * MFRC522_BUS_PIO = PIO), e.g. from the runtime configuration store
+ * Must be called before PCD_Init().
+ * @return false, leaving the object unchanged, if this build cannot drive
+ * that bus: PIO without MFRC522_PIO_SPI or, with MFRC522_STATIC_CONFIG,
+ * any bus other than MFRC522_SPI_BUS
+ */
+bool MFRC522_SetBus(MFRC522Ptr_t mfrc, uint bus);
+
+#if MFRC522_PIO_SPI
+/**
+ * @brief Selects the PIO SPI bus for an ADT object
+ * Must be called before PCD_Init(). Ignored when MFRC522_STATIC_CONFIG is set.
+ */
+void MFRC522_SetPioBus(MFRC522Ptr_t mfrc, PIO pio);
+
+/**
+ * @brief Moves a running reader onto the PIO bus (claims a state machine once)
+ * @return false if no state machine or program space is available
+ */
+bool PCD_AttachPioBus(MFRC522Ptr_t mfrc, PIO pio);
+#endif
+
+/**
+ * @brief Moves a running reader onto a hardware SPI bus
+ */
+void PCD_AttachSpiBus(MFRC522Ptr_t mfrc, spi_inst_t *spi);
+
 /*******************************************************************************
  * Basic Interface Functions for Communicating with the MFRC522
  ******************************************************************************/
@@ -343,8 +419,11 @@ static inline void cs_deselect(const uint cs) {
 
 /**
  * @brief Initializes the MFRC522 chip
+ * @return false if the PIO bus was selected but no state machine or program
+ * space is left; there is no hardware SPI fallback and the reader must not
+ * be used
  */
-void PCD_Init(MFRC522Ptr_t mfrc, spi_inst_t *spi);
+bool PCD_Init(MFRC522Ptr_t mfrc, spi_inst_t *spi);
 
 /**
  * @brief Performs a soft reset on the MFRC522 chip
@@ -508,6 +587,11 @@ const char *GetStatusCodeName(StatusCode code);
  */
 const char *PICC_GetTypeName(PICC_Type type);
 
+/**
+ * @brief Translates the SAK (Select Acknowledge) to a PICC type
+ */
+PICC_Type PICC_GetType(uint8_t sak);
+
 /**
  * @brief Helper function for two-step MIFARE Classic protocol operations
  */
@@ -517,6 +601,7 @@ StatusCode MIFARE_TwoStepHelper(MFRC522Ptr_t mfrc, uint8_t command, uint8_t bloc
  * Debugging Functions
  ******************************************************************************/
 
+#if MFRC522_FEATURE_DUMP
 /**
  * @brief Dumps debug info about the connected PCD to Serial
  */
@@ -548,6 +633,7 @@ void PICC_DumpMifareClassicSectorToSerial(MFRC522Ptr_t mfrc, Uid *uid, MIFARE_Ke
  * @brief Dumps memory contents of a MIFARE Ultralight PICC to Serial
  */
 void PICC_DumpMifareUltralightToSerial(MFRC522Ptr_t mfrc);
+#endif // MFRC522_FEATURE_DUMP
 
 /*******************************************************************************
  * Advanced MIFARE Functions
@@ -558,6 +644,7 @@ void PICC_DumpMifareUltralightToSerial(MFRC522Ptr_t mfrc);
  */
 void MIFARE_SetAccessBits(uint8_t *accessBitBuffer, uint8_t g0, uint8_t g1, uint8_t g2, uint8_t g3);
 
+#if MFRC522_FEATURE_UID_BACKDOOR
 /**
  * @brief Opens a UID backdoor on some MIFARE Classic cards
  */
@@ -572,6 +659,7 @@ bool MIFARE_SetUid(MFRC522Ptr_t mfrc, uint8_t *newUid, uint8_t uidSize, bool log
  * @brief Unbricks a MIFARE Classic card with UID backdoor
  */
 bool MIFARE_UnbrickUidSector(MFRC522Ptr_t mfrc, bool logErrors);
+#endif // MFRC522_FEATURE_UID_BACKDOOR
 
 /*******************************************************************************
  * Convenience Functions
@@ -0,0 +1,297 @@
+#include "mfrc522_bench.h"
+#include <stdio.h>
+#include <string.h>
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+#include "cycle_counter.h"
+
+void mfrc522_bench_register_access(MFRC522Ptr_t mfrc, uint32_t iterations,
+                                   mfrc522_bench_result_t *result) {
+    uint8_t fifo[64];   // FIFO_SIZE (static const: não serve como tamanho fixo em C)
+    uint64_t total;
+    uint32_t start;
+
+    if (iterations == 0) iterations = 1;
+    result->iterations = iterations;
+#if MFRC522_PIO_SPI
+    result->pio = PCD_USES_PIO(mfrc);
+#else
+    result->pio = false;
+#endif
+    cycle_counter_init();
+
+    uint8_t water_level = PCD_ReadRegister(mfrc, WaterLevelReg);
+    for (uint8_t i = 0; i < FIFO_SIZE; i++) fifo[i] = i;
+
+    // Interrupções desligadas: USB/stdio não entram na medição
+    uint32_t irq = save_and_disable_interrupts();
+
+    total = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        start = cycle_counter_read();
+        PCD_WriteRegister(mfrc, WaterLevelReg, water_level);
+        total += cycle_counter_elapsed(start, cycle_counter_read());
+    }
+    result->write_cycles = (uint32_t)(total / iterations);
+
+    total = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        start = cycle_counter_read();
+        (void)PCD_ReadRegister(mfrc, WaterLevelReg);
+        total += cycle_counter_elapsed(start, cycle_counter_read());
+    }
+    result->read_cycles = (uint32_t)(total / iterations);
+
+    total = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        PCD_WriteRegister(mfrc, FIFOLevelReg, 0x80);  // Flush
+        start = cycle_counter_read();
+        PCD_WriteNRegister(mfrc, FIFODataReg, FIFO_SIZE, fifo);
+        total += cycle_counter_elapsed(start, cycle_counter_read());
+    }
+    result->fifo_write_cycles = (uint32_t)(total / iterations);
+
+    total = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        PCD_WriteRegister(mfrc, FIFOLevelReg, 0x80);
+        PCD_WriteNRegister(mfrc, FIFODataReg, FIFO_SIZE, fifo);
+        start = cycle_counter_read();
+        PCD_ReadNRegister(mfrc, FIFODataReg, FIFO_SIZE, fifo, 0);
+        total += cycle_counter_elapsed(start, cycle_counter_read());
+    }
+    result->fifo_read_cycles = (uint32_t)(total / iterations);
+
+    restore_interrupts(irq);
+    PCD_WriteRegister(mfrc, FIFOLevelReg, 0x80);
+}
+
+static void print_rows(const mfrc522_bench_result_t *result, uint32_t mhz) {
+    printf("[BENCH] %-24s %8s %8s\n", "Operacao", "ciclos", "us");
+    printf("[BENCH] %-24s %8lu %8lu\n", "WriteRegister",
+           (unsigned long)result->write_cycles, (unsigned long)(result->write_cycles / mhz));
+    printf("[BENCH] %-24s %8lu %8lu\n", "ReadRegister",
+           (unsigned long)result->read_cycles, (unsigned long)(result->read_cycles / mhz));
+    printf("[BENCH] %-24s %8lu %8lu\n", "WriteNRegister (64 B)",
+           (unsigned long)result->fifo_write_cycles, (unsigned long)(result->fifo_write_cycles / mhz));
+    printf("[BENCH] %-24s %8lu %8lu\n", "ReadNRegister (64 B)",
+           (unsigned long)result->fifo_read_cycles, (unsigned long)(result->fifo_read_cycles / mhz));
+}
+
+void mfrc522_bench_print(const mfrc522_bench_result_t *result) {
+    uint32_t mhz = clock_get_hz(clk_sys) / 1000000;
+
+    printf("[BENCH] Driver MFRC522: %s, %s\n",
+           MFRC522_STATIC_CONFIG ? "configuracao estatica" : "configuracao de runtime",
+           result->pio ? "SPI em PIO" :
+           MFRC522_FAST_SPI ? "FIFO SPI direta (RAM)" : "SDK spi_*_blocking");
+    printf("[BENCH] clk_sys=%lu MHz, %lu iteracoes\n",
+           (unsigned long)mhz, (unsigned long)result->iterations);
+    print_rows(result, mhz);
+}
+
+int mfrc522_bench_spi_speeds(MFRC522Ptr_t mfrc, const uint32_t *bauds, uint32_t count,
+                             uint32_t iterations, mfrc522_bench_speed_t *results) {
+    mfrc522_bench_result_t run;
+
+#if MFRC522_PIO_SPI
+    if (PCD_USES_PIO(mfrc)) return -1;  // Clock do PIO não passa pelo periférico
+#endif
+    uint32_t old_baud = spi_get_baudrate(mfrc->spi);
+
+    for (uint32_t i = 0; i < count; i++) {
+        results[i].baud = spi_set_baudrate(mfrc->spi, bauds[i]);
+        mfrc522_bench_register_access(mfrc, iterations, &run);
+        results[i].fifo_write_cycles = run.fifo_write_cycles;
+        results[i].fifo_read_cycles = run.fifo_read_cycles;
+    }
+
+    spi_set_baudrate(mfrc->spi, old_baud);
+    return 0;
+}
+
+void mfrc522_bench_crc_a(const uint8_t *data, uint8_t length, uint8_t result[2]) {
+    // ISO/IEC 14443-3, anexo B: polinômio x^16 + x^12 + x^5 + 1, início 0x6363
+    uint16_t crc = 0x6363;
+    for (uint8_t i = 0; i < length; i++) {
+        uint8_t b = data[i] ^ (uint8_t)crc;
+        b ^= (uint8_t)(b << 4);
+        crc = (uint16_t)((crc >> 8) ^ ((uint16_t)b << 8) ^ ((uint16_t)b << 3) ^ (b >> 4));
+    }
+    result[0] = (uint8_t)crc;
+    result[1] = (uint8_t)(crc >> 8);
+}
+
+void mfrc522_bench_crc(MFRC522Ptr_t mfrc, uint8_t length, uint32_t iterations,
+                       mfrc522_bench_crc_t *result) {
+    uint8_t frame[64];
+    uint8_t hw[2] = {0}, sw[2] = {0};
+    uint64_t total;
+    uint32_t start;
+
+    if (iterations == 0) iterations = 1;
+    if (length > FIFO_SIZE) length = FIFO_SIZE;
+    for (uint8_t i = 0; i < length; i++) frame[i] = (uint8_t)(0x30 + i);
+    result->length = length;
+    cycle_counter_init();
+
+    uint32_t irq = save_and_disable_interrupts();
+
+    total = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        start = cycle_counter_read();
+        (void)PCD_CalculateCRC(mfrc, frame, length, hw);
+        total += cycle_counter_elapsed(start, cycle_counter_read());
+    }
+    result->hw_cycles = (uint32_t)(total / iterations);
+
+    total = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        start = cycle_counter_read();
+        mfrc522_bench_crc_a(frame, length, sw);
+        total += cycle_counter_elapsed(start, cycle_counter_read());
+    }
+    result->sw_cycles = (uint32_t)(total / iterations);
+
+    restore_interrupts(irq);
+    result->match = hw[0] == sw[0] && hw[1] == sw[1];
+}
+
+int mfrc522_bench_reqa_empty(MFRC522Ptr_t mfrc, uint32_t iterations, mfrc522_bench_rf_t *result) {
+    uint8_t atqa[2];
+    uint8_t atqa_size;
+    uint64_t cycles = 0, us = 0;
+
+    if (iterations == 0) iterations = 1;
+    cycle_counter_init();
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        atqa_size = sizeof(atqa);
+        // Uma operação por vez sem interrupções (o timeout leva ~25 ms)
+        uint32_t irq = save_and_disable_interrupts();
+        uint32_t start = cycle_counter_read();
+        uint32_t t0 = time_us_32();
+        StatusCode status = PICC_RequestA(mfrc, atqa, &atqa_size);
+        cycles += cycle_counter_elapsed(start, cycle_counter_read());
+        us += time_us_32() - t0;
+        restore_interrupts(irq);
+        if (status != STATUS_TIMEOUT) {
+            result->reqa_iterations = 0;
+            return -1;  // Tag no campo (ou colisão): não é a medida do campo vazio
+        }
+    }
+
+    result->reqa_cycles = (uint32_t)(cycles / iterations);
+    result->reqa_us = (uint32_t)(us / iterations);
+    result->reqa_iterations = iterations;
+    return 0;
+}
+
+int mfrc522_bench_card(MFRC522Ptr_t mfrc, uint32_t iterations, mfrc522_bench_rf_t *result) {
+    uint8_t atqa[2];
+    uint8_t atqa_size;
+    uint8_t block[18];
+    uint8_t block_size;
+    uint64_t cycles = 0, us = 0;
+    uint32_t irq, start, t0;
+    StatusCode status;
+
+    if (iterations == 0) iterations = 1;
+    cycle_counter_init();
+    result->uid_size = mfrc->uid.size;
+    result->type = PICC_GetType(mfrc->uid.sak);
+    result->select_iterations = 0;
+    result->read_iterations = 0;
+    PCD_StopCrypto1(mfrc);
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        (void)PICC_HaltA(mfrc);
+        atqa_size = sizeof(atqa);
+        if (PICC_WakeupA(mfrc, atqa, &atqa_size) != STATUS_OK) return -1;
+
+        irq = save_and_disable_interrupts();
+        start = cycle_counter_read();
+        t0 = time_us_32();
+        status = PICC_Select(mfrc, &mfrc->uid, 0);
+        cycles += cycle_counter_elapsed(start, cycle_counter_read());
+        us += time_us_32() - t0;
+        restore_interrupts(irq);
+        if (status != STATUS_OK) return -1;
+    }
+    result->select_cycles = (uint32_t)(cycles / iterations);
+    result->select_us = (uint32_t)(us / iterations);
+    result->select_iterations = iterations;
+
+    // Tag selecionada: MIFARE Classic precisa autenticar o setor do bloco 4
+    bool classic = result->type == PICC_TYPE_MIFARE_MINI ||
+                   result->type == PICC_TYPE_MIFARE_1K ||
+                   result->type == PICC_TYPE_MIFARE_4K;
+    if (classic) {
+        MIFARE_Key key;
+        memset(key.keybyte, 0xFF, sizeof(key.keybyte));
+        if (PCD_Authenticate(mfrc, PICC_CMD_MF_AUTH_KEY_A, 4, &key, &mfrc->uid) != STATUS_OK) {
+            iterations = 0;
+        }
+    }
+
+    cycles = 0;
+    us = 0;
+    uint32_t done = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        block_size = sizeof(block);
+        irq = save_and_disable_interrupts();
+        start = cycle_counter_read();
+        t0 = time_us_32();
+        status = MIFARE_Read(mfrc, 4, block, &block_size);
+        cycles += cycle_counter_elapsed(start, cycle_counter_read());
+        us += time_us_32() - t0;
+        restore_interrupts(irq);
+        if (status != STATUS_OK) break;
+        done++;
+    }
+    if (done > 0) {
+        result->read_cycles = (uint32_t)(cycles / done);
+        result->read_us = (uint32_t)(us / done);
+    }
+    result->read_iterations = done;
+
+    (void)PICC_HaltA(mfrc);
+    PCD_StopCrypto1(mfrc);
+    return 0;
+}
+
+#if MFRC522_PIO_SPI
+void mfrc522_bench_compare_buses(MFRC522Ptr_t mfrc, spi_inst_t *spi, PIO pio,
+                                 uint32_t iterations) {
+    mfrc522_bench_result_t hw, sm;
+    bool was_pio = PCD_USES_PIO(mfrc);
+    spi_inst_t *old_spi = mfrc->spi;
+    uint32_t mhz = clock_get_hz(clk_sys) / 1000000;
+
+    PCD_AttachSpiBus(mfrc, spi);
+    mfrc522_bench_register_access(mfrc, iterations, &hw);
+
+    if (!PCD_AttachPioBus(mfrc, pio)) {
+        printf("[BENCH] ERRO: sem state machine PIO livre\n");
+        if (was_pio) PCD_AttachPioBus(mfrc, mfrc->pio);
+        return;
+    }
+    mfrc522_bench_register_access(mfrc, iterations, &sm);
+
+    // Devolve o leitor ao barramento original
+    if (!was_pio) {
+        PCD_AttachSpiBus(mfrc, old_spi);
+    }
+
+    printf("[BENCH] SPI de hardware vs. SPI em PIO (%lu iteracoes, %lu MHz)\n",
+           (unsigned long)iterations, (unsigned long)mhz);
+    printf("[BENCH] %-24s %10s %10s\n", "Operacao (ciclos)", "SPI HW", "PIO");
+    printf("[BENCH] %-24s %10lu %10lu\n", "WriteRegister",
+           (unsigned long)hw.write_cycles, (unsigned long)sm.write_cycles);
+    printf("[BENCH] %-24s %10lu %10lu\n", "ReadRegister",
+           (unsigned long)hw.read_cycles, (unsigned long)sm.read_cycles);
+    printf("[BENCH] %-24s %10lu %10lu\n", "WriteNRegister (64 B)",
+           (unsigned long)hw.fifo_write_cycles, (unsigned long)sm.fifo_write_cycles);
+    printf("[BENCH] %-24s %10lu %10lu\n", "ReadNRegister (64 B)",
+           (unsigned long)hw.fifo_read_cycles, (unsigned long)sm.fifo_read_cycles);
+}
+#endif
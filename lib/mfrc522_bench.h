@@ -0,0 +1,152 @@
+/**
+ * mfrc522_bench.h
+ *
+ * Medição do custo de acesso a registradores do MFRC522 em ciclos de CPU.
+ *
+ * Usado para comparar as variantes do driver (configuração de runtime vs.
+ * MFRC522_STATIC_CONFIG, SDK vs. MFRC522_FAST_SPI) diretamente no hardware
+ * e, no firmware RFID_BENCH (main_bench.c), para conferir os números do
+ * simulador de benchmarks/ contra o chip real.
+ */
+
+#ifndef MFRC522_BENCH_H
+#define MFRC522_BENCH_H
+
+#include <stdint.h>
+#include "mfrc522.h"
+
+// Média de ciclos por operação
+typedef struct {
+    uint32_t write_cycles;       // PCD_WriteRegister
+    uint32_t read_cycles;        // PCD_ReadRegister
+    uint32_t fifo_write_cycles;  // PCD_WriteNRegister de FIFO_SIZE bytes
+    uint32_t fifo_read_cycles;   // PCD_ReadNRegister de FIFO_SIZE bytes
+    uint32_t iterations;
+    bool pio;                    // Medido no barramento SPI em PIO
+} mfrc522_bench_result_t;
+
+/**
+ * @brief Mede o custo médio dos acessos a registradores.
+ *
+ * Escreve de volta o valor atual de WaterLevelReg e usa a FIFO com flush
+ * antes e depois, sem transmitir nada pela antena.
+ *
+ * @param mfrc O leitor já inicializado com PCD_Init().
+ * @param iterations Repetições por operação.
+ * @param result Resultado em ciclos por operação.
+ */
+void mfrc522_bench_register_access(MFRC522Ptr_t mfrc, uint32_t iterations,
+                                   mfrc522_bench_result_t *result);
+
+/**
+ * @brief Imprime o resultado no serial, com a variante do driver.
+ */
+void mfrc522_bench_print(const mfrc522_bench_result_t *result);
+
+// Rajadas de FIFO numa velocidade do SPI de hardware
+typedef struct {
+    uint32_t baud;               // Velocidade efetiva (divisores do periférico)
+    uint32_t fifo_write_cycles;  // PCD_WriteNRegister de FIFO_SIZE bytes
+    uint32_t fifo_read_cycles;   // PCD_ReadNRegister de FIFO_SIZE bytes
+} mfrc522_bench_speed_t;
+
+/**
+ * @brief Mede as rajadas de FIFO em cada velocidade do SPI de hardware e
+ * devolve o barramento à velocidade em que estava.
+ *
+ * O MFRC522 aceita até 10 Mbit/s; acima disso as leituras podem falhar.
+ *
+ * @param mfrc O leitor já inicializado com PCD_Init().
+ * @param bauds Velocidades pedidas (bit/s).
+ * @param count Quantidade de velocidades (e de posições em results).
+ * @param iterations Repetições por rajada.
+ * @param results Resultado por velocidade.
+ * @return 0 em caso de sucesso, -1 se o leitor está no SPI em PIO.
+ */
+int mfrc522_bench_spi_speeds(MFRC522Ptr_t mfrc, const uint32_t *bauds, uint32_t count,
+                             uint32_t iterations, mfrc522_bench_speed_t *results);
+
+// CRC_A de um quadro: coprocessador do MFRC522 vs. software
+typedef struct {
+    uint32_t length;             // Bytes do quadro
+    uint32_t hw_cycles;          // PCD_CalculateCRC (FIFO + CalcCRC + leitura)
+    uint32_t sw_cycles;          // mfrc522_bench_crc_a()
+    bool match;                  // Os dois calcularam o mesmo CRC
+} mfrc522_bench_crc_t;
+
+/**
+ * @brief CRC_A (ISO/IEC 14443-3) em software, na ordem de envio
+ * (byte menos significativo primeiro em result[0]).
+ */
+void mfrc522_bench_crc_a(const uint8_t *data, uint8_t length, uint8_t result[2]);
+
+/**
+ * @brief Mede o CRC_A de um quadro no coprocessador e em software.
+ *
+ * @param mfrc O leitor já inicializado com PCD_Init().
+ * @param length Bytes do quadro (até FIFO_SIZE).
+ * @param iterations Repetições por variante.
+ * @param result Resultado em ciclos por quadro.
+ */
+void mfrc522_bench_crc(MFRC522Ptr_t mfrc, uint8_t length, uint32_t iterations,
+                       mfrc522_bench_crc_t *result);
+
+// Operações no ar (ciclos de CPU e us do timer, média por operação)
+typedef struct {
+    uint32_t reqa_cycles;        // REQA com o campo vazio (até o timeout)
+    uint32_t reqa_us;
+    uint32_t reqa_iterations;
+    uint32_t select_cycles;      // PICC_Select completo (anticolisão + SELECT)
+    uint32_t select_us;
+    uint32_t select_iterations;
+    uint32_t read_cycles;        // MIFARE_Read de um bloco (16 bytes + CRC_A)
+    uint32_t read_us;
+    uint32_t read_iterations;    // 0: sem leitura (chave padrão recusada)
+    uint8_t uid_size;
+    PICC_Type type;
+} mfrc522_bench_rf_t;
+
+/**
+ * @brief Mede o REQA sem tag no campo: o tempo é dominado pelo timeout
+ * do timer do MFRC522 programado em PCD_Init().
+ *
+ * @param mfrc O leitor já inicializado com PCD_Init().
+ * @param iterations Repetições.
+ * @param result Preenche os campos reqa_*.
+ * @return 0 em caso de sucesso, -1 se alguma tag respondeu.
+ */
+int mfrc522_bench_reqa_empty(MFRC522Ptr_t mfrc, uint32_t iterations, mfrc522_bench_rf_t *result);
+
+/**
+ * @brief Mede SELECT e MIFARE_Read com uma tag parada no campo.
+ *
+ * Cada SELECT parte da tag em HALT (HLTA + WUPA fora da medição). A
+ * leitura usa o bloco 4: MIFARE Classic autentica antes com a chave A
+ * padrão (FF FF FF FF FF FF); Ultralight/NTAG lê sem autenticação. Ao
+ * final a tag fica em HALT.
+ *
+ * @param mfrc O leitor já inicializado, com a tag lida por
+ * PICC_ReadCardSerial() (mfrc->uid preenchido).
+ * @param iterations Repetições por operação.
+ * @param result Preenche os campos select_*, read_*, uid_size e type.
+ * @return 0 em caso de sucesso, -1 se a tag não respondeu ao SELECT.
+ */
+int mfrc522_bench_card(MFRC522Ptr_t mfrc, uint32_t iterations, mfrc522_bench_rf_t *result);
+
+#if MFRC522_PIO_SPI
+/**
+ * @brief Compara o barramento SPI de hardware com o SPI em PIO.
+ *
+ * Mede nos mesmos pinos, alternando o leitor entre os dois barramentos,
+ * e devolve o leitor ao barramento em que estava.
+ *
+ * @param mfrc O leitor já inicializado com PCD_Init().
+ * @param spi O periférico SPI de hardware a usar na comparação.
+ * @param pio O bloco PIO a usar na comparação.
+ * @param iterations Repetições por operação.
+ */
+void mfrc522_bench_compare_buses(MFRC522Ptr_t mfrc, spi_inst_t *spi, PIO pio,
+                                 uint32_t iterations);
+#endif
+
+#endif // MFRC522_BENCH_H
@@ -0,0 +1,88 @@
+/**
+ * PIO SPI master for the MFRC522.
+ * NOTE: see mfrc522_spi.pio for the frame format.
+ */
+
+#include "mfrc522_pio.h"
+#include "hardware/clocks.h"
+#include "mfrc522_spi.pio.h"
+
+// Program offset per PIO block (-1 => not loaded yet)
+static int program_offset[NUM_PIOS] = { -1, -1 };
+
+int mfrc522_pio_init(PIO pio, uint cs, uint sck, uint mosi, uint miso, uint baudrate) {
+	uint index = pio_get_index(pio);
+
+	if (program_offset[index] < 0) {
+		if (!pio_can_add_program(pio, &mfrc522_spi_program)) {
+			return -1;
+		}
+		program_offset[index] = pio_add_program(pio, &mfrc522_spi_program);
+	}
+
+	int sm = pio_claim_unused_sm(pio, false);
+	if (sm < 0) {
+		return -1;
+	}
+
+	pio_sm_config c = mfrc522_spi_program_get_default_config(program_offset[index]);
+	sm_config_set_out_pins(&c, mosi, 1);
+	sm_config_set_in_pins(&c, miso);
+	sm_config_set_set_pins(&c, cs, 1);
+	sm_config_set_sideset_pins(&c, sck);
+	// MSB first, autopull/autopush every 8 bits
+	sm_config_set_out_shift(&c, false, true, 8);
+	sm_config_set_in_shift(&c, false, true, 8);
+	// 4 state machine cycles per SCK period
+	sm_config_set_clkdiv(&c, (float)clock_get_hz(clk_sys) / (4.0f * baudrate));
+
+	// CS idle high, SCK idle low (mode 0)
+	uint32_t out_mask = (1u << cs) | (1u << sck) | (1u << mosi);
+	pio_sm_set_pins_with_mask(pio, sm, 1u << cs, out_mask);
+	pio_sm_set_pindirs_with_mask(pio, sm, out_mask, out_mask | (1u << miso));
+	mfrc522_pio_attach_pins(pio, cs, sck, mosi, miso);
+
+	pio_sm_init(pio, sm, program_offset[index], &c);
+	pio_sm_set_enabled(pio, sm, true);
+	return sm;
+}
+
+void mfrc522_pio_attach_pins(PIO pio, uint cs, uint sck, uint mosi, uint miso) {
+	pio_gpio_init(pio, cs);
+	pio_gpio_init(pio, sck);
+	pio_gpio_init(pio, mosi);
+	pio_gpio_init(pio, miso);
+}
+
+void __not_in_flash_func(mfrc522_pio_frame)(PIO pio, uint sm, uint8_t address,
+										  const uint8_t *data, uint8_t fill,
+										  uint8_t *rx, uint count) {
+	const uint total = count + 1;
+	uint sent = 0;
+	uint received = 0;
+
+	pio_sm_put(pio, sm, total * 8 - 1); // Frame header
+
+	// At most 4 bytes in flight: the RX FIFO is 4 words deep
+	while (received < total) {
+		if (sent < total && (sent - received) < 4 && !pio_sm_is_tx_fifo_full(pio, sm)) {
+			uint8_t value;
+			if (sent == 0) {
+				value = address;
+			} else if (data) {
+				value = data[sent - 1];
+			} else {
+				value = (sent == total - 1) ? 0x00 : fill;
+			}
+			pio_sm_put(pio, sm, (uint32_t)value << 24);
+			sent++;
+		}
+		if (!pio_sm_is_rx_fifo_empty(pio, sm)) {
+			uint8_t value = (uint8_t)pio_sm_get(pio, sm);
+			if (received > 0 && rx) {
+				rx[received - 1] = value;
+			}
+			received++;
+		}
+	}
+}
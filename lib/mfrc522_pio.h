@@ -0,0 +1,40 @@
+/*
+ * mfrc522_pio.h
+ *
+ * PIO based SPI master for the MFRC522 (see mfrc522_spi.pio).
+ *
+ * The state machine handles CS framing and multi-byte sequences on its own,
+ * so readers can sit on any GPIOs and the hardware SPI peripherals stay free
+ * for other devices.
+ */
+
+#ifndef MFRC522_PIO_h
+#define MFRC522_PIO_h
+
+#include <stdint.h>
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+
+/**
+ * @brief Claims a state machine on pio and configures it for the given pins
+ * @return The state machine index, or -1 if no state machine/program space
+ */
+int mfrc522_pio_init(PIO pio, uint cs, uint sck, uint mosi, uint miso, uint baudrate);
+
+/**
+ * @brief Routes the pins back to the state machine (after using another bus)
+ */
+void mfrc522_pio_attach_pins(PIO pio, uint cs, uint sck, uint mosi, uint miso);
+
+/**
+ * @brief Clocks one CS-framed frame: address followed by count bytes
+ *
+ * The count bytes are taken from data, or, if data is NULL, are all fill
+ * except the last one, which is 0x00 (the MFRC522 burst read terminator).
+ * The count bytes received after the address byte are stored in rx (may
+ * be NULL).
+ */
+void mfrc522_pio_frame(PIO pio, uint sm, uint8_t address, const uint8_t *data,
+					   uint8_t fill, uint8_t *rx, uint count);
+
+#endif // MFRC522_PIO_h
@@ -0,0 +1,366 @@
+#include "mqtt_link.h"
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "lwip/apps/mqtt.h"
+#include "lwip/dns.h"
+#include "rfid_config.h"
+#include "supervisor.h"
+#include "crash_dump.h"
+#include "reconnect_sched.h"
+
+// Tempo que o LED fica apagado a cada publicação confirmada
+#define LED_BLINK_MS  50
+
+// Espera máxima pela resolução do broker
+#define DNS_TIMEOUT_MS  5000
+
+// Reconexão: reconnect_delay_ms após a primeira falha, dobrando até 8x
+#define RECONNECT_BACKOFF_MAX_SHIFT  3
+
+// Maior mensagem recebida no tópico assinado (chega em fragmentos)
+#define RX_MAX  1536
+
+static mqtt_client_t *mqtt_client = NULL;
+static volatile bool mqtt_connected = false;
+
+// Publicações aceitas pelo lwIP ainda sem callback (ocupam a janela de
+// MQTT_REQ_MAX_IN_FLIGHT); atualizado sob o lock do lwIP
+static uint32_t in_flight = 0;
+static ip_addr_t mqtt_broker_ip;
+static void (*connected_hook)(void) = NULL;
+
+static reconnect_sched_t reconnect;
+static bool dns_pending = false;
+static volatile bool dns_failed = false;
+static absolute_time_t dns_deadline;
+static volatile bool led_blink_pending = false;
+static absolute_time_t led_blink_until;
+static mqtt_link_stats_t link_stats;
+
+static uint32_t now_ms(void) {
+    return to_ms_since_boot(get_absolute_time());
+}
+
+// Assinaturas (refeitas a cada conexão: a sessão é limpa)
+typedef struct {
+    const char *topic;
+    mqtt_link_message_fn handler;
+} subscription_t;
+
+static subscription_t subs[MQTT_LINK_MAX_SUBS];
+static uint32_t sub_count = 0;
+static const subscription_t *rx_sub;   // Assinatura da mensagem em curso (NULL = nenhuma)
+static char rx_buf[RX_MAX + 1];
+static uint32_t rx_len;
+static bool rx_overflow;
+
+/**
+ * Início de uma publicação recebida
+ */
+static void mqtt_incoming_publish_cb(void *arg, const char *topic, u32_t tot_len) {
+    rx_sub = NULL;
+    for (uint32_t i = 0; i < sub_count; i++) {
+        if (strcmp(topic, subs[i].topic) == 0) {
+            rx_sub = &subs[i];
+            break;
+        }
+    }
+    rx_overflow = tot_len > RX_MAX;
+    rx_len = 0;
+    if (rx_sub != NULL && rx_overflow) {
+        printf("[MQTT] AVISO: mensagem de %lu bytes em %s excede %u, ignorada\n",
+               (unsigned long)tot_len, topic, RX_MAX);
+    }
+}
+
+/**
+ * Fragmentos da publicação recebida; entrega ao handler no último
+ */
+static void mqtt_incoming_data_cb(void *arg, const u8_t *data, u16_t len, u8_t flags) {
+    if (rx_sub == NULL || rx_overflow) return;
+
+    if (rx_len + len <= RX_MAX) {
+        memcpy(rx_buf + rx_len, data, len);
+        rx_len += len;
+    }
+    if (flags & MQTT_DATA_FLAG_LAST) {
+        const subscription_t *sub = rx_sub;
+        rx_buf[rx_len] = '\0';
+        rx_sub = NULL;
+        crash_trace(CRASH_TRACE_RX, rx_len);
+        sub->handler(sub->topic, rx_buf, rx_len);
+    }
+}
+
+static void mqtt_sub_request_cb(void *arg, err_t result) {
+    const subscription_t *sub = arg;
+    if (result != ERR_OK) {
+        printf("[MQTT] ERRO ao assinar %s! Codigo: %d\n", sub->topic, result);
+    }
+}
+
+/**
+ * Callback chamado quando a resolução DNS é concluída
+ */
+static void dns_found_cb(const char *hostname, const ip_addr_t *ipaddr, void *arg) {
+    if (ipaddr != NULL) {
+        mqtt_broker_ip = *ipaddr;
+        printf("[MQTT] Broker resolvido: %s\n", ip4addr_ntoa(ipaddr));
+    } else {
+        printf("[MQTT] ERRO: Falha ao resolver hostname!\n");
+        dns_failed = true;
+    }
+}
+
+/**
+ * Callback de conexão MQTT
+ */
+static void mqtt_connection_cb(mqtt_client_t *client, void *arg, mqtt_connection_status_t status) {
+    if (status == MQTT_CONNECT_ACCEPTED) {
+        mqtt_connected = true;
+        in_flight = 0;
+        reconnect_sched_reset(&reconnect);
+        link_stats.connects++;
+        printf("[MQTT] Conectado ao broker!\n");
+
+        if (sub_count > 0) {
+            mqtt_set_inpub_callback(client, mqtt_incoming_publish_cb,
+                                    mqtt_incoming_data_cb, NULL);
+        }
+        for (uint32_t i = 0; i < sub_count; i++) {
+            mqtt_subscribe(client, subs[i].topic, 1, mqtt_sub_request_cb, &subs[i]);
+        }
+
+        if (connected_hook) {
+            connected_hook();
+        }
+
+        // LED integrado: aceso = conectado
+        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
+    } else {
+        // Queda de uma conexão ativa: primeira tentativa sem backoff
+        if (mqtt_connected) {
+            reconnect_sched_reset(&reconnect);
+        } else {
+            reconnect_sched_failed(&reconnect, now_ms());
+        }
+        mqtt_connected = false;
+        printf("[MQTT] Conexao falhou! Status: %d\n", status);
+        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
+    }
+}
+
+/**
+ * Callback de confirmação de publicação MQTT
+ */
+static void mqtt_pub_request_cb(void *arg, err_t result) {
+    if (in_flight > 0) in_flight--;
+
+    if (result == ERR_OK) {
+        link_stats.last_done_us = time_us_64();
+
+        // QoS 1: arg carrega o instante do envio (bit 0 ligado para nunca ser NULL)
+        if (arg != NULL) {
+            uint32_t rtt = time_us_32() - ((uint32_t)(uintptr_t)arg & ~1u);
+            link_stats.acks++;
+            link_stats.rtt_last_us = rtt;
+            link_stats.rtt_avg_us = link_stats.acks == 1 ? rtt :
+                                    link_stats.rtt_avg_us - link_stats.rtt_avg_us / 8 + rtt / 8;
+            if (rtt > link_stats.rtt_max_us) link_stats.rtt_max_us = rtt;
+        }
+
+        printf("[MQTT] Mensagem publicada com sucesso!\n");
+
+        // Pisca LED para indicar publicação (reacende em mqtt_link_service,
+        // sem bloquear o contexto do lwIP)
+        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
+        led_blink_until = make_timeout_time_ms(LED_BLINK_MS);
+        led_blink_pending = true;
+    } else {
+        printf("[MQTT] ERRO ao publicar! Codigo: %d\n", result);
+    }
+}
+
+void mqtt_link_init(void (*on_connected)(void)) {
+    connected_hook = on_connected;
+    reconnect_sched_init(&reconnect, rfid_config()->reconnect_delay_ms,
+                         RECONNECT_BACKOFF_MAX_SHIFT, 0, now_ms());
+}
+
+/**
+ * Inicia a conexão MQTT com o broker já resolvido
+ */
+static void start_connect(void) {
+    const rfid_config_t *cfg = rfid_config();
+
+    supervisor_set_phase(SUP_PHASE_MQTT_CONNECT);
+    printf("[MQTT] Conectando ao broker %s:%d...\n",
+           ip4addr_ntoa(&mqtt_broker_ip), cfg->mqtt_port);
+
+    // Configuração de conexão
+    struct mqtt_connect_client_info_t ci;
+    memset(&ci, 0, sizeof(ci));
+    ci.client_id = cfg->mqtt_client_id;
+    ci.keep_alive = 60;  // Keep-alive de 60 segundos
+
+    // Conecta ao broker
+    cyw43_arch_lwip_begin();
+    err_t err = mqtt_client_connect(mqtt_client, &mqtt_broker_ip, cfg->mqtt_port,
+                                    mqtt_connection_cb, NULL, &ci);
+    cyw43_arch_lwip_end();
+
+    if (err != ERR_OK) {
+        printf("[MQTT] ERRO ao iniciar conexao! Codigo: %d\n", err);
+        mqtt_connected = false;
+        reconnect_sched_failed(&reconnect, now_ms());
+    } else {
+        printf("[MQTT] Conexao iniciada, aguardando confirmacao...\n");
+    }
+}
+
+void mqtt_link_connect(void) {
+    const rfid_config_t *cfg = rfid_config();
+
+    printf("[MQTT] Inicializando cliente...\n");
+    reconnect_sched_attempt(&reconnect, now_ms());
+
+    // Se já existe um cliente, desconecta e libera recursos
+    if (mqtt_client != NULL) {
+        printf("[MQTT] Liberando cliente antigo...\n");
+        mqtt_link_disconnect();
+    }
+
+    cyw43_arch_lwip_begin();
+    mqtt_client = mqtt_client_new();
+    cyw43_arch_lwip_end();
+    if (mqtt_client == NULL) {
+        printf("[MQTT] ERRO: Falha ao criar cliente!\n");
+        reconnect_sched_failed(&reconnect, now_ms());
+        return;
+    }
+
+    // Tenta converter IP do broker
+    if (ip4addr_aton(cfg->mqtt_broker, &mqtt_broker_ip)) {
+        start_connect();
+        return;
+    }
+
+    // Se não for IP válido, resolve via DNS; a conexão segue em
+    // mqtt_link_service() quando a resposta chegar
+    printf("[MQTT] IP invalido, tentando resolver DNS...\n");
+    ip_addr_set_zero(&mqtt_broker_ip);
+    dns_failed = false;
+    cyw43_arch_lwip_begin();
+    err_t err = dns_gethostbyname(cfg->mqtt_broker, &mqtt_broker_ip, dns_found_cb, NULL);
+    cyw43_arch_lwip_end();
+
+    if (err == ERR_OK) {
+        start_connect();  // Já estava no cache
+    } else if (err == ERR_INPROGRESS) {
+        printf("[MQTT] Aguardando resolucao DNS...\n");
+        dns_pending = true;
+        dns_deadline = make_timeout_time_ms(DNS_TIMEOUT_MS);
+    } else {
+        printf("[MQTT] ERRO: Nao foi possivel resolver o broker!\n");
+        reconnect_sched_failed(&reconnect, now_ms());
+    }
+}
+
+void mqtt_link_service(bool wifi_up) {
+    // Reacende o LED após o pisca de publicação
+    if (led_blink_pending && time_reached(led_blink_until)) {
+        led_blink_pending = false;
+        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, mqtt_connected);
+    }
+
+    // Resolução DNS em andamento
+    if (dns_pending) {
+        if (mqtt_broker_ip.addr != 0) {
+            dns_pending = false;
+            start_connect();
+        } else if (dns_failed || time_reached(dns_deadline)) {
+            printf("[MQTT] ERRO: Nao foi possivel resolver o broker!\n");
+            dns_pending = false;
+            reconnect_sched_failed(&reconnect, now_ms());
+        }
+        return;
+    }
+
+    if (mqtt_connected || !wifi_up) return;
+
+    if (!reconnect_sched_due(&reconnect, now_ms())) {
+        return; // Ainda não é hora de tentar reconectar
+    }
+
+    printf("[MQTT] Tentando reconectar...\n");
+    mqtt_link_connect();
+}
+
+bool mqtt_link_is_connected(void) {
+    return mqtt_connected;
+}
+
+bool mqtt_link_publish(const char *topic, const char *payload, uint8_t qos) {
+    return mqtt_link_publish_bin(topic, payload, strlen(payload), qos);
+}
+
+bool mqtt_link_publish_bin(const char *topic, const void *data, size_t len, uint8_t qos) {
+    if (!mqtt_connected) return false;
+
+    void *sent_at = qos > 0 ? (void *)(uintptr_t)(time_us_32() | 1u) : NULL;
+
+    cyw43_arch_lwip_begin();
+    err_t err = mqtt_publish(mqtt_client, topic, data, (u16_t)len,
+                             qos, 0, mqtt_pub_request_cb, sent_at);
+    if (err == ERR_OK) in_flight++;
+    cyw43_arch_lwip_end();
+
+    if (err != ERR_OK) {
+        printf("[MQTT] ERRO ao publicar! Codigo: %d\n", err);
+        return false;
+    }
+    return true;
+}
+
+int mqtt_link_subscribe(const char *topic, mqtt_link_message_fn on_message) {
+    if (sub_count == MQTT_LINK_MAX_SUBS) {
+        printf("[MQTT] ERRO: limite de %d assinaturas\n", MQTT_LINK_MAX_SUBS);
+        return -1;
+    }
+    subs[sub_count].topic = topic;
+    subs[sub_count].handler = on_message;
+    sub_count++;
+    return 0;
+}
+
+void mqtt_link_disconnect(void) {
+    dns_pending = false;
+    if (mqtt_client == NULL) return;
+
+    cyw43_arch_lwip_begin();
+    mqtt_disconnect(mqtt_client);
+    mqtt_client_free(mqtt_client);
+    cyw43_arch_lwip_end();
+
+    mqtt_client = NULL;
+    mqtt_connected = false;
+    in_flight = 0;
+    cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
+}
+
+uint32_t mqtt_link_window_free(void) {
+    if (!mqtt_connected) return 0;
+    return in_flight < MQTT_REQ_MAX_IN_FLIGHT ? MQTT_REQ_MAX_IN_FLIGHT - in_flight : 0;
+}
+
+void mqtt_link_get_stats(mqtt_link_stats_t *stats) {
+    *stats = link_stats;
+}
+
+int mqtt_link_format_json(char *buf, size_t len) {
+    return snprintf(buf, len, "\"mqtt_rtt_us\":{\"avg\":%lu,\"max\":%lu,\"acks\":%lu}",
+                    (unsigned long)link_stats.rtt_avg_us, (unsigned long)link_stats.rtt_max_us,
+                    (unsigned long)link_stats.acks);
+}
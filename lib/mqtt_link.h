@@ -0,0 +1,107 @@
+/**
+ * mqtt_link.h
+ *
+ * Conexão com o broker MQTT (cliente MQTT do lwIP), compartilhada entre o
+ * firmware bare-metal (main_mqtt.c) e a variante FreeRTOS (main_freertos.c).
+ *
+ * Broker, porta, client id e intervalo de reconexão vêm de rfid_config().
+ * Todas as chamadas ao lwIP ficam entre cyw43_arch_lwip_begin()/end(),
+ * que não custam nada no modo poll e protegem o núcleo do lwIP no FreeRTOS.
+ */
+
+#ifndef MQTT_LINK_H
+#define MQTT_LINK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Tópicos assinados (mapa de marcadores, regras...)
+#define MQTT_LINK_MAX_SUBS  4
+
+// Medidas do enlace com o broker. O tempo de ida e volta das publicações
+// QoS 1 (PUBLISH -> PUBACK) mede WiFi + broker e é sensível ao power save
+typedef struct {
+    uint32_t acks;
+    uint32_t rtt_last_us;
+    uint32_t rtt_avg_us;    // Média móvel (peso 1/8)
+    uint32_t rtt_max_us;
+    uint32_t connects;      // Conexões aceitas pelo broker
+    uint64_t last_done_us;  // Instante (time_us_64) da última publicação concluída
+} mqtt_link_stats_t;
+
+/**
+ * Mensagem recebida num tópico assinado, já remontada e terminada em '\0'.
+ * Executa no contexto do lwIP: não bloquear nem gravar a flash aqui.
+ */
+typedef void (*mqtt_link_message_fn)(const char *topic, const char *data, uint32_t len);
+
+/**
+ * @brief Registra a função chamada a cada conexão aceita pelo broker
+ * (ex: publicar o status "online"). Executa no contexto do lwIP.
+ */
+void mqtt_link_init(void (*on_connected)(void));
+
+/**
+ * @brief Cria o cliente e inicia a conexão sem bloquear. Com hostname, a
+ * resolução DNS (até 5 s) e a conexão continuam em mqtt_link_service().
+ * O resultado chega depois, pelo callback de conexão.
+ */
+void mqtt_link_connect(void);
+
+/**
+ * @brief Tarefas periódicas: resolução DNS pendente, reconexão (após
+ * reconnect_delay_ms, dobrando a cada falha até 8x) e o pisca do LED de
+ * publicação. Chamar no loop principal ou numa tarefa.
+ */
+void mqtt_link_service(bool wifi_up);
+
+/**
+ * @brief Indica se o broker aceitou a conexão e ela continua ativa.
+ */
+bool mqtt_link_is_connected(void);
+
+/**
+ * @brief Publica uma mensagem (retain desligado).
+ * @return true se o lwIP aceitou; false se desconectado ou sem espaço
+ * (ERR_MEM: janela de publicações em andamento cheia, tentar depois).
+ */
+bool mqtt_link_publish(const char *topic, const char *payload, uint8_t qos);
+
+/**
+ * @brief Publica um payload binário (ex: quadro de lib/event_codec.h).
+ */
+bool mqtt_link_publish_bin(const char *topic, const void *data, size_t len, uint8_t qos);
+
+/**
+ * @brief Publicações que ainda cabem na janela do lwIP
+ * (MQTT_REQ_MAX_IN_FLIGHT menos as que aguardam envio ou PUBACK).
+ */
+uint32_t mqtt_link_window_free(void);
+
+/**
+ * @brief Assina um tópico (QoS 1) a cada conexão, inclusive as próximas.
+ * Chamar antes de conectar; mensagens maiores que 1,5 KB são ignoradas.
+ * @param topic Deve continuar válido (ex: campo de rfid_config()).
+ * @return 0 em caso de sucesso, -1 se já há MQTT_LINK_MAX_SUBS assinaturas.
+ */
+int mqtt_link_subscribe(const char *topic, mqtt_link_message_fn on_message);
+
+/**
+ * @brief Copia as medidas de ida e volta das publicações QoS 1.
+ */
+void mqtt_link_get_stats(mqtt_link_stats_t *stats);
+
+/**
+ * @brief Escreve as medidas como campo JSON (sem chaves externas).
+ * Ex: "mqtt_rtt_us":{"avg":8200,"max":41000,"acks":57}
+ * @return O número de caracteres escritos (como snprintf).
+ */
+int mqtt_link_format_json(char *buf, size_t len);
+
+/**
+ * @brief Desconecta e libera o cliente.
+ */
+void mqtt_link_disconnect(void);
+
+#endif // MQTT_LINK_H
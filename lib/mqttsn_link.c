@@ -0,0 +1,545 @@
+#include "mqttsn_link.h"
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "lwip/udp.h"
+#include "lwip/pbuf.h"
+#include "rfid_config.h"
+#include "supervisor.h"
+
+// Tipos de mensagem MQTT-SN 1.2 usados
+#define MSG_CONNECT         0x04
+#define MSG_CONNACK         0x05
+#define MSG_REGISTER        0x0A
+#define MSG_REGACK          0x0B
+#define MSG_PUBLISH         0x0C
+#define MSG_PUBACK          0x0D
+#define MSG_PINGREQ         0x16
+#define MSG_PINGRESP        0x17
+#define MSG_DISCONNECT      0x18
+
+#define FLAG_DUP            0x80
+#define FLAG_QOS1           0x20
+#define FLAG_CLEAN_SESSION  0x04
+#define PROTOCOL_ID         0x01
+#define RC_ACCEPTED         0x00
+
+// Temporizações
+#define KEEP_ALIVE_S        60
+#define PING_INTERVAL_MS    30000   // Só quando nada chega do gateway
+#define HANDSHAKE_RETRY_MS  2000
+#define HANDSHAKE_TRIES     3
+#define RTO_MIN_MS          300     // Timeout de retransmissão: 2x RTT médio,
+#define RTO_MAX_MS          4000    // dobrando a cada tentativa
+#define MAX_RETRIES         5
+
+// Maior datagrama (status com toda a telemetria)
+#define MAX_PACKET          1100
+
+// Tópicos registrados; as mensagens em voo guardam o índice, não o id,
+// que pode mudar ao reconectar
+enum { TOPIC_RFID, TOPIC_STATUS, TOPIC_POSITION, TOPIC_REPLY, TOPIC_CRASH, TOPIC_COUNT };
+
+typedef enum {
+    SN_IDLE,            // Sem sessão (aguardando reconexão)
+    SN_CONNECTING,      // CONNECT enviado
+    SN_REGISTERING,     // REGISTER dos tópicos
+    SN_ACTIVE
+} sn_state_t;
+
+// Mensagem QoS 1 aguardando PUBACK
+typedef struct {
+    bool used;
+    uint8_t topic;
+    uint8_t retries;
+    uint16_t msg_id;
+    uint16_t len;
+    uint64_t first_sent_us;
+    absolute_time_t next_retry;
+    uint8_t data[MQTTSN_MAX_RETAINED];
+} inflight_t;
+
+static struct udp_pcb *pcb = NULL;
+static ip_addr_t gateway_ip;
+static uint16_t gateway_port;
+static void (*connected_hook)(void) = NULL;
+
+static volatile sn_state_t state = SN_IDLE;
+static volatile bool connected_pending = false;  // Chama o hook fora do callback
+static volatile bool heard_from_gateway = false;
+static uint16_t topic_ids[TOPIC_COUNT];
+static volatile uint8_t registering;
+static uint16_t reg_msg_id;
+static uint16_t next_msg_id = 1;
+static uint8_t handshake_tries;
+static absolute_time_t handshake_retry;
+static absolute_time_t last_attempt;
+static absolute_time_t next_ping;
+static uint8_t pings_outstanding;
+
+// Estado, janela e tx_buf são usados pelas tarefas de publicação e de
+// manutenção e pelo udp_recv_cb (thread do lwIP): tudo roda com o lwIP
+// travado, entre cyw43_arch_lwip_begin()/end(), que no modo
+// poll não custa nada e no FreeRTOS serializa com o callback
+static inflight_t inflight[MQTTSN_WINDOW];
+static uint8_t tx_buf[MAX_PACKET];
+static mqttsn_link_stats_t stats;
+
+// --- Codificação ---
+
+static void put16(uint8_t *p, uint16_t v) {
+    p[0] = v >> 8;
+    p[1] = v & 0xFF;
+}
+
+static uint16_t get16(const uint8_t *p) {
+    return (uint16_t)(p[0] << 8) | p[1];
+}
+
+static uint16_t new_msg_id(void) {
+    uint16_t id = next_msg_id++;
+    if (next_msg_id == 0) next_msg_id = 1;  // 0 é reservado
+    return id;
+}
+
+// O corpo é montado em tx_buf + 4; o cabeçalho (2 ou 4 bytes) vai logo antes
+#define BODY        (tx_buf + 4)
+#define BODY_MAX    (MAX_PACKET - 4)
+
+static bool send_packet(uint8_t type, size_t body_len) {
+    size_t len = body_len + 2;
+    uint8_t *start;
+
+    if (len < 256) {
+        start = tx_buf + 2;
+        start[0] = (uint8_t)len;
+    } else {
+        len += 2;
+        start = tx_buf;
+        start[0] = 0x01;    // Comprimento em 3 bytes
+        put16(start + 1, (uint16_t)len);
+    }
+    start[len - body_len - 1] = type;
+
+    if (pcb == NULL) return false;
+
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)len, PBUF_RAM);
+    err_t err = ERR_MEM;
+    if (p != NULL) {
+        memcpy(p->payload, start, len);
+        err = udp_sendto(pcb, p, &gateway_ip, gateway_port);
+        pbuf_free(p);
+    }
+
+    if (err != ERR_OK) return false;
+    stats.bytes_tx += len;
+    return true;
+}
+
+static bool send_connect(void) {
+    const char *client_id = rfid_config()->mqtt_client_id;
+    size_t id_len = strlen(client_id);
+
+    BODY[0] = FLAG_CLEAN_SESSION;
+    BODY[1] = PROTOCOL_ID;
+    put16(BODY + 2, KEEP_ALIVE_S);
+    memcpy(BODY + 4, client_id, id_len);
+    return send_packet(MSG_CONNECT, 4 + id_len);
+}
+
+static const char *topic_name(uint8_t topic) {
+    const rfid_config_t *cfg = rfid_config();
+    switch (topic) {
+        case TOPIC_RFID:    return cfg->topic_rfid;
+        case TOPIC_STATUS:  return cfg->topic_status;
+        case TOPIC_REPLY:   return cfg->topic_reply;
+        case TOPIC_CRASH:   return cfg->topic_crash;
+        default:            return cfg->topic_position;
+    }
+}
+
+// Próximo tópico a registrar a partir de 'topic'; os vazios ficam de fora
+static uint8_t next_topic(uint8_t topic) {
+    while (topic < TOPIC_COUNT && topic_name(topic)[0] == '\0') topic++;
+    return topic;
+}
+
+static bool send_register(uint8_t topic) {
+    const char *name = topic_name(topic);
+    size_t name_len = strlen(name);
+
+    reg_msg_id = new_msg_id();
+    put16(BODY, 0);
+    put16(BODY + 2, reg_msg_id);
+    memcpy(BODY + 4, name, name_len);
+    return send_packet(MSG_REGISTER, 4 + name_len);
+}
+
+static bool send_publish(uint8_t flags, uint8_t topic, uint16_t msg_id,
+                         const void *data, size_t len) {
+    if (len > BODY_MAX - 5) return false;
+
+    BODY[0] = flags;
+    put16(BODY + 1, topic_ids[topic]);
+    put16(BODY + 3, msg_id);
+    memcpy(BODY + 5, data, len);
+    return send_packet(MSG_PUBLISH, 5 + len);
+}
+
+// --- Janela de retransmissão ---
+
+static uint32_t rto_ms(uint8_t retries) {
+    uint32_t rto = stats.acks ? 2 * stats.rtt_avg_us / 1000 : RTO_MAX_MS / 4;
+    if (rto < RTO_MIN_MS) rto = RTO_MIN_MS;
+    rto <<= retries;
+    return rto > RTO_MAX_MS ? RTO_MAX_MS : rto;
+}
+
+static void on_puback(uint16_t msg_id, uint8_t rc) {
+    for (int i = 0; i < MQTTSN_WINDOW; i++) {
+        inflight_t *m = &inflight[i];
+        if (!m->used || m->msg_id != msg_id) continue;
+
+        if (rc != RC_ACCEPTED) {
+            printf("[MQTT-SN] Publicacao %u recusada pelo gateway (rc %u)\n", msg_id, rc);
+            stats.lost++;
+        } else {
+            uint64_t now = time_us_64();
+            stats.acks++;
+            stats.last_done_us = now;
+            // Karn: RTT só de mensagens sem retransmissão
+            if (m->retries == 0) {
+                uint32_t rtt = (uint32_t)(now - m->first_sent_us);
+                stats.rtt_last_us = rtt;
+                stats.rtt_avg_us = stats.acks == 1 ? rtt :
+                                   stats.rtt_avg_us - stats.rtt_avg_us / 8 + rtt / 8;
+                if (rtt > stats.rtt_max_us) stats.rtt_max_us = rtt;
+            }
+        }
+        m->used = false;
+        return;
+    }
+}
+
+static void retransmit_due(void) {
+    for (int i = 0; i < MQTTSN_WINDOW; i++) {
+        inflight_t *m = &inflight[i];
+        if (!m->used || !time_reached(m->next_retry)) continue;
+
+        if (m->retries >= MAX_RETRIES) {
+            printf("[MQTT-SN] ERRO: mensagem %u sem PUBACK, descartada\n", m->msg_id);
+            stats.lost++;
+            m->used = false;
+            continue;
+        }
+        m->retries++;
+        stats.retransmits++;
+        send_publish(FLAG_QOS1 | FLAG_DUP, m->topic, m->msg_id, m->data, m->len);
+        m->next_retry = make_timeout_time_ms(rto_ms(m->retries));
+    }
+}
+
+// --- Recepção (contexto do lwIP) ---
+
+static void udp_recv_cb(void *arg, struct udp_pcb *upcb, struct pbuf *p,
+                        const ip_addr_t *addr, u16_t port) {
+    uint8_t buf[16];    // Respostas do gateway são curtas
+    uint16_t n = pbuf_copy_partial(p, buf, sizeof(buf), 0);
+    pbuf_free(p);
+
+    // Só o gateway configurado: um CONNACK/PUBACK forjado de outro endereço
+    // derrubaria a sessão ou confirmaria mensagens que não chegaram
+    if (addr == NULL || !ip_addr_cmp(addr, &gateway_ip) || port != gateway_port) return;
+
+    if (n < 2) return;
+    uint16_t len = buf[0];
+    uint8_t hdr = 2;
+    if (buf[0] == 0x01) {
+        if (n < 4) return;
+        len = get16(buf + 1);
+        hdr = 4;
+    }
+    if (len < hdr || len > n) return;   // Truncada ou longa demais (não assinamos tópicos)
+
+    uint8_t type = buf[hdr - 1];
+    const uint8_t *b = buf + hdr;
+    uint16_t body_len = len - hdr;
+    heard_from_gateway = true;
+
+    switch (type) {
+        case MSG_CONNACK:
+            if (state != SN_CONNECTING || body_len < 1) return;
+            if (b[0] != RC_ACCEPTED) {
+                printf("[MQTT-SN] Conexao recusada! Codigo: %u\n", b[0]);
+                state = SN_IDLE;
+                return;
+            }
+            state = SN_REGISTERING;
+            registering = next_topic(TOPIC_RFID);
+            handshake_tries = 1;
+            handshake_retry = make_timeout_time_ms(HANDSHAKE_RETRY_MS);
+            send_register(registering);
+            return;
+
+        case MSG_REGACK:
+            if (state != SN_REGISTERING || body_len < 5 || get16(b + 2) != reg_msg_id) return;
+            if (b[4] != RC_ACCEPTED) {
+                printf("[MQTT-SN] Registro de %s recusado! Codigo: %u\n",
+                       topic_name(registering), b[4]);
+                state = SN_IDLE;
+                return;
+            }
+            topic_ids[registering] = get16(b);
+            registering = next_topic(registering + 1);
+            if (registering < TOPIC_COUNT) {
+                handshake_tries = 1;
+                handshake_retry = make_timeout_time_ms(HANDSHAKE_RETRY_MS);
+                send_register(registering);
+            } else {
+                state = SN_ACTIVE;
+                connected_pending = true;
+            }
+            return;
+
+        case MSG_PUBACK:
+            if (body_len >= 5) on_puback(get16(b + 2), b[4]);
+            return;
+
+        case MSG_PINGRESP:
+            return;     // heard_from_gateway já registrou
+
+        case MSG_DISCONNECT:
+            printf("[MQTT-SN] Gateway encerrou a sessao\n");
+            state = SN_IDLE;
+            return;
+
+        default:
+            return;
+    }
+}
+
+// --- Interface ---
+
+void mqttsn_link_init(void (*on_connected)(void)) {
+    connected_hook = on_connected;
+    last_attempt = get_absolute_time();
+}
+
+// Com o lwIP travado
+static void connect_locked(void) {
+    const rfid_config_t *cfg = rfid_config();
+
+    last_attempt = get_absolute_time();
+    if (!ip4addr_aton(cfg->mqttsn_gateway, &gateway_ip)) {
+        printf("[MQTT-SN] ERRO: IP do gateway invalido: %s\n", cfg->mqttsn_gateway);
+        return;
+    }
+    gateway_port = cfg->mqttsn_port;
+
+    if (pcb == NULL) {
+        pcb = udp_new();
+        if (pcb != NULL) {
+            udp_bind(pcb, IP_ADDR_ANY, 0);
+            udp_recv(pcb, udp_recv_cb, NULL);
+        }
+    }
+    if (pcb == NULL) {
+        printf("[MQTT-SN] ERRO: Falha ao criar socket UDP!\n");
+        return;
+    }
+
+    supervisor_set_phase(SUP_PHASE_MQTT_CONNECT);
+    printf("[MQTT-SN] Conectando ao gateway %s:%u...\n",
+           ip4addr_ntoa(&gateway_ip), gateway_port);
+
+    state = SN_CONNECTING;
+    handshake_tries = 1;
+    handshake_retry = make_timeout_time_ms(HANDSHAKE_RETRY_MS);
+    send_connect();
+}
+
+void mqttsn_link_connect(void) {
+    cyw43_arch_lwip_begin();
+    connect_locked();
+    cyw43_arch_lwip_end();
+}
+
+// Com o lwIP travado
+static void service_locked(bool wifi_up) {
+    switch (state) {
+        case SN_IDLE: {
+            if (!wifi_up) return;
+            int64_t diff_ms = absolute_time_diff_us(last_attempt, get_absolute_time()) / 1000;
+            if (diff_ms < rfid_config()->reconnect_delay_ms) return;
+            printf("[MQTT-SN] Tentando reconectar...\n");
+            connect_locked();
+            return;
+        }
+
+        case SN_CONNECTING:
+        case SN_REGISTERING:
+            if (!time_reached(handshake_retry)) return;
+            if (++handshake_tries > HANDSHAKE_TRIES) {
+                printf("[MQTT-SN] ERRO: gateway nao respondeu\n");
+                state = SN_IDLE;
+                return;
+            }
+            handshake_retry = make_timeout_time_ms(HANDSHAKE_RETRY_MS);
+            if (state == SN_CONNECTING) {
+                send_connect();
+            } else {
+                send_register(registering);
+            }
+            return;
+
+        case SN_ACTIVE:
+            retransmit_due();
+
+            // Keep-alive: PINGREQ só se o gateway ficou em silêncio
+            if (heard_from_gateway) {
+                heard_from_gateway = false;
+                pings_outstanding = 0;
+                next_ping = make_timeout_time_ms(PING_INTERVAL_MS);
+            } else if (time_reached(next_ping)) {
+                if (pings_outstanding >= HANDSHAKE_TRIES) {
+                    printf("[MQTT-SN] ERRO: gateway sem resposta, reconectando\n");
+                    state = SN_IDLE;
+                    last_attempt = get_absolute_time();
+                    return;
+                }
+                pings_outstanding++;
+                send_packet(MSG_PINGREQ, 0);
+                next_ping = make_timeout_time_ms(HANDSHAKE_RETRY_MS);
+            }
+            return;
+    }
+}
+
+void mqttsn_link_service(bool wifi_up) {
+    bool connected = false;
+
+    cyw43_arch_lwip_begin();
+    if (connected_pending) {
+        connected_pending = false;
+        connected = true;
+        stats.connects++;
+        pings_outstanding = 0;
+        next_ping = make_timeout_time_ms(PING_INTERVAL_MS);
+        printf("[MQTT-SN] Conectado ao gateway!\n");
+
+        // Mensagens de uma sessão anterior seguem já, como duplicatas
+        for (int i = 0; i < MQTTSN_WINDOW; i++) {
+            inflight[i].next_retry = get_absolute_time();
+        }
+    }
+    service_locked(wifi_up);
+    cyw43_arch_lwip_end();
+
+    // O hook publica o status: fora da trava
+    if (connected && connected_hook) {
+        connected_hook();
+    }
+}
+
+bool mqttsn_link_is_connected(void) {
+    return state == SN_ACTIVE;
+}
+
+uint32_t mqttsn_link_window_free(void) {
+    uint32_t free_slots = 0;
+
+    cyw43_arch_lwip_begin();
+    if (state == SN_ACTIVE) {
+        for (int i = 0; i < MQTTSN_WINDOW; i++) {
+            if (!inflight[i].used) free_slots++;
+        }
+    }
+    cyw43_arch_lwip_end();
+    return free_slots;
+}
+
+// Com o lwIP travado
+static bool publish_locked(const char *topic, const char *payload, uint8_t qos) {
+    if (state != SN_ACTIVE) return false;
+
+    uint8_t t = 0;
+    while (t < TOPIC_COUNT && (topic_name(t)[0] == '\0' || strcmp(topic, topic_name(t)) != 0)) {
+        t++;
+    }
+    if (t == TOPIC_COUNT) {
+        printf("[MQTT-SN] ERRO: topico nao registrado: %s\n", topic);
+        return false;
+    }
+    size_t len = strlen(payload);
+
+    if (qos == 0) {
+        if (!send_publish(0, t, 0, payload, len)) return false;
+        stats.last_done_us = time_us_64();
+        return true;
+    }
+
+    if (len > MQTTSN_MAX_RETAINED) {
+        printf("[MQTT-SN] ERRO: payload QoS 1 de %u bytes excede %u\n",
+               (unsigned)len, MQTTSN_MAX_RETAINED);
+        return false;
+    }
+
+    inflight_t *m = NULL;
+    for (int i = 0; i < MQTTSN_WINDOW; i++) {
+        if (!inflight[i].used) {
+            m = &inflight[i];
+            break;
+        }
+    }
+    if (m == NULL) return false;    // Janela cheia: tenta depois
+
+    m->topic = t;
+    m->msg_id = new_msg_id();
+    m->len = (uint16_t)len;
+    m->retries = 0;
+    memcpy(m->data, payload, len);
+    m->first_sent_us = time_us_64();
+    m->next_retry = make_timeout_time_ms(rto_ms(0));
+    m->used = true;
+    stats.sent++;
+
+    // Falha no envio (ex: sem pbuf) é coberta pela retransmissão
+    send_publish(FLAG_QOS1, t, m->msg_id, m->data, len);
+    return true;
+}
+
+bool mqttsn_link_publish(const char *topic, const char *payload, uint8_t qos) {
+    cyw43_arch_lwip_begin();
+    bool ok = publish_locked(topic, payload, qos);
+    cyw43_arch_lwip_end();
+    return ok;
+}
+
+void mqttsn_link_disconnect(void) {
+    cyw43_arch_lwip_begin();
+    if (pcb != NULL) {
+        if (state != SN_IDLE) {
+            send_packet(MSG_DISCONNECT, 0);
+        }
+        udp_remove(pcb);
+        pcb = NULL;
+        state = SN_IDLE;
+    }
+    cyw43_arch_lwip_end();
+}
+
+void mqttsn_link_get_stats(mqttsn_link_stats_t *out) {
+    cyw43_arch_lwip_begin();
+    *out = stats;
+    cyw43_arch_lwip_end();
+}
+
+int mqttsn_link_format_json(char *buf, size_t len) {
+    mqttsn_link_stats_t s;
+    mqttsn_link_get_stats(&s);
+    return snprintf(buf, len,
+                    "\"mqttsn\":{\"rtt_avg_us\":%lu,\"rtt_max_us\":%lu,\"retx\":%lu,\"lost\":%lu}",
+                    (unsigned long)s.rtt_avg_us, (unsigned long)s.rtt_max_us,
+                    (unsigned long)s.retransmits, (unsigned long)s.lost);
+}
@@ -0,0 +1,106 @@
+/**
+ * mqttsn_link.h
+ *
+ * Transporte leve dos eventos por UDP (MQTT-SN 1.2), alternativo ao
+ * cliente MQTT/TCP do lwIP (mqtt_link). Selecionado com 'cfg set transport 1'.
+ *
+ * Em instalações com muitos leitores, cada conexão TCP custa handshake,
+ * keep-alive, PCBs e buffers no broker e no leitor. Aqui cada evento é um
+ * único datagrama para um gateway MQTT-SN (que repassa ao broker):
+ *
+ *  - CONNECT / REGISTER dos tópicos (agv/rfid, status e posição) no início;
+ *  - PUBLISH QoS 1 para as tags: o MsgId é o número de sequência, o
+ *    gateway responde PUBACK e o leitor retransmite (flag DUP) até 5 vezes
+ *    com timeout adaptativo; até MQTTSN_WINDOW mensagens em voo;
+ *  - PUBLISH QoS 0 para o status (sem retransmissão);
+ *  - PINGREQ a cada 30 s detecta gateway ausente.
+ *
+ * Só datagramas do gateway configurado (IP e porta) são aceitos. As funções
+ * podem ser chamadas de tarefas diferentes: o estado da sessão e a janela
+ * só são tocados com o lwIP travado (cyw43_arch_lwip_begin()/end()).
+ *
+ * A interface é a mesma de mqtt_link; link_supervisor escolhe o transporte.
+ * Para testes sem gateway real: tools/mqttsn_gateway.c.
+ */
+
+#ifndef MQTTSN_LINK_H
+#define MQTTSN_LINK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Mensagens QoS 1 aguardando PUBACK
+#define MQTTSN_WINDOW           4
+
+// Maior payload QoS 1 guardado para retransmissão (eventos de tag assinados)
+#define MQTTSN_MAX_RETAINED     288
+
+typedef struct {
+    uint32_t connects;          // CONNACKs recebidos
+    uint32_t sent;              // PUBLISH QoS 1 enviados (sem retransmissões)
+    uint32_t acks;
+    uint32_t retransmits;
+    uint32_t lost;              // Desistências após todas as retransmissões
+    uint32_t bytes_tx;          // Bytes de datagramas enviados (payload UDP)
+    uint32_t rtt_last_us;       // PUBLISH -> PUBACK (só mensagens sem retransmissão)
+    uint32_t rtt_avg_us;        // Média móvel (peso 1/8)
+    uint32_t rtt_max_us;
+    uint64_t last_done_us;      // Instante (time_us_64) da última publicação concluída
+} mqttsn_link_stats_t;
+
+/**
+ * @brief Registra a função chamada quando o gateway aceita a conexão e os
+ * tópicos estão registrados (ex: publicar o status "online").
+ */
+void mqttsn_link_init(void (*on_connected)(void));
+
+/**
+ * @brief Abre o socket UDP e envia CONNECT ao gateway da configuração.
+ * Não bloqueia: o handshake continua em mqttsn_link_service().
+ */
+void mqttsn_link_connect(void);
+
+/**
+ * @brief Handshake, retransmissões, keep-alive e reconexão (após
+ * reconnect_delay_ms). Chamar no loop principal ou numa tarefa.
+ */
+void mqttsn_link_service(bool wifi_up);
+
+/**
+ * @brief Indica se o gateway aceitou a conexão e os tópicos estão registrados.
+ */
+bool mqttsn_link_is_connected(void);
+
+/**
+ * @brief Publica em um dos tópicos registrados (topic_rfid, topic_status,
+ * topic_position, topic_reply ou topic_crash).
+ * @return true se o datagrama foi enviado (QoS 1: e guardado para
+ * retransmissão); false se desconectado, tópico desconhecido ou janela cheia.
+ */
+bool mqttsn_link_publish(const char *topic, const char *payload, uint8_t qos);
+
+/**
+ * @brief Mensagens QoS 1 que ainda cabem na janela (MQTTSN_WINDOW).
+ */
+uint32_t mqttsn_link_window_free(void);
+
+/**
+ * @brief Envia DISCONNECT e fecha o socket. Mensagens em voo são mantidas
+ * e reenviadas (com DUP) na próxima conexão.
+ */
+void mqttsn_link_disconnect(void);
+
+/**
+ * @brief Copia as medidas do transporte.
+ */
+void mqttsn_link_get_stats(mqttsn_link_stats_t *stats);
+
+/**
+ * @brief Escreve as medidas como campo JSON (sem chaves externas).
+ * Ex: "mqttsn":{"rtt_avg_us":6100,"rtt_max_us":30000,"retx":3,"lost":0}
+ * @return O número de caracteres escritos (como snprintf).
+ */
+int mqttsn_link_format_json(char *buf, size_t len);
+
+#endif // MQTTSN_LINK_H
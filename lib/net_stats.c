@@ -0,0 +1,81 @@
+#include "net_stats.h"
+#include <stdio.h>
+#include "pico/cyw43_arch.h"
+#include "lwip/stats.h"
+#include "lwip/memp.h"
+
+#if !MEM_STATS || !MEMP_STATS
+#error "net_stats exige MEM_STATS e MEMP_STATS em lwipopts.h"
+#endif
+
+void net_stats_snapshot(net_stats_t *stats) {
+    cyw43_arch_lwip_begin();
+
+    stats->heap_size = MEM_SIZE;
+    stats->heap_used = lwip_stats.mem.used;
+    stats->heap_max = lwip_stats.mem.max;
+    stats->heap_err = lwip_stats.mem.err;
+
+    stats->pbuf_max = lwip_stats.memp[MEMP_PBUF_POOL]->max;
+    stats->pbuf_avail = lwip_stats.memp[MEMP_PBUF_POOL]->avail;
+    stats->seg_max = lwip_stats.memp[MEMP_TCP_SEG]->max;
+    stats->seg_avail = lwip_stats.memp[MEMP_TCP_SEG]->avail;
+
+    stats->pool_err = 0;
+    for (int i = 0; i < MEMP_MAX; i++) {
+        stats->pool_err += lwip_stats.memp[i]->err;
+    }
+
+    cyw43_arch_lwip_end();
+}
+
+int net_stats_format_json(char *buf, size_t len) {
+    net_stats_t s;
+    net_stats_snapshot(&s);
+
+    return snprintf(buf, len,
+                    "\"heap\":{\"used\":%lu,\"max\":%lu,\"size\":%lu,\"err\":%lu},"
+                    "\"pbuf\":{\"max\":%lu,\"avail\":%lu},"
+                    "\"tcp_seg\":{\"max\":%lu,\"avail\":%lu},\"pool_err\":%lu",
+                    (unsigned long)s.heap_used, (unsigned long)s.heap_max,
+                    (unsigned long)s.heap_size, (unsigned long)s.heap_err,
+                    (unsigned long)s.pbuf_max, (unsigned long)s.pbuf_avail,
+                    (unsigned long)s.seg_max, (unsigned long)s.seg_avail,
+                    (unsigned long)s.pool_err);
+}
+
+void net_stats_print(void) {
+    cyw43_arch_lwip_begin();
+
+    printf("[NET] Perfil lwIP %d\n", LWIP_MEM_PROFILE);
+    printf("[NET] heap: used=%lu max=%lu size=%lu err=%lu\n",
+           (unsigned long)lwip_stats.mem.used, (unsigned long)lwip_stats.mem.max,
+           (unsigned long)MEM_SIZE, (unsigned long)lwip_stats.mem.err);
+
+    for (int i = 0; i < MEMP_MAX; i++) {
+        const struct stats_mem *m = lwip_stats.memp[i];
+#if defined(LWIP_DEBUG) || LWIP_STATS_DISPLAY
+        printf("[NET] %-16s", m->name);
+#else
+        printf("[NET] pool %-11d", i);
+#endif
+        printf(" used=%u max=%u avail=%u err=%lu\n",
+               (unsigned)m->used, (unsigned)m->max, (unsigned)m->avail,
+               (unsigned long)m->err);
+    }
+
+    cyw43_arch_lwip_end();
+}
+
+void net_stats_reset_peaks(void) {
+    cyw43_arch_lwip_begin();
+
+    lwip_stats.mem.max = lwip_stats.mem.used;
+    lwip_stats.mem.err = 0;
+    for (int i = 0; i < MEMP_MAX; i++) {
+        lwip_stats.memp[i]->max = lwip_stats.memp[i]->used;
+        lwip_stats.memp[i]->err = 0;
+    }
+
+    cyw43_arch_lwip_end();
+}
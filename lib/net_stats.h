@@ -0,0 +1,53 @@
+/**
+ * net_stats.h
+ *
+ * Telemetria de memória do lwIP: uso atual, máximo (high-water mark) e
+ * falhas de alocação do heap (MEM_SIZE) e de cada pool (memp).
+ *
+ * Serve para dimensionar os perfis de lib/lwipopts.h com dados reais:
+ * um pool com "max" bem abaixo de "avail" pode ser reduzido, e qualquer
+ * "err" diferente de zero indica que o perfil está pequeno demais.
+ */
+
+#ifndef NET_STATS_H
+#define NET_STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Resumo usado na telemetria MQTT
+typedef struct {
+    uint32_t heap_size;     // MEM_SIZE do perfil
+    uint32_t heap_used;
+    uint32_t heap_max;
+    uint32_t heap_err;      // Falhas de alocação no heap
+    uint32_t pbuf_max;      // Máximo de PBUF_POOL em uso
+    uint32_t pbuf_avail;
+    uint32_t seg_max;       // Máximo de TCP_SEG em uso
+    uint32_t seg_avail;
+    uint32_t pool_err;      // Soma das falhas de todos os pools
+} net_stats_t;
+
+/**
+ * @brief Lê os contadores atuais do lwIP.
+ */
+void net_stats_snapshot(net_stats_t *stats);
+
+/**
+ * @brief Escreve o resumo como campos JSON (sem chaves externas).
+ * Ex: "heap":{"used":1200,"max":3400,"size":8000,"err":0},...
+ * @return O número de caracteres escritos (como snprintf).
+ */
+int net_stats_format_json(char *buf, size_t len);
+
+/**
+ * @brief Imprime heap e todos os pools no serial (comando 'net').
+ */
+void net_stats_print(void);
+
+/**
+ * @brief Zera os máximos e contadores de falha (comando 'net reset').
+ */
+void net_stats_reset_peaks(void);
+
+#endif // NET_STATS_H
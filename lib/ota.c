@@ -0,0 +1,961 @@
+#include "ota.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "pico/critical_section.h"
+#include "pico/cyw43_arch.h"
+#include "hardware/flash.h"
+#include "lwip/pbuf.h"
+#include "lwip/altcp.h"
+#include "lwip/apps/http_client.h"
+#include "flash_layout.h"
+#include "ota_slots.h"
+#include "auth_crypto.h"
+#include "rfid_config.h"
+#include "event_auth.h"
+#include "link_supervisor.h"
+#include "wifi_link.h"
+
+#define SLICE_US            2000    // Gravações por chamada de ota_service
+#define REBOOT_DELAY_MS     2000    // Tempo para a resposta 'ready' sair
+#define REBOOT_WAIT_MAX_MS  10000   // Sem broker: reinicia mesmo sem a resposta
+
+_Static_assert(FLASH_PAGE_SIZE == OTA_PAGE_SIZE && FLASH_SECTOR_SIZE == OTA_SECTOR_SIZE,
+               "geometria da flash diferente da de ota_slots");
+_Static_assert(FLASH_OTA_SLOT_B_OFFSET + FLASH_OTA_SLOT_SIZE <= FLASH_DATA_OFFSET,
+               "slot B invade as regioes de dados da flash");
+_Static_assert(FLASH_OTA_SLOT_SIZE / FLASH_SECTOR_SIZE <= OTA_SLOT_SECTORS_MAX,
+               "slot maior que as marcas do setor de controle");
+
+// Limites da imagem em execução (script do linker do SDK)
+extern char __flash_binary_start;
+extern char __flash_binary_end;
+
+typedef enum {
+    OP_UPDATE,
+    OP_ABORT,
+    OP_CONFIRM,
+    OP_ROLLBACK,
+} ota_op_t;
+
+static const char *const op_names[] = { "update", "abort", "confirm", "rollback" };
+
+typedef enum {
+    DL_IDLE,
+    DL_REQUESTED,       // Pedido aceito (lwIP/console -> ota_service)
+    DL_RUNNING,
+    DL_STAGED,          // Imagem conferida, reinício agendado
+} dl_state_t;
+
+static const char *const dl_names[] = { "idle", "requested", "downloading", "staged" };
+
+typedef struct {
+    char req[16];
+    char url[OTA_URL_MAX];
+    char version[24];
+    uint32_t size;
+    uint8_t sha256[SHA256_DIGEST_SIZE];
+} ota_job_t;
+
+// Resposta pendente: uma por vez, e o progresso não sobrescreve as outras
+typedef struct {
+    bool pending;
+    uint32_t seq;
+    const char *status;
+    const char *error;
+    char req[16];
+    char version[24];
+    uint32_t offset;
+    uint32_t size;
+} ota_reply_t;
+
+// Situação deixada pelo bootloader
+static ota_phase_t boot_phase = OTA_PHASE_IDLE;
+static ota_record_t boot_record;
+static bool result_pending = false;     // Rollback/rejeição ainda não registrados
+static uint32_t healthy_since_ms = 0;
+
+// Pedido e flags: escritos pelo lwIP ou console, lidos por ota_service
+static volatile dl_state_t dl_state = DL_IDLE;
+static ota_job_t job;
+static uint64_t last_ctr = 0;          // Último contador aceito (lwIP)
+static uint64_t saved_ctr = 0;          // Último contador gravado na flash
+static uint64_t unsaved_ctr = 0;        // Contador que não pôde ser gravado
+static uint64_t request_ctr = 0;        // Contador do último pedido registrado
+static bool abort_requested = false;
+static bool confirm_requested = false;
+static bool rollback_requested = false;
+static ota_reply_t reply;
+
+static critical_section_t ota_lock;
+static bool lock_ready = false;
+
+// Download (ota_service); 'held' e http_* também no contexto do lwIP
+static char http_host[64];
+static char http_path[OTA_URL_MAX];
+static uint16_t http_port;
+static httpc_connection_t http_settings;
+static uint32_t http_gen = 0;           // Descarta callbacks de downloads anteriores
+static struct pbuf *held = NULL;        // Recebido e não gravado: a janela TCP fica fechada
+static struct altcp_pcb *http_pcb = NULL;
+static bool http_closed = false;
+static httpc_result_t http_result;
+static uint32_t http_status;
+static const char *http_error = NULL;
+
+static uint8_t page[FLASH_PAGE_SIZE];
+static uint32_t page_len;
+static uint32_t written;                // Bytes gravados e conferidos no slot B
+static uint32_t erased;                 // Bytes do slot B já apagados
+static sha256_ctx_t sha;
+static uint32_t image_crc;
+static uint32_t last_data_ms;
+static uint32_t started_ms;
+static uint32_t staged_ms;
+static uint8_t progress_tenths;
+
+static const char *last_error = NULL;
+static char error_buf[48];
+static uint32_t updates = 0;
+static uint32_t failures = 0;
+
+static void lock(void) {
+    if (!lock_ready) {
+        critical_section_init(&ota_lock);
+        lock_ready = true;
+    }
+    critical_section_enter_blocking(&ota_lock);
+}
+
+static void unlock(void) {
+    critical_section_exit(&ota_lock);
+}
+
+static uint32_t now_ms(void) {
+    return to_ms_since_boot(get_absolute_time());
+}
+
+// --- Flash ---
+
+static bool flash_failed = false;
+
+typedef struct {
+    uint32_t offset;
+    const uint8_t *data;
+} program_args_t;
+
+// Executadas com o outro core e as interrupções pausados por flash_safe_execute
+static void do_erase(void *param) {
+    flash_range_erase(*(const uint32_t *)param, FLASH_SECTOR_SIZE);
+}
+
+static void do_program(void *param) {
+    const program_args_t *args = (const program_args_t *)param;
+    flash_range_program(args->offset, args->data, FLASH_PAGE_SIZE);
+}
+
+static const uint8_t *flash_read(uint32_t offset) {
+    return FLASH_XIP_PTR(offset);
+}
+
+static void flash_erase(uint32_t offset) {
+    if (flash_safe_execute(do_erase, &offset, 1000) != PICO_OK) flash_failed = true;
+}
+
+static void flash_program(uint32_t offset, const uint8_t *data) {
+    program_args_t args = { offset, data };
+    if (flash_safe_execute(do_program, &args, 1000) != PICO_OK) flash_failed = true;
+}
+
+static const ota_flash_t slots = {
+    .slot_a = FLASH_OTA_SLOT_A_OFFSET,
+    .slot_b = FLASH_OTA_SLOT_B_OFFSET,
+    .scratch = FLASH_OTA_SCRATCH_OFFSET,
+    .control = FLASH_OTA_CONTROL_OFFSET,
+    .read = flash_read,
+    .erase = flash_erase,
+    .program = flash_program,
+    .tick = NULL,
+};
+
+// --- Respostas ---
+
+static void set_reply(const char *req, const char *status, const char *error,
+                      const char *version, uint32_t offset, uint32_t size, bool progress) {
+    lock();
+    if (!progress || !reply.pending) {
+        reply.pending = true;
+        reply.seq++;
+        reply.status = status;
+        reply.error = error;
+        strncpy(reply.req, req, sizeof(reply.req) - 1);
+        reply.req[sizeof(reply.req) - 1] = '\0';
+        strncpy(reply.version, version, sizeof(reply.version) - 1);
+        reply.version[sizeof(reply.version) - 1] = '\0';
+        reply.offset = offset;
+        reply.size = size;
+    }
+    unlock();
+}
+
+static void publish_reply(void) {
+    const rfid_config_t *cfg = rfid_config();
+    ota_reply_t r;
+
+    lock();
+    r = reply;
+    unlock();
+    if (!r.pending || !link_supervisor_online()) return;
+
+    char payload[320 + EVENT_AUTH_OVERHEAD];
+    size_t size = sizeof(payload) - EVENT_AUTH_OVERHEAD;
+    int len = snprintf(payload, size, "{\"req\":\"%s\",\"op\":\"ota\",\"status\":\"%s\"",
+                       r.req, r.status);
+    if (r.version[0]) {
+        len += snprintf(payload + len, size - len, ",\"version\":\"%s\"", r.version);
+    }
+    if (r.size > 0) {
+        len += snprintf(payload + len, size - len, ",\"offset\":%lu,\"size\":%lu",
+                        (unsigned long)r.offset, (unsigned long)r.size);
+    }
+    if (r.error != NULL) {
+        len += snprintf(payload + len, size - len, ",\"error\":\"%s\"", r.error);
+    }
+    len += snprintf(payload + len, size - len, ",\"client\":\"%s\",\"reader\":\"PicoW\"}",
+                    cfg->mqtt_client_id);
+    event_auth_sign(cfg->topic_reply, payload, len, sizeof(payload));
+
+    if (!link_supervisor_publish(cfg->topic_reply, payload, 1)) return;
+    printf("[OTA] Resposta em %s: %s\n", cfg->topic_reply, payload);
+
+    lock();
+    if (reply.seq == r.seq) reply.pending = false;
+    unlock();
+}
+
+// --- Boot ---
+
+void ota_init(void) {
+    if (!RFID_OTA) return;
+    boot_phase = ota_phase(&slots, &boot_record);
+    last_ctr = saved_ctr = ota_ctr_read(&slots, &boot_record);
+
+    switch (boot_phase) {
+        case OTA_PHASE_TRIAL:
+            printf("[OTA] Firmware %s em teste (boot %lu de %d): confirma com %u s de rede e leitor OK\n",
+                   boot_record.version,
+                   (unsigned long)ota_marks(&slots, OTA_CTRL_TRIES, OTA_MAX_TRIES), OTA_MAX_TRIES,
+                   rfid_config()->ota_confirm_s);
+            break;
+        case OTA_PHASE_ROLLED_BACK:
+            printf("[OTA] AVISO: firmware %s reprovado no teste; versao anterior restaurada\n",
+                   boot_record.version);
+            set_reply(boot_record.req, "rolled_back", "imagem nova nao confirmada",
+                      boot_record.version, 0, 0, false);
+            result_pending = true;
+            break;
+        case OTA_PHASE_REJECTED:
+            printf("[OTA] AVISO: firmware %s recusado pelo bootloader (CRC); versao anterior mantida\n",
+                   boot_record.version);
+            set_reply(boot_record.req, "rejected", "CRC da imagem no slot B",
+                      boot_record.version, 0, 0, false);
+            result_pending = true;
+            break;
+        default:
+            break;
+    }
+}
+
+// --- Pedidos ---
+
+static bool item_is(const char *key, size_t key_len, const char *name) {
+    return strlen(name) == key_len && memcmp(key, name, key_len) == 0;
+}
+
+static bool parse_sha256(const char *s, size_t len, uint8_t *out) {
+    if (len != 2 * SHA256_DIGEST_SIZE) return false;
+    for (size_t i = 0; i < len; i += 2) {
+        // strtoul aceitaria sinal ("+f", "-1") e espaços
+        if (!isxdigit((unsigned char)s[i]) || !isxdigit((unsigned char)s[i + 1])) return false;
+        char byte[3] = { s[i], s[i + 1], '\0' };
+        out[i / 2] = (uint8_t)strtoul(byte, NULL, 16);
+    }
+    return true;
+}
+
+// http://host[:porta]/caminho (sem TLS: a autenticidade vem do sha256 assinado)
+static bool parse_url(const char *url) {
+    if (strncmp(url, "http://", 7) != 0) return false;
+    const char *host = url + 7;
+    size_t host_len = strcspn(host, ":/");
+    if (host_len == 0 || host_len >= sizeof(http_host)) return false;
+
+    const char *rest = host + host_len;
+    http_port = 80;
+    if (*rest == ':') {
+        char *end;
+        unsigned long port = strtoul(rest + 1, &end, 10);
+        if (port == 0 || port > 65535 || end == rest + 1) return false;
+        http_port = (uint16_t)port;
+        rest = end;
+    }
+    if (*rest != '/' && *rest != '\0') return false;
+
+    memcpy(http_host, host, host_len);
+    http_host[host_len] = '\0';
+    snprintf(http_path, sizeof(http_path), "%s", *rest ? rest : "/");
+    return true;
+}
+
+static bool parse_request(const char *text, size_t len, ota_job_t *out, ota_op_t *op,
+                          const char **reader, size_t *reader_len, const char **error) {
+    size_t pos = 0;
+    bool has_sha = false;
+
+    memset(out, 0, sizeof(*out));
+    *op = OP_UPDATE;
+    *reader = NULL;
+    *reader_len = 0;
+    *error = NULL;
+
+    while (pos < len) {
+        size_t end = pos;
+        while (end < len && text[end] != ';' && text[end] != '\n') end++;
+        const char *item = text + pos;
+        size_t item_len = end - pos;
+        pos = end + 1;
+        while (item_len && (item[item_len - 1] == ' ' || item[item_len - 1] == '\r')) item_len--;
+        if (item_len == 0) continue;
+
+        const char *eq = memchr(item, '=', item_len);
+        if (eq == NULL) {
+            *error = "item sem '='";
+            return false;
+        }
+        size_t key_len = eq - item;
+        const char *val = eq + 1;
+        size_t val_len = item_len - key_len - 1;
+
+        if (item_is(item, key_len, "req")) {
+            if (val_len >= sizeof(out->req)) val_len = sizeof(out->req) - 1;
+            memcpy(out->req, val, val_len);
+        } else if (item_is(item, key_len, "reader")) {
+            *reader = val;
+            *reader_len = val_len;
+        } else if (item_is(item, key_len, "op")) {
+            size_t i = 0;
+            while (i < sizeof(op_names) / sizeof(op_names[0]) && !item_is(val, val_len, op_names[i])) i++;
+            if (i == sizeof(op_names) / sizeof(op_names[0])) {
+                *error = "op invalida";
+                return false;
+            }
+            *op = (ota_op_t)i;
+        } else if (item_is(item, key_len, "url")) {
+            if (val_len >= sizeof(out->url)) {
+                *error = "url longa demais";
+                return false;
+            }
+            memcpy(out->url, val, val_len);
+        } else if (item_is(item, key_len, "size")) {
+            // Só algarismos: strtoul aceitaria sinal e espaços ("-1" viraria 4 GB)
+            char num[12];
+            bool digits = val_len > 0 && val_len < sizeof(num);
+            for (size_t i = 0; i < val_len && digits; i++) {
+                digits = isdigit((unsigned char)val[i]);
+            }
+            if (!digits) {
+                *error = "size invalido";
+                return false;
+            }
+            memcpy(num, val, val_len);
+            num[val_len] = '\0';
+            out->size = (uint32_t)strtoul(num, NULL, 10);
+        } else if (item_is(item, key_len, "sha256")) {
+            has_sha = parse_sha256(val, val_len, out->sha256);
+            if (!has_sha) {
+                *error = "sha256 invalido (64 hexadecimais)";
+                return false;
+            }
+        } else if (item_is(item, key_len, "version")) {
+            if (val_len >= sizeof(out->version)) val_len = sizeof(out->version) - 1;
+            memcpy(out->version, val, val_len);
+        } else if (!item_is(item, key_len, "ctr") && !item_is(item, key_len, "mac")) {
+            *error = "chave desconhecida";
+            return false;
+        }
+    }
+
+    if (*op == OP_UPDATE && (out->url[0] == '\0' || out->size == 0 || !has_sha)) {
+        *error = "faltam url, size ou sha256";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Com auth_mode, o pedido termina em ";ctr=N;mac=HEX" (event_auth_check_command)
+ * e o contador tem de ser maior que o último aceito.
+ * @return O comprimento do texto assinado, o único interpretado; -1 se recusado.
+ */
+static int check_auth(const char *topic, const char *text, uint32_t len) {
+    uint64_t value;
+    int signed_len = event_auth_check_command(topic, text, len, &value);
+    if (signed_len < 0) return -1;
+
+    lock();
+    bool fresh = value > last_ctr;
+    if (fresh) last_ctr = value;
+    unlock();
+    return fresh ? signed_len : -1;
+}
+
+// Registra um pedido já validado; retorna o motivo da recusa ou NULL
+static const char *submit(const ota_job_t *request, ota_op_t op) {
+    const char *error = NULL;
+
+    if (!RFID_OTA) return "firmware sem bootloader OTA (RFID_OTA=OFF)";
+
+    lock();
+    request_ctr = last_ctr;
+    switch (op) {
+        case OP_UPDATE:
+            if (boot_phase == OTA_PHASE_TRIAL) {
+                error = "imagem atual em teste: confirmar antes";
+            } else if (dl_state != DL_IDLE) {
+                error = "atualizacao em andamento";
+            } else if (request->size > FLASH_OTA_SLOT_SIZE) {
+                error = "imagem maior que o slot";
+            } else if (strncmp(request->url, "http://", 7) != 0) {
+                error = "url invalida (http://host[:porta]/caminho)";
+            } else {
+                job = *request;
+                dl_state = DL_REQUESTED;
+            }
+            break;
+        case OP_ABORT:
+            if (dl_state == DL_IDLE || dl_state == DL_STAGED) error = "nenhum download em andamento";
+            else abort_requested = true;
+            break;
+        case OP_CONFIRM:
+        case OP_ROLLBACK:
+            if (boot_phase != OTA_PHASE_TRIAL) error = "nenhuma imagem em teste";
+            else if (op == OP_CONFIRM) confirm_requested = true;
+            else rollback_requested = true;
+            break;
+    }
+    unlock();
+    return error;
+}
+
+void ota_on_message(const char *topic, const char *data, uint32_t len) {
+    const rfid_config_t *cfg = rfid_config();
+    ota_job_t request;
+    ota_op_t op;
+    const char *reader;
+    size_t reader_len;
+    const char *error;
+
+    if (event_auth_enabled()) {
+        int signed_len = check_auth(topic, data, len);
+        if (signed_len < 0) {
+            printf("[OTA] Pedido recusado: MAC invalido, itens apos o MAC ou contador repetido\n");
+            return;
+        }
+        len = (uint32_t)signed_len;
+    }
+
+    bool valid = parse_request(data, len, &request, &op, &reader, &reader_len, &error);
+
+    // Pedido para outro leitor: nem responde
+    if (reader != NULL && (reader_len != strlen(cfg->mqtt_client_id) ||
+                           memcmp(reader, cfg->mqtt_client_id, reader_len) != 0)) {
+        return;
+    }
+
+    if (valid) error = submit(&request, op);
+    if (error != NULL) {
+        printf("[OTA] Pedido '%s' recusado: %s\n", request.req, error);
+        set_reply(request.req, "failed", error, request.version, 0, 0, false);
+        return;
+    }
+    printf("[OTA] Pedido '%s' (%s) aceito\n", request.req, op_names[op]);
+    if (op == OP_UPDATE) {
+        set_reply(request.req, "accepted", NULL, request.version, 0, request.size, false);
+    }
+}
+
+int ota_start(const char *url, uint32_t size, const char *sha256_hex) {
+    ota_job_t request;
+
+    memset(&request, 0, sizeof(request));
+    strncpy(request.req, "console", sizeof(request.req) - 1);
+    request.size = size;
+    if (strlen(url) >= sizeof(request.url) ||
+        !parse_sha256(sha256_hex, strlen(sha256_hex), request.sha256)) {
+        printf("[OTA] Uso: ota <url> <bytes> <sha256 em 64 hexadecimais>\n");
+        return -1;
+    }
+    strcpy(request.url, url);
+
+    const char *error = submit(&request, OP_UPDATE);
+    if (error != NULL) {
+        printf("[OTA] Atualizacao recusada: %s\n", error);
+        return -1;
+    }
+    return 0;
+}
+
+void ota_abort(void) {
+    const char *error = submit(NULL, OP_ABORT);
+    if (error != NULL) printf("[OTA] %s\n", error);
+}
+
+int ota_confirm(void) {
+    return submit(NULL, OP_CONFIRM) == NULL ? 0 : -1;
+}
+
+int ota_rollback(void) {
+    return submit(NULL, OP_ROLLBACK) == NULL ? 0 : -1;
+}
+
+// --- HTTP (contexto do lwIP) ---
+
+static err_t http_headers(httpc_state_t *connection, void *arg, struct pbuf *hdr,
+                          u16_t hdr_len, u32_t content_len) {
+    (void)connection;
+    (void)hdr;
+    (void)hdr_len;
+    if ((uintptr_t)arg != http_gen) return ERR_VAL;
+    if (content_len != HTTPC_CONTENT_LEN_INVALID && content_len != job.size) {
+        http_error = "Content-Length diferente de size";
+        return ERR_VAL;
+    }
+    return ERR_OK;
+}
+
+static err_t http_recv(void *arg, struct altcp_pcb *pcb, struct pbuf *p, err_t err) {
+    (void)err;
+    if (p == NULL) return ERR_OK;
+
+    uint32_t queued = held != NULL ? held->tot_len : 0;
+    if ((uintptr_t)arg != http_gen || dl_state != DL_RUNNING ||
+        written + page_len + queued + p->tot_len > job.size) {
+        if ((uintptr_t)arg == http_gen) http_error = "servidor enviou mais que size";
+        pbuf_free(p);
+        altcp_abort(pcb);
+        return ERR_ABRT;
+    }
+
+    // Sem altcp_recved aqui: a janela só reabre quando ota_service grava
+    http_pcb = pcb;
+    if (held == NULL) {
+        held = p;
+    } else {
+        pbuf_cat(held, p);
+    }
+    return ERR_OK;
+}
+
+static void http_done(void *arg, httpc_result_t result, u32_t rx_content_len, u32_t srv_res,
+                      err_t err) {
+    (void)rx_content_len;
+    (void)err;
+    if ((uintptr_t)arg != http_gen) return;
+    http_closed = true;
+    http_pcb = NULL;
+    http_result = result;
+    http_status = srv_res;
+}
+
+// --- Download ---
+
+static void close_http(void) {
+    cyw43_arch_lwip_begin();
+    http_gen++;     // Callbacks pendentes deste download passam a ser ignorados
+    if (held != NULL) {
+        pbuf_free(held);
+        held = NULL;
+    }
+    if (http_pcb != NULL) {
+        struct altcp_pcb *pcb = http_pcb;
+        http_pcb = NULL;
+        altcp_abort(pcb);
+    }
+    cyw43_arch_lwip_end();
+}
+
+static void fail(const char *error) {
+    close_http();
+    dl_state = DL_IDLE;
+    last_error = error;
+    failures++;
+    printf("[OTA] ERRO: %s (%lu de %lu bytes)\n", error, (unsigned long)written,
+           (unsigned long)job.size);
+    set_reply(job.req, "failed", error, job.version, written, job.size, false);
+}
+
+static void start_download(uint32_t now) {
+    if (!parse_url(job.url)) {
+        fail("url invalida (http://host[:porta]/caminho)");
+        return;
+    }
+
+    page_len = 0;
+    written = 0;
+    erased = 0;
+    image_crc = 0;
+    progress_tenths = 0;
+    flash_failed = false;
+    http_error = NULL;
+    sha256_init(&sha);
+
+    memset(&http_settings, 0, sizeof(http_settings));
+    http_settings.use_proxy = 0;
+    http_settings.headers_done_fn = http_headers;
+    http_settings.result_fn = http_done;
+
+    cyw43_arch_lwip_begin();
+    http_gen++;
+    held = NULL;
+    http_pcb = NULL;
+    http_closed = false;
+    httpc_state_t *connection;
+    err_t err = httpc_get_file_dns(http_host, http_port, http_path, &http_settings, http_recv,
+                                   (void *)(uintptr_t)http_gen, &connection);
+    cyw43_arch_lwip_end();
+
+    if (err != ERR_OK) {
+        fail("falha ao abrir a conexao HTTP");
+        return;
+    }
+    dl_state = DL_RUNNING;
+    started_ms = now;
+    last_data_ms = now;
+    printf("[OTA] Baixando %s (%lu bytes) de %s:%u%s\n", job.version[0] ? job.version : "imagem",
+           (unsigned long)job.size, http_host, http_port, http_path);
+    set_reply(job.req, "downloading", NULL, job.version, 0, job.size, false);
+}
+
+// Copia até 'want' bytes recebidos e reabre a janela TCP na mesma medida
+static uint32_t take(uint8_t *dst, uint32_t want) {
+    uint32_t n = 0;
+
+    cyw43_arch_lwip_begin();
+    if (held != NULL) {
+        n = pbuf_copy_partial(held, dst, (u16_t)(want < held->tot_len ? want : held->tot_len), 0);
+        held = pbuf_free_header(held, (u16_t)n);
+        if (http_pcb != NULL) altcp_recved(http_pcb, (u16_t)n);
+    }
+    cyw43_arch_lwip_end();
+    return n;
+}
+
+static void finish(uint32_t now) {
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    sha256_final(&sha, digest);
+    if (memcmp(digest, job.sha256, sizeof(digest)) != 0) {
+        fail("sha256 da imagem nao confere");
+        return;
+    }
+    close_http();
+
+    // A troca cobre também o que sobrar da imagem atual, se ela for maior
+    uint32_t current = (uint32_t)(&__flash_binary_end - &__flash_binary_start);
+    uint32_t largest = job.size > current ? job.size : current;
+
+    ota_record_t rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.state = OTA_REC_PENDING;
+    rec.image_size = job.size;
+    rec.image_crc = image_crc;
+    rec.swap_sectors = (largest + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE;
+    rec.ctr = last_ctr;
+    strncpy(rec.version, job.version, sizeof(rec.version) - 1);
+    strncpy(rec.req, job.req, sizeof(rec.req) - 1);
+
+    flash_failed = false;
+    ota_record_write(&slots, &rec);
+    if (flash_failed) {
+        fail("erro ao gravar o registro OTA");
+        return;
+    }
+    saved_ctr = rec.ctr;
+
+    dl_state = DL_STAGED;
+    staged_ms = now;
+    updates++;
+    printf("[OTA] Imagem %s conferida (%lu bytes em %lu s): reiniciando para instalar\n",
+           job.version, (unsigned long)job.size, (unsigned long)(now - started_ms) / 1000);
+    set_reply(job.req, "ready", NULL, job.version, written, job.size, false);
+}
+
+static void download_slice(uint32_t now) {
+    uint32_t start = time_us_32();
+
+    do {
+        uint32_t page_end = job.size - written > FLASH_PAGE_SIZE ? written + FLASH_PAGE_SIZE
+                                                                  : job.size;
+        uint32_t want = page_end - written - page_len;
+        if (want > 0) {
+            uint32_t n = take(page + page_len, want);
+            page_len += n;
+            if (n > 0) last_data_ms = now;
+        }
+
+        if (written + page_len < page_end) {
+            if (http_closed && held == NULL) {
+                if (http_error == NULL) {
+                    snprintf(error_buf, sizeof(error_buf), "download interrompido (httpc %d, HTTP %lu)",
+                             (int)http_result, (unsigned long)http_status);
+                }
+                fail(http_error != NULL ? http_error : error_buf);
+            } else if (now - last_data_ms > OTA_STALL_TIMEOUT_MS) {
+                fail("download parado");
+            }
+            return;
+        }
+
+        if (written >= erased) {
+            flash_erase(FLASH_OTA_SLOT_B_OFFSET + erased);
+            erased += FLASH_SECTOR_SIZE;
+            if (flash_failed) fail("erro ao apagar o slot B");
+            return;     // Um setor apagado (~45 ms) já ocupa a fatia
+        }
+
+        memset(page + page_len, 0xFF, FLASH_PAGE_SIZE - page_len);
+        flash_program(FLASH_OTA_SLOT_B_OFFSET + written, page);
+        const uint8_t *stored = FLASH_XIP_PTR(FLASH_OTA_SLOT_B_OFFSET + written);
+        if (flash_failed || memcmp(stored, page, FLASH_PAGE_SIZE) != 0) {
+            fail("erro ao gravar o slot B");
+            return;
+        }
+
+        // Resumo e CRC do que ficou na flash, não do que chegou
+        sha256_update(&sha, stored, page_len);
+        image_crc = ota_crc32(image_crc, stored, page_len);
+        written += page_len;
+        page_len = 0;
+
+        uint8_t tenths = (uint8_t)((uint64_t)written * 10 / job.size);
+        if (tenths > progress_tenths && written < job.size) {
+            progress_tenths = tenths;
+            printf("[OTA] %u%% (%lu bytes)\n", tenths * 10, (unsigned long)written);
+            set_reply(job.req, "downloading", NULL, job.version, written, job.size, true);
+        }
+        if (written == job.size) {
+            finish(now);
+            return;
+        }
+    } while (time_us_32() - start < SLICE_US);
+}
+
+// --- Imagem em teste ---
+
+static bool service_trial(bool healthy, uint32_t now) {
+    const rfid_config_t *cfg = rfid_config();
+
+    if (result_pending) {
+        // Registra o rollback/rejeição: libera o slot B para o próximo pedido
+        boot_record.state = boot_phase == OTA_PHASE_REJECTED ? OTA_REC_REJECTED
+                                                             : OTA_REC_ROLLED_BACK;
+        boot_record.ctr = last_ctr;
+        flash_failed = false;
+        ota_record_write(&slots, &boot_record);
+        if (!flash_failed) {
+            saved_ctr = boot_record.ctr;
+            result_pending = false;
+            boot_phase = OTA_PHASE_IDLE;
+        }
+    }
+    if (boot_phase != OTA_PHASE_TRIAL) return false;
+
+    lock();
+    bool confirm = confirm_requested;
+    bool rollback = rollback_requested;
+    confirm_requested = rollback_requested = false;
+    unlock();
+
+    if (!healthy) healthy_since_ms = now;
+
+    if (rollback) {
+        printf("[OTA] Rollback pedido: voltando a versao anterior\n");
+    } else if (confirm || now - healthy_since_ms >= cfg->ota_confirm_s * 1000u) {
+        boot_record.state = OTA_REC_CONFIRMED;
+        boot_record.ctr = last_ctr;
+        flash_failed = false;
+        ota_record_write(&slots, &boot_record);
+        if (flash_failed) return false;
+        saved_ctr = boot_record.ctr;
+
+        lock();
+        boot_phase = OTA_PHASE_IDLE;
+        unlock();
+        printf("[OTA] Firmware %s confirmado\n", boot_record.version);
+        set_reply(boot_record.req, "confirmed", NULL, boot_record.version, 0, 0, false);
+        return false;
+    } else if (now / 1000 >= (uint32_t)cfg->ota_confirm_s + OTA_HEALTH_TIMEOUT_S) {
+        printf("[OTA] Firmware %s sem rede ou leitor por %u s: voltando a versao anterior\n",
+               boot_record.version, OTA_HEALTH_TIMEOUT_S);
+    } else {
+        return false;
+    }
+
+    // O bootloader vê a marca e troca os slots de volta
+    ota_mark(&slots, OTA_CTRL_ROLLBACK, 0);
+    return true;
+}
+
+/**
+ * Grava o contador do último pedido aceito antes de o pedido ter efeito.
+ * Vale também para pedidos recusados, cancelados ou de outro leitor: nenhum
+ * deles volta a ser aceito depois de reiniciar.
+ */
+static bool save_ctr(void) {
+    lock();
+    uint64_t ctr = last_ctr;
+    unlock();
+    if (ctr <= saved_ctr) return true;
+    if (ctr == unsaved_ctr) return false;
+
+    // Sem registro, ou com a área de contadores cheia, o contador vai no
+    // registro: reescrevê-lo apaga as marcas, então só fora de uma troca
+    flash_failed = false;
+    if (boot_record.magic != OTA_RECORD_MAGIC || !ota_ctr_write(&slots, ctr)) {
+        if (boot_phase != OTA_PHASE_IDLE || dl_state == DL_STAGED) {
+            flash_failed = true;
+        } else {
+            boot_record.ctr = ctr;
+            ota_record_write(&slots, &boot_record);
+        }
+    }
+    if (flash_failed) {
+        unsaved_ctr = ctr;
+        return false;
+    }
+    saved_ctr = ctr;
+    return true;
+}
+
+bool ota_service(bool healthy) {
+    if (!RFID_OTA) return false;
+    uint32_t now = now_ms();
+
+    // Pedido só tem efeito com o contador já na flash; sem isso ele poderia
+    // ser repetido depois de um reboot
+    bool saved = save_ctr();
+    lock();
+    bool waiting = request_ctr > saved_ctr;
+    bool discarded = waiting && !saved;
+    bool requested = dl_state == DL_REQUESTED;
+    if (discarded) {
+        if (requested) dl_state = DL_IDLE;
+        abort_requested = confirm_requested = rollback_requested = false;
+        request_ctr = 0;
+    }
+    unlock();
+    if (discarded) {
+        printf("[OTA] ERRO: contador do pedido nao gravado na flash; pedido descartado\n");
+        if (requested) set_reply(job.req, "failed", "contador nao gravado", job.version, 0, 0, false);
+    } else if (waiting) {
+        return false;   // Gravado na próxima chamada
+    }
+
+    if (service_trial(healthy, now)) return true;
+
+    lock();
+    bool abort = abort_requested;
+    abort_requested = false;
+    unlock();
+
+    switch (dl_state) {
+        case DL_REQUESTED:
+            if (abort) {
+                dl_state = DL_IDLE;
+                set_reply(job.req, "failed", "cancelado", job.version, 0, job.size, false);
+            } else if (wifi_link_is_up()) {
+                start_download(now);
+            }
+            break;
+        case DL_RUNNING:
+            if (abort) {
+                fail("cancelado");
+            } else {
+                download_slice(now);
+            }
+            break;
+        default:
+            break;
+    }
+
+    publish_reply();
+
+    if (dl_state == DL_STAGED && now - staged_ms >= REBOOT_DELAY_MS) {
+        lock();
+        bool sent = !reply.pending;
+        unlock();
+        if (sent || now - staged_ms >= REBOOT_WAIT_MAX_MS) return true;
+    }
+    return false;
+}
+
+// --- Diagnóstico ---
+
+static const char *record_state_name(uint8_t state) {
+    static const char *const names[] = { "none", "pending", "confirmed", "rolled_back", "rejected" };
+    return state < sizeof(names) / sizeof(names[0]) ? names[state] : "?";
+}
+
+int ota_format_json(char *buf, size_t len) {
+    if (!RFID_OTA) return snprintf(buf, len, "\"ota\":{\"phase\":\"off\"}");
+
+    dl_state_t state = dl_state;
+    int n = snprintf(buf, len, "\"ota\":{\"phase\":\"%s\",\"last\":\"%s\",\"state\":\"%s\"",
+                     ota_phase_name(boot_phase), record_state_name(boot_record.state),
+                     dl_names[state]);
+    if (boot_record.version[0] && n < (int)len) {
+        n += snprintf(buf + n, len - n, ",\"version\":\"%s\"", boot_record.version);
+    }
+    if (state == DL_RUNNING && n < (int)len) {
+        n += snprintf(buf + n, len - n, ",\"offset\":%lu,\"size\":%lu",
+                      (unsigned long)written, (unsigned long)job.size);
+    }
+    if (last_error != NULL && n < (int)len) {
+        n += snprintf(buf + n, len - n, ",\"error\":\"%s\"", last_error);
+    }
+    if (n < (int)len) n += snprintf(buf + n, len - n, "}");
+    return n;
+}
+
+void ota_print(void) {
+    const rfid_config_t *cfg = rfid_config();
+
+    if (!RFID_OTA) {
+        printf("[OTA] Indisponivel: firmware gerado sem RFID_OTA (sem bootloader)\n");
+        return;
+    }
+    printf("[OTA] Pedidos %s em %s; slots de %lu KB (A em 0x%08lx, B em 0x%08lx)\n",
+           cfg->ota_enabled ? "aceitos" : "desligados", cfg->topic_ota,
+           (unsigned long)FLASH_OTA_SLOT_SIZE / 1024,
+           (unsigned long)(XIP_BASE + FLASH_OTA_SLOT_A_OFFSET),
+           (unsigned long)(XIP_BASE + FLASH_OTA_SLOT_B_OFFSET));
+    printf("[OTA] Imagem atual: %lu bytes; situacao %s, ultima atualizacao %s%s%s\n",
+           (unsigned long)(&__flash_binary_end - &__flash_binary_start),
+           ota_phase_name(boot_phase), record_state_name(boot_record.state),
+           boot_record.version[0] ? " - versao " : "", boot_record.version);
+    if (boot_phase == OTA_PHASE_TRIAL) {
+        uint32_t healthy_s = (now_ms() - healthy_since_ms) / 1000;
+        printf("[OTA] Em teste: %lu de %u s com rede e leitor OK\n", (unsigned long)healthy_s,
+               cfg->ota_confirm_s);
+    }
+    if (dl_state == DL_RUNNING) {
+        uint32_t elapsed = now_ms() - started_ms;
+        printf("[OTA] Baixando '%s': %lu de %lu bytes (%lu B/s)\n", job.req,
+               (unsigned long)written, (unsigned long)job.size,
+               elapsed ? (unsigned long)((uint64_t)written * 1000 / elapsed) : 0ul);
+    }
+    printf("[OTA] %lu imagens preparadas, %lu falhas%s%s\n", (unsigned long)updates,
+           (unsigned long)failures, last_error ? "; ultima: " : "", last_error ? last_error : "");
+}
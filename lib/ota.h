@@ -0,0 +1,105 @@
+/**
+ * ota.h
+ *
+ * Atualização de firmware pela rede, sem BOOTSEL: o backend publica um
+ * pedido em 'topic_ota' e o leitor baixa a imagem (.bin do alvo) por HTTP
+ * para o slot B, gravando página a página enquanto a leitura continua.
+ * Conferida a imagem, o leitor reinicia e o bootloader (ota_boot.c) troca
+ * os slots; a imagem nova roda em teste até ficar ota_confirm_s segundos
+ * com rede e leitor OK. Se não confirmar (travou, reiniciou OTA_MAX_TRIES
+ * vezes ou ficou sem rede por OTA_HEALTH_TIMEOUT_S), a anterior volta.
+ *
+ * Pedido em texto "chave=valor" separados por ';' (como card_ops.h):
+ *
+ *   req=9;url=http://192.168.0.10:8000/RFID_MQTT.bin;size=612352;sha256=HEX;version=1.4
+ *   req=10;op=abort          (também op=confirm e op=rollback na imagem em teste)
+ *
+ *  - reader: só no leitor com este mqtt_client_id (padrão: todos);
+ *  - size e sha256 (64 hex) da imagem; version: rótulo devolvido nas respostas.
+ *
+ * Com auth_mode, o pedido termina em ";ctr=N;mac=HEX" como os comandos de
+ * cartão; nada depois do MAC é aceito, e só o texto assinado é
+ * interpretado. O contador de cada pedido aceito (mesmo os recusados depois,
+ * cancelados ou de outro leitor) vai para a flash antes de o pedido ter
+ * efeito, então um pedido antigo não é aceito de novo nem depois de reiniciar. O MAC cobre o sha256, então só
+ * imagens autorizadas pelo backend são gravadas.
+ *
+ * Respostas em 'topic_reply' (JSON, assinadas como os eventos):
+ *   {"req":"9","op":"ota","status":"downloading","version":"1.4","offset":262144,
+ *    "size":612352,"client":"PicoW-1","reader":"PicoW"}
+ *   status: accepted, downloading, ready, confirmed, failed, rolled_back, rejected
+ *
+ * Só funciona no firmware gerado com RFID_OTA=ON (CMake), gravado junto
+ * com o bootloader RFID_OTA_BOOT.
+ */
+
+#ifndef OTA_H
+#define OTA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifndef RFID_OTA
+#define RFID_OTA 0
+#endif
+
+#define OTA_URL_MAX             128
+#define OTA_HEALTH_TIMEOUT_S    600     // Sem rede/leitor por este tempo: rollback
+#define OTA_STALL_TIMEOUT_MS    30000   // Download sem dados por este tempo: falha
+
+/**
+ * @brief Lê a situação deixada pelo bootloader (imagem em teste, rollback,
+ * imagem rejeitada). Chamar no boot, depois de rfid_config_load().
+ */
+void ota_init(void);
+
+/**
+ * @brief Recebe um pedido de 'topic_ota' (contexto do lwIP). O download
+ * começa em ota_service().
+ */
+void ota_on_message(const char *topic, const char *data, uint32_t len);
+
+/**
+ * @brief Pede uma atualização pelo console (sem MAC).
+ * @param sha256_hex Resumo da imagem em 64 caracteres hexadecimais.
+ * @return 0 se aceita, -1 se recusada.
+ */
+int ota_start(const char *url, uint32_t size, const char *sha256_hex);
+
+/**
+ * @brief Cancela o download em andamento.
+ */
+void ota_abort(void);
+
+/**
+ * @brief Confirma a imagem em teste (sem esperar ota_confirm_s) ou pede o
+ * rollback para a anterior (reinicia).
+ * @return 0 se havia imagem em teste, -1 caso contrário.
+ */
+int ota_confirm(void);
+int ota_rollback(void);
+
+/**
+ * @brief Avança o download (gravações na flash limitadas a uma fatia de
+ * tempo por chamada), confirma ou desfaz a imagem em teste, publica as
+ * respostas. Chamar no laço principal (ou na tarefa que grava a flash).
+ * @param healthy Rede e leitor RFID funcionando.
+ * @return true quando é hora de reiniciar (imagem pronta ou rollback):
+ * o chamador reinicia com supervisor_reboot(), fora dos seus locks.
+ */
+bool ota_service(bool healthy);
+
+/**
+ * @brief Escreve a situação como campo JSON (sem chaves externas).
+ * Ex: "ota":{"phase":"trial","version":"1.4","state":"idle"}
+ * @return O número de caracteres escritos (como snprintf).
+ */
+int ota_format_json(char *buf, size_t len);
+
+/**
+ * @brief Imprime a situação e o download em andamento (comando 'ota').
+ */
+void ota_print(void);
+
+#endif // OTA_H
@@ -0,0 +1,219 @@
+#include "ota_slots.h"
+#include <string.h>
+
+#define SWAP_MARKS_MAX  (3 * OTA_SLOT_SECTORS_MAX)
+
+_Static_assert(sizeof(ota_record_t) <= OTA_PAGE_SIZE, "registro OTA maior que uma pagina");
+_Static_assert(OTA_CTRL_SWAP + SWAP_MARKS_MAX <= OTA_CTRL_UNDO, "marcas da troca sobrepostas");
+_Static_assert(OTA_CTRL_UNDO + SWAP_MARKS_MAX <= OTA_CTRL_TRIES, "marcas do rollback sobrepostas");
+_Static_assert(OTA_CTRL_REJECTED < OTA_CTRL_CTR && OTA_CTRL_CTR % OTA_PAGE_SIZE == 0,
+               "area de contadores sobreposta ou fora do inicio de uma pagina");
+
+// --- CRC-32 ---
+
+// Mesma tabela de nibbles de rfid_crc32 (o bootloader não liga rfid_config)
+static const uint32_t crc32_nibble_table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+uint32_t ota_crc32(uint32_t crc, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ crc32_nibble_table[crc & 0x0F];
+        crc = (crc >> 4) ^ crc32_nibble_table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+// --- Registro e marcas ---
+
+bool ota_record_read(const ota_flash_t *fl, ota_record_t *rec) {
+    memcpy(rec, fl->read(fl->control + OTA_CTRL_RECORD), sizeof(*rec));
+    if (rec->magic == OTA_RECORD_MAGIC &&
+        ota_crc32(0, rec, offsetof(ota_record_t, crc)) == rec->crc &&
+        rec->swap_sectors <= OTA_SLOT_SECTORS_MAX &&
+        rec->image_size <= rec->swap_sectors * OTA_SECTOR_SIZE) {
+        rec->version[sizeof(rec->version) - 1] = '\0';
+        rec->req[sizeof(rec->req) - 1] = '\0';
+        return true;
+    }
+    memset(rec, 0, sizeof(*rec));
+    return false;
+}
+
+void ota_record_write(const ota_flash_t *fl, ota_record_t *rec) {
+    uint8_t page[OTA_PAGE_SIZE];
+
+    rec->magic = OTA_RECORD_MAGIC;
+    rec->crc = ota_crc32(0, rec, offsetof(ota_record_t, crc));
+    memset(page, 0xFF, sizeof(page));
+    memcpy(page, rec, sizeof(*rec));
+
+    fl->erase(fl->control);
+    fl->program(fl->control + OTA_CTRL_RECORD, page);
+}
+
+uint32_t ota_marks(const ota_flash_t *fl, uint32_t area, uint32_t max) {
+    const uint8_t *marks = fl->read(fl->control + area);
+    uint32_t n = 0;
+    while (n < max && marks[n] == 0x00) n++;
+    return n;
+}
+
+void ota_mark(const ota_flash_t *fl, uint32_t area, uint32_t index) {
+    // Bits em 1 não mudam ao gravar: só o byte da marca vai a zero
+    uint8_t page[OTA_PAGE_SIZE];
+    uint32_t offset = area + index;
+
+    memset(page, 0xFF, sizeof(page));
+    page[offset % OTA_PAGE_SIZE] = 0x00;
+    fl->program(fl->control + offset - offset % OTA_PAGE_SIZE, page);
+}
+
+// Posições livres ficam em 0xFF (valor UINT64_MAX, nunca usado)
+static uint32_t ctr_used(const ota_flash_t *fl) {
+    const uint8_t *area = fl->read(fl->control + OTA_CTRL_CTR);
+    uint32_t n = 0;
+    while (n < OTA_CTR_SLOTS) {
+        uint64_t value;
+        memcpy(&value, area + n * sizeof(value), sizeof(value));
+        if (value == UINT64_MAX) break;
+        n++;
+    }
+    return n;
+}
+
+uint64_t ota_ctr_read(const ota_flash_t *fl, const ota_record_t *rec) {
+    // Sem registro válido a área não foi escrita por este formato
+    if (rec->magic != OTA_RECORD_MAGIC) return 0;
+
+    uint64_t ctr = rec->ctr;
+    uint32_t used = ctr_used(fl);
+    if (used > 0) {
+        // Gravação interrompida só deixa bits em 1: o valor lido nunca é menor
+        uint64_t last;
+        memcpy(&last, fl->read(fl->control + OTA_CTRL_CTR) + (used - 1) * sizeof(last),
+               sizeof(last));
+        if (last > ctr) ctr = last;
+    }
+    return ctr;
+}
+
+bool ota_ctr_write(const ota_flash_t *fl, uint64_t ctr) {
+    uint8_t page[OTA_PAGE_SIZE];
+    uint32_t used = ctr_used(fl);
+    if (used == OTA_CTR_SLOTS) return false;
+
+    uint32_t offset = OTA_CTRL_CTR + used * sizeof(ctr);
+    memset(page, 0xFF, sizeof(page));
+    memcpy(page + offset % OTA_PAGE_SIZE, &ctr, sizeof(ctr));
+    fl->program(fl->control + offset - offset % OTA_PAGE_SIZE, page);
+    return true;
+}
+
+static bool mark_set(const ota_flash_t *fl, uint32_t area) {
+    return ota_marks(fl, area, 1) == 1;
+}
+
+ota_phase_t ota_phase(const ota_flash_t *fl, ota_record_t *rec) {
+    if (!ota_record_read(fl, rec) || rec->state != OTA_REC_PENDING) return OTA_PHASE_IDLE;
+
+    uint32_t steps = 3 * rec->swap_sectors;
+    if (mark_set(fl, OTA_CTRL_REJECTED)) return OTA_PHASE_REJECTED;
+    if (mark_set(fl, OTA_CTRL_ROLLBACK)) {
+        return ota_marks(fl, OTA_CTRL_UNDO, steps) < steps ? OTA_PHASE_ROLLING_BACK
+                                                           : OTA_PHASE_ROLLED_BACK;
+    }
+
+    uint32_t done = ota_marks(fl, OTA_CTRL_SWAP, steps);
+    if (done == 0) return OTA_PHASE_STAGED;
+    return done < steps ? OTA_PHASE_SWAPPING : OTA_PHASE_TRIAL;
+}
+
+// --- Troca ---
+
+static void copy_sector(const ota_flash_t *fl, uint32_t src, uint32_t dst) {
+    // A origem vem do XIP, que fica desligado durante a gravação: passa pela RAM
+    uint8_t page[OTA_PAGE_SIZE];
+
+    fl->erase(dst);
+    for (uint32_t off = 0; off < OTA_SECTOR_SIZE; off += OTA_PAGE_SIZE) {
+        memcpy(page, fl->read(src + off), sizeof(page));
+
+        bool erased = true;
+        for (uint32_t i = 0; i < sizeof(page) && erased; i++) erased = page[i] == 0xFF;
+        if (!erased) fl->program(dst + off, page);
+    }
+}
+
+void ota_swap(const ota_flash_t *fl, uint32_t journal, uint32_t sectors) {
+    uint32_t steps = 3 * sectors;
+
+    for (uint32_t step = ota_marks(fl, journal, steps); step < steps; step++) {
+        uint32_t sector = (step / 3) * OTA_SECTOR_SIZE;
+
+        switch (step % 3) {
+            case 0: copy_sector(fl, fl->slot_a + sector, fl->scratch); break;
+            case 1: copy_sector(fl, fl->slot_b + sector, fl->slot_a + sector); break;
+            default: copy_sector(fl, fl->scratch, fl->slot_b + sector); break;
+        }
+        ota_mark(fl, journal, step);
+        if (fl->tick) fl->tick();
+    }
+}
+
+static bool slot_crc_ok(const ota_flash_t *fl, uint32_t slot, const ota_record_t *rec) {
+    return ota_crc32(0, fl->read(slot), rec->image_size) == rec->image_crc;
+}
+
+ota_phase_t ota_boot(const ota_flash_t *fl) {
+    ota_record_t rec;
+    ota_phase_t phase = ota_phase(fl, &rec);
+
+    if (phase == OTA_PHASE_STAGED) {
+        if (!slot_crc_ok(fl, fl->slot_b, &rec)) {
+            ota_mark(fl, OTA_CTRL_REJECTED, 0);
+            return OTA_PHASE_REJECTED;
+        }
+        phase = OTA_PHASE_SWAPPING;
+    }
+
+    if (phase == OTA_PHASE_SWAPPING) {
+        ota_swap(fl, OTA_CTRL_SWAP, rec.swap_sectors);
+        if (slot_crc_ok(fl, fl->slot_a, &rec)) {
+            phase = OTA_PHASE_TRIAL;
+        } else {
+            ota_mark(fl, OTA_CTRL_ROLLBACK, 0);
+            phase = OTA_PHASE_ROLLING_BACK;
+        }
+    }
+
+    if (phase == OTA_PHASE_TRIAL) {
+        uint32_t tries = ota_marks(fl, OTA_CTRL_TRIES, OTA_MAX_TRIES);
+        if (tries < OTA_MAX_TRIES) {
+            ota_mark(fl, OTA_CTRL_TRIES, tries);
+            return OTA_PHASE_TRIAL;
+        }
+        // Nenhum dos boots confirmou a imagem: volta a anterior
+        ota_mark(fl, OTA_CTRL_ROLLBACK, 0);
+        phase = OTA_PHASE_ROLLING_BACK;
+    }
+
+    if (phase == OTA_PHASE_ROLLING_BACK) {
+        ota_swap(fl, OTA_CTRL_UNDO, rec.swap_sectors);
+        phase = OTA_PHASE_ROLLED_BACK;
+    }
+    return phase;
+}
+
+const char *ota_phase_name(ota_phase_t phase) {
+    static const char *const names[] = {
+        "idle", "staged", "swapping", "trial", "rolling_back", "rolled_back", "rejected"
+    };
+    return (unsigned)phase < sizeof(names) / sizeof(names[0]) ? names[phase] : "?";
+}
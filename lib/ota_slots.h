@@ -0,0 +1,158 @@
+/**
+ * ota_slots.h
+ *
+ * Formato na flash da atualização OTA, comum ao bootloader (ota_boot.c) e
+ * ao firmware (lib/ota.c).
+ *
+ * O RP2040 executa direto da flash (XIP) no endereço em que o firmware foi
+ * ligado, então os dois slots não são executáveis: o slot A (logo após o
+ * bootloader) é o que roda e o slot B recebe a imagem nova. No boot
+ * seguinte o bootloader troca A e B setor a setor, usando um setor de
+ * rascunho; a imagem antiga fica em B e volta para A no rollback.
+ *
+ * Setor de controle:
+ *   0     ota_record_t (reescrito com erase: imagem preparada, confirmada...)
+ *   256   marcas da troca: 3 passos por setor (A -> rascunho, B -> A, rascunho -> B)
+ *   1024  marcas da troca de volta (rollback)
+ *   1792  uma marca por boot da imagem em teste
+ *   1808  marca de rollback pedido; 1809 marca de imagem rejeitada (CRC)
+ *   2048  contadores de pedidos aceitos (anti-replay), 8 bytes cada
+ *
+ * Cada marca é um byte gravado com 0x00 sem apagar o setor: o progresso
+ * sobrevive a uma queda de energia no meio da troca e cada passo pode ser
+ * refeito (a origem de um passo não é alterada por ele). Os contadores
+ * seguem a mesma ideia: cada pedido aceito grava o seu na próxima posição
+ * livre, sem apagar o setor (e sem perder as marcas de uma troca).
+ *
+ * Código C puro (sem SDK): as operações de flash chegam por ota_flash_t.
+ */
+
+#ifndef OTA_SLOTS_H
+#define OTA_SLOTS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define OTA_RECORD_MAGIC        0x3141544Fu // "OTA1"
+#define OTA_SECTOR_SIZE         4096
+#define OTA_PAGE_SIZE           256
+#define OTA_SLOT_SECTORS_MAX    256
+#define OTA_MAX_TRIES           3           // Boots sem confirmação antes do rollback
+
+// Áreas do setor de controle
+#define OTA_CTRL_RECORD         0
+#define OTA_CTRL_SWAP           256
+#define OTA_CTRL_UNDO           1024
+#define OTA_CTRL_TRIES          1792
+#define OTA_CTRL_ROLLBACK       1808
+#define OTA_CTRL_REJECTED       1809
+#define OTA_CTRL_CTR            2048
+#define OTA_CTR_SLOTS           ((OTA_SECTOR_SIZE - OTA_CTRL_CTR) / sizeof(uint64_t))
+
+// ota_record_t.state
+#define OTA_REC_PENDING         1   // Imagem nova em B, verificada
+#define OTA_REC_CONFIRMED       2   // Imagem nova aprovada no teste
+#define OTA_REC_ROLLED_BACK     3   // Imagem nova reprovada, antiga de volta
+#define OTA_REC_REJECTED        4   // CRC da imagem nova não conferiu no bootloader
+
+typedef struct {
+    uint32_t magic;
+    uint8_t state;
+    uint8_t reserved[3];
+    uint32_t image_size;
+    uint32_t image_crc;         // CRC-32 da imagem (conferido pelo bootloader)
+    uint32_t swap_sectors;      // Setores trocados: o maior entre a imagem nova e a antiga
+    uint64_t ctr;               // Contador do último comando aceito (anti-replay)
+    char version[24];
+    char req[16];               // Identificador do pedido (respostas após o reboot)
+    uint32_t crc;               // CRC-32 dos campos anteriores
+} ota_record_t;
+
+// Situação derivada do registro e das marcas
+typedef enum {
+    OTA_PHASE_IDLE,             // Sem troca pendente (resultado anterior em record.state)
+    OTA_PHASE_STAGED,           // Imagem nova em B, troca ainda não começou
+    OTA_PHASE_SWAPPING,         // Troca interrompida (só o bootloader vê)
+    OTA_PHASE_TRIAL,            // Imagem nova em A, aguardando confirmação
+    OTA_PHASE_ROLLING_BACK,     // Troca de volta interrompida (só o bootloader vê)
+    OTA_PHASE_ROLLED_BACK,      // Imagem antiga de volta em A
+    OTA_PHASE_REJECTED,         // Imagem nova recusada antes da troca
+} ota_phase_t;
+
+typedef struct {
+    uint32_t slot_a;            // Offsets a partir do início da flash
+    uint32_t slot_b;
+    uint32_t scratch;
+    uint32_t control;
+    const uint8_t *(*read)(uint32_t offset);                // Leitura direta (XIP)
+    void (*erase)(uint32_t offset);                         // Um setor
+    void (*program)(uint32_t offset, const uint8_t *page);  // Uma página, origem na RAM
+    void (*tick)(void);                                     // Entre passos (watchdog), opcional
+} ota_flash_t;
+
+/**
+ * @brief CRC-32 incremental (mesmo resultado de rfid_crc32 com crc = 0).
+ */
+uint32_t ota_crc32(uint32_t crc, const void *data, size_t len);
+
+/**
+ * @brief Lê o registro do setor de controle.
+ * @return false se não há registro válido.
+ */
+bool ota_record_read(const ota_flash_t *fl, ota_record_t *rec);
+
+/**
+ * @brief Apaga o setor de controle (marcas incluídas) e grava o registro.
+ */
+void ota_record_write(const ota_flash_t *fl, ota_record_t *rec);
+
+/**
+ * @brief Conta as marcas gravadas a partir de uma área, até 'max'.
+ */
+uint32_t ota_marks(const ota_flash_t *fl, uint32_t area, uint32_t max);
+
+/**
+ * @brief Grava a marca 'index' de uma área.
+ */
+void ota_mark(const ota_flash_t *fl, uint32_t area, uint32_t index);
+
+/**
+ * @brief Último contador aceito: o maior entre o do registro e os gravados
+ * depois dele na área de contadores.
+ */
+uint64_t ota_ctr_read(const ota_flash_t *fl, const ota_record_t *rec);
+
+/**
+ * @brief Grava o contador na próxima posição livre, sem apagar o setor.
+ * @return false se a área está cheia (reescrever o registro com o
+ * contador a esvazia).
+ */
+bool ota_ctr_write(const ota_flash_t *fl, uint64_t ctr);
+
+/**
+ * @brief Situação atual da atualização.
+ * @param rec Recebe o registro (magic 0 se não houver).
+ */
+ota_phase_t ota_phase(const ota_flash_t *fl, ota_record_t *rec);
+
+/**
+ * @brief Troca os primeiros 'sectors' setores de A e B, retomando das
+ * marcas já gravadas em 'journal'.
+ */
+void ota_swap(const ota_flash_t *fl, uint32_t journal, uint32_t sectors);
+
+/**
+ * @brief Decisão do bootloader: confere o CRC e troca uma imagem preparada,
+ * conta os boots em teste e faz o rollback após OTA_MAX_TRIES ou quando
+ * pedido pelo firmware. Retoma trocas interrompidas.
+ * @return A situação com que o slot A será executado.
+ */
+ota_phase_t ota_boot(const ota_flash_t *fl);
+
+/**
+ * @brief Nome legível da situação.
+ */
+const char *ota_phase_name(ota_phase_t phase);
+
+#endif // OTA_SLOTS_H
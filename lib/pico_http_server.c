@@ -6,6 +6,7 @@
 
 // --- Variáveis internas da biblioteca ---
 #define MAX_HANDLERS 10
+#define MAX_PATH_LEN 128 // Caminhos maiores recebem 414
 static http_request_handler_t handlers[MAX_HANDLERS];
 static int handler_count = 0;
 static const char *homepage_content = NULL;
@@ -19,6 +20,8 @@ struct http_state
     size_t sent;
 };
 
+static int listen_on_port_80(void);
+
 // Callback para enviar dados após a escrita
 static err_t http_sent_callback(void *arg, struct tcp_pcb *tpcb, u16_t len)
 {
@@ -42,8 +45,13 @@ static void handle_request(struct http_state *hs, const char *req_line)
         return;
     }
     size_t path_len = path_end - req_line;
-    char path[path_len + 1];
-    strncpy(path, req_line, path_len);
+    if (path_len >= MAX_PATH_LEN)
+    {
+        hs->len = snprintf(hs->response, sizeof(hs->response), "HTTP/1.1 414 URI Too Long\r\n\r\n");
+        return;
+    }
+    char path[MAX_PATH_LEN];
+    memcpy(path, req_line, path_len);
     path[path_len] = '\0';
 
     if ((strcmp(path, "/") == 0) && homepage_content)
@@ -277,8 +285,22 @@ int http_server_init(const char *ssid, const char *password)
         return 0;  // Retorna sucesso para não bloquear o sistema
     }
 
+    return http_server_start();
+}
+
+// Abre a porta 80 (WiFi já conectado)
+int http_server_start(void)
+{
     printf("\nIniciando servidor HTTP...\n");
 
+    cyw43_arch_lwip_begin();
+    int result = listen_on_port_80();
+    cyw43_arch_lwip_end();
+    return result;
+}
+
+static int listen_on_port_80(void)
+{
     struct tcp_pcb *pcb = tcp_new();
     if (pcb == NULL)
     {
@@ -35,6 +35,16 @@ typedef struct
  */
 int http_server_init(const char *ssid, const char *password);
 
+/**
+ * @brief Inicia apenas o servidor HTTP na porta 80.
+ *
+ * Para firmwares que já conectaram o Wi-Fi por conta própria
+ * (ex: a variante FreeRTOS do leitor RFID).
+ *
+ * @return Retorna 0 (falhas são apenas informadas no serial).
+ */
+int http_server_start(void);
+
 /**
  * @brief Define o conteúdo HTML da página principal.
  *
@@ -0,0 +1,123 @@
+#include "pipeline_stats.h"
+#include <stdio.h>
+#include "pico/stdlib.h"
+
+static latency_stat_t scan_gap;
+static latency_stat_t pipeline[EVENT_CLASS_COUNT];
+static uint32_t last_scan_us;
+static bool have_scan = false;
+
+// Vazão
+static uint32_t published = 0;
+static uint32_t since_us;
+static uint32_t window_start_us;
+static uint32_t window_count = 0;
+static uint32_t peak_per_s = 0;
+
+static void latency_reset(latency_stat_t *s) {
+    s->count = 0;
+    s->min_us = UINT32_MAX;
+    s->max_us = 0;
+    s->total_us = 0;
+}
+
+static void latency_add(latency_stat_t *s, uint32_t us) {
+    s->count++;
+    s->total_us += us;
+    if (us < s->min_us) s->min_us = us;
+    if (us > s->max_us) s->max_us = us;
+}
+
+static uint32_t latency_avg(const latency_stat_t *s) {
+    return s->count ? (uint32_t)(s->total_us / s->count) : 0;
+}
+
+// Soma das classes
+static latency_stat_t pipeline_total(void) {
+    latency_stat_t t;
+    latency_reset(&t);
+    for (int i = 0; i < EVENT_CLASS_COUNT; i++) {
+        t.count += pipeline[i].count;
+        t.total_us += pipeline[i].total_us;
+        if (pipeline[i].min_us < t.min_us) t.min_us = pipeline[i].min_us;
+        if (pipeline[i].max_us > t.max_us) t.max_us = pipeline[i].max_us;
+    }
+    return t;
+}
+
+void pipeline_stats_reset(void) {
+    latency_reset(&scan_gap);
+    for (int i = 0; i < EVENT_CLASS_COUNT; i++) {
+        latency_reset(&pipeline[i]);
+    }
+    have_scan = false;
+    published = 0;
+    since_us = window_start_us = time_us_32();
+    window_count = 0;
+    peak_per_s = 0;
+}
+
+void pipeline_stats_scan(uint32_t now_us) {
+    if (have_scan) {
+        latency_add(&scan_gap, now_us - last_scan_us);
+    }
+    last_scan_us = now_us;
+    have_scan = true;
+}
+
+void pipeline_stats_published(uint32_t detect_us, uint32_t now_us, bool restored, uint8_t cls) {
+    if (!restored && cls < EVENT_CLASS_COUNT) {
+        latency_add(&pipeline[cls], now_us - detect_us);
+    }
+
+    published++;
+    if (now_us - window_start_us >= 1000000) {
+        window_start_us = now_us;
+        window_count = 0;
+    }
+    if (++window_count > peak_per_s) {
+        peak_per_s = window_count;
+    }
+}
+
+// Eventos por segundo desde o último reset, em milésimos
+static uint32_t rate_milli(void) {
+    uint32_t elapsed_ms = (time_us_32() - since_us) / 1000;
+    return elapsed_ms ? (uint32_t)(((uint64_t)published * 1000000) / elapsed_ms) : 0;
+}
+
+int pipeline_stats_format_json(char *buf, size_t len) {
+    latency_stat_t total = pipeline_total();
+    const latency_stat_t *prio = &pipeline[EVENT_CLASS_PRIORITY];
+    return snprintf(buf, len,
+                    "\"lat\":{\"scan_gap_avg\":%lu,\"scan_gap_max\":%lu,"
+                    "\"pipe_avg\":%lu,\"pipe_max\":%lu,\"prio_avg\":%lu,\"prio_max\":%lu,"
+                    "\"published\":%lu,\"peak_per_s\":%lu}",
+                    (unsigned long)latency_avg(&scan_gap), (unsigned long)scan_gap.max_us,
+                    (unsigned long)latency_avg(&total), (unsigned long)total.max_us,
+                    (unsigned long)latency_avg(prio), (unsigned long)prio->max_us,
+                    (unsigned long)published, (unsigned long)peak_per_s);
+}
+
+static void print_latency(const char *name, const latency_stat_t *s) {
+    if (s->count == 0) {
+        printf("[LAT] %s: sem amostras\n", name);
+        return;
+    }
+    printf("[LAT] %s: n=%lu min=%lu avg=%lu max=%lu us\n", name,
+           (unsigned long)s->count, (unsigned long)s->min_us,
+           (unsigned long)latency_avg(s), (unsigned long)s->max_us);
+}
+
+void pipeline_stats_print(const char *variant) {
+    uint32_t rate = rate_milli();
+    printf("[LAT] Variante: %s\n", variant);
+    print_latency("intervalo entre varreduras", &scan_gap);
+    latency_stat_t total = pipeline_total();
+    print_latency("leitura -> publicacao", &total);
+    print_latency("  eventos comuns", &pipeline[EVENT_CLASS_BULK]);
+    print_latency("  eventos prioritarios", &pipeline[EVENT_CLASS_PRIORITY]);
+    printf("[LAT] vazao: %lu eventos, %lu.%03lu/s em media, pico %lu/s\n",
+           (unsigned long)published, (unsigned long)(rate / 1000),
+           (unsigned long)(rate % 1000), (unsigned long)peak_per_s);
+}
@@ -0,0 +1,62 @@
+/**
+ * pipeline_stats.h
+ *
+ * Latência e vazão do caminho leitura -> publicação, medidas igualmente
+ * no firmware bare-metal e na variante FreeRTOS para compará-los:
+ *
+ *  - scan_gap: intervalo real entre duas varreduras do leitor. O pior caso
+ *    limita a latência de detecção (tag que chega logo após uma varredura).
+ *  - pipeline: da leitura do UID até o lwIP aceitar a publicação, no total
+ *    e por classe de evento (comum e prioritária, ver event_queue.h): a
+ *    classe prioritária deve continuar rápida com a fila comum cheia.
+ *  - vazão: eventos publicados por segundo (média e pico em janelas de 1 s).
+ *
+ * Os contadores são escritos por um único produtor cada (varredura e
+ * publicação), então podem ser atualizados de tarefas diferentes.
+ */
+
+#ifndef PIPELINE_STATS_H
+#define PIPELINE_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "event_queue.h"
+
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t total_us;
+} latency_stat_t;
+
+/**
+ * @brief Zera todas as medidas (comando 'lat reset').
+ */
+void pipeline_stats_reset(void);
+
+/**
+ * @brief Registra o início de uma varredura do leitor.
+ */
+void pipeline_stats_scan(uint32_t now_us);
+
+/**
+ * @brief Registra um evento aceito pelo lwIP.
+ * @param detect_us Instante da leitura (time_us_32()).
+ * @param restored Evento restaurado da flash (fica fora da latência).
+ * @param cls Classe do evento (EVENT_CLASS(ev)).
+ */
+void pipeline_stats_published(uint32_t detect_us, uint32_t now_us, bool restored, uint8_t cls);
+
+/**
+ * @brief Escreve as medidas como um campo JSON: "lat":{...}
+ * @return O número de caracteres escritos (como snprintf).
+ */
+int pipeline_stats_format_json(char *buf, size_t len);
+
+/**
+ * @brief Imprime as medidas no serial (comando 'lat').
+ */
+void pipeline_stats_print(const char *variant);
+
+#endif // PIPELINE_STATS_H
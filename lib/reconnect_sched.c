@@ -0,0 +1,41 @@
+#include "reconnect_sched.h"
+
+void reconnect_sched_init(reconnect_sched_t *s, uint32_t base_ms, uint8_t max_shift,
+                          uint32_t max_ms, uint32_t now_ms) {
+    s->base_ms = base_ms;
+    s->max_ms = max_ms;
+    s->max_shift = max_shift;
+    s->failures = 0;
+    s->since_ms = now_ms;
+    s->immediate = false;
+}
+
+uint32_t reconnect_sched_delay_ms(const reconnect_sched_t *s) {
+    uint32_t shift = s->failures > 1 ? s->failures - 1 : 0;
+    if (shift > s->max_shift) shift = s->max_shift;
+
+    uint64_t delay = (uint64_t)s->base_ms << shift;
+    if (s->max_ms != 0 && delay > s->max_ms) delay = s->max_ms;
+    return delay > UINT32_MAX ? UINT32_MAX : (uint32_t)delay;
+}
+
+void reconnect_sched_attempt(reconnect_sched_t *s, uint32_t now_ms) {
+    s->since_ms = now_ms;
+    s->immediate = false;
+}
+
+void reconnect_sched_failed(reconnect_sched_t *s, uint32_t now_ms) {
+    s->failures++;
+    s->since_ms = now_ms;
+    s->immediate = false;
+}
+
+void reconnect_sched_reset(reconnect_sched_t *s) {
+    s->failures = 0;
+    s->immediate = true;
+}
+
+bool reconnect_sched_due(const reconnect_sched_t *s, uint32_t now_ms) {
+    // Subtração sem sinal: continua certa quando o relógio dá a volta
+    return s->immediate || now_ms - s->since_ms >= reconnect_sched_delay_ms(s);
+}
@@ -0,0 +1,66 @@
+/**
+ * reconnect_sched.h
+ *
+ * Agenda de reconexão com backoff exponencial, usada pelo WiFi
+ * (wifi_link.c) e pelo MQTT (mqtt_link.c):
+ *
+ *  - após a n-ésima falha seguida, a próxima tentativa espera
+ *    base_ms << min(n - 1, max_shift), limitado a max_ms;
+ *  - uma tentativa sem resposta também libera a seguinte após a mesma
+ *    espera, contada do início da tentativa;
+ *  - sucesso ou queda de uma conexão ativa zeram as falhas e liberam a
+ *    próxima tentativa na hora.
+ *
+ * Estado explícito e sem acesso a hardware: o relógio (ms) vem de quem
+ * chama. Testado no PC (tests/).
+ */
+
+#ifndef RECONNECT_SCHED_H
+#define RECONNECT_SCHED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    uint32_t base_ms;           // Espera após a primeira falha
+    uint32_t max_ms;            // Teto da espera (0: só max_shift limita)
+    uint8_t max_shift;          // A espera dobra no máximo max_shift vezes
+    uint32_t failures;          // Falhas seguidas
+    uint32_t since_ms;          // Início da espera atual
+    bool immediate;             // Próxima tentativa sem espera
+} reconnect_sched_t;
+
+/**
+ * @brief Inicializa sem falhas; a primeira tentativa automática espera
+ * base_ms a partir de now_ms.
+ */
+void reconnect_sched_init(reconnect_sched_t *s, uint32_t base_ms, uint8_t max_shift,
+                          uint32_t max_ms, uint32_t now_ms);
+
+/**
+ * @brief Espera atual entre tentativas, conforme as falhas seguidas.
+ */
+uint32_t reconnect_sched_delay_ms(const reconnect_sched_t *s);
+
+/**
+ * @brief Registra o início de uma tentativa.
+ */
+void reconnect_sched_attempt(reconnect_sched_t *s, uint32_t now_ms);
+
+/**
+ * @brief Registra uma falha: a espera seguinte dobra e conta de now_ms.
+ */
+void reconnect_sched_failed(reconnect_sched_t *s, uint32_t now_ms);
+
+/**
+ * @brief Zera as falhas e libera a próxima tentativa na hora (conexão
+ * aceita, ou queda de uma conexão que estava ativa).
+ */
+void reconnect_sched_reset(reconnect_sched_t *s);
+
+/**
+ * @brief Indica se a próxima tentativa já pode começar.
+ */
+bool reconnect_sched_due(const reconnect_sched_t *s, uint32_t now_ms);
+
+#endif // RECONNECT_SCHED_H
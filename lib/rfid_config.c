@@ -0,0 +1,416 @@
+#include "rfid_config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "hardware/flash.h"
+#include "flash_layout.h"
+
+// Cabeçalho gravado antes da configuração no setor da flash
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;      // sizeof(rfid_config_t) da versão que gravou
+    uint32_t crc;       // CRC-32 dos 'size' bytes seguintes
+} rfid_config_header_t;
+
+// Tamanho gravado, arredondado para páginas de 256 bytes
+#define RECORD_SIZE    (sizeof(rfid_config_header_t) + sizeof(rfid_config_t))
+#define PROGRAM_SIZE   ((RECORD_SIZE + FLASH_PAGE_SIZE - 1) & ~(FLASH_PAGE_SIZE - 1))
+
+// Configuração ativa: escrita apenas por rfid_config_load()
+static rfid_config_t active_config;
+static bool config_loaded = false;
+
+// --- CRC-32 ---
+
+// Tabela de nibbles: 64 bytes em vez dos 1 KB da tabela completa
+static const uint32_t crc32_nibble_table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+uint32_t rfid_crc32(const void *data, uint32_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    uint32_t crc = 0xFFFFFFFFu;
+
+    while (len--) {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ crc32_nibble_table[crc & 0x0F];
+        crc = (crc >> 4) ^ crc32_nibble_table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+// --- Padrões ---
+
+void rfid_config_defaults(rfid_config_t *cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+
+    strncpy(cfg->wifi_ssid, WIFI_SSID, sizeof(cfg->wifi_ssid) - 1);
+    strncpy(cfg->wifi_password, WIFI_PASSWORD, sizeof(cfg->wifi_password) - 1);
+    strncpy(cfg->mqtt_broker, MQTT_BROKER_IP, sizeof(cfg->mqtt_broker) - 1);
+    cfg->mqtt_port = MQTT_BROKER_PORT;
+    strncpy(cfg->mqtt_client_id, MQTT_CLIENT_ID, sizeof(cfg->mqtt_client_id) - 1);
+    strncpy(cfg->topic_rfid, MQTT_TOPIC_RFID, sizeof(cfg->topic_rfid) - 1);
+    strncpy(cfg->topic_status, MQTT_TOPIC_STATUS, sizeof(cfg->topic_status) - 1);
+
+    cfg->pin_miso = PIN_MISO;
+    cfg->pin_cs = PIN_CS;
+    cfg->pin_sck = PIN_SCK;
+    cfg->pin_mosi = PIN_MOSI;
+    cfg->pin_rst = PIN_RST;
+
+    cfg->scan_interval_ms = SCAN_INTERVAL_MS;
+    cfg->debounce_time_ms = DEBOUNCE_TIME_MS;
+    cfg->reconnect_delay_ms = RECONNECT_DELAY_MS;
+
+    cfg->reader_bus = READER_BUS;
+
+    cfg->wifi_power_mode = WIFI_POWER_MODE;
+    cfg->wifi_roam_rssi = WIFI_ROAM_RSSI;
+
+    cfg->transport = TRANSPORT;
+    strncpy(cfg->mqttsn_gateway, MQTTSN_GATEWAY_IP, sizeof(cfg->mqttsn_gateway) - 1);
+    cfg->mqttsn_port = MQTTSN_GATEWAY_PORT;
+
+    strncpy(cfg->topic_map, MQTT_TOPIC_MAP, sizeof(cfg->topic_map) - 1);
+    strncpy(cfg->topic_position, MQTT_TOPIC_POSITION, sizeof(cfg->topic_position) - 1);
+
+    strncpy(cfg->time_server, TIME_SERVER_IP, sizeof(cfg->time_server) - 1);
+
+    cfg->auth_mode = AUTH_MODE;
+    strncpy(cfg->auth_key, AUTH_KEY, sizeof(cfg->auth_key) - 1);
+
+    strncpy(cfg->topic_rules, MQTT_TOPIC_RULES, sizeof(cfg->topic_rules) - 1);
+
+    cfg->batch_codec = BATCH_CODEC;
+    strncpy(cfg->topic_batch, MQTT_TOPIC_BATCH, sizeof(cfg->topic_batch) - 1);
+
+    cfg->card_ops = CARD_OPS;
+    strncpy(cfg->topic_cmd, MQTT_TOPIC_CMD, sizeof(cfg->topic_cmd) - 1);
+    strncpy(cfg->topic_reply, MQTT_TOPIC_REPLY, sizeof(cfg->topic_reply) - 1);
+
+    cfg->ota_enabled = OTA_ENABLED;
+    cfg->ota_confirm_s = OTA_CONFIRM_S;
+    strncpy(cfg->topic_ota, MQTT_TOPIC_OTA, sizeof(cfg->topic_ota) - 1);
+    strncpy(cfg->topic_crash, MQTT_TOPIC_CRASH, sizeof(cfg->topic_crash) - 1);
+}
+
+// Campos numéricos: limite aceito (em 'cfg set' e na carga) e padrão
+#define UINT_FIELDS(X) \
+    X(mqtt_port, 65535, MQTT_BROKER_PORT) \
+    X(pin_miso, 29, PIN_MISO) \
+    X(pin_cs, 29, PIN_CS) \
+    X(pin_sck, 29, PIN_SCK) \
+    X(pin_mosi, 29, PIN_MOSI) \
+    X(pin_rst, 29, PIN_RST) \
+    X(scan_interval_ms, 5000, SCAN_INTERVAL_MS)     /* Abaixo do timeout do watchdog */ \
+    X(debounce_time_ms, 600000, DEBOUNCE_TIME_MS) \
+    X(reconnect_delay_ms, 600000, RECONNECT_DELAY_MS) \
+    X(reader_bus, 2, READER_BUS) \
+    X(wifi_power_mode, 3, WIFI_POWER_MODE) \
+    X(wifi_roam_rssi, 100, WIFI_ROAM_RSSI) \
+    X(transport, 1, TRANSPORT) \
+    X(mqttsn_port, 65535, MQTTSN_GATEWAY_PORT) \
+    X(auth_mode, 2, AUTH_MODE) \
+    X(batch_codec, 2, BATCH_CODEC) \
+    X(card_ops, 2, CARD_OPS) \
+    X(ota_enabled, 1, OTA_ENABLED) \
+    X(ota_confirm_s, 3600, OTA_CONFIRM_S)
+
+// Garante terminação das strings vindas da flash e os mesmos limites de
+// 'cfg set' nos números (um registro antigo ou corrompido com CRC válido
+// não pode, por exemplo, passar do timeout do watchdog)
+static void sanitize(rfid_config_t *cfg) {
+    cfg->wifi_ssid[sizeof(cfg->wifi_ssid) - 1] = '\0';
+    cfg->wifi_password[sizeof(cfg->wifi_password) - 1] = '\0';
+    cfg->mqtt_broker[sizeof(cfg->mqtt_broker) - 1] = '\0';
+    cfg->mqtt_client_id[sizeof(cfg->mqtt_client_id) - 1] = '\0';
+    cfg->topic_rfid[sizeof(cfg->topic_rfid) - 1] = '\0';
+    cfg->topic_status[sizeof(cfg->topic_status) - 1] = '\0';
+    cfg->mqttsn_gateway[sizeof(cfg->mqttsn_gateway) - 1] = '\0';
+    cfg->topic_map[sizeof(cfg->topic_map) - 1] = '\0';
+    cfg->topic_position[sizeof(cfg->topic_position) - 1] = '\0';
+    cfg->time_server[sizeof(cfg->time_server) - 1] = '\0';
+    cfg->auth_key[sizeof(cfg->auth_key) - 1] = '\0';
+    cfg->topic_rules[sizeof(cfg->topic_rules) - 1] = '\0';
+    cfg->topic_batch[sizeof(cfg->topic_batch) - 1] = '\0';
+    cfg->topic_cmd[sizeof(cfg->topic_cmd) - 1] = '\0';
+    cfg->topic_reply[sizeof(cfg->topic_reply) - 1] = '\0';
+    cfg->topic_ota[sizeof(cfg->topic_ota) - 1] = '\0';
+    cfg->topic_crash[sizeof(cfg->topic_crash) - 1] = '\0';
+
+#define LIMIT_FIELD(name, max, def) \
+    if ((uint32_t)cfg->name > (uint32_t)(max)) { \
+        printf("[CFG] AVISO: " #name "=%lu acima de %lu, usando o padrao %lu\n", \
+               (unsigned long)cfg->name, (unsigned long)(max), (unsigned long)(def)); \
+        cfg->name = (def); \
+    }
+
+    UINT_FIELDS(LIMIT_FIELD)
+
+#undef LIMIT_FIELD
+}
+
+// --- Carga ---
+
+rfid_config_source_t rfid_config_load(void) {
+    const uint8_t *sector = FLASH_XIP_PTR(FLASH_CONFIG_OFFSET);
+    rfid_config_header_t hdr;
+    memcpy(&hdr, sector, sizeof(hdr));
+
+    rfid_config_defaults(&active_config);
+    config_loaded = true;
+
+    if (hdr.magic != RFID_CONFIG_MAGIC || hdr.version == 0 ||
+        hdr.version > RFID_CONFIG_VERSION ||
+        hdr.size == 0 || hdr.size > sizeof(rfid_config_t)) {
+        printf("[CFG] Nenhuma configuracao gravada, usando padroes\n");
+        return RFID_CONFIG_SOURCE_DEFAULTS;
+    }
+
+    const uint8_t *payload = sector + sizeof(hdr);
+    if (rfid_crc32(payload, hdr.size) != hdr.crc) {
+        printf("[CFG] ERRO: CRC invalido, usando padroes\n");
+        return RFID_CONFIG_SOURCE_DEFAULTS;
+    }
+
+    // Versões antigas têm um prefixo menor: o restante fica com os padrões
+    memcpy(&active_config, payload, hdr.size);
+
+    // Campos novos que caem no preenchimento final da versão anterior
+    // (gravado como zero) recebem o padrão explicitamente
+    if (hdr.version < 3) {
+        active_config.wifi_power_mode = WIFI_POWER_MODE;
+        active_config.wifi_roam_rssi = WIFI_ROAM_RSSI;
+    }
+    if (hdr.version < 4) {
+        active_config.transport = TRANSPORT;
+    }
+    if (hdr.version < 5) {
+        strncpy(active_config.topic_map, MQTT_TOPIC_MAP, sizeof(active_config.topic_map) - 1);
+        strncpy(active_config.topic_position, MQTT_TOPIC_POSITION,
+                sizeof(active_config.topic_position) - 1);
+    }
+    if (hdr.version < 6) {
+        strncpy(active_config.time_server, TIME_SERVER_IP, sizeof(active_config.time_server) - 1);
+    }
+    if (hdr.version < 7) {
+        active_config.auth_mode = AUTH_MODE;
+        strncpy(active_config.auth_key, AUTH_KEY, sizeof(active_config.auth_key) - 1);
+    }
+    if (hdr.version < 8) {
+        strncpy(active_config.topic_rules, MQTT_TOPIC_RULES, sizeof(active_config.topic_rules) - 1);
+    }
+    if (hdr.version < 9) {
+        active_config.batch_codec = BATCH_CODEC;
+        strncpy(active_config.topic_batch, MQTT_TOPIC_BATCH, sizeof(active_config.topic_batch) - 1);
+    }
+    if (hdr.version < 10) {
+        active_config.card_ops = CARD_OPS;
+        strncpy(active_config.topic_cmd, MQTT_TOPIC_CMD, sizeof(active_config.topic_cmd) - 1);
+        strncpy(active_config.topic_reply, MQTT_TOPIC_REPLY, sizeof(active_config.topic_reply) - 1);
+    }
+    if (hdr.version < 11) {
+        active_config.ota_enabled = OTA_ENABLED;
+        active_config.ota_confirm_s = OTA_CONFIRM_S;
+        strncpy(active_config.topic_ota, MQTT_TOPIC_OTA, sizeof(active_config.topic_ota) - 1);
+    }
+    if (hdr.version < 12) {
+        strncpy(active_config.topic_crash, MQTT_TOPIC_CRASH, sizeof(active_config.topic_crash) - 1);
+    }
+
+    sanitize(&active_config);
+
+    if (hdr.version != RFID_CONFIG_VERSION) {
+        printf("[CFG] Configuracao v%u migrada para v%u\n",
+               hdr.version, RFID_CONFIG_VERSION);
+        return RFID_CONFIG_SOURCE_MIGRATED;
+    }
+
+    printf("[CFG] Configuracao carregada da flash\n");
+    return RFID_CONFIG_SOURCE_FLASH;
+}
+
+const rfid_config_t *rfid_config(void) {
+    if (!config_loaded) {
+        rfid_config_load();
+    }
+    return &active_config;
+}
+
+// --- Edição ---
+
+static bool set_string(char *dst, size_t dst_size, const char *value) {
+    if (strlen(value) >= dst_size) return false;
+    strcpy(dst, value);
+    return true;
+}
+
+static bool set_uint(uint32_t *dst, const char *value, uint32_t max) {
+    char *end;
+    unsigned long v = strtoul(value, &end, 10);
+    if (end == value || *end != '\0' || v > max) return false;
+    *dst = (uint32_t)v;
+    return true;
+}
+
+bool rfid_config_set_field(rfid_config_t *cfg, const char *key, const char *value) {
+    uint32_t v;
+
+#define STRING_FIELD(name) \
+    if (strcmp(key, #name) == 0) return set_string(cfg->name, sizeof(cfg->name), value)
+#define UINT_FIELD(name, max, def) \
+    if (strcmp(key, #name) == 0) { \
+        if (!set_uint(&v, value, (max))) return false; \
+        cfg->name = v; \
+        return true; \
+    }
+
+    STRING_FIELD(wifi_ssid);
+    STRING_FIELD(wifi_password);
+    STRING_FIELD(mqtt_broker);
+    STRING_FIELD(mqtt_client_id);
+    STRING_FIELD(topic_rfid);
+    STRING_FIELD(topic_status);
+    STRING_FIELD(mqttsn_gateway);
+    STRING_FIELD(topic_map);
+    STRING_FIELD(topic_position);
+    STRING_FIELD(time_server);
+    STRING_FIELD(auth_key);
+    STRING_FIELD(topic_rules);
+    STRING_FIELD(topic_batch);
+    STRING_FIELD(topic_cmd);
+    STRING_FIELD(topic_reply);
+    STRING_FIELD(topic_ota);
+    STRING_FIELD(topic_crash);
+    UINT_FIELDS(UINT_FIELD)
+
+#undef STRING_FIELD
+#undef UINT_FIELD
+
+    return false;
+}
+
+// --- Gravação ---
+
+// Executada com o outro core e as interrupções pausados por flash_safe_execute
+static void program_sector(void *param) {
+    const uint8_t *record = (const uint8_t *)param;
+    flash_range_erase(FLASH_CONFIG_OFFSET, FLASH_CONFIG_SIZE);
+    flash_range_program(FLASH_CONFIG_OFFSET, record, PROGRAM_SIZE);
+}
+
+int rfid_config_save(const rfid_config_t *cfg) {
+    uint8_t record[PROGRAM_SIZE];
+    memset(record, 0xFF, sizeof(record));
+
+    rfid_config_header_t hdr = {
+        .magic = RFID_CONFIG_MAGIC,
+        .version = RFID_CONFIG_VERSION,
+        .size = sizeof(rfid_config_t),
+        .crc = rfid_crc32(cfg, sizeof(rfid_config_t))
+    };
+    memcpy(record, &hdr, sizeof(hdr));
+    memcpy(record + sizeof(hdr), cfg, sizeof(rfid_config_t));
+
+    int rc = flash_safe_execute(program_sector, record, 1000);
+    if (rc != PICO_OK) {
+        printf("[CFG] ERRO ao gravar na flash! Codigo: %d\n", rc);
+        return -1;
+    }
+
+    // Confere a gravação lendo de volta pelo XIP
+    if (memcmp(FLASH_XIP_PTR(FLASH_CONFIG_OFFSET), record, RECORD_SIZE) != 0) {
+        printf("[CFG] ERRO: verificacao da flash falhou!\n");
+        return -1;
+    }
+
+    printf("[CFG] Configuracao salva (vale a partir do proximo boot)\n");
+    return 0;
+}
+
+// --- Console ---
+
+// Cópia editada por 'cfg set' até o 'cfg save'
+static rfid_config_t pending_config;
+static bool pending_config_valid = false;
+
+bool rfid_config_console(char *args) {
+    const rfid_config_t *cfg = rfid_config();
+
+    char *action = strtok(args, " ");
+    if (action == NULL || strcmp(action, "show") == 0) {
+        rfid_config_print(pending_config_valid ? &pending_config : cfg);
+        return false;
+    }
+
+    if (strcmp(action, "set") == 0) {
+        char *key = strtok(NULL, " ");
+        char *value = strtok(NULL, "");
+        if (key == NULL) {
+            printf("[CFG] Uso: cfg set <campo> <valor>\n");
+            return false;
+        }
+        if (!pending_config_valid) {
+            pending_config = *cfg;
+            pending_config_valid = true;
+        }
+        if (rfid_config_set_field(&pending_config, key, value ? value : "")) {
+            printf("[CFG] %s alterado (use 'cfg save' para gravar)\n", key);
+        } else {
+            printf("[CFG] ERRO: campo ou valor invalido: %s\n", key);
+        }
+    } else if (strcmp(action, "save") == 0) {
+        if (!pending_config_valid) {
+            printf("[CFG] Nada para gravar\n");
+            return false;
+        }
+        rfid_config_save(&pending_config);
+    } else if (strcmp(action, "defaults") == 0) {
+        rfid_config_defaults(&pending_config);
+        pending_config_valid = true;
+        printf("[CFG] Padroes carregados (use 'cfg save' para gravar)\n");
+    } else if (strcmp(action, "reboot") == 0) {
+        printf("[CFG] Reiniciando...\n");
+        return true;
+    } else {
+        printf("[CFG] Comandos: show | set <campo> <valor> | save | defaults | reboot\n");
+    }
+    return false;
+}
+
+void rfid_config_print(const rfid_config_t *cfg) {
+    printf("[CFG] wifi_ssid=%s\n", cfg->wifi_ssid);
+    printf("[CFG] wifi_password=%s\n", cfg->wifi_password[0] ? "********" : "");
+    printf("[CFG] mqtt_broker=%s\n", cfg->mqtt_broker);
+    printf("[CFG] mqtt_port=%u\n", cfg->mqtt_port);
+    printf("[CFG] mqtt_client_id=%s\n", cfg->mqtt_client_id);
+    printf("[CFG] topic_rfid=%s\n", cfg->topic_rfid);
+    printf("[CFG] topic_status=%s\n", cfg->topic_status);
+    printf("[CFG] topic_map=%s topic_position=%s topic_rules=%s\n", cfg->topic_map,
+           cfg->topic_position, cfg->topic_rules);
+    printf("[CFG] pin_miso=%u pin_cs=%u pin_sck=%u pin_mosi=%u pin_rst=%u\n",
+           cfg->pin_miso, cfg->pin_cs, cfg->pin_sck, cfg->pin_mosi, cfg->pin_rst);
+    printf("[CFG] scan_interval_ms=%lu debounce_time_ms=%lu reconnect_delay_ms=%lu\n",
+           (unsigned long)cfg->scan_interval_ms, (unsigned long)cfg->debounce_time_ms,
+           (unsigned long)cfg->reconnect_delay_ms);
+    printf("[CFG] reader_bus=%u\n", cfg->reader_bus);
+    printf("[CFG] wifi_power_mode=%u wifi_roam_rssi=%u\n",
+           cfg->wifi_power_mode, cfg->wifi_roam_rssi);
+    printf("[CFG] transport=%u (%s) mqttsn_gateway=%s mqttsn_port=%u\n", cfg->transport,
+           cfg->transport == 1 ? "MQTT-SN/UDP" : "MQTT/TCP", cfg->mqttsn_gateway, cfg->mqttsn_port);
+    printf("[CFG] time_server=%s\n", cfg->time_server[0] ? cfg->time_server : "(desligado)");
+    printf("[CFG] auth_mode=%u auth_key=%s\n", cfg->auth_mode,
+           cfg->auth_key[0] ? "********" : "");
+    printf("[CFG] batch_codec=%u topic_batch=%s\n", cfg->batch_codec, cfg->topic_batch);
+    printf("[CFG] card_ops=%u topic_cmd=%s topic_reply=%s\n", cfg->card_ops, cfg->topic_cmd,
+           cfg->topic_reply);
+    printf("[CFG] ota_enabled=%u ota_confirm_s=%u topic_ota=%s\n", cfg->ota_enabled,
+           cfg->ota_confirm_s, cfg->topic_ota);
+    printf("[CFG] topic_crash=%s\n", cfg->topic_crash);
+}
@@ -0,0 +1,287 @@
+/**
+ * rfid_config.h
+ *
+ * Configuração de runtime do leitor RFID, persistida na flash.
+ *
+ * Substitui as #defines de main_mqtt.c: um único binário serve para toda a
+ * frota e cada leitor carrega suas credenciais, broker, tópicos, pinos e
+ * temporizações do último setor da flash. Se o setor estiver vazio ou
+ * corrompido (CRC inválido), os valores padrão abaixo são usados.
+ *
+ * Os padrões podem ser sobrescritos em tempo de compilação (config.h ou
+ * -D no CMake), mas não é mais necessário recompilar para cada local.
+ */
+
+#ifndef RFID_CONFIG_H
+#define RFID_CONFIG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(__has_include)
+#if __has_include("config.h")
+#include "config.h"
+#endif
+#endif
+
+// ========== VALORES PADRÃO ==========
+
+#ifndef WIFI_SSID
+#define WIFI_SSID           "SUA_REDE_WIFI"
+#endif
+#ifndef WIFI_PASSWORD
+#define WIFI_PASSWORD       "SUA_SENHA_WIFI"
+#endif
+#ifndef MQTT_BROKER_IP
+#define MQTT_BROKER_IP      "192.168.1.100"
+#endif
+#ifndef MQTT_BROKER_PORT
+#define MQTT_BROKER_PORT    1883
+#endif
+#ifndef MQTT_CLIENT_ID
+#define MQTT_CLIENT_ID      "PicoW-RFID-Reader"
+#endif
+#ifndef MQTT_TOPIC_RFID
+#define MQTT_TOPIC_RFID     "agv/rfid"
+#endif
+#ifndef MQTT_TOPIC_STATUS
+#define MQTT_TOPIC_STATUS   "agv/sensors/rfid/status"
+#endif
+#ifndef MQTT_TOPIC_MAP
+#define MQTT_TOPIC_MAP      "agv/map"          // Mapa tag -> posição (ver tag_map.h)
+#endif
+#ifndef MQTT_TOPIC_POSITION
+#define MQTT_TOPIC_POSITION "agv/position"     // Posição, velocidade e ETA do AGV
+#endif
+#ifndef MQTT_TOPIC_RULES
+#define MQTT_TOPIC_RULES    "agv/rules"        // Tabela de regras de borda (ver rules.h)
+#endif
+#ifndef MQTT_TOPIC_BATCH
+#define MQTT_TOPIC_BATCH    "agv/rfid/batch"   // Fila pendente em lotes binários (event_codec.h)
+#endif
+#ifndef MQTT_TOPIC_CMD
+#define MQTT_TOPIC_CMD      "agv/rfid/cmd"     // Operações remotas em cartões (card_ops.h)
+#endif
+#ifndef MQTT_TOPIC_REPLY
+#define MQTT_TOPIC_REPLY    "agv/rfid/reply"   // Resultados das operações
+#endif
+#ifndef MQTT_TOPIC_OTA
+#define MQTT_TOPIC_OTA      "agv/rfid/ota"     // Atualização de firmware (ota.h)
+#endif
+#ifndef MQTT_TOPIC_CRASH
+#define MQTT_TOPIC_CRASH    "agv/rfid/crash"   // Registro do último HardFault
+#endif
+#ifndef PIN_MISO
+#define PIN_MISO            4
+#endif
+#ifndef PIN_CS
+#define PIN_CS              5
+#endif
+#ifndef PIN_SCK
+#define PIN_SCK             2
+#endif
+#ifndef PIN_MOSI
+#define PIN_MOSI            3
+#endif
+#ifndef PIN_RST
+#define PIN_RST             0
+#endif
+#ifndef READER_BUS
+#define READER_BUS          0     // 0 = spi0, 1 = spi1, 2 = SPI em PIO
+#endif
+#ifndef SCAN_INTERVAL_MS
+#define SCAN_INTERVAL_MS    500
+#endif
+#ifndef DEBOUNCE_TIME_MS
+#define DEBOUNCE_TIME_MS    3000
+#endif
+#ifndef RECONNECT_DELAY_MS
+#define RECONNECT_DELAY_MS  5000
+#endif
+#ifndef WIFI_POWER_MODE
+#define WIFI_POWER_MODE     0     // 0 = sem power save ... 3 = agressivo (wifi_link.h)
+#endif
+#ifndef WIFI_ROAM_RSSI
+#define WIFI_ROAM_RSSI      70    // Procura outro AP abaixo de -70 dBm (0 = desliga)
+#endif
+#ifndef TRANSPORT
+#define TRANSPORT           0     // 0 = MQTT (TCP), 1 = MQTT-SN (UDP)
+#endif
+#ifndef MQTTSN_GATEWAY_IP
+#define MQTTSN_GATEWAY_IP   MQTT_BROKER_IP
+#endif
+#ifndef MQTTSN_GATEWAY_PORT
+#define MQTTSN_GATEWAY_PORT 1884
+#endif
+#ifndef TIME_SERVER_IP
+#define TIME_SERVER_IP      MQTT_BROKER_IP   // Servidor NTP ("" = sem sincronização)
+#endif
+#ifndef AUTH_MODE
+#define AUTH_MODE           0     // 0 = sem MAC, 1 = HMAC-SHA256, 2 = SipHash-2-4
+#endif
+#ifndef AUTH_KEY
+#define AUTH_KEY            ""    // Chave em hexadecimal (16 a 32 bytes)
+#endif
+#ifndef BATCH_CODEC
+#define BATCH_CODEC         0     // 0 = JSON por evento, 1 = delta + dicionário, 2 = + LZSS
+#endif
+#ifndef CARD_OPS
+#define CARD_OPS            0     // 0 = desligado, 1 = só leitura, 2 = leitura e escrita
+#endif
+#ifndef OTA_ENABLED
+#define OTA_ENABLED         0     // Aceita atualização remota (firmware com RFID_OTA)
+#endif
+#ifndef OTA_CONFIRM_S
+#define OTA_CONFIRM_S       60    // Tempo saudável até confirmar a imagem nova
+#endif
+
+// ========== FORMATO NA FLASH ==========
+
+#define RFID_CONFIG_MAGIC   0x52464347u  // "RFCG"
+#define RFID_CONFIG_VERSION 12
+
+/**
+ * Configuração tipada do leitor. Strings sempre terminadas em '\0'.
+ * Novos campos devem ser adicionados SEMPRE no final, incrementando
+ * RFID_CONFIG_VERSION: registros antigos são migrados copiando o prefixo
+ * conhecido e completando o restante com os padrões.
+ */
+typedef struct {
+    // WiFi
+    char wifi_ssid[33];
+    char wifi_password[65];
+
+    // Broker MQTT
+    char mqtt_broker[64];       // IP ou hostname
+    uint16_t mqtt_port;
+    char mqtt_client_id[32];
+    char topic_rfid[48];
+    char topic_status[48];
+
+    // Pinagem do MFRC522
+    uint8_t pin_miso;
+    uint8_t pin_cs;
+    uint8_t pin_sck;
+    uint8_t pin_mosi;
+    uint8_t pin_rst;
+
+    // Temporizações (ms)
+    uint32_t scan_interval_ms;
+    uint32_t debounce_time_ms;
+    uint32_t reconnect_delay_ms;
+
+    // v2: barramento do MFRC522 (0 = spi0, 1 = spi1, 2 = SPI em PIO)
+    uint8_t reader_bus;
+
+    // v3: WiFi (ver wifi_link.h)
+    uint8_t wifi_power_mode;    // 0 = sem power save, 1 = performance, 2 = padrão, 3 = agressivo
+    uint8_t wifi_roam_rssi;     // Limiar de roaming em -dBm (70 = -70 dBm), 0 = desligado
+
+    // v4: transporte dos eventos (ver mqttsn_link.h)
+    uint8_t transport;          // 0 = MQTT (TCP), 1 = MQTT-SN (UDP)
+    char mqttsn_gateway[64];    // IP do gateway MQTT-SN
+    uint16_t mqttsn_port;
+
+    // v5: localização do AGV (ver tag_map.h e agv_tracker.h)
+    char topic_map[48];         // Assinado: mapa de marcadores
+    char topic_position[48];    // Publicado: posição/velocidade/ETA a cada marcador
+
+    // v6: relógio comum entre leitores (ver time_sync.h)
+    char time_server[64];       // IP do servidor NTP, vazio = desligado
+
+    // v7: assinatura dos eventos (ver event_auth.h)
+    uint8_t auth_mode;          // 0 = desligado, 1 = HMAC-SHA256, 2 = SipHash-2-4
+    char auth_key[65];          // Chave compartilhada em hexadecimal
+
+    // v8: regras de borda (ver rules.h)
+    char topic_rules[48];       // Assinado: tabela compilada por tools/rules_compile
+
+    // v9: fila pendente em lotes (ver event_codec.h)
+    uint8_t batch_codec;        // 0 = desligado, 1 = delta + dicionário, 2 = + LZSS
+    char topic_batch[48];       // Publicado: quadros binários
+
+    // v10: operações remotas em cartões (ver card_ops.h)
+    uint8_t card_ops;           // 0 = desligado, 1 = só leitura, 2 = leitura e escrita
+    char topic_cmd[48];         // Assinado: comandos
+    char topic_reply[48];       // Publicado: resultados
+
+    // v11: atualização de firmware (ver ota.h)
+    uint8_t ota_enabled;
+    uint16_t ota_confirm_s;     // Rede e leitor OK por este tempo: imagem confirmada
+    char topic_ota[48];         // Assinado: pedidos de atualização
+
+    // v12: registro de falhas (ver crash_dump.h)
+    char topic_crash[48];       // Publicado: último HardFault (vazio = não publica)
+} rfid_config_t;
+
+// Origem da configuração carregada no boot
+typedef enum {
+    RFID_CONFIG_SOURCE_DEFAULTS,   // Setor vazio ou inválido
+    RFID_CONFIG_SOURCE_FLASH,      // Registro válido da versão atual
+    RFID_CONFIG_SOURCE_MIGRATED    // Registro válido de versão anterior
+} rfid_config_source_t;
+
+/**
+ * @brief Carrega a configuração da flash (ou os padrões) para a RAM.
+ *
+ * Deve ser chamada uma vez no boot, antes de qualquer rfid_config().
+ * A leitura é feita direto pelo XIP, sem cópia intermediária.
+ *
+ * @return A origem da configuração carregada.
+ */
+rfid_config_source_t rfid_config_load(void);
+
+/**
+ * @brief Retorna a configuração ativa (somente leitura após o boot).
+ */
+const rfid_config_t *rfid_config(void);
+
+/**
+ * @brief Preenche uma estrutura com os valores padrão de compilação.
+ */
+void rfid_config_defaults(rfid_config_t *cfg);
+
+/**
+ * @brief Altera um campo de uma configuração a partir de texto.
+ *
+ * Usado pelo console serial de provisionamento (ex: "wifi_ssid", "MinhaRede").
+ *
+ * @param cfg A configuração a ser alterada (normalmente uma cópia da ativa).
+ * @param key O nome do campo.
+ * @param value O novo valor em texto.
+ * @return true se o campo existe e o valor é válido.
+ */
+bool rfid_config_set_field(rfid_config_t *cfg, const char *key, const char *value);
+
+/**
+ * @brief Grava a configuração na flash.
+ *
+ * A configuração ativa só passa a valer no próximo boot, mantendo a
+ * estrutura em RAM constante durante a execução.
+ *
+ * @return 0 em caso de sucesso, -1 em caso de falha.
+ */
+int rfid_config_save(const rfid_config_t *cfg);
+
+/**
+ * @brief Executa um comando 'cfg' do console serial.
+ *
+ * Comum às variantes bare-metal e FreeRTOS: show | set <campo> <valor> |
+ * save | defaults | reboot. As alterações ficam numa cópia até o 'cfg save'.
+ *
+ * @param args O texto depois de "cfg" (alterado por strtok).
+ * @return true se 'cfg reboot' foi pedido (quem chama reinicia o leitor).
+ */
+bool rfid_config_console(char *args);
+
+/**
+ * @brief Imprime a configuração no serial (senha mascarada).
+ */
+void rfid_config_print(const rfid_config_t *cfg);
+
+/**
+ * @brief CRC-32 (IEEE 802.3) usado para validar registros na flash.
+ */
+uint32_t rfid_crc32(const void *data, uint32_t len);
+
+#endif // RFID_CONFIG_H
@@ -0,0 +1,387 @@
+#include "rules.h"
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "pico/critical_section.h"
+#include "hardware/flash.h"
+#include "flash_layout.h"
+#include "rfid_config.h"
+#include "time_sync.h"
+
+#define RECORD_PAGES    ((RULES_TABLE_MAX + FLASH_PAGE_SIZE - 1) & ~(FLASH_PAGE_SIZE - 1))
+
+_Static_assert(RECORD_PAGES <= FLASH_RULES_SIZE, "tabela de regras nao cabe no setor reservado");
+
+// Regras que valem para este leitor (as de outros leitores saem na carga)
+typedef struct {
+    rule_t rule;
+    uint8_t index;              // Posição na tabela recebida
+    uint32_t hits;
+    // Janela de agregação em curso
+    uint32_t agg_count;
+    uint32_t agg_first_ms;
+    uint8_t agg_uid[EVENT_UID_MAX];
+    uint8_t agg_uid_size;
+} active_rule_t;
+
+static active_rule_t active[RULES_MAX];
+static uint32_t active_count = 0;
+static char routes[RULES_ROUTES_MAX][RULES_TOPIC_LEN];
+static bool needs_time = false;
+
+// Tabela recebida, como chegou (gravada na flash por rules_persist)
+static uint8_t table[RULES_TABLE_MAX];
+static uint32_t table_len = 0;
+static bool dirty = false;
+
+// Permanência: sequência de leituras do mesmo UID sem intervalo longo
+static uint8_t run_uid[EVENT_UID_MAX];
+static uint8_t run_uid_size = 0;
+static uint32_t run_start_ms = 0;
+static uint32_t run_last_ms = 0;
+
+static uint32_t evaluated = 0;
+static uint32_t dropped = 0;
+static uint32_t aggregated = 0;
+static uint32_t eval_us_max = 0;
+
+// A tabela pode ser trocada pelo lwIP (MQTT) enquanto o RF a consulta.
+// Iniciado em rules_init(), antes de qualquer outro contexto usar as regras
+static critical_section_t rules_lock;
+
+static void lock(void) {
+    critical_section_enter_blocking(&rules_lock);
+}
+
+static void unlock(void) {
+    critical_section_exit(&rules_lock);
+}
+
+// --- Carga ---
+
+static int validate(const uint8_t *data, uint32_t len, rules_header_t *hdr) {
+    if (len < sizeof(*hdr)) return -1;
+    memcpy(hdr, data, sizeof(*hdr));
+
+    if (hdr->magic != RULES_MAGIC || hdr->version != RULES_VERSION ||
+        hdr->count > RULES_MAX || hdr->route_count > RULES_ROUTES_MAX ||
+        len != sizeof(*hdr) + hdr->count * sizeof(rule_t) + hdr->route_count * RULES_TOPIC_LEN) {
+        return -1;
+    }
+    if (rfid_crc32(data + sizeof(*hdr), len - sizeof(*hdr)) != hdr->crc) return -1;
+
+    const uint8_t *p = data + sizeof(*hdr);
+    for (uint8_t i = 0; i < hdr->count; i++) {
+        rule_t r;
+        memcpy(&r, p + i * sizeof(rule_t), sizeof(r));
+        bool timed = r.time_from != RULES_NO_TIME;
+        if (r.uid_lo > r.uid_hi ||
+            (timed && (r.time_from >= 1440 || r.time_to >= 1440)) ||
+            (!timed && r.time_to != RULES_NO_TIME) ||
+            ((r.actions & RULE_ACT_ROUTE) && (r.route == 0 || r.route > hdr->route_count)) ||
+            ((r.actions & RULE_ACT_AGGREGATE) && r.window_ms == 0)) {
+            return -1;
+        }
+    }
+
+    const char *topics = (const char *)(p + hdr->count * sizeof(rule_t));
+    for (uint8_t i = 0; i < hdr->route_count; i++) {
+        const char *t = topics + i * RULES_TOPIC_LEN;
+        if (t[0] == '\0' || memchr(t, '\0', RULES_TOPIC_LEN) == NULL) return -1;
+    }
+    return 0;
+}
+
+static int install(const uint8_t *data, uint32_t len) {
+    rules_header_t hdr = { .count = 0, .route_count = 0 };
+    if (len > 0 && validate(data, len, &hdr) != 0) return -1;
+
+    const rfid_config_t *cfg = rfid_config();
+    uint32_t reader = rfid_crc32(cfg->mqtt_client_id, strlen(cfg->mqtt_client_id));
+    const uint8_t *p = len > 0 ? data + sizeof(hdr) : NULL;
+
+    lock();
+    active_count = 0;
+    needs_time = false;
+    for (uint8_t i = 0; i < hdr.count; i++) {
+        rule_t r;
+        memcpy(&r, p + i * sizeof(rule_t), sizeof(r));
+        if (r.reader != 0 && r.reader != reader) continue;
+
+        active_rule_t *a = &active[active_count++];
+        memset(a, 0, sizeof(*a));
+        a->rule = r;
+        a->index = i;
+        if (r.time_from != RULES_NO_TIME) needs_time = true;
+    }
+    memset(routes, 0, sizeof(routes));
+    if (len > 0) {
+        memcpy(routes, p + hdr.count * sizeof(rule_t), hdr.route_count * RULES_TOPIC_LEN);
+        memcpy(table, data, len);
+    }
+    table_len = len;
+    unlock();
+
+    return (int)active_count;
+}
+
+void rules_init(void) {
+    critical_section_init(&rules_lock);
+}
+
+int rules_load_table(const uint8_t *data, uint32_t len) {
+    int n = install(data, len);
+    if (n >= 0) dirty = true;
+    return n;
+}
+
+int rules_load(void) {
+    const uint8_t *sector = FLASH_XIP_PTR(FLASH_RULES_OFFSET);
+    rules_header_t hdr;
+    memcpy(&hdr, sector, sizeof(hdr));
+
+    if (hdr.magic != RULES_MAGIC) {
+        printf("[RULES] Nenhuma regra gravada\n");
+        return 0;
+    }
+
+    uint32_t len = sizeof(hdr) + hdr.count * sizeof(rule_t) + hdr.route_count * RULES_TOPIC_LEN;
+    int n = len <= RULES_TABLE_MAX ? install(sector, len) : -1;
+    if (n < 0) {
+        printf("[RULES] ERRO: tabela gravada invalida, descartada\n");
+        return 0;
+    }
+    printf("[RULES] %d regras carregadas da flash\n", n);
+    return n;
+}
+
+static uint8_t record[RECORD_PAGES];
+static uint32_t record_size;
+
+// Executada com o outro core e as interrupções pausados por flash_safe_execute
+static void program_sector(void *param) {
+    (void)param;
+    flash_range_erase(FLASH_RULES_OFFSET, FLASH_RULES_SIZE);
+    if (record_size) flash_range_program(FLASH_RULES_OFFSET, record, record_size);
+}
+
+int rules_persist(void) {
+    if (!dirty) return 0;
+
+    lock();
+    uint32_t used = table_len;
+    memcpy(record, table, used);
+    dirty = false;
+    unlock();
+
+    record_size = (used + FLASH_PAGE_SIZE - 1) & ~(FLASH_PAGE_SIZE - 1);
+    memset(record + used, 0xFF, record_size - used);
+
+    int rc = flash_safe_execute(program_sector, NULL, 1000);
+    if (rc != PICO_OK) {
+        printf("[RULES] ERRO ao gravar na flash! Codigo: %d\n", rc);
+        dirty = true;
+        return -1;
+    }
+    printf("[RULES] Tabela gravada (%lu bytes)\n", (unsigned long)used);
+    return 0;
+}
+
+// --- Avaliação ---
+
+static uint32_t uid_key(const rfid_event_t *ev) {
+    uint32_t key = 0;
+    for (int i = 0; i < 4; i++) {
+        key = (key << 8) | (i < ev->uid_size ? ev->uid[i] : 0);
+    }
+    return key;
+}
+
+// Minuto UTC do dia da leitura, -1 sem relógio sincronizado
+static int minute_of_day(const rfid_event_t *ev) {
+    uint64_t unix_us;
+    if (!time_sync_event_unix_us(ev, &unix_us)) return -1;
+    return (int)((unix_us / 60000000ull) % 1440);
+}
+
+static bool in_window(const rule_t *r, int minute) {
+    if (r->time_from == RULES_NO_TIME) return true;
+    if (minute < 0) return false;
+    if (r->time_from <= r->time_to) return minute >= r->time_from && minute < r->time_to;
+    return minute >= r->time_from || minute < r->time_to;  // Atravessa a meia-noite
+}
+
+// Tempo contínuo no campo, em décimos de segundo. A tag parada é relida a
+// cada debounce_time_ms; um intervalo maior que dois períodos encerra a
+// sequência
+static uint32_t update_dwell(const rfid_event_t *ev) {
+    uint32_t gap = 2 * rfid_config()->debounce_time_ms;
+    bool same = ev->uid_size == run_uid_size && memcmp(ev->uid, run_uid, run_uid_size) == 0;
+
+    if (!same || ev->timestamp_ms - run_last_ms > gap) {
+        memcpy(run_uid, ev->uid, ev->uid_size);
+        run_uid_size = ev->uid_size;
+        run_start_ms = ev->timestamp_ms;
+    }
+    run_last_ms = ev->timestamp_ms;
+    return (run_last_ms - run_start_ms) / 100;
+}
+
+bool rules_apply(rfid_event_t *ev) {
+    uint32_t start = time_us_32();
+    bool keep = true;
+    uint32_t key = uid_key(ev);
+    int minute = needs_time ? minute_of_day(ev) : -1;
+
+    lock();
+    uint32_t dwell_ds = update_dwell(ev);
+    evaluated++;
+
+    // Busca linear, primeira que casa: no pior caso (nenhuma casa, todas
+    // falham só na janela de horário) são RULES_MAX x ~35 ciclos no M0+
+    for (uint32_t i = 0; i < active_count; i++) {
+        active_rule_t *a = &active[i];
+        const rule_t *r = &a->rule;
+        if (key < r->uid_lo || key > r->uid_hi || dwell_ds < r->dwell_ds ||
+            !in_window(r, minute)) {
+            continue;
+        }
+
+        a->hits++;
+        if (r->actions & RULE_ACT_DROP) {
+            dropped++;
+            keep = false;
+        } else if (r->actions & RULE_ACT_AGGREGATE) {
+            if (a->agg_count++ == 0) a->agg_first_ms = ev->timestamp_ms;
+            memcpy(a->agg_uid, ev->uid, ev->uid_size);
+            a->agg_uid_size = ev->uid_size;
+            aggregated++;
+            keep = false;
+        } else {
+            if (r->actions & RULE_ACT_PRIORITY) ev->flags |= EVENT_FLAG_PRIORITY;
+            if (r->actions & RULE_ACT_ROUTE) {
+                ev->flags = (ev->flags & ~EVENT_ROUTE_MASK) | (r->route << EVENT_ROUTE_SHIFT);
+            }
+        }
+        break;
+    }
+    unlock();
+
+    uint32_t cost = time_us_32() - start;
+    if (cost > eval_us_max) eval_us_max = cost;
+    return keep;
+}
+
+void rules_route_topic(const rfid_event_t *ev, char *topic, size_t len) {
+    const rfid_config_t *cfg = rfid_config();
+    uint8_t route = (ev->flags & EVENT_ROUTE_MASK) >> EVENT_ROUTE_SHIFT;
+
+    // MQTT-SN usa só o tópico registrado no gateway: rotas valem no MQTT
+    lock();
+    if (route == 0 || route > RULES_ROUTES_MAX || routes[route - 1][0] == '\0' ||
+        cfg->transport != 0) {
+        snprintf(topic, len, "%s", cfg->topic_rfid);
+    } else {
+        snprintf(topic, len, "%s", routes[route - 1]);
+    }
+    unlock();
+}
+
+// --- Agregação ---
+
+bool rules_aggregate_peek(uint32_t now_ms, rules_summary_t *summary) {
+    bool found = false;
+
+    lock();
+    for (uint32_t i = 0; i < active_count && !found; i++) {
+        active_rule_t *a = &active[i];
+        if (a->agg_count == 0 || now_ms - a->agg_first_ms < a->rule.window_ms) continue;
+
+        summary->rule = a->index;
+        summary->route = (a->rule.actions & RULE_ACT_ROUTE) ? a->rule.route : 0;
+        summary->count = a->agg_count;
+        summary->first_ms = a->agg_first_ms;
+        summary->window_ms = a->rule.window_ms;
+        memcpy(summary->last_uid, a->agg_uid, a->agg_uid_size);
+        summary->last_uid_size = a->agg_uid_size;
+        found = true;
+    }
+    unlock();
+    return found;
+}
+
+void rules_aggregate_done(const rules_summary_t *summary) {
+    lock();
+    for (uint32_t i = 0; i < active_count; i++) {
+        active_rule_t *a = &active[i];
+        if (a->index != summary->rule || a->agg_count < summary->count) continue;
+        a->agg_count -= summary->count;
+        a->agg_first_ms = summary->first_ms + summary->window_ms;
+    }
+    unlock();
+}
+
+// --- Texto ---
+
+void rules_print(void) {
+    uint32_t n, n_evaluated, n_dropped, n_aggregated, cost_max;
+    bool unsaved;
+
+    lock();
+    n = active_count;
+    unsaved = dirty;
+    n_evaluated = evaluated;
+    n_dropped = dropped;
+    n_aggregated = aggregated;
+    cost_max = eval_us_max;
+    unlock();
+
+    printf("[RULES] %lu regras ativas%s; %lu avaliadas, %lu descartadas, %lu agregadas, "
+           "custo max %lu us\n", (unsigned long)n, unsaved ? " (nao gravadas)" : "",
+           (unsigned long)n_evaluated, (unsigned long)n_dropped, (unsigned long)n_aggregated,
+           (unsigned long)cost_max);
+
+    // Uma regra por vez, copiada sob o lock: o printf fica fora dele e a
+    // tabela pode ser trocada pelo MQTT entre uma linha e outra
+    for (uint32_t i = 0; ; i++) {
+        active_rule_t a;
+        char route[RULES_TOPIC_LEN];
+
+        lock();
+        bool more = i < active_count;
+        if (more) {
+            a = active[i];
+            if (a.rule.actions & RULE_ACT_ROUTE) {
+                memcpy(route, routes[a.rule.route - 1], sizeof(route));
+            }
+        }
+        unlock();
+        if (!more) break;
+
+        const rule_t *r = &a.rule;
+        printf("[RULES]   #%u uid %08lX-%08lX", a.index, (unsigned long)r->uid_lo,
+               (unsigned long)r->uid_hi);
+        if (r->time_from != RULES_NO_TIME) {
+            printf(" time %02u:%02u-%02u:%02u", r->time_from / 60, r->time_from % 60,
+                   r->time_to / 60, r->time_to % 60);
+        }
+        if (r->dwell_ds) printf(" dwell %u.%us", r->dwell_ds / 10, r->dwell_ds % 10);
+        if (r->actions & RULE_ACT_DROP) printf(" drop");
+        if (r->actions & RULE_ACT_AGGREGATE) printf(" aggregate %lums", (unsigned long)r->window_ms);
+        if (r->actions & RULE_ACT_PRIORITY) printf(" priority");
+        if (r->actions & RULE_ACT_ROUTE) printf(" route %s", route);
+        printf(" -> %lu acertos\n", (unsigned long)a.hits);
+    }
+}
+
+int rules_format_json(char *buf, size_t len) {
+    lock();
+    uint32_t n = active_count, n_dropped = dropped, n_aggregated = aggregated;
+    uint32_t cost_max = eval_us_max;
+    unlock();
+    return snprintf(buf, len,
+                    "\"rules\":{\"n\":%lu,\"drop\":%lu,\"agg\":%lu,\"eval_us_max\":%lu}",
+                    (unsigned long)n, (unsigned long)n_dropped,
+                    (unsigned long)n_aggregated, (unsigned long)cost_max);
+}
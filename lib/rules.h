@@ -0,0 +1,154 @@
+/**
+ * rules.h
+ *
+ * Regras de filtragem e roteamento aplicadas na borda, no caminho de RF,
+ * antes de qualquer formatação: cada leitura é descartada, agregada,
+ * marcada como prioritária ou desviada para outro tópico.
+ *
+ * A tabela é binária e compilada no PC a partir de um texto simples
+ * (tools/rules_compile.c), publicada como mensagem retida em 'topic_rules'
+ * e guardada na flash. Cada regra compara:
+ *
+ *  - faixa de UID (4 primeiros bytes, big-endian: prefixo = faixa);
+ *  - leitor (CRC-32 do mqtt_client_id; resolvido na carga, não por evento);
+ *  - janela de horário UTC em minutos (exige o relógio de time_sync);
+ *  - permanência mínima da tag no campo (leituras repetidas do mesmo UID).
+ *
+ * A primeira regra que casa decide; sem regra, o evento segue normal.
+ * Custo por evento limitado: busca linear em no máximo RULES_MAX regras de
+ * comparações inteiras, sem alocação nem texto. Estimativa do pior caso no
+ * Cortex-M0+ (nenhuma regra casa): ~35 ciclos por regra, ~560 nas 16, mais
+ * ~300 do lock, da chave e da permanência; com regras de horário, a
+ * divisão de 64 bits do minuto do dia soma ~200. Perto de 1100 ciclos,
+ * ~9 us a 125 MHz. O máximo medido aparece no comando 'rules' e em
+ * 'eval_us_max' no status. Com 16 regras, uma tabela indexada por hash do
+ * UID não compensa: as faixas de UID não viram chaves exatas.
+ */
+
+#ifndef RULES_H
+#define RULES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "event_queue.h"
+
+#define RULES_MAGIC         0x534C5552u  // "RULS"
+#define RULES_VERSION       1
+#define RULES_MAX           16
+#define RULES_ROUTES_MAX    4
+#define RULES_TOPIC_LEN     48
+#define RULES_NO_TIME       0xFFFF
+
+// Ações (bits); nenhuma = deixa passar
+#define RULE_ACT_DROP       0x01
+#define RULE_ACT_PRIORITY   0x02
+#define RULE_ACT_ROUTE      0x04
+#define RULE_ACT_AGGREGATE  0x08
+
+// Formato na flash e no MQTT (little-endian, campos alinhados)
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint8_t count;
+    uint8_t route_count;
+    uint32_t crc;               // CRC-32 das regras e rotas seguintes
+} rules_header_t;
+
+typedef struct {
+    uint32_t uid_lo;            // Faixa dos 4 primeiros bytes do UID
+    uint32_t uid_hi;
+    uint32_t reader;            // CRC-32 do mqtt_client_id, 0 = qualquer
+    uint32_t window_ms;         // RULE_ACT_AGGREGATE: duração da janela
+    uint16_t time_from;         // Minuto UTC do dia [from, to), RULES_NO_TIME = sempre
+    uint16_t time_to;
+    uint16_t dwell_ds;          // Permanência mínima em décimos de segundo
+    uint8_t actions;
+    uint8_t route;              // RULE_ACT_ROUTE: rota 1..route_count
+} rule_t;
+
+_Static_assert(sizeof(rules_header_t) == 12, "formato do cabecalho de regras");
+_Static_assert(sizeof(rule_t) == 24, "formato da regra");
+
+// Seguem: count x rule_t, route_count x char[RULES_TOPIC_LEN] (terminadas em '\0')
+#define RULES_TABLE_MAX (sizeof(rules_header_t) + RULES_MAX * sizeof(rule_t) + \
+                         RULES_ROUTES_MAX * RULES_TOPIC_LEN)
+
+// Rota e prioridade (EVENT_FLAG_PRIORITY) viajam nas flags do evento,
+// inclusive pela fila na flash
+#define EVENT_ROUTE_SHIFT       4
+#define EVENT_ROUTE_MASK        0x70
+
+// Resumo de uma janela de agregação encerrada
+typedef struct {
+    uint8_t rule;               // Índice da regra (na tabela recebida)
+    uint8_t route;
+    uint32_t count;
+    uint32_t first_ms;          // timestamp_ms da primeira leitura da janela
+    uint32_t window_ms;
+    uint8_t last_uid[EVENT_UID_MAX];
+    uint8_t last_uid_size;
+} rules_summary_t;
+
+/**
+ * @brief Inicia o lock das regras (chamar uma vez no boot, antes de
+ * rules_load() e de assinar o tópico das regras).
+ */
+void rules_init(void);
+
+/**
+ * @brief Valida e instala uma tabela (ex: recebida por MQTT). Tamanho zero
+ * limpa as regras. Pode ser chamada do contexto do lwIP: a gravação na
+ * flash fica para rules_persist().
+ * @return O número de regras que valem para este leitor, ou -1 se inválida.
+ */
+int rules_load_table(const uint8_t *data, uint32_t len);
+
+/**
+ * @brief Carrega a tabela gravada na flash (chamar uma vez no boot).
+ */
+int rules_load(void);
+
+/**
+ * @brief Grava a tabela na flash se mudou (fora do contexto do lwIP).
+ * @return 0 se gravou ou não havia mudança, -1 em caso de falha.
+ */
+int rules_persist(void);
+
+/**
+ * @brief Aplica as regras a uma leitura (caminho de RF). Pode marcar
+ * EVENT_FLAG_PRIORITY e a rota nas flags do evento.
+ * @return false se o evento foi descartado ou absorvido por uma agregação.
+ */
+bool rules_apply(rfid_event_t *ev);
+
+/**
+ * @brief Tópico de publicação do evento: a rota da regra ou topic_rfid.
+ */
+void rules_route_topic(const rfid_event_t *ev, char *topic, size_t len);
+
+/**
+ * @brief Próxima janela de agregação encerrada até 'now_ms' (sem removê-la).
+ * @return false se nenhuma está pronta.
+ */
+bool rules_aggregate_peek(uint32_t now_ms, rules_summary_t *summary);
+
+/**
+ * @brief Retira da janela as leituras do resumo publicado. Leituras que
+ * chegaram depois do peek abrem a janela seguinte.
+ */
+void rules_aggregate_done(const rules_summary_t *summary);
+
+/**
+ * @brief Imprime as regras ativas e os acertos de cada uma (comando 'rules').
+ */
+void rules_print(void);
+
+/**
+ * @brief Escreve o resumo como campo JSON (sem chaves externas).
+ * Ex: "rules":{"n":3,"drop":120,"agg":40,"eval_us_max":9}
+ * @return O número de caracteres escritos (como snprintf).
+ */
+int rules_format_json(char *buf, size_t len);
+
+#endif // RULES_H
@@ -0,0 +1,174 @@
+#include "supervisor.h"
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/watchdog.h"
+
+// Registradores de scratch usados (4..7 são reservados ao bootrom/SDK)
+#define SCRATCH_MAGIC     0
+#define SCRATCH_PHASE     1
+#define SCRATCH_REASON    2   // bits 0..7: motivo, bits 8..15: tarefa
+#define SCRATCH_RESTARTS  3
+
+#define SUPERVISOR_MAGIC  0x53555056u  // "SUPV"
+
+// Prazos padrão entre heartbeats (ms)
+static uint32_t deadline_ms[SUP_TASK_COUNT] = {
+    [SUP_TASK_RF] = 5000,
+    [SUP_TASK_NET] = 5000,
+    [SUP_TASK_PUBLISH] = 60000
+};
+
+static uint32_t last_beat_ms[SUP_TASK_COUNT];
+static bool task_armed[SUP_TASK_COUNT];
+static bool stalling = false;
+static void (*pre_reset_hook)(void) = NULL;
+static supervisor_boot_info_t boot_info;
+
+static const char *const phase_names[SUP_PHASE_COUNT] = {
+    [SUP_PHASE_BOOT] = "boot",
+    [SUP_PHASE_WIFI_CONNECT] = "wifi_connect",
+    [SUP_PHASE_MQTT_CONNECT] = "mqtt_connect",
+    [SUP_PHASE_DNS_WAIT] = "dns_wait",
+    [SUP_PHASE_RF_INIT] = "rf_init",
+    [SUP_PHASE_RF_SCAN] = "rf_scan",
+    [SUP_PHASE_PUBLISH] = "publish",
+    [SUP_PHASE_FLASH_WRITE] = "flash_write",
+    [SUP_PHASE_IDLE] = "idle"
+};
+
+static const char *const task_names[SUP_TASK_COUNT] = {
+    [SUP_TASK_RF] = "rf",
+    [SUP_TASK_NET] = "net",
+    [SUP_TASK_PUBLISH] = "publish"
+};
+
+static inline uint32_t now_ms(void) {
+    return to_ms_since_boot(get_absolute_time());
+}
+
+const supervisor_boot_info_t *supervisor_init(void) {
+    bool scratch_valid = watchdog_hw->scratch[SCRATCH_MAGIC] == SUPERVISOR_MAGIC;
+
+    boot_info.warm = scratch_valid && watchdog_caused_reboot();
+    if (boot_info.warm) {
+        uint32_t reason = watchdog_hw->scratch[SCRATCH_REASON];
+        boot_info.last_phase = (supervisor_phase_t)watchdog_hw->scratch[SCRATCH_PHASE];
+        boot_info.last_reason = (supervisor_reason_t)(reason & 0xFF);
+        boot_info.stalled_task = (supervisor_task_t)((reason >> 8) & 0xFF);
+        boot_info.restarts = watchdog_hw->scratch[SCRATCH_RESTARTS] + 1;
+
+        // Sem motivo gravado: o laço inteiro parou de alimentar o watchdog
+        if (boot_info.last_reason == SUP_REASON_NONE) {
+            boot_info.last_reason = SUP_REASON_WATCHDOG;
+        }
+        if (boot_info.last_phase >= SUP_PHASE_COUNT) {
+            boot_info.last_phase = SUP_PHASE_BOOT;
+        }
+    } else {
+        boot_info.last_phase = SUP_PHASE_BOOT;
+        boot_info.last_reason = SUP_REASON_NONE;
+        boot_info.stalled_task = SUP_TASK_COUNT;
+        boot_info.restarts = 0;
+    }
+
+    watchdog_hw->scratch[SCRATCH_MAGIC] = SUPERVISOR_MAGIC;
+    watchdog_hw->scratch[SCRATCH_PHASE] = SUP_PHASE_BOOT;
+    watchdog_hw->scratch[SCRATCH_REASON] = SUP_REASON_NONE;
+    watchdog_hw->scratch[SCRATCH_RESTARTS] = boot_info.restarts;
+
+    // Pausa durante depuração para não reiniciar em breakpoints
+    watchdog_enable(SUPERVISOR_WATCHDOG_MS, true);
+
+    if (boot_info.warm) {
+        printf("[SUP] Reinicio quente #%lu: motivo=%s fase=%s",
+               (unsigned long)boot_info.restarts,
+               supervisor_reason_name(boot_info.last_reason),
+               supervisor_phase_name(boot_info.last_phase));
+        if (boot_info.last_reason == SUP_REASON_TASK_STALL) {
+            printf(" tarefa=%s", supervisor_task_name(boot_info.stalled_task));
+        }
+        printf("\n");
+    }
+    return &boot_info;
+}
+
+void supervisor_set_phase(supervisor_phase_t phase) {
+    watchdog_hw->scratch[SCRATCH_PHASE] = phase;
+}
+
+supervisor_phase_t supervisor_get_phase(void) {
+    return (supervisor_phase_t)watchdog_hw->scratch[SCRATCH_PHASE];
+}
+
+void supervisor_heartbeat(supervisor_task_t task) {
+    last_beat_ms[task] = now_ms();
+    task_armed[task] = true;
+}
+
+void supervisor_set_deadline(supervisor_task_t task, uint32_t ms) {
+    deadline_ms[task] = ms;
+}
+
+void supervisor_set_pre_reset_hook(void (*hook)(void)) {
+    pre_reset_hook = hook;
+}
+
+void supervisor_service(void) {
+    if (stalling) return;  // Aguardando o watchdog reiniciar
+
+    uint32_t now = now_ms();
+    for (int t = 0; t < SUP_TASK_COUNT; t++) {
+        if (task_armed[t] && (now - last_beat_ms[t]) > deadline_ms[t]) {
+            printf("[SUP] ERRO: tarefa '%s' sem heartbeat ha %lu ms, reiniciando...\n",
+                   task_names[t], (unsigned long)(now - last_beat_ms[t]));
+            watchdog_hw->scratch[SCRATCH_REASON] = SUP_REASON_TASK_STALL | ((uint32_t)t << 8);
+            stalling = true;
+            if (pre_reset_hook) {
+                watchdog_update();  // Garante tempo para o gancho
+                pre_reset_hook();
+            }
+            return;
+        }
+    }
+    watchdog_update();
+}
+
+void supervisor_reboot(supervisor_reason_t reason) {
+    if (pre_reset_hook) {
+        watchdog_update();
+        pre_reset_hook();
+    }
+    watchdog_hw->scratch[SCRATCH_REASON] = reason;
+    watchdog_reboot(0, 0, 10);
+    while (1) tight_loop_contents();
+}
+
+void supervisor_fault_reset(void) {
+    watchdog_hw->scratch[SCRATCH_REASON] = SUP_REASON_CRASH;
+    watchdog_reboot(0, 0, 1);
+    while (1) tight_loop_contents();
+}
+
+const char *supervisor_phase_name(supervisor_phase_t phase) {
+    return phase < SUP_PHASE_COUNT ? phase_names[phase] : "?";
+}
+
+const char *supervisor_reason_name(supervisor_reason_t reason) {
+    switch (reason) {
+    case SUP_REASON_WATCHDOG:
+        return "watchdog";
+    case SUP_REASON_TASK_STALL:
+        return "task_stall";
+    case SUP_REASON_REQUESTED:
+        return "requested";
+    case SUP_REASON_CRASH:
+        return "crash";
+    case SUP_REASON_NONE:
+    default:
+        return "power_on";
+    }
+}
+
+const char *supervisor_task_name(supervisor_task_t task) {
+    return task < SUP_TASK_COUNT ? task_names[task] : "?";
+}
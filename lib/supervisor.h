@@ -0,0 +1,123 @@
+/**
+ * supervisor.h
+ *
+ * Supervisão do laço principal pelo watchdog de hardware.
+ *
+ * Cada tarefa lógica (RF, rede, publicação) registra um heartbeat; o
+ * watchdog só é alimentado enquanto todas as tarefas ativas estiverem
+ * dentro do prazo. Se uma tarefa travar (ou o laço inteiro parar, como no
+ * laço de PowerDown do PCD_Reset ou na espera de DNS), o RP2040 reinicia.
+ *
+ * Os registradores de scratch do watchdog sobrevivem ao reset e guardam a
+ * última fase executada e o motivo, permitindo um reinício "quente" que
+ * pula os atrasos longos de boot.
+ */
+
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Timeout do watchdog (máximo do RP2040: ~8,3 s)
+#define SUPERVISOR_WATCHDOG_MS  8000
+
+// Tarefas supervisionadas
+typedef enum {
+    SUP_TASK_RF,        // Varredura do MFRC522
+    SUP_TASK_NET,       // WiFi + lwIP (cyw43_arch_poll)
+    SUP_TASK_PUBLISH,   // Escoamento da fila de eventos
+    SUP_TASK_COUNT
+} supervisor_task_t;
+
+// Fases registradas no scratch (última fase antes de um reset)
+typedef enum {
+    SUP_PHASE_BOOT,
+    SUP_PHASE_WIFI_CONNECT,
+    SUP_PHASE_MQTT_CONNECT,
+    SUP_PHASE_DNS_WAIT,
+    SUP_PHASE_RF_INIT,
+    SUP_PHASE_RF_SCAN,
+    SUP_PHASE_PUBLISH,
+    SUP_PHASE_FLASH_WRITE,
+    SUP_PHASE_IDLE,
+    SUP_PHASE_COUNT
+} supervisor_phase_t;
+
+// Motivo do último reset
+typedef enum {
+    SUP_REASON_NONE,            // Power-on ou reset externo
+    SUP_REASON_WATCHDOG,        // Laço travado (watchdog não alimentado)
+    SUP_REASON_TASK_STALL,      // Uma tarefa perdeu o prazo do heartbeat
+    SUP_REASON_REQUESTED,       // Reinício pedido (ex: 'cfg reboot')
+    SUP_REASON_CRASH            // HardFault (registro em crash_dump)
+} supervisor_reason_t;
+
+// Informações do boot atual
+typedef struct {
+    bool warm;                      // Reinício pelo watchdog com scratch válido
+    uint32_t restarts;              // Reinícios quentes consecutivos
+    supervisor_phase_t last_phase;  // Fase em que o reset ocorreu
+    supervisor_reason_t last_reason;
+    supervisor_task_t stalled_task; // Válido se last_reason == TASK_STALL
+} supervisor_boot_info_t;
+
+/**
+ * @brief Lê o scratch do watchdog, identifica o tipo de boot e liga o watchdog.
+ * @return Informações do boot (reinício quente, fase e motivo anteriores).
+ */
+const supervisor_boot_info_t *supervisor_init(void);
+
+/**
+ * @brief Registra a fase atual no scratch do watchdog.
+ */
+void supervisor_set_phase(supervisor_phase_t phase);
+
+/**
+ * @brief Registra um heartbeat. A tarefa passa a ser supervisionada a
+ * partir do primeiro heartbeat.
+ */
+void supervisor_heartbeat(supervisor_task_t task);
+
+/**
+ * @brief Define o prazo máximo entre heartbeats de uma tarefa (ms).
+ */
+void supervisor_set_deadline(supervisor_task_t task, uint32_t deadline_ms);
+
+/**
+ * @brief Alimenta o watchdog se todas as tarefas estiverem no prazo.
+ *
+ * Se alguma tarefa estiver atrasada, chama o gancho de pré-reset uma vez
+ * (ex: salvar a fila de eventos) e deixa o watchdog reiniciar o sistema.
+ */
+void supervisor_service(void);
+
+/**
+ * @brief Define a função chamada antes de um reset provocado pelo supervisor.
+ */
+void supervisor_set_pre_reset_hook(void (*hook)(void));
+
+/**
+ * @brief Reinicia o sistema por software, como reinício quente.
+ */
+void supervisor_reboot(supervisor_reason_t reason);
+
+/**
+ * @brief Reinicia a partir do tratador de HardFault: sem o gancho de
+ * pré-reset (nada de flash nem de locks com o sistema em falha).
+ */
+void supervisor_fault_reset(void);
+
+/**
+ * @brief Fase atual (a registrada no scratch).
+ */
+supervisor_phase_t supervisor_get_phase(void);
+
+/**
+ * @brief Nomes legíveis para o serial e a telemetria.
+ */
+const char *supervisor_phase_name(supervisor_phase_t phase);
+const char *supervisor_reason_name(supervisor_reason_t reason);
+const char *supervisor_task_name(supervisor_task_t task);
+
+#endif // SUPERVISOR_H
@@ -0,0 +1,31 @@
+#include "tag_debounce.h"
+#include <string.h>
+
+void tag_debounce_init(tag_debounce_t *d, uint32_t window_ms) {
+    memset(d, 0, sizeof(*d));
+    d->window_ms = window_ms;
+}
+
+bool tag_debounce_is_repeat(const tag_debounce_t *d, const uint8_t *uid, uint8_t uid_size,
+                            uint32_t now_ms) {
+    if (d->uid_size == 0 || d->uid_size != uid_size) return false;
+    if (memcmp(d->uid, uid, uid_size) != 0) return false;
+
+    // Subtração sem sinal: continua certa quando o relógio dá a volta
+    return now_ms - d->last_ms < d->window_ms;
+}
+
+void tag_debounce_record(tag_debounce_t *d, const uint8_t *uid, uint8_t uid_size,
+                         uint32_t now_ms) {
+    if (uid_size > EVENT_UID_MAX) uid_size = EVENT_UID_MAX;
+    memcpy(d->uid, uid, uid_size);
+    d->uid_size = uid_size;
+    d->last_ms = now_ms;
+}
+
+bool tag_debounce_accept(tag_debounce_t *d, const uint8_t *uid, uint8_t uid_size,
+                         uint32_t now_ms) {
+    if (tag_debounce_is_repeat(d, uid, uid_size, now_ms)) return false;
+    tag_debounce_record(d, uid, uid_size, now_ms);
+    return true;
+}
@@ -0,0 +1,54 @@
+/**
+ * tag_debounce.h
+ *
+ * Debounce das leituras: a mesma tag parada no campo só gera um novo
+ * evento depois de debounce_time_ms desde o último evento aceito dela.
+ * Leituras repetidas não estendem a janela, então uma tag que fica no
+ * campo volta a ser registrada a cada debounce_time_ms.
+ *
+ * Estado explícito e sem acesso a hardware: o relógio (ms) vem de quem
+ * chama. Usado pelos dois firmwares e pelos benchmarks, testado no PC
+ * (tests/).
+ */
+
+#ifndef TAG_DEBOUNCE_H
+#define TAG_DEBOUNCE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "event_queue.h"
+
+typedef struct {
+    uint8_t uid[EVENT_UID_MAX];
+    uint8_t uid_size;           // 0: nenhuma leitura aceita ainda
+    uint32_t last_ms;           // Instante do último evento aceito
+    uint32_t window_ms;
+} tag_debounce_t;
+
+/**
+ * @brief Inicializa sem nenhuma tag registrada.
+ * @param window_ms Janela do debounce (debounce_time_ms da configuração).
+ */
+void tag_debounce_init(tag_debounce_t *d, uint32_t window_ms);
+
+/**
+ * @brief Indica se a leitura repete a última tag aceita dentro da janela.
+ * @param now_ms Relógio em ms (pode dar a volta nos 32 bits).
+ */
+bool tag_debounce_is_repeat(const tag_debounce_t *d, const uint8_t *uid, uint8_t uid_size,
+                            uint32_t now_ms);
+
+/**
+ * @brief Registra a leitura como a última aceita (abre uma nova janela).
+ */
+void tag_debounce_record(tag_debounce_t *d, const uint8_t *uid, uint8_t uid_size,
+                         uint32_t now_ms);
+
+/**
+ * @brief Verifica e registra numa chamada.
+ * @return true se a leitura é nova (e foi registrada); false se é repetição.
+ */
+bool tag_debounce_accept(tag_debounce_t *d, const uint8_t *uid, uint8_t uid_size,
+                         uint32_t now_ms);
+
+#endif // TAG_DEBOUNCE_H
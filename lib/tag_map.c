@@ -0,0 +1,312 @@
+#include "tag_map.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "pico/critical_section.h"
+#include "hardware/flash.h"
+#include "flash_layout.h"
+#include "rfid_config.h"
+
+#define TAG_MAP_MAGIC       0x544D4150u  // "TMAP"
+#define TAG_MAP_VERSION     1
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t loop_mm;
+    uint32_t crc;       // CRC-32 das 'count' entradas seguintes
+} tag_map_header_t;
+
+#define RECORD_MAX      (sizeof(tag_map_header_t) + TAG_MAP_CAPACITY * sizeof(tag_map_entry_t))
+#define RECORD_PAGES    ((RECORD_MAX + FLASH_PAGE_SIZE - 1) & ~(FLASH_PAGE_SIZE - 1))
+
+_Static_assert(RECORD_PAGES <= FLASH_TAG_MAP_SIZE, "mapa de tags nao cabe no setor reservado");
+
+static tag_map_entry_t entries[TAG_MAP_CAPACITY];
+static uint32_t count = 0;
+static uint32_t loop_mm = 0;
+static bool dirty = false;
+
+// O mapa pode ser trocado pelo lwIP (MQTT) enquanto o RF o consulta
+static critical_section_t map_lock;
+static bool lock_ready = false;
+
+static void lock(void) {
+    if (!lock_ready) {
+        critical_section_init(&map_lock);
+        lock_ready = true;
+    }
+    critical_section_enter_blocking(&map_lock);
+}
+
+static void unlock(void) {
+    critical_section_exit(&map_lock);
+}
+
+static int find(const uint8_t *uid, uint8_t uid_size) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (entries[i].uid_size == uid_size && memcmp(entries[i].uid, uid, uid_size) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+// --- Consulta ---
+
+bool tag_map_lookup(const uint8_t *uid, uint8_t uid_size, uint32_t *position_mm) {
+    lock();
+    int i = find(uid, uid_size);
+    if (i >= 0) *position_mm = entries[i].position_mm;
+    unlock();
+    return i >= 0;
+}
+
+bool tag_map_next(uint32_t position_mm, int direction, uint32_t *next_mm) {
+    uint32_t best = UINT32_MAX;
+    bool found = false;
+
+    lock();
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t p = entries[i].position_mm;
+        uint32_t ahead;
+
+        if (loop_mm) {
+            ahead = direction > 0 ? (p + loop_mm - position_mm % loop_mm) % loop_mm
+                                  : (position_mm % loop_mm + loop_mm - p) % loop_mm;
+        } else if (direction > 0) {
+            if (p <= position_mm) continue;
+            ahead = p - position_mm;
+        } else {
+            if (p >= position_mm) continue;
+            ahead = position_mm - p;
+        }
+
+        if (ahead > 0 && ahead < best) {
+            best = ahead;
+            *next_mm = p;
+            found = true;
+        }
+    }
+    unlock();
+    return found;
+}
+
+uint32_t tag_map_loop_mm(void) {
+    return loop_mm;
+}
+
+uint32_t tag_map_count(void) {
+    return count;
+}
+
+// --- Alteração ---
+
+static bool set_locked(const uint8_t *uid, uint8_t uid_size, uint32_t position_mm) {
+    int i = find(uid, uid_size);
+    if (i < 0) {
+        if (count == TAG_MAP_CAPACITY) return false;
+        i = (int)count++;
+        memset(&entries[i], 0, sizeof(entries[i]));
+        memcpy(entries[i].uid, uid, uid_size);
+        entries[i].uid_size = uid_size;
+    }
+    entries[i].position_mm = position_mm;
+    dirty = true;
+    return true;
+}
+
+bool tag_map_set(const uint8_t *uid, uint8_t uid_size, uint32_t position_mm) {
+    if (uid_size == 0 || uid_size > EVENT_UID_MAX) return false;
+    lock();
+    bool ok = set_locked(uid, uid_size, position_mm);
+    unlock();
+    return ok;
+}
+
+bool tag_map_remove(const uint8_t *uid, uint8_t uid_size) {
+    lock();
+    int i = find(uid, uid_size);
+    if (i >= 0) {
+        entries[i] = entries[--count];
+        dirty = true;
+    }
+    unlock();
+    return i >= 0;
+}
+
+void tag_map_set_loop(uint32_t mm) {
+    loop_mm = mm;
+    dirty = true;
+}
+
+void tag_map_clear(void) {
+    lock();
+    count = 0;
+    loop_mm = 0;
+    dirty = true;
+    unlock();
+}
+
+// --- Texto ---
+
+uint8_t tag_map_parse_uid(const char *hex, size_t len, uint8_t *uid) {
+    if (len == 0 || len % 2 || len / 2 > EVENT_UID_MAX) return 0;
+
+    for (size_t i = 0; i < len; i += 2) {
+        // strtoul aceitaria sinal ("+f", "-1") e espaços
+        if (!isxdigit((unsigned char)hex[i]) || !isxdigit((unsigned char)hex[i + 1])) return 0;
+        char byte[3] = { hex[i], hex[i + 1], '\0' };
+        uid[i / 2] = (uint8_t)strtoul(byte, NULL, 16);
+    }
+    return (uint8_t)(len / 2);
+}
+
+static bool parse_uint(const char *s, size_t len, uint32_t *out) {
+    char num[12];
+    if (len == 0 || len >= sizeof(num)) return false;
+    for (size_t i = 0; i < len; i++) {
+        if (!isdigit((unsigned char)s[i])) return false;
+    }
+    memcpy(num, s, len);
+    num[len] = '\0';
+    *out = strtoul(num, NULL, 10);
+    return true;
+}
+
+/**
+ * Percorre os itens "chave=valor" separados por ';'. Sem 'apply', só valida.
+ */
+static int parse_items(const char *text, size_t len, bool apply) {
+    int markers = 0;
+    size_t pos = 0;
+
+    while (pos < len) {
+        size_t end = pos;
+        while (end < len && text[end] != ';' && text[end] != '\n') end++;
+
+        const char *item = text + pos;
+        size_t item_len = end - pos;
+        pos = end + 1;
+        while (item_len && (item[item_len - 1] == ' ' || item[item_len - 1] == '\r')) item_len--;
+        if (item_len == 0) continue;
+
+        const char *eq = memchr(item, '=', item_len);
+        if (eq == NULL) return -1;
+        size_t key_len = eq - item;
+        uint32_t value;
+        if (!parse_uint(eq + 1, item_len - key_len - 1, &value)) return -1;
+
+        if (key_len == 4 && memcmp(item, "loop", 4) == 0) {
+            if (apply) loop_mm = value;
+            continue;
+        }
+
+        uint8_t uid[EVENT_UID_MAX];
+        uint8_t uid_size = tag_map_parse_uid(item, key_len, uid);
+        if (uid_size == 0 || ++markers > TAG_MAP_CAPACITY) return -1;
+        if (apply) set_locked(uid, uid_size, value);
+    }
+    return markers;
+}
+
+int tag_map_parse(const char *text, size_t len) {
+    if (parse_items(text, len, false) < 0) return -1;
+
+    lock();
+    count = 0;
+    loop_mm = 0;
+    int markers = parse_items(text, len, true);
+    dirty = true;
+    unlock();
+    return markers;
+}
+
+// --- Flash ---
+
+uint32_t tag_map_load(void) {
+    const uint8_t *sector = FLASH_XIP_PTR(FLASH_TAG_MAP_OFFSET);
+    tag_map_header_t hdr;
+    memcpy(&hdr, sector, sizeof(hdr));
+
+    if (hdr.magic != TAG_MAP_MAGIC || hdr.version != TAG_MAP_VERSION ||
+        hdr.count > TAG_MAP_CAPACITY) {
+        printf("[MAP] Nenhum mapa de marcadores gravado\n");
+        return 0;
+    }
+
+    const uint8_t *payload = sector + sizeof(hdr);
+    if (rfid_crc32(payload, hdr.count * sizeof(tag_map_entry_t)) != hdr.crc) {
+        printf("[MAP] ERRO: CRC invalido, mapa descartado\n");
+        return 0;
+    }
+
+    lock();
+    memcpy(entries, payload, hdr.count * sizeof(tag_map_entry_t));
+    count = hdr.count;
+    loop_mm = hdr.loop_mm;
+    dirty = false;
+    unlock();
+
+    printf("[MAP] %lu marcadores carregados da flash\n", (unsigned long)count);
+    return count;
+}
+
+static uint8_t record[RECORD_PAGES];
+static uint32_t record_size;
+
+// Executada com o outro core e as interrupções pausados por flash_safe_execute
+static void program_sector(void *param) {
+    (void)param;
+    flash_range_erase(FLASH_TAG_MAP_OFFSET, FLASH_TAG_MAP_SIZE);
+    flash_range_program(FLASH_TAG_MAP_OFFSET, record, record_size);
+}
+
+int tag_map_persist(bool force) {
+    if (!dirty && !force) return 0;
+
+    lock();
+    tag_map_header_t hdr = {
+        .magic = TAG_MAP_MAGIC,
+        .version = TAG_MAP_VERSION,
+        .count = (uint16_t)count,
+        .loop_mm = loop_mm
+    };
+    uint32_t used = sizeof(hdr) + count * sizeof(tag_map_entry_t);
+    memcpy(record + sizeof(hdr), entries, count * sizeof(tag_map_entry_t));
+    dirty = false;
+    unlock();
+
+    hdr.crc = rfid_crc32(record + sizeof(hdr), used - sizeof(hdr));
+    memcpy(record, &hdr, sizeof(hdr));
+    record_size = (used + FLASH_PAGE_SIZE - 1) & ~(FLASH_PAGE_SIZE - 1);
+    memset(record + used, 0xFF, record_size - used);
+
+    int rc = flash_safe_execute(program_sector, NULL, 1000);
+    if (rc != PICO_OK) {
+        printf("[MAP] ERRO ao gravar na flash! Codigo: %d\n", rc);
+        dirty = true;
+        return -1;
+    }
+    printf("[MAP] Mapa gravado (%u marcadores)\n", hdr.count);
+    return 0;
+}
+
+void tag_map_print(void) {
+    printf("[MAP] %lu marcadores, percurso %s", (unsigned long)count,
+           loop_mm ? "fechado de " : "em linha");
+    if (loop_mm) printf("%lu mm", (unsigned long)loop_mm);
+    printf("%s\n", dirty ? " (nao gravado)" : "");
+
+    for (uint32_t i = 0; i < count; i++) {
+        printf("[MAP]   ");
+        for (uint8_t b = 0; b < entries[i].uid_size; b++) {
+            printf("%02X", entries[i].uid[b]);
+        }
+        printf(" -> %lu mm\n", (unsigned long)entries[i].position_mm);
+    }
+}
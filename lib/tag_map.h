@@ -0,0 +1,101 @@
+/**
+ * tag_map.h
+ *
+ * Mapa de marcadores do trilho: UID da tag -> posição ao longo do percurso
+ * (mm). Com o leitor embarcado no AGV, cada marcador lido no piso vira uma
+ * posição absoluta (ver agv_tracker.h).
+ *
+ * O mapa fica num setor próprio da flash e pode ser substituído:
+ *  - pelo console serial ('map set', 'map del', 'map loop', 'map save');
+ *  - por MQTT, no tópico topic_map (mensagem retida), em texto:
+ *      loop=24000;A1B2C3D4=0;04AABBCC=1200;04DDEEFF=3400
+ *    'loop' é o comprimento de um percurso fechado (0 ou ausente = linha).
+ *
+ * Atualizações vindas do lwIP só marcam o mapa como alterado; a gravação na
+ * flash é feita por tag_map_persist(), chamada no loop principal.
+ */
+
+#ifndef TAG_MAP_H
+#define TAG_MAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "event_queue.h"
+
+#define TAG_MAP_CAPACITY    64
+
+typedef struct {
+    uint8_t uid[EVENT_UID_MAX];
+    uint8_t uid_size;
+    uint32_t position_mm;
+} tag_map_entry_t;
+
+/**
+ * @brief Carrega o mapa salvo na flash (chamar uma vez no boot).
+ * @return O número de marcadores carregados.
+ */
+uint32_t tag_map_load(void);
+
+/**
+ * @brief Procura a posição de um marcador.
+ * @return true se o UID está no mapa.
+ */
+bool tag_map_lookup(const uint8_t *uid, uint8_t uid_size, uint32_t *position_mm);
+
+/**
+ * @brief Próximo marcador a partir de uma posição, no sentido indicado
+ * (+1 = posições crescentes, -1 = decrescentes). Num percurso fechado a
+ * busca dá a volta.
+ * @return true se existe um marcador à frente.
+ */
+bool tag_map_next(uint32_t position_mm, int direction, uint32_t *next_mm);
+
+/**
+ * @brief Comprimento do percurso fechado em mm (0 = percurso em linha).
+ */
+uint32_t tag_map_loop_mm(void);
+
+uint32_t tag_map_count(void);
+
+/**
+ * @brief Inclui ou move um marcador.
+ * @return false se o mapa está cheio.
+ */
+bool tag_map_set(const uint8_t *uid, uint8_t uid_size, uint32_t position_mm);
+
+/**
+ * @brief Remove um marcador.
+ * @return false se o UID não está no mapa.
+ */
+bool tag_map_remove(const uint8_t *uid, uint8_t uid_size);
+
+void tag_map_set_loop(uint32_t loop_mm);
+void tag_map_clear(void);
+
+/**
+ * @brief Substitui o mapa inteiro a partir do texto (formato acima).
+ * Um texto inválido não altera o mapa atual.
+ * @return O número de marcadores, ou -1 se o texto é inválido.
+ */
+int tag_map_parse(const char *text, size_t len);
+
+/**
+ * @brief Converte um UID em texto hexadecimal ("A1B2C3D4").
+ * @return O número de bytes, ou 0 se inválido.
+ */
+uint8_t tag_map_parse_uid(const char *hex, size_t len, uint8_t *uid);
+
+/**
+ * @brief Grava o mapa na flash se mudou.
+ * @param force Grava mesmo sem mudança (comando 'map save').
+ * @return 0 se gravou ou não havia mudança, -1 em caso de falha.
+ */
+int tag_map_persist(bool force);
+
+/**
+ * @brief Imprime o mapa no serial (comando 'map').
+ */
+void tag_map_print(void);
+
+#endif // TAG_MAP_H
@@ -0,0 +1,328 @@
+#include "time_sync.h"
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "pico/critical_section.h"
+#include "lwip/udp.h"
+#include "lwip/pbuf.h"
+#include "rfid_config.h"
+
+#define NTP_PORT                123
+#define NTP_PACKET_SIZE         48
+#define NTP_UNIX_OFFSET_S       2208988800ull   // 1900 -> 1970
+
+#define EXCHANGE_SPACING_MS     100     // Entre trocas de uma rodada
+#define EXCHANGE_TIMEOUT_MS     500
+#define INTERVAL_FAST_MS        16000   // Primeiras rodadas (estima a deriva)
+#define INTERVAL_SLOW_MS        64000
+#define FAST_ROUNDS             4
+#define MAX_DELAY_US            50000   // Trocas mais lentas são descartadas
+#define MAX_DRIFT_PPB           500000  // Além disso o servidor mudou de hora
+#define DRIFT_MIN_SPAN_US       10000000ll      // Intervalo mínimo para medir deriva
+#define DRIFT_WINDOW_US         1024000000ll    // Âncora renovada a cada ~17 min
+#define DELAY_SLACK_US          500
+
+static struct udp_pcb *pcb = NULL;
+static ip_addr_t server_ip;
+static bool enabled = false;
+
+// Relógio sincronizado: unix_us = local + ref_offset + deriva * (local - ref_local)
+static critical_section_t clock_lock;
+static uint64_t ref_local_us;
+static int64_t ref_offset_us;
+static time_sync_stats_t stats;
+
+// Estimativa da deriva e filtro de atraso
+static uint64_t anchor_local_us;
+static int64_t anchor_offset_us;
+static bool drift_settled = false;
+static uint32_t floor_delay_us;
+
+// Rodada em andamento
+static bool in_round = false;
+static bool waiting = false;
+static uint8_t exchanges;
+static uint64_t t1_local;
+static absolute_time_t next_action;
+static bool best_valid;
+static uint32_t best_delay;
+static int64_t best_offset;
+static uint64_t best_local;
+
+// Resposta entregue pelo callback do lwIP
+static volatile bool reply_ready = false;
+static int64_t reply_offset;
+static uint32_t reply_delay;
+static uint64_t reply_local;
+
+// --- Formato NTP ---
+
+static uint64_t get64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) v = (v << 8) | p[i];
+    return v;
+}
+
+static void put64(uint8_t *p, uint64_t v) {
+    for (int i = 7; i >= 0; i--) {
+        p[i] = v & 0xFF;
+        v >>= 8;
+    }
+}
+
+// Timestamp NTP (segundos desde 1900 . fração 2^-32) -> µs desde 1970
+static uint64_t ntp_to_unix_us(const uint8_t *p) {
+    uint64_t ts = get64(p);
+    uint64_t sec = (ts >> 32) - NTP_UNIX_OFFSET_S;
+    uint64_t frac_us = ((ts & 0xFFFFFFFFull) * 1000000) >> 32;
+    return sec * 1000000 + frac_us;
+}
+
+static int64_t predict_offset(uint64_t local_us) {
+    int64_t dt = (int64_t)(local_us - ref_local_us);
+    return ref_offset_us + dt * stats.drift_ppb / 1000000000;
+}
+
+// --- Rede ---
+
+static void ntp_recv_cb(void *arg, struct udp_pcb *upcb, struct pbuf *p,
+                        const ip_addr_t *addr, u16_t port) {
+    uint64_t t4 = time_us_64();
+    uint8_t pkt[NTP_PACKET_SIZE];
+    uint16_t n = pbuf_copy_partial(p, pkt, sizeof(pkt), 0);
+    pbuf_free(p);
+
+    // Modo 4 (servidor), estrato válido e resposta à troca em curso
+    if (n < NTP_PACKET_SIZE || (pkt[0] & 0x07) != 4 || pkt[1] == 0 || pkt[1] > 15 ||
+        !waiting || get64(pkt + 24) != t1_local) {
+        return;
+    }
+
+    uint64_t t2 = ntp_to_unix_us(pkt + 32);
+    uint64_t t3 = ntp_to_unix_us(pkt + 40);
+    int64_t delay = (int64_t)(t4 - t1_local) - (int64_t)(t3 - t2);
+
+    reply_offset = ((int64_t)(t2 - t1_local) + (int64_t)(t3 - t4)) / 2;
+    reply_delay = delay > 0 ? (uint32_t)delay : 0;
+    reply_local = t1_local + (t4 - t1_local) / 2;
+    reply_ready = true;
+}
+
+static void send_request(void) {
+    uint8_t pkt[NTP_PACKET_SIZE] = {0};
+    pkt[0] = 0x23;      // LI 0, versão 4, modo 3 (cliente)
+
+    // O servidor devolve o transmit timestamp no campo originate: usamos o
+    // relógio local bruto para casar a resposta e medir t1 exato
+    t1_local = time_us_64();
+    put64(pkt + 40, t1_local);
+
+    cyw43_arch_lwip_begin();
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, NTP_PACKET_SIZE, PBUF_RAM);
+    if (p != NULL) {
+        memcpy(p->payload, pkt, NTP_PACKET_SIZE);
+        udp_sendto(pcb, p, &server_ip, NTP_PORT);
+        pbuf_free(p);
+    }
+    cyw43_arch_lwip_end();
+}
+
+// --- Rodadas ---
+
+static void finish_round(void) {
+    if (!best_valid) {
+        printf("[TIME] Servidor de hora sem resposta\n");
+        return;
+    }
+
+    // Rodada em que até a melhor troca pegou fila: o offset dela pode errar
+    // em até metade do atraso, pior que a previsão pela deriva. Mantém o
+    // relógio atual (o piso sobe devagar se a rede mudou de fato)
+    if (stats.synced && best_delay > floor_delay_us + floor_delay_us / 2 + DELAY_SLACK_US) {
+        floor_delay_us += (best_delay - floor_delay_us) / 16;
+        stats.rejected++;
+        return;
+    }
+    if (!stats.synced || best_delay < floor_delay_us) {
+        floor_delay_us = best_delay;
+    }
+
+    critical_section_enter_blocking(&clock_lock);
+    if (stats.synced) {
+        stats.residual_us = (int32_t)(predict_offset(best_local) - best_offset);
+
+        // Deriva pela inclinação do offset desde a âncora: quanto maior o
+        // intervalo, menor o peso do ruído de cada rodada
+        int64_t span = (int64_t)(best_local - anchor_local_us);
+        if (span >= DRIFT_MIN_SPAN_US) {
+            int64_t measured = (best_offset - anchor_offset_us) * 1000000000 / span;
+            if (measured > -MAX_DRIFT_PPB && measured < MAX_DRIFT_PPB) {
+                if (!drift_settled) {
+                    stats.drift_ppb = (int32_t)measured;
+                } else {
+                    int64_t weight = span < DRIFT_WINDOW_US ? span : DRIFT_WINDOW_US;
+                    stats.drift_ppb += (int32_t)((measured - stats.drift_ppb) * weight /
+                                                 DRIFT_WINDOW_US);
+                }
+                if (span >= DRIFT_WINDOW_US) {
+                    anchor_local_us = best_local;
+                    anchor_offset_us = best_offset;
+                    drift_settled = true;
+                }
+            } else {
+                // Servidor mudou de hora: recomeça a estimativa
+                printf("[TIME] AVISO: salto de %lld us no servidor\n",
+                       (long long)(best_offset - predict_offset(best_local)));
+                anchor_local_us = best_local;
+                anchor_offset_us = best_offset;
+                drift_settled = false;
+            }
+        }
+    } else {
+        anchor_local_us = best_local;
+        anchor_offset_us = best_offset;
+    }
+    ref_local_us = best_local;
+    ref_offset_us = best_offset;
+    stats.delay_us = best_delay;
+    stats.error_us = best_delay / 2 + (uint32_t)(stats.residual_us < 0 ? -stats.residual_us
+                                                                     : stats.residual_us);
+    stats.rounds++;
+    stats.synced = true;
+    critical_section_exit(&clock_lock);
+}
+
+void time_sync_init(void) {
+    const rfid_config_t *cfg = rfid_config();
+
+    critical_section_init(&clock_lock);
+    if (cfg->time_server[0] == '\0') {
+        printf("[TIME] Sincronizacao desligada (time_server vazio)\n");
+        return;
+    }
+    if (!ip4addr_aton(cfg->time_server, &server_ip)) {
+        printf("[TIME] ERRO: IP do servidor de hora invalido: %s\n", cfg->time_server);
+        return;
+    }
+
+    cyw43_arch_lwip_begin();
+    pcb = udp_new();
+    if (pcb != NULL) {
+        udp_bind(pcb, IP_ADDR_ANY, 0);
+        udp_recv(pcb, ntp_recv_cb, NULL);
+    }
+    cyw43_arch_lwip_end();
+
+    if (pcb == NULL) {
+        printf("[TIME] ERRO: Falha ao criar socket UDP!\n");
+        return;
+    }
+    enabled = true;
+    next_action = get_absolute_time();
+}
+
+void time_sync_service(bool wifi_up) {
+    if (!enabled) return;
+
+    if (reply_ready) {
+        reply_ready = false;
+        waiting = false;
+        if (reply_delay <= MAX_DELAY_US && (!best_valid || reply_delay < best_delay)) {
+            best_valid = true;
+            best_delay = reply_delay;
+            best_offset = reply_offset;
+            best_local = reply_local;
+        }
+        next_action = make_timeout_time_ms(EXCHANGE_SPACING_MS);
+    }
+
+    if (!wifi_up) {
+        // Rodada interrompida recomeça quando o link voltar
+        in_round = false;
+        waiting = false;
+        return;
+    }
+    if (!time_reached(next_action)) return;
+
+    if (waiting) {
+        waiting = false;
+        stats.timeouts++;
+    }
+
+    if (in_round && exchanges == TIME_SYNC_BURST) {
+        in_round = false;
+        finish_round();
+        next_action = make_timeout_time_ms(stats.rounds < FAST_ROUNDS ? INTERVAL_FAST_MS
+                                                                      : INTERVAL_SLOW_MS);
+        return;
+    }
+    if (!in_round) {
+        in_round = true;
+        exchanges = 0;
+        best_valid = false;
+    }
+
+    exchanges++;
+    waiting = true;
+    next_action = make_timeout_time_ms(EXCHANGE_TIMEOUT_MS);
+    send_request();
+}
+
+bool time_sync_is_synced(void) {
+    return stats.synced;
+}
+
+bool time_sync_to_unix_us(uint64_t local_us, uint64_t *unix_us) {
+    if (!stats.synced) return false;
+    critical_section_enter_blocking(&clock_lock);
+    *unix_us = local_us + predict_offset(local_us);
+    critical_section_exit(&clock_lock);
+    return true;
+}
+
+bool time_sync_event_unix_us(const rfid_event_t *ev, uint64_t *unix_us) {
+    if (ev->flags & EVENT_FLAG_RESTORED) return false;
+
+    // detect_us são os 32 bits baixos de time_us_64() na leitura; os altos
+    // vêm de timestamp_ms, capturado no mesmo instante
+    uint64_t base = (uint64_t)ev->timestamp_ms * 1000;
+    uint64_t local = (base & ~0xFFFFFFFFull) | ev->detect_us;
+    if (local > base + 0x80000000ull) {
+        local -= 0x100000000ull;
+    } else if (local + 0x80000000ull < base) {
+        local += 0x100000000ull;
+    }
+    return time_sync_to_unix_us(local, unix_us);
+}
+
+void time_sync_get_stats(time_sync_stats_t *out) {
+    *out = stats;
+}
+
+int time_sync_format_json(char *buf, size_t len) {
+    return snprintf(buf, len, "\"time\":{\"synced\":%s,\"err_us\":%lu,\"drift_ppb\":%ld}",
+                    stats.synced ? "true" : "false", (unsigned long)stats.error_us,
+                    (long)stats.drift_ppb);
+}
+
+void time_sync_print(void) {
+    if (!enabled) {
+        printf("[TIME] Sincronizacao desligada\n");
+        return;
+    }
+    printf("[TIME] Servidor %s: %s, %lu rodadas (%lu descartadas), %lu trocas sem resposta\n",
+           rfid_config()->time_server, stats.synced ? "sincronizado" : "aguardando",
+           (unsigned long)stats.rounds, (unsigned long)stats.rejected,
+           (unsigned long)stats.timeouts);
+    if (!stats.synced) return;
+
+    uint64_t now;
+    time_sync_to_unix_us(time_us_64(), &now);
+    printf("[TIME] Atraso da melhor troca: %lu us, erro estimado: %lu us\n",
+           (unsigned long)stats.delay_us, (unsigned long)stats.error_us);
+    printf("[TIME] Deriva: %ld ppb, erro de previsao na ultima rodada: %ld us\n",
+           (long)stats.drift_ppb, (long)stats.residual_us);
+    printf("[TIME] Agora: %llu.%06llu (Unix)\n",
+           (unsigned long long)(now / 1000000), (unsigned long long)(now % 1000000));
+}
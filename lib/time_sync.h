@@ -0,0 +1,88 @@
+/**
+ * time_sync.h
+ *
+ * Relógio comum entre leitores: to_ms_since_boot() de leitores diferentes
+ * não é comparável, então velocidades medidas entre dois leitores do
+ * trilho precisam de uma base de tempo única.
+ *
+ * Troca de mão dupla no formato NTP (RFC 5905, modo cliente) por UDP com o
+ * servidor de 'time_server' (chrony/ntpd no computador do broker):
+ *
+ *   t1 envio (local) -> t2 recepção (servidor) -> t3 resposta -> t4 (local)
+ *   offset = ((t2 - t1) + (t3 - t4)) / 2     atraso = (t4 - t1) - (t3 - t2)
+ *
+ * A cada rodada são feitas TIME_SYNC_BURST trocas e vale a de menor atraso
+ * (menos fila no WiFi); rodadas em que todas as trocas pegaram fila são
+ * descartadas. A deriva do cristal é estimada pela inclinação do offset ao
+ * longo de vários minutos e compensada, de modo que o relógio se mantém
+ * entre as rodadas. O erro informado é metade do atraso da melhor troca (limite
+ * de assimetria do caminho) mais o erro de previsão da última rodada.
+ */
+
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "event_queue.h"
+
+#define TIME_SYNC_BURST     4       // Trocas por rodada
+
+typedef struct {
+    bool synced;
+    uint32_t rounds;            // Rodadas aceitas
+    uint32_t rejected;          // Rodadas descartadas (atraso muito acima do normal)
+    uint32_t timeouts;          // Trocas sem resposta
+    uint32_t delay_us;          // Atraso da melhor troca da última rodada
+    uint32_t error_us;          // Erro estimado do relógio sincronizado
+    int32_t residual_us;        // Previsto - medido na última rodada
+    int32_t drift_ppb;          // Deriva do cristal local (partes por bilhão)
+} time_sync_stats_t;
+
+/**
+ * @brief Abre o socket UDP (chamar depois de iniciar o cyw43). Sem
+ * time_server configurado, a sincronização fica desligada.
+ */
+void time_sync_init(void);
+
+/**
+ * @brief Rodadas de troca (a cada 16 s até estabilizar, depois 64 s).
+ * Chamar no loop principal ou na tarefa de manutenção.
+ */
+void time_sync_service(bool wifi_up);
+
+/**
+ * @brief Indica se já houve ao menos uma rodada aceita.
+ */
+bool time_sync_is_synced(void);
+
+/**
+ * @brief Converte um instante local (time_us_64) para o tempo do servidor,
+ * em µs desde 1970 (Unix).
+ * @return false se ainda não sincronizado.
+ */
+bool time_sync_to_unix_us(uint64_t local_us, uint64_t *unix_us);
+
+/**
+ * @brief Instante sincronizado de uma leitura (a partir de timestamp_ms e
+ * detect_us, com resolução de µs).
+ * @return false se não sincronizado ou se o evento veio de um boot anterior.
+ */
+bool time_sync_event_unix_us(const rfid_event_t *ev, uint64_t *unix_us);
+
+void time_sync_get_stats(time_sync_stats_t *stats);
+
+/**
+ * @brief Escreve o estado como campo JSON (sem chaves externas).
+ * Ex: "time":{"synced":true,"err_us":640,"drift_ppb":-12400}
+ * @return O número de caracteres escritos (como snprintf).
+ */
+int time_sync_format_json(char *buf, size_t len);
+
+/**
+ * @brief Imprime o estado no serial (comando 'time').
+ */
+void time_sync_print(void);
+
+#endif // TIME_SYNC_H
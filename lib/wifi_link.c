@@ -0,0 +1,350 @@
+#include "wifi_link.h"
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "rfid_config.h"
+#include "reconnect_sched.h"
+
+// Verificação do link e amostragem de RSSI
+#define LINK_CHECK_MS           500
+#define RSSI_SAMPLE_MS          2000
+
+// Reconexão: primeira tentativa imediata (no último AP), depois backoff
+#define CONNECT_TIMEOUT_MS      15000
+#define BACKOFF_MIN_MS          500
+#define BACKOFF_MAX_MS          8000
+#define BACKOFF_MAX_SHIFT       5
+
+// Roaming: amostras fracas seguidas, ganho mínimo e intervalo entre varreduras
+#define ROAM_WEAK_SAMPLES       3
+#define ROAM_HYSTERESIS_DB      8
+#define ROAM_SCAN_INTERVAL_MS   30000
+
+static wifi_link_stats_t stats;
+
+static reconnect_sched_t retry;        // Falhas seguidas e próxima tentativa
+static absolute_time_t attempt_deadline;
+static uint64_t down_since_us;          // Início da queda (ou do boot)
+static absolute_time_t last_check;
+static absolute_time_t last_rssi_sample;
+static absolute_time_t last_scan;
+static bool ever_up = false;
+static bool have_bssid = false;
+static bool roaming = false;            // Tentativa atual é uma troca de AP
+static bool scanning = false;
+static uint8_t weak_samples = 0;
+
+// Eventos dos callbacks da netif (contexto do lwIP), com o instante exato
+static volatile bool link_lost = false;
+static volatile uint64_t link_lost_at_us = 0;
+static volatile uint64_t ip_up_at_us = 0;
+
+// Melhor AP do mesmo SSID encontrado na varredura (escrito pelo cyw43)
+static volatile bool candidate_valid = false;
+static uint8_t candidate_bssid[6];
+static int16_t candidate_rssi;
+
+static const char *const pm_names[WIFI_PM_COUNT] = {
+    "none", "performance", "default", "aggressive"
+};
+
+static uint32_t pm_value(wifi_power_mode_t mode) {
+    switch (mode) {
+        case WIFI_PM_NONE:        return CYW43_NONE_PM;
+        case WIFI_PM_PERFORMANCE: return CYW43_PERFORMANCE_PM;
+        case WIFI_PM_AGGRESSIVE:  return CYW43_AGGRESSIVE_PM;
+        default:                  return CYW43_DEFAULT_PM;
+    }
+}
+
+static uint32_t elapsed_ms(absolute_time_t since) {
+    return (uint32_t)(absolute_time_diff_us(since, get_absolute_time()) / 1000);
+}
+
+/**
+ * Callback de link da netif: o cyw43 derruba o link ao perder a associação
+ */
+static void netif_link_cb(struct netif *netif) {
+    if (!netif_is_link_up(netif) && stats.state == WIFI_STATE_UP) {
+        link_lost_at_us = time_us_64();
+        link_lost = true;
+    }
+}
+
+/**
+ * Callback de status da netif: registra quando o DHCP entrega o IP
+ */
+static void netif_status_cb(struct netif *netif) {
+    if (netif_is_up(netif) && !ip4_addr_isany_val(*netif_ip4_addr(netif))) {
+        ip_up_at_us = time_us_64();
+    }
+}
+
+/**
+ * Inicia uma associação; com bssid != NULL, direto naquele AP
+ */
+static void start_attempt(const uint8_t *bssid) {
+    const rfid_config_t *cfg = rfid_config();
+    int rc;
+
+    if (bssid != NULL) {
+        rc = cyw43_arch_wifi_connect_bssid_async(cfg->wifi_ssid, bssid, cfg->wifi_password,
+                                                 CYW43_AUTH_WPA2_AES_PSK);
+    } else {
+        rc = cyw43_arch_wifi_connect_async(cfg->wifi_ssid, cfg->wifi_password,
+                                           CYW43_AUTH_WPA2_AES_PSK);
+    }
+
+    if (rc != 0) {
+        printf("[WiFi] ERRO ao iniciar conexao! Codigo: %d\n", rc);
+        attempt_deadline = get_absolute_time();  // Falha na próxima verificação
+    } else {
+        attempt_deadline = make_timeout_time_ms(CONNECT_TIMEOUT_MS);
+    }
+    link_lost = false;  // Queda causada pela própria troca de AP
+    stats.state = WIFI_STATE_CONNECTING;
+}
+
+/**
+ * Agenda a próxima tentativa com backoff exponencial
+ */
+static void schedule_retry(void) {
+    reconnect_sched_failed(&retry, to_ms_since_boot(get_absolute_time()));
+    roaming = false;
+    stats.state = WIFI_STATE_WAIT;
+}
+
+static void on_link_up(void) {
+    // Instante do IP pelo callback da netif (o serviço pode rodar depois)
+    uint64_t up_at = ip_up_at_us > down_since_us ? ip_up_at_us : time_us_64();
+    uint32_t outage = (uint32_t)((up_at - down_since_us) / 1000);
+    stats.up_at_us = up_at;
+    link_lost = false;
+
+    if (!ever_up) {
+        ever_up = true;
+        stats.connect_ms = outage;
+        printf("[WiFi] Conectado em %lu ms! IP: %s\n", (unsigned long)outage,
+               ip4addr_ntoa(netif_ip4_addr(netif_list)));
+    } else {
+        if (roaming) {
+            stats.roams++;
+            printf("[WiFi] Roaming concluido em %lu ms\n", (unsigned long)outage);
+        } else {
+            stats.reconnects++;
+            printf("[WiFi] Reconectado em %lu ms (tentativas: %lu)\n",
+                   (unsigned long)outage, (unsigned long)retry.failures + 1);
+        }
+        stats.outage_last_ms = outage;
+        if (outage > stats.outage_max_ms) stats.outage_max_ms = outage;
+    }
+
+    have_bssid = cyw43_wifi_get_bssid(&cyw43_state, stats.bssid) == 0;
+    stats.state = WIFI_STATE_UP;
+    reconnect_sched_reset(&retry);
+    roaming = false;
+    weak_samples = 0;
+    last_check = get_absolute_time();
+    last_rssi_sample = get_absolute_time();
+}
+
+static void on_link_down(uint64_t at_us) {
+    printf("[WiFi] AVISO: link perdido, reconectando...\n");
+    down_since_us = at_us;
+    stats.rssi = 0;
+    scanning = false;
+    reconnect_sched_reset(&retry);  // Primeira tentativa imediata
+    stats.state = WIFI_STATE_WAIT;
+}
+
+/**
+ * Resultado da varredura: guarda o AP mais forte do mesmo SSID
+ */
+static int scan_result_cb(void *env, const cyw43_ev_scan_result_t *result) {
+    const char *ssid = rfid_config()->wifi_ssid;
+    size_t ssid_len = strlen(ssid);
+
+    if (result->ssid_len != ssid_len || memcmp(result->ssid, ssid, ssid_len) != 0) return 0;
+    if (have_bssid && memcmp(result->bssid, stats.bssid, 6) == 0) return 0;
+
+    if (!candidate_valid || result->rssi > candidate_rssi) {
+        memcpy(candidate_bssid, result->bssid, 6);
+        candidate_rssi = result->rssi;
+        candidate_valid = true;
+    }
+    return 0;
+}
+
+/**
+ * Amostra o RSSI e, com sinal fraco persistente, procura um AP melhor
+ */
+static void check_roaming(void) {
+    const rfid_config_t *cfg = rfid_config();
+
+    if (scanning) {
+        if (cyw43_wifi_scan_active(&cyw43_state)) return;
+        scanning = false;
+
+        if (candidate_valid && candidate_rssi >= stats.rssi + ROAM_HYSTERESIS_DB) {
+            printf("[WiFi] Roaming: %ld dBm -> %02X:%02X:%02X:%02X:%02X:%02X (%d dBm)\n",
+                   (long)stats.rssi, candidate_bssid[0], candidate_bssid[1],
+                   candidate_bssid[2], candidate_bssid[3], candidate_bssid[4],
+                   candidate_bssid[5], candidate_rssi);
+            roaming = true;
+            down_since_us = time_us_64();
+            cyw43_wifi_leave(&cyw43_state, CYW43_ITF_STA);
+            start_attempt(candidate_bssid);
+        }
+        return;
+    }
+
+    if (absolute_time_diff_us(last_rssi_sample, get_absolute_time()) < RSSI_SAMPLE_MS * 1000) return;
+    last_rssi_sample = get_absolute_time();
+
+    int32_t rssi;
+    if (cyw43_wifi_get_rssi(&cyw43_state, &rssi) != 0) return;
+    stats.rssi = rssi;
+    if (stats.rssi_min == 0 || rssi < stats.rssi_min) stats.rssi_min = rssi;
+
+    if (cfg->wifi_roam_rssi == 0 || rssi >= -(int32_t)cfg->wifi_roam_rssi) {
+        weak_samples = 0;
+        return;
+    }
+    if (++weak_samples < ROAM_WEAK_SAMPLES) return;
+    if (stats.scans > 0 && elapsed_ms(last_scan) < ROAM_SCAN_INTERVAL_MS) return;
+
+    cyw43_wifi_scan_options_t opts = {0};
+    candidate_valid = false;
+    if (cyw43_wifi_scan(&cyw43_state, &opts, NULL, scan_result_cb) == 0) {
+        scanning = true;
+        stats.scans++;
+        last_scan = get_absolute_time();
+        printf("[WiFi] Sinal fraco (%ld dBm), procurando outro AP...\n", (long)rssi);
+    }
+}
+
+int wifi_link_init(void) {
+    const rfid_config_t *cfg = rfid_config();
+
+    memset(&stats, 0, sizeof(stats));
+    stats.state = WIFI_STATE_OFF;
+    down_since_us = time_us_64();
+
+    if (cyw43_arch_init()) {
+        printf("[WiFi] ERRO: Falha ao inicializar CYW43!\n");
+        return -1;
+    }
+    cyw43_arch_enable_sta_mode();
+
+    // A netif da estação é (re)criada por enable_sta_mode: registrar depois
+    cyw43_arch_lwip_begin();
+    netif_set_link_callback(&cyw43_state.netif[CYW43_ITF_STA], netif_link_cb);
+    netif_set_status_callback(&cyw43_state.netif[CYW43_ITF_STA], netif_status_cb);
+    cyw43_arch_lwip_end();
+
+    wifi_power_mode_t pm = cfg->wifi_power_mode < WIFI_PM_COUNT ?
+                           (wifi_power_mode_t)cfg->wifi_power_mode : WIFI_PM_DEFAULT;
+    cyw43_wifi_pm(&cyw43_state, pm_value(pm));
+
+    printf("[WiFi] Conectando a: %s (power save: %s)\n", cfg->wifi_ssid,
+           wifi_link_power_mode_name(pm));
+
+    reconnect_sched_init(&retry, BACKOFF_MIN_MS, BACKOFF_MAX_SHIFT, BACKOFF_MAX_MS,
+                         to_ms_since_boot(get_absolute_time()));
+    reconnect_sched_reset(&retry);
+    stats.state = WIFI_STATE_WAIT;
+    return 0;
+}
+
+void wifi_link_service(void) {
+    switch (stats.state) {
+        case WIFI_STATE_OFF:
+            return;
+
+        case WIFI_STATE_WAIT:
+            if (!reconnect_sched_due(&retry, to_ms_since_boot(get_absolute_time()))) return;
+            // Reassociação rápida: a primeira tentativa vai direto ao último AP
+            start_attempt(retry.failures == 0 && have_bssid ? stats.bssid : NULL);
+            return;
+
+        case WIFI_STATE_CONNECTING: {
+            int status = cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA);
+            if (status == CYW43_LINK_UP) {
+                on_link_up();
+            } else if (status < 0 || time_reached(attempt_deadline)) {
+                printf("[WiFi] Tentativa %lu falhou (status %d)\n",
+                       (unsigned long)retry.failures + 1, status);
+                if (status == CYW43_LINK_BADAUTH) {
+                    printf("[WiFi] Senha recusada: use 'cfg set wifi_password ...'\n");
+                }
+                cyw43_wifi_leave(&cyw43_state, CYW43_ITF_STA);
+                schedule_retry();
+            }
+            return;
+        }
+
+        case WIFI_STATE_UP:
+            // Queda avisada pelo callback: reage sem esperar a verificação
+            if (link_lost) {
+                link_lost = false;
+                on_link_down(link_lost_at_us);
+                return;
+            }
+            if (absolute_time_diff_us(last_check, get_absolute_time()) >= LINK_CHECK_MS * 1000) {
+                last_check = get_absolute_time();
+                if (!scanning &&
+                    cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA) != CYW43_LINK_UP) {
+                    on_link_down(time_us_64());
+                    return;
+                }
+            }
+            check_roaming();
+            return;
+    }
+}
+
+bool wifi_link_is_up(void) {
+    return stats.state == WIFI_STATE_UP;
+}
+
+void wifi_link_get_stats(wifi_link_stats_t *out) {
+    *out = stats;
+}
+
+const char *wifi_link_power_mode_name(wifi_power_mode_t mode) {
+    return mode < WIFI_PM_COUNT ? pm_names[mode] : "?";
+}
+
+int wifi_link_format_json(char *buf, size_t len) {
+    return snprintf(buf, len,
+                    "\"wifi\":{\"rssi\":%ld,\"pm\":\"%s\",\"connect_ms\":%lu,\"reconn\":%lu,"
+                    "\"outage_ms\":%lu,\"outage_max_ms\":%lu,\"roams\":%lu}",
+                    (long)stats.rssi,
+                    wifi_link_power_mode_name((wifi_power_mode_t)rfid_config()->wifi_power_mode),
+                    (unsigned long)stats.connect_ms, (unsigned long)stats.reconnects,
+                    (unsigned long)stats.outage_last_ms, (unsigned long)stats.outage_max_ms,
+                    (unsigned long)stats.roams);
+}
+
+void wifi_link_print(void) {
+    static const char *const state_names[] = { "off", "aguardando", "conectando", "ativo" };
+    const rfid_config_t *cfg = rfid_config();
+
+    printf("[WiFi] Estado: %s, power save: %s\n", state_names[stats.state],
+           wifi_link_power_mode_name((wifi_power_mode_t)cfg->wifi_power_mode));
+    printf("[WiFi] AP: %02X:%02X:%02X:%02X:%02X:%02X  RSSI: %ld dBm (pior: %ld)\n",
+           stats.bssid[0], stats.bssid[1], stats.bssid[2],
+           stats.bssid[3], stats.bssid[4], stats.bssid[5],
+           (long)stats.rssi, (long)stats.rssi_min);
+    printf("[WiFi] Primeira conexao: %lu ms\n", (unsigned long)stats.connect_ms);
+    printf("[WiFi] Reconexoes: %lu  queda: ultima %lu ms, maxima %lu ms\n",
+           (unsigned long)stats.reconnects, (unsigned long)stats.outage_last_ms,
+           (unsigned long)stats.outage_max_ms);
+    if (cfg->wifi_roam_rssi) {
+        printf("[WiFi] Roaming abaixo de -%u dBm: %lu trocas, %lu varreduras\n",
+               cfg->wifi_roam_rssi, (unsigned long)stats.roams, (unsigned long)stats.scans);
+    } else {
+        printf("[WiFi] Roaming desligado\n");
+    }
+}
@@ -0,0 +1,100 @@
+/**
+ * wifi_link.h
+ *
+ * Enlace WiFi do leitor: modo de economia de energia, monitoramento do
+ * link com reassociação rápida e roaming entre APs pela força do sinal.
+ *
+ * O power save padrão do cyw43 desliga o rádio entre beacons e atrasa
+ * publicações em dezenas a centenas de ms; por isso o padrão aqui é sem
+ * power save (wifi_power_mode=0). O AGV percorre áreas cobertas por vários
+ * APs com o mesmo SSID: abaixo de wifi_roam_rssi o módulo faz uma varredura
+ * e troca para o AP mais forte (com histerese), sem esperar o link cair.
+ *
+ * Quedas e a chegada do IP são avisadas pelos callbacks de link e status
+ * da netif (LWIP_NETIF_LINK_CALLBACK/STATUS_CALLBACK), com o instante exato;
+ * uma verificação a cada 500 ms cobre o caso de o aviso não chegar.
+ *
+ * Tudo roda em wifi_link_service(), chamado no loop principal (ou numa
+ * tarefa); nenhuma função bloqueia.
+ */
+
+#ifndef WIFI_LINK_H
+#define WIFI_LINK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Modos de economia de energia (campo wifi_power_mode da configuração)
+typedef enum {
+    WIFI_PM_NONE,           // Rádio sempre ligado: menor latência
+    WIFI_PM_PERFORMANCE,    // PM2 com retorno rápido ao sono (~20 ms)
+    WIFI_PM_DEFAULT,        // Padrão do cyw43
+    WIFI_PM_AGGRESSIVE,     // PM1: menor consumo, maior latência
+    WIFI_PM_COUNT
+} wifi_power_mode_t;
+
+// Estado do enlace
+typedef enum {
+    WIFI_STATE_OFF,         // wifi_link_init() ainda não chamado ou falhou
+    WIFI_STATE_WAIT,        // Aguardando o backoff para nova tentativa
+    WIFI_STATE_CONNECTING,  // Associação/DHCP em andamento
+    WIFI_STATE_UP           // Conectado com IP
+} wifi_state_t;
+
+// Telemetria do enlace
+typedef struct {
+    wifi_state_t state;
+    int32_t rssi;               // Último RSSI (dBm), 0 se desconectado
+    int32_t rssi_min;           // Pior RSSI com o link ativo
+    uint8_t bssid[6];           // AP atual
+    uint32_t connect_ms;        // Tempo até o primeiro link
+    uint64_t up_at_us;          // Instante (time_us_64) do último link com IP
+    uint32_t reconnects;        // Reconexões após queda
+    uint32_t outage_last_ms;    // Duração da última queda (até ter IP de novo)
+    uint32_t outage_max_ms;
+    uint32_t roams;             // Trocas de AP por sinal fraco
+    uint32_t scans;
+} wifi_link_stats_t;
+
+/**
+ * @brief Inicializa o cyw43 em modo estação, aplica o modo de energia da
+ * configuração e inicia a primeira conexão (assíncrona).
+ * @return 0 em caso de sucesso, -1 se o cyw43 não iniciou.
+ */
+int wifi_link_init(void);
+
+/**
+ * @brief Máquina de estados do enlace: detecta queda, reconecta com
+ * backoff (primeiro no último AP), amostra RSSI e decide o roaming.
+ */
+void wifi_link_service(void);
+
+/**
+ * @brief Indica se o enlace está ativo (associado e com IP).
+ */
+bool wifi_link_is_up(void);
+
+/**
+ * @brief Copia a telemetria atual.
+ */
+void wifi_link_get_stats(wifi_link_stats_t *stats);
+
+/**
+ * @brief Nome curto de um modo de energia (ex: "none", "aggressive").
+ */
+const char *wifi_link_power_mode_name(wifi_power_mode_t mode);
+
+/**
+ * @brief Escreve a telemetria como campo JSON (sem chaves externas).
+ * Ex: "wifi":{"rssi":-61,"pm":"none","reconn":2,...}
+ * @return O número de caracteres escritos (como snprintf).
+ */
+int wifi_link_format_json(char *buf, size_t len);
+
+/**
+ * @brief Imprime a telemetria no serial (comando 'wifi').
+ */
+void wifi_link_print(void);
+
+#endif // WIFI_LINK_H
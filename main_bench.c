@@ -0,0 +1,369 @@
+// =====================================================
+// Microbenchmarks na placa (alvo RFID_BENCH)
+//
+// Mede no RP2040, com o SysTick (ciclos) e o timer (us), o custo de cada
+// etapa do caminho leitura -> publicação: acesso a registradores, rajadas
+// de FIFO em cada velocidade de SPI, CRC_A (coprocessador vs. software),
+// REQA com o campo vazio, SELECT completo, MIFARE_Read, montagem do JSON
+// e o enfileiramento no mqtt_publish. A tabela final serve para conferir
+// os números do simulador de benchmarks/ contra o chip real.
+//
+// Usa a configuração gravada na flash (pinos, barramento, WiFi, broker),
+// a mesma do RFID_MQTT. Publica apenas em <topic_rfid>/bench.
+// 'r' no serial repete as medidas.
+// =====================================================
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "hardware/spi.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+#include "mfrc522.h"
+#include "mfrc522_bench.h"
+#include "cycle_counter.h"
+#include "rfid_config.h"
+#include "event_queue.h"
+#include "event_json.h"
+#include "link_supervisor.h"
+
+#define REG_ITERATIONS      1000
+#define SPEED_ITERATIONS    200
+#define CRC_ITERATIONS      1000
+#define RF_ITERATIONS       50
+#define ENCODE_ITERATIONS   1000
+#define PUBLISH_ITERATIONS  50
+
+#define CARD_WAIT_MS        20000
+#define NET_WAIT_MS         30000
+#define MAX_ROWS            24
+
+typedef struct {
+    char name[32];
+    uint32_t cycles;
+    uint32_t us_x10;    // Décimos de us
+    uint32_t n;         // Repetições (0: não medido)
+} bench_row_t;
+
+static MFRC522Ptr_t mfrc = NULL;
+static const rfid_config_t *cfg = NULL;
+static bool net_ready = false;
+static uint32_t mhz = 0;
+
+static bench_row_t rows[MAX_ROWS];
+static int row_count = 0;
+
+static void add_row(const char *name, uint32_t cycles, uint32_t us_x10, uint32_t n) {
+    if (row_count == MAX_ROWS) return;
+    bench_row_t *row = &rows[row_count++];
+    snprintf(row->name, sizeof(row->name), "%s", name);
+    row->cycles = cycles;
+    row->us_x10 = us_x10;
+    row->n = n;
+}
+
+// Operações só de CPU/SPI: o tempo sai dos ciclos
+static void add_cycles_row(const char *name, uint32_t cycles, uint32_t n) {
+    add_row(name, cycles, (uint32_t)((uint64_t)cycles * 10 / mhz), n);
+}
+
+static void net_poll(void) {
+    if (net_ready) {
+        cyw43_arch_poll();
+    }
+    link_supervisor_service();
+}
+
+// Espera mantendo a rede viva
+static void wait_ms(uint32_t ms) {
+    absolute_time_t until = make_timeout_time_ms(ms);
+    while (absolute_time_diff_us(get_absolute_time(), until) > 0) {
+        net_poll();
+        sleep_ms(1);
+    }
+}
+
+/**
+ * Mesmos pinos e barramento do RFID_MQTT (setup_gpio em main_mqtt.c)
+ */
+static bool reader_init(void) {
+    gpio_init(cfg->pin_rst);
+    gpio_set_dir(cfg->pin_rst, GPIO_OUT);
+    gpio_put(cfg->pin_rst, 1);
+
+    if (cfg->reader_bus != MFRC522_BUS_PIO) {
+        spi_init(cfg->reader_bus == 1 ? spi1 : spi0, 1000000);
+        gpio_set_function(cfg->pin_miso, GPIO_FUNC_SPI);
+        gpio_set_function(cfg->pin_sck, GPIO_FUNC_SPI);
+        gpio_set_function(cfg->pin_mosi, GPIO_FUNC_SPI);
+    }
+
+    gpio_init(cfg->pin_cs);
+    gpio_set_dir(cfg->pin_cs, GPIO_OUT);
+    gpio_put(cfg->pin_cs, 1);
+
+    mfrc = MFRC522_Init();
+    if (mfrc == NULL) return false;
+    MFRC522_SetPins(mfrc, cfg->pin_cs, cfg->pin_sck, cfg->pin_mosi,
+                    cfg->pin_miso, cfg->pin_rst);
+    if (!MFRC522_SetBus(mfrc, cfg->reader_bus)) {
+        printf("[RFID] ERRO: reader_bus %u nao suportado neste build, configuracao recusada\n",
+               cfg->reader_bus);
+        return false;
+    }
+    if (!PCD_Init(mfrc, cfg->reader_bus == 1 ? spi1 : spi0)) {
+        printf("[RFID] ERRO: nenhuma state machine PIO livre para o leitor\n");
+        return false;
+    }
+
+    uint8_t version = PCD_ReadRegister(mfrc, VersionReg);
+    printf("[BENCH] MFRC522 versao 0x%02X\n", version);
+    return version == 0x91 || version == 0x92;
+}
+
+// --- Driver ---
+
+static void bench_registers(void) {
+    mfrc522_bench_result_t result;
+    mfrc522_bench_register_access(mfrc, REG_ITERATIONS, &result);
+    add_cycles_row("WriteRegister", result.write_cycles, REG_ITERATIONS);
+    add_cycles_row("ReadRegister", result.read_cycles, REG_ITERATIONS);
+}
+
+static void bench_spi_speeds(void) {
+    static const uint32_t bauds[] = { 1000000, 2000000, 4000000, 8000000, 10000000 };
+    mfrc522_bench_speed_t speeds[sizeof(bauds) / sizeof(bauds[0])];
+    char name[32];
+
+    if (mfrc522_bench_spi_speeds(mfrc, bauds, sizeof(bauds) / sizeof(bauds[0]),
+                                 SPEED_ITERATIONS, speeds) != 0) {
+        // No PIO o clock é fixo: só a velocidade atual
+        mfrc522_bench_result_t result;
+        mfrc522_bench_register_access(mfrc, SPEED_ITERATIONS, &result);
+        add_cycles_row("FIFO escrita 64 B (PIO)", result.fifo_write_cycles, SPEED_ITERATIONS);
+        add_cycles_row("FIFO leitura 64 B (PIO)", result.fifo_read_cycles, SPEED_ITERATIONS);
+        return;
+    }
+    for (size_t i = 0; i < sizeof(bauds) / sizeof(bauds[0]); i++) {
+        uint32_t khz = speeds[i].baud / 1000;
+        snprintf(name, sizeof(name), "FIFO escrita 64 B %lu kHz", (unsigned long)khz);
+        add_cycles_row(name, speeds[i].fifo_write_cycles, SPEED_ITERATIONS);
+        snprintf(name, sizeof(name), "FIFO leitura 64 B %lu kHz", (unsigned long)khz);
+        add_cycles_row(name, speeds[i].fifo_read_cycles, SPEED_ITERATIONS);
+    }
+}
+
+static void bench_crc(void) {
+    static const uint8_t lengths[] = { 2, 16, 64 };    // REQA/HLTA, bloco MIFARE, FIFO cheia
+    mfrc522_bench_crc_t crc;
+    char name[32];
+
+    for (size_t i = 0; i < sizeof(lengths); i++) {
+        mfrc522_bench_crc(mfrc, lengths[i], CRC_ITERATIONS, &crc);
+        if (!crc.match) {
+            printf("[BENCH] ERRO: CRC_A do coprocessador difere do software (%u B)\n", lengths[i]);
+        }
+        snprintf(name, sizeof(name), "CRC_A %u B coprocessador", lengths[i]);
+        add_cycles_row(name, crc.hw_cycles, CRC_ITERATIONS);
+        snprintf(name, sizeof(name), "CRC_A %u B software", lengths[i]);
+        add_cycles_row(name, crc.sw_cycles, CRC_ITERATIONS);
+    }
+}
+
+static void bench_rf(void) {
+    mfrc522_bench_rf_t rf = {0};
+
+    printf("[BENCH] REQA: mantenha o campo vazio...\n");
+    absolute_time_t until = make_timeout_time_ms(CARD_WAIT_MS);
+    while (mfrc522_bench_reqa_empty(mfrc, RF_ITERATIONS, &rf) != 0) {
+        if (absolute_time_diff_us(get_absolute_time(), until) <= 0) break;
+        printf("[BENCH] Tag no campo: afaste as tags do leitor\n");
+        sleep_ms(1000);
+    }
+    add_row("REQA campo vazio", rf.reqa_cycles, rf.reqa_us * 10, rf.reqa_iterations);
+
+    printf("[BENCH] SELECT/MIFARE_Read: aproxime uma tag (ate %d s)...\n", CARD_WAIT_MS / 1000);
+    until = make_timeout_time_ms(CARD_WAIT_MS);
+    bool present = false;
+    while (!present && absolute_time_diff_us(get_absolute_time(), until) > 0) {
+        // WUPA também acorda uma tag deixada em HALT pela rodada anterior
+        uint8_t atqa[2];
+        uint8_t atqa_size = sizeof(atqa);
+        present = PICC_WakeupA(mfrc, atqa, &atqa_size) == STATUS_OK &&
+                  PICC_Select(mfrc, &mfrc->uid, 0) == STATUS_OK;
+        if (!present) sleep_ms(50);
+    }
+    if (!present || mfrc522_bench_card(mfrc, RF_ITERATIONS, &rf) != 0) {
+        printf("[BENCH] Sem tag: SELECT e MIFARE_Read nao medidos\n");
+        add_row("SELECT completo", 0, 0, 0);
+        add_row("MIFARE_Read (bloco 4)", 0, 0, 0);
+        return;
+    }
+    printf("[BENCH] Tag %s, UID de %u bytes\n", PICC_GetTypeName(rf.type), rf.uid_size);
+    add_row("SELECT completo", rf.select_cycles, rf.select_us * 10, rf.select_iterations);
+    add_row("MIFARE_Read (bloco 4)", rf.read_cycles, rf.read_us * 10, rf.read_iterations);
+    if (rf.read_iterations == 0) {
+        printf("[BENCH] MIFARE_Read recusado (chave A diferente da padrao?)\n");
+    }
+}
+
+// --- Publicação ---
+
+static const rfid_event_t sample_event = {
+    .uid = { 0x04, 0x5E, 0x71, 0x8A, 0x2C, 0x49, 0x80 },
+    .uid_size = 7,
+    .timestamp_ms = 123456,
+};
+
+// Payload de publish_rfid_tag(), com o relógio sincronizado (ts_us presente)
+static void bench_encode(void) {
+    char payload[EVENT_JSON_MAX];
+    uint64_t total = 0;
+
+    cycle_counter_init();
+    uint32_t irq = save_and_disable_interrupts();
+    for (uint32_t i = 0; i < ENCODE_ITERATIONS; i++) {
+        uint32_t start = cycle_counter_read();
+        uint64_t ts_us = 1760000000000000ull + i;
+        (void)event_json_format(&sample_event, &ts_us, payload, sizeof(payload));
+        total += cycle_counter_elapsed(start, cycle_counter_read());
+    }
+    restore_interrupts(irq);
+    add_cycles_row("JSON do evento (7 B)", (uint32_t)(total / ENCODE_ITERATIONS), ENCODE_ITERATIONS);
+}
+
+// Só o enfileiramento: mqtt_publish copia para o buffer de saída e volta
+static void bench_publish_qos(const char *topic, uint8_t qos) {
+    char payload[EVENT_JSON_MAX];
+    char name[32];
+    uint64_t total = 0;
+    uint32_t done = 0, refused = 0;
+
+    event_json_format(&sample_event, NULL, payload, sizeof(payload));
+    cycle_counter_init();
+
+    for (uint32_t i = 0; i < PUBLISH_ITERATIONS; i++) {
+        // QoS 1 precisa de vaga na janela de publicações em andamento
+        absolute_time_t until = make_timeout_time_ms(2000);
+        while (qos > 0 && link_supervisor_window_free() == 0 &&
+               absolute_time_diff_us(get_absolute_time(), until) > 0) {
+            net_poll();
+        }
+
+        uint32_t irq = save_and_disable_interrupts();
+        uint32_t start = cycle_counter_read();
+        bool ok = link_supervisor_publish(topic, payload, qos);
+        uint32_t cycles = cycle_counter_elapsed(start, cycle_counter_read());
+        restore_interrupts(irq);
+
+        if (ok) {
+            total += cycles;
+            done++;
+        } else {
+            refused++;
+        }
+        wait_ms(20);    // Deixa o TCP esvaziar o buffer de saída
+    }
+
+    snprintf(name, sizeof(name), "mqtt_publish QoS %u", qos);
+    add_cycles_row(name, done ? (uint32_t)(total / done) : 0, done);
+    if (refused > 0) {
+        printf("[BENCH] mqtt_publish QoS %u: %lu recusadas (buffer ou janela cheios)\n",
+               qos, (unsigned long)refused);
+    }
+}
+
+static void bench_publish(void) {
+    char topic[96];
+    snprintf(topic, sizeof(topic), "%s/bench", cfg->topic_rfid);
+
+    if (!net_ready) {
+        printf("[BENCH] Sem WiFi: mqtt_publish nao medido\n");
+        add_row("mqtt_publish QoS 0", 0, 0, 0);
+        add_row("mqtt_publish QoS 1", 0, 0, 0);
+        return;
+    }
+
+    printf("[BENCH] Aguardando o broker (ate %d s)...\n", NET_WAIT_MS / 1000);
+    absolute_time_t until = make_timeout_time_ms(NET_WAIT_MS);
+    while (!link_supervisor_online() && absolute_time_diff_us(get_absolute_time(), until) > 0) {
+        net_poll();
+        sleep_ms(1);
+    }
+    if (!link_supervisor_online()) {
+        printf("[BENCH] Broker indisponivel: mqtt_publish nao medido\n");
+        add_row("mqtt_publish QoS 0", 0, 0, 0);
+        add_row("mqtt_publish QoS 1", 0, 0, 0);
+        return;
+    }
+
+    bench_publish_qos(topic, 0);
+    bench_publish_qos(topic, 1);
+}
+
+// --- Relatório ---
+
+static void print_table(void) {
+    printf("\n[BENCH] Driver MFRC522: %s, %s; clk_sys=%lu MHz\n",
+           MFRC522_STATIC_CONFIG ? "configuracao estatica" : "configuracao de runtime",
+           cfg->reader_bus == 2 ? "SPI em PIO" :
+           MFRC522_FAST_SPI ? "FIFO SPI direta (RAM)" : "SDK spi_*_blocking",
+           (unsigned long)mhz);
+    printf("[BENCH] %-30s %10s %10s %6s\n", "Operacao", "ciclos", "us", "n");
+    for (int i = 0; i < row_count; i++) {
+        const bench_row_t *row = &rows[i];
+        if (row->n == 0) {
+            printf("[BENCH] %-30s %10s %10s %6s\n", row->name, "-", "-", "0");
+            continue;
+        }
+        printf("[BENCH] %-30s %10lu %8lu.%lu %6lu\n", row->name, (unsigned long)row->cycles,
+               (unsigned long)(row->us_x10 / 10), (unsigned long)(row->us_x10 % 10),
+               (unsigned long)row->n);
+    }
+    printf("\n[BENCH] 'r' repete as medidas\n");
+}
+
+static void run_all(void) {
+    row_count = 0;
+    bench_registers();
+    bench_spi_speeds();
+    bench_crc();
+    bench_rf();
+    bench_encode();
+    bench_publish();
+    print_table();
+}
+
+int main() {
+    stdio_init_all();
+    sleep_ms(3000);  // Tempo para abrir o monitor serial
+
+    printf("\n========================================\n");
+    printf("  RFID_BENCH - microbenchmarks na placa\n");
+    printf("========================================\n\n");
+
+    rfid_config_load();
+    cfg = rfid_config();
+    mhz = clock_get_hz(clk_sys) / 1000000;
+
+    if (!reader_init()) {
+        printf("[BENCH] ERRO: MFRC522 nao respondeu (verifique pinos e alimentacao)\n");
+        while (1) {
+            sleep_ms(1000);
+        }
+    }
+
+    // Rede em segundo plano: só é necessária na medida do mqtt_publish
+    net_ready = link_supervisor_init(NULL) == 0;
+
+    run_all();
+    while (1) {
+        int c = getchar_timeout_us(0);
+        if (c == 'r' || c == 'R') {
+            run_all();
+        }
+        net_poll();
+        sleep_ms(10);
+    }
+}
@@ -0,0 +1,784 @@
+// =====================================================
+// Sistema RFID - Raspberry Pi Pico W com MQTT
+// Variante FreeRTOS (SMP nos dois cores)
+//
+// Mesma funcionalidade de main_mqtt.c, dividida em tarefas com
+// prioridades explícitas e filas entre elas:
+//
+//   RF          (prioridade 4, core 1) -> varre o MFRC522
+//        | barramento de eventos (event_bus) + notificação
+//   Publicação  (prioridade 3)         -> sinks: serial, MQTT (fila pendente), HTTP
+//   Manutenção  (prioridade 2)         -> WiFi, reconexão, relógio, status, watchdog
+//   HTTP        (prioridade 1)         -> páginas /status, /events e /api/crash
+//
+// Compare com o firmware bare-metal pelo comando 'lat' (ver README).
+// =====================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "hardware/spi.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "mfrc522.h"
+#include "rfid_config.h"
+#include "supervisor.h"
+#include "event_queue.h"
+#include "event_bus.h"
+#include "tag_map.h"
+#include "agv_tracker.h"
+#include "net_stats.h"
+#include "mqtt_link.h"
+#include "pipeline_stats.h"
+#include "wifi_link.h"
+#include "link_supervisor.h"
+#include "time_sync.h"
+#include "event_auth.h"
+#include "rules.h"
+#include "event_batch.h"
+#include "card_ops.h"
+#include "ota.h"
+#include "crash_dump.h"
+#include "tag_debounce.h"
+#include "event_json.h"
+#include "event_pipeline.h"
+#include "pico_http_server.h"
+
+// ========== TAREFAS ==========
+
+#define RF_TASK_PRIORITY            (tskIDLE_PRIORITY + 4)
+#define PUBLISH_TASK_PRIORITY       (tskIDLE_PRIORITY + 3)
+#define HOUSEKEEPING_TASK_PRIORITY  (tskIDLE_PRIORITY + 2)
+#define HTTP_TASK_PRIORITY          (tskIDLE_PRIORITY + 1)
+
+// Tamanho das pilhas (palavras de 32 bits)
+#define RF_TASK_STACK               1024
+#define PUBLISH_TASK_STACK          1024
+#define HOUSEKEEPING_TASK_STACK     2048
+#define HTTP_TASK_STACK             1024
+
+// Máximo de eventos comuns publicados por rodada
+#define PUBLISH_BURST               8
+
+// Vagas da janela de publicação reservadas aos eventos prioritários
+#define PRIORITY_RESERVE            2
+
+static TaskHandle_t rf_task_handle;
+static TaskHandle_t publish_task_handle;
+static TaskHandle_t housekeeping_task_handle;
+static TaskHandle_t http_task_handle;
+
+static SemaphoreHandle_t queue_mutex;   // Estado de event_queue (só durante cada operação)
+static SemaphoreHandle_t flash_mutex;   // Gravações na flash (fila, mapa, regras, OTA...)
+
+// Sink MQTT e escoamento da fila (só na tarefa de publicação)
+static event_pipeline_t pipeline;
+
+// Leitor respondeu no PCD_Init (saúde da imagem em teste da OTA)
+static volatile bool rf_ok = false;
+
+static const rfid_config_t *cfg = NULL;
+static const supervisor_boot_info_t *boot_info = NULL;
+
+// Página /status: a tarefa HTTP monta, o servidor (thread do lwIP) serve
+static char http_status[2][512];
+static volatile uint8_t http_status_index = 0;
+
+// Página /events: últimas leituras guardadas pelo sink HTTP
+#define HTTP_RECENT_EVENTS          8
+static rfid_event_t http_recent[HTTP_RECENT_EVENTS];
+static uint32_t http_recent_count = 0;
+static char http_events[2][512];
+static volatile uint8_t http_events_index = 0;
+
+// ========== UTILITÁRIOS ==========
+
+/**
+ * Grava a fila pendente na flash (gancho de pré-reset do supervisor)
+ */
+static void save_pending_events(void) {
+    if (xSemaphoreTake(flash_mutex, pdMS_TO_TICKS(500)) == pdTRUE) {
+        event_queue_persist(true);
+        xSemaphoreGive(flash_mutex);
+    }
+}
+
+// Trava de event_queue: a tarefa de publicação não a segura durante a rede
+static void queue_lock(void) {
+    xSemaphoreTake(queue_mutex, portMAX_DELAY);
+}
+
+static void queue_unlock(void) {
+    xSemaphoreGive(queue_mutex);
+}
+
+/**
+ * Publica status do leitor RFID
+ */
+static void publish_status(const char *status) {
+    char payload[1024];
+    int len = snprintf(payload, sizeof(payload),
+                       "{\"status\":\"%s\",\"reader\":\"PicoW\",\"variant\":\"freertos\","
+                       "\"restarts\":%lu,\"reset_reason\":\"%s\",\"queued\":%lu,"
+                       "\"queued_prio\":%lu,\"rtos_heap_free\":%lu,\"rtos_heap_min\":%lu,",
+                       status, (unsigned long)boot_info->restarts,
+                       supervisor_reason_name(boot_info->last_reason),
+                       (unsigned long)event_queue_count(),
+                       (unsigned long)event_queue_class_count(EVENT_CLASS_PRIORITY),
+                       (unsigned long)xPortGetFreeHeapSize(),
+                       (unsigned long)xPortGetMinimumEverFreeHeapSize());
+
+    len += net_stats_format_json(payload + len, sizeof(payload) - len - 1);
+    if (len >= (int)sizeof(payload) - 2) return;
+
+    payload[len++] = ',';
+    len += pipeline_stats_format_json(payload + len, sizeof(payload) - len - 1);
+    if (len >= (int)sizeof(payload) - 2) return;
+
+    payload[len++] = ',';
+    len += wifi_link_format_json(payload + len, sizeof(payload) - len - 1);
+    if (len >= (int)sizeof(payload) - 2) return;
+    payload[len++] = ',';
+    len += link_supervisor_format_json(payload + len, sizeof(payload) - len - 1);
+    if (len >= (int)sizeof(payload) - 2) return;
+    payload[len++] = ',';
+    len += event_bus_format_json(payload + len, sizeof(payload) - len - 1);
+    if (len >= (int)sizeof(payload) - 2) return;
+
+    // Relógio comum: erro estimado e deriva
+    payload[len++] = ',';
+    len += time_sync_format_json(payload + len, sizeof(payload) - len - 1);
+    if (len >= (int)sizeof(payload) - 2) return;
+
+    // Regras de borda: descartes, agregações e custo da avaliação
+    payload[len++] = ',';
+    len += rules_format_json(payload + len, sizeof(payload) - len - 1);
+    if (len >= (int)sizeof(payload) - 2) return;
+
+    // Lotes binários da fila pendente: compressão e custo
+    payload[len++] = ',';
+    len += event_batch_format_json(payload + len, sizeof(payload) - len - 1);
+    if (len >= (int)sizeof(payload) - 2) return;
+
+    // Atualização de firmware: imagem em teste, download em andamento
+    payload[len++] = ',';
+    len += ota_format_json(payload + len, sizeof(payload) - len - 1);
+    if (len >= (int)sizeof(payload) - 1) return;
+    strcat(payload, "}");
+
+    link_supervisor_publish(cfg->topic_status, payload, 0);
+}
+
+// Chamado na thread do lwIP (pilha de TCPIP_THREAD_STACKSIZE): o status,
+// com o payload de 1 KB, sai na housekeeping_task
+static volatile bool connected_pending = false;
+
+static void on_mqtt_connected(void) {
+    connected_pending = true;
+}
+
+/**
+ * Imprime a folga de pilha de cada tarefa
+ */
+static void print_tasks(void) {
+    const struct {
+        const char *name;
+        TaskHandle_t *handle;
+    } tasks[] = {
+        { "rf", &rf_task_handle },
+        { "publish", &publish_task_handle },
+        { "housekeeping", &housekeeping_task_handle },
+        { "http", &http_task_handle },
+    };
+
+    for (size_t i = 0; i < sizeof(tasks) / sizeof(tasks[0]); i++) {
+        if (*tasks[i].handle == NULL) continue;
+        printf("[RTOS] %-12s folga de pilha: %lu palavras\n", tasks[i].name,
+               (unsigned long)uxTaskGetStackHighWaterMark(*tasks[i].handle));
+    }
+    printf("[RTOS] heap livre: %lu (minimo %lu)\n",
+           (unsigned long)xPortGetFreeHeapSize(),
+           (unsigned long)xPortGetMinimumEverFreeHeapSize());
+}
+
+/**
+ * Console serial (subconjunto do bare-metal, com o mesmo 'cfg')
+ */
+static void console_poll(void) {
+    static char line[224];  // Cabe 'ota <url> <bytes> <sha256>'
+    static uint8_t len = 0;
+    int c;
+
+    while ((c = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT) {
+        if (c != '\r' && c != '\n') {
+            if (len < sizeof(line) - 1) line[len++] = (char)c;
+            continue;
+        }
+        if (len == 0) continue;
+        line[len] = '\0';
+        len = 0;
+
+        if (strcmp(line, "lat") == 0) {
+            pipeline_stats_print("FreeRTOS SMP");
+        } else if (strcmp(line, "lat reset") == 0) {
+            pipeline_stats_reset();
+            printf("[LAT] Medidas zeradas\n");
+        } else if (strcmp(line, "tasks") == 0) {
+            print_tasks();
+        } else if (strcmp(line, "net") == 0) {
+            net_stats_print();
+        } else if (strcmp(line, "bus") == 0) {
+            event_bus_print();
+        } else if (strcmp(line, "map") == 0) {
+            tag_map_print();
+        } else if (strcmp(line, "time") == 0) {
+            time_sync_print();
+        } else if (strcmp(line, "auth") == 0) {
+            event_auth_print();
+        } else if (strcmp(line, "rules") == 0) {
+            rules_print();
+        } else if (strcmp(line, "rules clear") == 0) {
+            rules_load_table(NULL, 0);
+            printf("[RULES] Regras apagadas\n");
+        } else if (strcmp(line, "batch") == 0) {
+            event_batch_print();
+        } else if (strcmp(line, "cards") == 0) {
+            card_ops_print();
+        } else if (strcmp(line, "crash") == 0) {
+            crash_dump_print();
+        } else if (strcmp(line, "crash test") == 0) {
+            crash_dump_test();
+        } else if (strcmp(line, "ota") == 0) {
+            ota_print();
+        } else if (strcmp(line, "ota abort") == 0) {
+            ota_abort();
+        } else if (strcmp(line, "ota confirm") == 0 || strcmp(line, "ota rollback") == 0) {
+            int rc = line[4] == 'c' ? ota_confirm() : ota_rollback();
+            if (rc != 0) printf("[OTA] Nenhuma imagem em teste\n");
+        } else if (strncmp(line, "ota ", 4) == 0) {
+            char *url = strtok(line + 4, " ");
+            char *size = strtok(NULL, " ");
+            char *sha256 = strtok(NULL, " ");
+            if (url == NULL || size == NULL || sha256 == NULL) {
+                printf("[OTA] Uso: ota <url> <bytes> <sha256> | abort | confirm | rollback\n");
+            } else {
+                ota_start(url, (uint32_t)strtoul(size, NULL, 10), sha256);
+            }
+        } else if (strcmp(line, "wifi") == 0) {
+            wifi_link_print();
+            link_supervisor_print();
+        } else if (strncmp(line, "cfg", 3) == 0 && (line[3] == ' ' || line[3] == '\0')) {
+            xSemaphoreTake(flash_mutex, portMAX_DELAY);   // 'cfg save'
+            bool reboot = rfid_config_console(line + 3);
+            xSemaphoreGive(flash_mutex);
+            if (reboot) {
+                supervisor_reboot(SUP_REASON_REQUESTED);
+            }
+        } else if (strcmp(line, "reboot") == 0) {
+            supervisor_reboot(SUP_REASON_REQUESTED);
+        } else {
+            printf("Comandos: lat | lat reset | tasks | net | bus | map | time | auth | rules | rules clear | batch | cards | ota | crash | wifi | cfg | reboot\n");
+        }
+    }
+}
+
+// ========== TAREFA RF ==========
+
+/**
+ * Configura os pinos do MFRC522 (igual ao firmware bare-metal)
+ */
+static void setup_gpio(void) {
+#if MFRC522_STATIC_CONFIG
+    const uint pin_rst = MFRC522_PIN_RST, pin_cs = MFRC522_PIN_CS;
+    const uint pin_miso = MFRC522_PIN_MISO, pin_sck = MFRC522_PIN_SCK, pin_mosi = MFRC522_PIN_MOSI;
+    const uint bus = MFRC522_SPI_BUS;
+#else
+    const uint pin_rst = cfg->pin_rst, pin_cs = cfg->pin_cs;
+    const uint pin_miso = cfg->pin_miso, pin_sck = cfg->pin_sck, pin_mosi = cfg->pin_mosi;
+    const uint bus = cfg->reader_bus;
+#endif
+
+    gpio_init(pin_rst);
+    gpio_set_dir(pin_rst, GPIO_OUT);
+    gpio_put(pin_rst, 1);
+
+    if (bus != MFRC522_BUS_PIO) {
+        spi_init(bus == 1 ? spi1 : spi0, 1000000);
+        gpio_set_function(pin_miso, GPIO_FUNC_SPI);
+        gpio_set_function(pin_sck, GPIO_FUNC_SPI);
+        gpio_set_function(pin_mosi, GPIO_FUNC_SPI);
+    }
+
+    gpio_init(pin_cs);
+    gpio_set_dir(pin_cs, GPIO_OUT);
+    gpio_put(pin_cs, 1);
+}
+
+/**
+ * Varre o leitor em intervalos fixos (vTaskDelayUntil) e envia cada tag
+ * nova para a tarefa de publicação. Fica no core 1, longe do lwIP/cyw43.
+ */
+static void rf_task(void *param) {
+    (void)param;
+
+    setup_gpio();
+
+    MFRC522Ptr_t mfrc = MFRC522_Init();
+    if (mfrc == NULL) {
+        printf("[RFID] ERRO: Falha ao inicializar MFRC522!\n");
+        vTaskDelete(NULL);
+        return;
+    }
+    MFRC522_SetPins(mfrc, cfg->pin_cs, cfg->pin_sck, cfg->pin_mosi,
+                    cfg->pin_miso, cfg->pin_rst);
+    if (!MFRC522_SetBus(mfrc, cfg->reader_bus)) {
+        printf("[RFID] ERRO: reader_bus %u nao suportado neste build (PIO ou barramento "
+               "fixo na compilacao), configuracao recusada\n", cfg->reader_bus);
+        vTaskDelete(NULL);
+        return;
+    }
+    if (boot_info->warm) {
+        MFRC522_SetResetHold(mfrc, 1);
+    }
+    supervisor_set_phase(SUP_PHASE_RF_INIT);
+    if (!PCD_Init(mfrc, cfg->reader_bus == 1 ? spi1 : spi0)) {
+        printf("[RFID] ERRO: nenhuma state machine PIO livre para o leitor; "
+               "use 'cfg set reader_bus 0' com os pinos de SPI\n");
+        vTaskDelete(NULL);
+        return;
+    }
+    uint8_t version = PCD_ReadRegister(mfrc, VersionReg);
+    rf_ok = version == 0x91 || version == 0x92;
+    if (!rf_ok) {
+        printf("[RFID] AVISO: versao do chip inesperada (0x%02X)\n", version);
+    }
+    printf("[RFID] Leitor inicializado (core %u)\n", get_core_num());
+
+    // Debounce: última tag enviada
+    tag_debounce_t debounce;
+    tag_debounce_init(&debounce, cfg->debounce_time_ms);
+
+    TickType_t wake = xTaskGetTickCount();
+    while (1) {
+        supervisor_heartbeat(SUP_TASK_RF);
+        pipeline_stats_scan(time_us_32());
+
+        if (PICC_IsNewCardPresent(mfrc) && PICC_ReadCardSerial(mfrc)) {
+            uint8_t size = mfrc->uid.size;
+            if (tag_debounce_accept(&debounce, mfrc->uid.uidByte, size,
+                                    to_ms_since_boot(get_absolute_time()))) {
+                rfid_event_t ev = {0};
+                memcpy(ev.uid, mfrc->uid.uidByte, size);
+                ev.uid_size = size;
+                ev.timestamp_ms = to_ms_since_boot(get_absolute_time());
+                ev.detect_us = time_us_32();
+                crash_trace(CRASH_TRACE_TAG, (uint32_t)ev.uid[0] << 24 | (uint32_t)ev.uid[1] << 16 |
+                                             (uint32_t)ev.uid[2] << 8 | ev.uid[3]);
+
+                // Regras de borda antes de qualquer cópia; formatação e envio
+                // na tarefa de publicação
+                if (rules_apply(&ev)) {
+                    event_bus_produce(&ev);
+                    xTaskNotifyGive(publish_task_handle);
+                }
+            }
+            // Comando remoto pendente: a resposta sai pela tarefa de publicação
+            if (card_ops_on_card(mfrc)) xTaskNotifyGive(publish_task_handle);
+            PCD_StopCrypto1(mfrc);
+        }
+
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(cfg->scan_interval_ms));
+    }
+}
+
+// ========== TAREFA DE PUBLICAÇÃO ==========
+
+/**
+ * Publica um evento no tópico agv/rfid (ou na rota da regra que casou)
+ */
+static bool publish_rfid_tag(const rfid_event_t *ev) {
+    // Instante no relógio comum dos leitores, quando sincronizado
+    uint64_t ts_us;
+    bool synced = time_sync_event_unix_us(ev, &ts_us);
+    char payload[EVENT_JSON_MAX + EVENT_AUTH_OVERHEAD];
+    int len = event_json_format(ev, synced ? &ts_us : NULL, payload,
+                                sizeof(payload) - EVENT_AUTH_OVERHEAD);
+
+    char topic[RULES_TOPIC_LEN];
+    rules_route_topic(ev, topic, sizeof(topic));
+    event_auth_sign(topic, payload, len, sizeof(payload));  // Contador + MAC
+
+    if (!link_supervisor_publish(topic, payload, 1)) {
+        return false;
+    }
+    pipeline_stats_published(ev->detect_us, time_us_32(),
+                             ev->flags & EVENT_FLAG_RESTORED, EVENT_CLASS(ev));
+    return true;
+}
+
+// --- Sinks do barramento (chamados só pela tarefa de publicação) ---
+
+static bool serial_sink_deliver(const rfid_event_t *ev, void *ctx) {
+    (void)ctx;
+    char uid_str[32];
+    event_json_uid_hex(ev->uid, ev->uid_size, uid_str);
+    printf("[RFID] Tag detectada: %s\n", uid_str);
+    return true;
+}
+
+/**
+ * Publica direto ou guarda na fila da sua classe (política em
+ * lib/event_pipeline.h); a fila toma queue_mutex só no push
+ */
+static bool mqtt_sink_deliver(const rfid_event_t *ev, void *ctx) {
+    (void)ctx;
+    if (!event_pipeline_deliver(&pipeline, ev)) {
+        printf("[QUEUE] AVISO: fila cheia, evento mais antigo descartado\n");
+    }
+    return true;
+}
+
+/**
+ * Guarda as últimas leituras para a página /events
+ */
+static bool http_sink_deliver(const rfid_event_t *ev, void *ctx) {
+    (void)ctx;
+    taskENTER_CRITICAL();
+    http_recent[http_recent_count % HTTP_RECENT_EVENTS] = *ev;
+    http_recent_count++;
+    taskEXIT_CRITICAL();
+    return true;
+}
+
+/**
+ * Posição, velocidade e ETA do AGV a cada marcador do mapa
+ */
+static bool position_sink_deliver(const rfid_event_t *ev, void *ctx) {
+    (void)ctx;
+    agv_position_t pos;
+    if (!agv_tracker_update(ev, &pos)) return true;
+
+    char payload[256 + EVENT_AUTH_OVERHEAD];
+    int len = agv_tracker_format_json(ev, &pos, payload, sizeof(payload) - EVENT_AUTH_OVERHEAD);
+    event_auth_sign(cfg->topic_position, payload, len, sizeof(payload));
+    if (link_supervisor_online()) {
+        link_supervisor_publish(cfg->topic_position, payload, 0);
+    }
+    return true;
+}
+
+static void on_map_message(const char *topic, const char *data, uint32_t len) {
+    int markers = tag_map_parse(data, len);
+    printf(markers < 0 ? "[MAP] ERRO: mapa invalido recebido em %s\n"
+                       : "[MAP] Mapa recebido por MQTT (%s)\n", topic);
+}
+
+static void on_rules_message(const char *topic, const char *data, uint32_t len) {
+    int n = rules_load_table((const uint8_t *)data, len);
+    printf(n < 0 ? "[RULES] ERRO: tabela invalida recebida em %s\n"
+                 : "[RULES] Tabela recebida por MQTT (%s)\n", topic);
+}
+
+static void on_card_command(const char *topic, const char *data, uint32_t len) {
+    card_ops_submit(topic, data, len);
+}
+
+static void on_ota_message(const char *topic, const char *data, uint32_t len) {
+    ota_on_message(topic, data, len);
+}
+
+/**
+ * Resumos das janelas de agregação encerradas (regras 'aggregate')
+ */
+static void publish_rule_summaries(void) {
+    rules_summary_t s;
+
+    while (link_supervisor_online() &&
+           rules_aggregate_peek(to_ms_since_boot(get_absolute_time()), &s)) {
+        char uid_str[32] = {0};
+        event_json_uid_hex(s.last_uid, s.last_uid_size, uid_str);
+
+        rfid_event_t route = { .flags = (uint8_t)(s.route << EVENT_ROUTE_SHIFT) };
+        char topic[RULES_TOPIC_LEN];
+        rules_route_topic(&route, topic, sizeof(topic));
+
+        char payload[192 + EVENT_AUTH_OVERHEAD];
+        int len = snprintf(payload, sizeof(payload) - EVENT_AUTH_OVERHEAD,
+                           "{\"aggregate\":%u,\"count\":%lu,\"timestamp\":%lu,"
+                           "\"window_ms\":%lu,\"last_tag\":\"%s\",\"reader\":\"PicoW\"}",
+                           s.rule, (unsigned long)s.count, (unsigned long)s.first_ms,
+                           (unsigned long)s.window_ms, uid_str);
+        event_auth_sign(topic, payload, len, sizeof(payload));
+
+        if (!link_supervisor_publish(topic, payload, 1)) break;
+        rules_aggregate_done(&s);
+    }
+}
+
+static event_sink_t serial_sink = { .name = "serial", .deliver = serial_sink_deliver };
+static event_sink_t position_sink = { .name = "position", .deliver = position_sink_deliver };
+static event_sink_t mqtt_sink = { .name = "mqtt", .deliver = mqtt_sink_deliver };
+static event_sink_t http_sink = { .name = "http", .deliver = http_sink_deliver };
+
+// Transporte do sink MQTT e do escoamento da fila
+static const event_pipeline_ops_t pipeline_ops = {
+    .online = link_supervisor_online,
+    .window_free = link_supervisor_window_free,
+    .publish = publish_rfid_tag,
+    .publish_batch = event_batch_publish,
+};
+
+/**
+ * Entrega as leituras da tarefa RF aos sinks, mantém a fila pendente
+ * (salva na flash quando offline) e a escoa enquanto o broker estiver
+ * conectado.
+ */
+static void publish_task(void *param) {
+    (void)param;
+
+    // Grava a época de boot na flash: precisa do escalonador rodando
+    event_auth_init();
+
+    while (1) {
+        // Acorda a cada leitura, ou a cada 100 ms para tentar de novo
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+
+        // Sem mutex durante a rede: a fila só trava nas próprias operações,
+        // e o OTA e o gancho de pré-reset não esperam pelas publicações
+        event_bus_dispatch(PUBLISH_BURST);
+
+        // Prioritários primeiro e fora do limite; comuns deixam a reserva
+        // livre e, com a fila longa, saem em lotes binários
+        uint32_t sent = event_pipeline_drain(&pipeline);
+        publish_rule_summaries();
+
+        if (sent > 0 || event_queue_count() == 0 || !link_supervisor_online()) {
+            supervisor_heartbeat(SUP_TASK_PUBLISH);
+        }
+
+        // Gravações na flash não se misturam com as do OTA. Os comandos de
+        // cartão e o registro de falha gravam antes de responder (raro)
+        xSemaphoreTake(flash_mutex, portMAX_DELAY);
+        card_ops_publish();
+        crash_dump_publish();
+        event_queue_persist(false);
+        tag_map_persist(false);
+        rules_persist();
+        xSemaphoreGive(flash_mutex);
+    }
+}
+
+// ========== TAREFA DE MANUTENÇÃO ==========
+
+/**
+ * WiFi, MQTT, status periódico, console e watchdog
+ */
+static void housekeeping_task(void *param) {
+    (void)param;
+
+    // Com lwip_sys_freertos, o cyw43 só pode ser iniciado com o escalonador rodando
+    supervisor_set_phase(SUP_PHASE_WIFI_CONNECT);
+    if (link_supervisor_init(on_mqtt_connected) == 0) {
+        time_sync_init();
+    }
+
+    absolute_time_t last_status = get_absolute_time();
+    while (1) {
+        supervisor_set_phase(SUP_PHASE_IDLE);
+        supervisor_heartbeat(SUP_TASK_NET);
+        link_supervisor_service();  // WiFi, reconexões e MQTT
+        time_sync_service(wifi_link_is_up());
+        console_poll();
+
+        if (connected_pending ||
+            absolute_time_diff_us(last_status, get_absolute_time()) > 30000000) {
+            connected_pending = false;
+            publish_status("online");
+            last_status = get_absolute_time();
+        }
+
+        // Download OTA: as gravações não se misturam com as da fila pendente.
+        // O reinício fica fora do mutex (o gancho de pré-reset toma o mesmo)
+        if (xSemaphoreTake(flash_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+            supervisor_set_phase(SUP_PHASE_FLASH_WRITE);
+            bool reboot = ota_service(link_supervisor_online() && rf_ok);
+            xSemaphoreGive(flash_mutex);
+            if (reboot) {
+                supervisor_reboot(SUP_REASON_REQUESTED);
+            }
+        }
+
+        supervisor_service();
+        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+}
+
+// ========== TAREFA HTTP ==========
+
+static const char *http_status_handler(const char *request) {
+    (void)request;
+    http_server_set_content_type(HTTP_CONTENT_TYPE_JSON);
+    return http_status[http_status_index];
+}
+
+static const char *http_events_handler(const char *request) {
+    (void)request;
+    http_server_set_content_type(HTTP_CONTENT_TYPE_JSON);
+    return http_events[http_events_index];
+}
+
+// Último HardFault: lido da flash a cada pedido (só a thread do lwIP usa o buffer)
+static const char *http_crash_handler(const char *request) {
+    static char crash_json[1024];
+    (void)request;
+    crash_dump_format_json(crash_json, sizeof(crash_json));
+    http_server_set_content_type(HTTP_CONTENT_TYPE_JSON);
+    return crash_json;
+}
+
+/**
+ * Monta /events com as últimas leituras (mais recente primeiro)
+ */
+static void update_http_events(void) {
+    rfid_event_t recent[HTTP_RECENT_EVENTS];
+    uint32_t count;
+
+    taskENTER_CRITICAL();
+    count = http_recent_count;
+    memcpy(recent, http_recent, sizeof(recent));
+    taskEXIT_CRITICAL();
+
+    uint8_t next = http_events_index ^ 1;
+    char *buf = http_events[next];
+    size_t size = sizeof(http_events[0]);
+    int len = snprintf(buf, size, "{\"total\":%lu,\"events\":[", (unsigned long)count);
+
+    uint32_t shown = count < HTTP_RECENT_EVENTS ? count : HTTP_RECENT_EVENTS;
+    for (uint32_t i = 0; i < shown && len < (int)size; i++) {
+        const rfid_event_t *ev = &recent[(count - 1 - i) % HTTP_RECENT_EVENTS];
+        char uid_str[32];
+        event_json_uid_hex(ev->uid, ev->uid_size, uid_str);
+        len += snprintf(buf + len, size - len, "%s{\"tag\":\"%s\",\"timestamp\":%lu}",
+                        i ? "," : "", uid_str, (unsigned long)ev->timestamp_ms);
+    }
+    if (len < (int)size - 2) {
+        strcat(buf, "]}");
+        http_events_index = next;
+    }
+}
+
+/**
+ * Abre o servidor HTTP e atualiza as páginas /status e /events a cada segundo.
+ * Prioridade mais baixa: só roda quando RF e publicação estão ociosas.
+ */
+static void http_task(void *param) {
+    (void)param;
+
+    while (!wifi_link_is_up()) {
+        vTaskDelay(pdMS_TO_TICKS(500));
+    }
+
+    strcpy(http_status[0], "{}");
+    strcpy(http_events[0], "{\"total\":0,\"events\":[]}");
+    http_server_register_handler((http_request_handler_t){ "/status", http_status_handler });
+    http_server_register_handler((http_request_handler_t){ "/events", http_events_handler });
+    http_server_register_handler((http_request_handler_t){ "/api/crash", http_crash_handler });
+    http_server_start();
+
+    while (1) {
+        // Monta no buffer que não está sendo servido e troca o índice
+        uint8_t next = http_status_index ^ 1;
+        char *buf = http_status[next];
+        int len = snprintf(buf, sizeof(http_status[0]),
+                           "{\"connected\":%s,\"queued\":%lu,",
+                           link_supervisor_online() ? "true" : "false",
+                           (unsigned long)event_queue_count());
+        len += pipeline_stats_format_json(buf + len, sizeof(http_status[0]) - len - 1);
+        if (len < (int)sizeof(http_status[0]) - 1) {
+            strcat(buf, "}");
+            http_status_index = next;
+        }
+        update_http_events();
+
+        vTaskDelay(pdMS_TO_TICKS(1000));
+    }
+}
+
+// ========== GANCHOS DO FreeRTOS ==========
+
+void vApplicationStackOverflowHook(TaskHandle_t task, char *name) {
+    (void)task;
+    panic("[RTOS] Estouro de pilha na tarefa %s", name);
+}
+
+void vApplicationMallocFailedHook(void) {
+    panic("[RTOS] Heap do FreeRTOS esgotado");
+}
+
+// ========== FUNÇÃO PRINCIPAL ==========
+
+int main() {
+    stdio_init_all();
+
+    boot_info = supervisor_init();
+    crash_dump_init();
+    if (!boot_info->warm) {
+        sleep_ms(3000);  // Aguarda estabilização (apenas no boot a frio)
+    }
+
+    printf("\n========================================\n");
+    printf("  Leitor RFID com MQTT (FreeRTOS SMP)\n");
+    printf("========================================\n\n");
+
+    rfid_config_load();
+    cfg = rfid_config();
+    ota_init();
+    event_queue_restore();
+    tag_map_load();
+    mqtt_link_subscribe(cfg->topic_map, on_map_message);
+    rules_init();
+    rules_load();
+    mqtt_link_subscribe(cfg->topic_rules, on_rules_message);
+    if (cfg->card_ops) {
+        card_ops_init();
+        mqtt_link_subscribe(cfg->topic_cmd, on_card_command);
+        if (cfg->card_ops == 2 && cfg->auth_mode == 0) {
+            printf("[AVISO] card_ops 2 sem auth_mode: escritas aceitas sem assinatura\n");
+        }
+    }
+    if (cfg->ota_enabled) {
+        mqtt_link_subscribe(cfg->topic_ota, on_ota_message);
+        if (cfg->auth_mode == 0) {
+            printf("[OTA] AVISO: ota_enabled sem auth_mode: pedidos de atualizacao aceitos sem assinatura\n");
+        }
+    }
+    pipeline_stats_reset();
+
+    queue_mutex = xSemaphoreCreateMutex();
+    flash_mutex = xSemaphoreCreateMutex();
+    event_queue_set_lock(queue_lock, queue_unlock);
+    event_pipeline_init(&pipeline, &pipeline_ops, PUBLISH_BURST, PRIORITY_RESERVE);
+    event_bus_register(&serial_sink);
+    event_bus_register(&position_sink);
+    event_bus_register(&mqtt_sink);
+    event_bus_register(&http_sink);
+    supervisor_set_pre_reset_hook(save_pending_events);
+
+    xTaskCreate(rf_task, "rf", RF_TASK_STACK, NULL, RF_TASK_PRIORITY, &rf_task_handle);
+    xTaskCreate(publish_task, "publish", PUBLISH_TASK_STACK, NULL,
+                PUBLISH_TASK_PRIORITY, &publish_task_handle);
+    xTaskCreate(housekeeping_task, "housekeeping", HOUSEKEEPING_TASK_STACK, NULL,
+                HOUSEKEEPING_TASK_PRIORITY, &housekeeping_task_handle);
+    xTaskCreate(http_task, "http", HTTP_TASK_STACK, NULL, HTTP_TASK_PRIORITY, &http_task_handle);
+
+    // RF isolada no core 1; as demais migram livremente
+    vTaskCoreAffinitySet(rf_task_handle, 1 << 1);
+
+    vTaskStartScheduler();
+
+    // Nunca alcançado
+    return 0;
+}
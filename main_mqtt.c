@@ -5,75 +5,120 @@
 // =====================================================
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include "pico/stdlib.h"
 #include "pico/cyw43_arch.h"
 #include "hardware/spi.h"
-#include "lwip/apps/mqtt.h"
-#include "lwip/dns.h"
+#include "hardware/watchdog.h"
 #include "mfrc522.h"
+#include "mfrc522_bench.h"
+#include "rfid_config.h"
+#include "supervisor.h"
+#include "event_queue.h"
+#include "event_bus.h"
+#include "tag_map.h"
+#include "agv_tracker.h"
+#include "net_stats.h"
+#include "mem_monitor.h"
+#include "mqtt_link.h"
+#include "pipeline_stats.h"
+#include "wifi_link.h"
+#include "link_supervisor.h"
+#include "time_sync.h"
+#include "event_auth.h"
+#include "rules.h"
+#include "event_batch.h"
+#include "card_ops.h"
+#include "ota.h"
+#include "crash_dump.h"
+#include "tag_debounce.h"
+#include "event_json.h"
+#include "event_pipeline.h"
 
 // ========== CONFIGURAÇÕES DO PROJETO ==========
 
-// 🔧 CONFIGURAÇÕES DE WIFI
-#define WIFI_SSID       "TP-Link_29B5"           // ⚠️ ALTERE AQUI: Nome da sua rede WiFi
-#define WIFI_PASSWORD   "23438651"          // ⚠️ ALTERE AQUI: Senha da sua rede WiFi
+// As configurações (WiFi, broker, tópicos, pinos e temporizações) ficam na
+// flash e são carregadas no boot por rfid_config_load(). Os valores padrão
+// estão em lib/rfid_config.h. Para alterar um leitor sem recompilar, use o
+// console serial:
+//   cfg show                 -> mostra a configuração ativa
+//   cfg set <campo> <valor>  -> altera um campo (ex: cfg set wifi_ssid MinhaRede)
+//   cfg save                 -> grava na flash
+//   cfg reboot               -> reinicia aplicando a nova configuração
+//   bench                    -> mede o custo dos acessos a registradores
+//   bench compare            -> compara SPI de hardware e SPI em PIO
+//   net                      -> uso de memória do lwIP (heap e pools)
+//   net reset                -> zera os máximos e contadores de falha
+//   mem                      -> pico de uso das pilhas e estado do heap
+//   lat                      -> latência leitura -> publicação e vazão
+//   lat reset                -> zera as medidas de latência
+//   wifi                     -> sinal, power save, quedas e roaming do WiFi
+//   bus                      -> entregas, atraso e perdas de cada sink de eventos
+//   time                     -> relógio comum: servidor, erro estimado e deriva
+//   auth                     -> assinatura dos eventos (auth bench: custo por evento)
+//   rules                    -> regras de borda ativas e acertos (rules clear: apaga)
+//   batch                    -> fila pendente em lotes binários (batch bench: compressão e custo)
+//   cards                    -> comandos remotos de cartão pendentes e contadores
+//   ota                      -> atualização de firmware (ota <url> <bytes> <sha256>,
+//                               ota abort, ota confirm, ota rollback)
+//   crash                    -> último HardFault registrado (crash test: provoca um)
+//   map                      -> mapa de marcadores (map set <UID> <mm>, map del <UID>,
+//                               map loop <mm>, map clear; gravado sozinho)
 
-// 🔧 CONFIGURAÇÕES DO BROKER MQTT
-#define MQTT_BROKER_IP  "192.168.0.103"      // ⚠️ ALTERE AQUI: IP do computador rodando o broker
-#define MQTT_BROKER_PORT 1883                // Porta padrão do MQTT
-#define MQTT_CLIENT_ID  "PicoW-RFID-Reader"  // ID único deste dispositivo
+// ========== VARIÁVEIS GLOBAIS ==========
 
-// 📡 TÓPICOS MQTT (conforme documentação do projeto)
-#define MQTT_TOPIC_RFID     "agv/rfid"       // Publicar leituras RFID
-#define MQTT_TOPIC_STATUS   "agv/sensors/rfid/status" // Status do leitor
+// Leitor RFID
+MFRC522Ptr_t mfrc = NULL;
 
-// 🔌 PINAGEM DO LEITOR RFID MFRC522
-#define PIN_MISO    4                        // SPI MISO (Master In Slave Out)
-#define PIN_CS      5                        // SPI CS (Chip Select)
-#define PIN_SCK     2                        // SPI Clock
-#define PIN_MOSI    3                        // SPI MOSI (Master Out Slave In)
-#define PIN_RST     0                        // Reset do MFRC522
+// Debounce das leituras (mesma tag parada no campo)
+static tag_debounce_t debounce;
 
-// ⚙️ CONFIGURAÇÕES DE OPERAÇÃO
-#define SCAN_INTERVAL_MS    500              // Intervalo entre leituras (ms)
-#define DEBOUNCE_TIME_MS    3000             // Tempo para ignorar mesma tag (ms)
-#define RECONNECT_DELAY_MS  5000             // Delay antes de reconectar MQTT
+// Entrega ao MQTT e escoamento da fila pendente
+static event_pipeline_t pipeline;
 
-// ========== VARIÁVEIS GLOBAIS ==========
+// Leitor respondeu no PCD_Init (saúde da imagem em teste da OTA)
+static bool rf_ok = false;
+
+// Configuração ativa (constante após o boot)
+const rfid_config_t *cfg = NULL;
+
+// cyw43 iniciado (cyw43_arch_poll() só pode ser chamado com ele ativo)
+bool net_ready = false;
+
+// Informações de boot do supervisor (reinício quente, último motivo)
+const supervisor_boot_info_t *boot_info = NULL;
 
-// Cliente MQTT
-mqtt_client_t *mqtt_client = NULL;
-bool mqtt_connected = false;
-ip_addr_t mqtt_broker_ip;
+// Última amostra de pilhas/heap (atualizada junto com o status)
+mem_usage_t mem_usage;
 
-// Controle de leitura RFID
-volatile uint8_t last_uid[10] = {0};
-volatile uint8_t last_uid_size = 0;
-volatile absolute_time_t last_read_time;
+// Máximo de eventos comuns da fila publicados por iteração do loop
+#define PUBLISH_BURST  8
 
-// Status da conexão
-bool wifi_connected = false;
-absolute_time_t last_reconnect_attempt;
+// Vagas da janela de publicação (QoS 1 em voo) que os eventos comuns nunca
+// ocupam: um evento prioritário sai na hora mesmo com a fila escoando
+#define PRIORITY_RESERVE  2
+
+// Console serial de provisionamento
+static char console_line[128];
+static uint8_t console_len = 0;
 
 // ========== PROTÓTIPOS DE FUNÇÕES ==========
 
 // Funções de inicialização
 void setup_gpio(void);
-void connect_wifi(void);
-void mqtt_init_and_connect(void);
 
-// Callbacks MQTT
-void mqtt_connection_cb(mqtt_client_t *client, void *arg, mqtt_connection_status_t status);
-void mqtt_pub_request_cb(void *arg, err_t result);
-void dns_found_cb(const char *hostname, const ip_addr_t *ipaddr, void *arg);
+// Callback MQTT
+void on_mqtt_connected(void);
 
 // Funções de operação
-void publish_rfid_tag(const uint8_t *uid, uint8_t uid_size);
+void record_rfid_tag(const uint8_t *uid, uint8_t uid_size);
+bool publish_rfid_tag(const rfid_event_t *ev);
+void register_event_sinks(void);
+void publish_pending_events(void);
 void publish_status(const char *status);
-bool is_same_tag(const uint8_t *uid, uint8_t uid_size);
-void uid_to_hex_string(const uint8_t *uid, uint8_t size, char *output);
+void console_poll(void);
 
 // ========== IMPLEMENTAÇÃO ==========
 
@@ -81,275 +126,583 @@ void uid_to_hex_string(const uint8_t *uid, uint8_t size, char *output);
  * Configura os pinos GPIO e inicializa SPI para o MFRC522
  */
 void setup_gpio(void) {
-    // Configura pino de reset
-    gpio_init(PIN_RST);
-    gpio_set_dir(PIN_RST, GPIO_OUT);
-    gpio_put(PIN_RST, 1);  // Reset inativo (HIGH)
+#if MFRC522_STATIC_CONFIG
+    // Pinos fixos na compilação (lib/mfrc522_config.h)
+    const uint pin_rst = MFRC522_PIN_RST, pin_cs = MFRC522_PIN_CS;
+    const uint pin_miso = MFRC522_PIN_MISO, pin_sck = MFRC522_PIN_SCK, pin_mosi = MFRC522_PIN_MOSI;
+    const uint bus = MFRC522_SPI_BUS;
+#else
+    const uint pin_rst = cfg->pin_rst, pin_cs = cfg->pin_cs;
+    const uint pin_miso = cfg->pin_miso, pin_sck = cfg->pin_sck, pin_mosi = cfg->pin_mosi;
+    const uint bus = cfg->reader_bus;
+#endif
 
-    // Inicializa SPI0 a 1MHz
-    spi_init(spi0, 1000000);
-    gpio_set_function(PIN_MISO, GPIO_FUNC_SPI);
-    gpio_set_function(PIN_SCK, GPIO_FUNC_SPI);
-    gpio_set_function(PIN_MOSI, GPIO_FUNC_SPI);
+    // Configura pino de reset
+    gpio_init(pin_rst);
+    gpio_set_dir(pin_rst, GPIO_OUT);
+    gpio_put(pin_rst, 1);  // Reset inativo (HIGH)
+
+    // Inicializa a 1MHz o SPI escolhido por reader_bus (no PIO, o
+    // PCD_Init assume os pinos)
+    if (bus != MFRC522_BUS_PIO) {
+        spi_init(bus == 1 ? spi1 : spi0, 1000000);
+        gpio_set_function(pin_miso, GPIO_FUNC_SPI);
+        gpio_set_function(pin_sck, GPIO_FUNC_SPI);
+        gpio_set_function(pin_mosi, GPIO_FUNC_SPI);
+    }
 
     // Configura Chip Select (CS)
-    gpio_init(PIN_CS);
-    gpio_set_dir(PIN_CS, GPIO_OUT);
-    gpio_put(PIN_CS, 1);  // CS inativo (HIGH)
+    gpio_init(pin_cs);
+    gpio_set_dir(pin_cs, GPIO_OUT);
+    gpio_put(pin_cs, 1);  // CS inativo (HIGH)
 
     printf("[RFID] GPIO configurado\n");
 }
 
 /**
- * Conecta ao WiFi
+ * Chamado a cada conexão aceita pelo broker
  */
-void connect_wifi(void) {
-    printf("[WiFi] Conectando a: %s\n", WIFI_SSID);
-
-    if (cyw43_arch_init()) {
-        printf("[WiFi] ERRO: Falha ao inicializar CYW43!\n");
-        return;
-    }
-
-    cyw43_arch_enable_sta_mode();
+void on_mqtt_connected(void) {
+    // Publica status de inicialização
+    publish_status("online");
+}
 
-    printf("[WiFi] Aguardando conexao...\n");
+/**
+ * Registra a leitura de uma tag no barramento de eventos (já passou pelo
+ * debounce, que vale também para as descartadas pelas regras).
+ * Caminho de RF: só copia o evento; log e publicação ficam nos sinks.
+ */
+void record_rfid_tag(const uint8_t *uid, uint8_t uid_size) {
+    rfid_event_t ev = {0};
+    memcpy(ev.uid, uid, uid_size);
+    ev.uid_size = uid_size;
+    ev.timestamp_ms = to_ms_since_boot(get_absolute_time());
+    ev.detect_us = time_us_32();
+    crash_trace(CRASH_TRACE_TAG, (uint32_t)uid[0] << 24 | (uint32_t)uid[1] << 16 |
+                                 (uint32_t)uid[2] << 8 | uid[3]);
+
+    // Regras de borda: descarte, agregação, prioridade e rota
+    if (!rules_apply(&ev)) return;
+
+    event_bus_produce(&ev);
+}
 
-    if (cyw43_arch_wifi_connect_timeout_ms(WIFI_SSID, WIFI_PASSWORD,
-                                           CYW43_AUTH_WPA2_AES_PSK, 30000)) {
-        printf("[WiFi] ERRO: Falha ao conectar!\n");
-        printf("[WiFi] Verifique SSID e senha!\n");
-        wifi_connected = false;
-        return;
+/**
+ * Publica leitura de tag RFID no broker MQTT
+ * Formato JSON: {"tag":"A1B2C3D4","timestamp":1234567890}
+ * Eventos restaurados da flash levam "restored":true (timestamp do boot anterior)
+ * O tópico é o da rota da regra que casou, ou topic_rfid
+ *
+ * @return true se o lwIP aceitou a mensagem
+ */
+bool publish_rfid_tag(const rfid_event_t *ev) {
+    // Cria payload JSON conforme especificação do projeto (lib/event_json.h),
+    // com o instante no relógio comum dos leitores quando sincronizado
+    uint64_t ts_us;
+    bool synced = time_sync_event_unix_us(ev, &ts_us);
+    char payload[EVENT_JSON_MAX + EVENT_AUTH_OVERHEAD];
+    int len = event_json_format(ev, synced ? &ts_us : NULL, payload,
+                                sizeof(payload) - EVENT_AUTH_OVERHEAD);
+
+    char topic[RULES_TOPIC_LEN];
+    rules_route_topic(ev, topic, sizeof(topic));
+    event_auth_sign(topic, payload, len, sizeof(payload));  // Contador + MAC
+
+    printf("[MQTT] Publicando em %s: %s\n", topic, payload);
+
+    // Publica no tópico agv/rfid (ou na rota), QoS 1 (pelo menos uma entrega)
+    if (!link_supervisor_publish(topic, payload, 1)) {
+        return false;  // ERR_MEM: janela de publicações cheia, tenta depois
     }
 
-    wifi_connected = true;
-    printf("[WiFi] Conectado com sucesso!\n");
-    printf("[WiFi] IP: %s\n", ip4addr_ntoa(netif_ip4_addr(netif_list)));
+    pipeline_stats_published(ev->detect_us, time_us_32(),
+                             ev->flags & EVENT_FLAG_RESTORED, EVENT_CLASS(ev));
+    printf("----------------------------------------\n");
+    return true;
 }
 
 /**
- * Callback chamado quando a resolução DNS é concluída
+ * Escoa a fila de eventos pendentes enquanto o broker estiver conectado
+ * (política em lib/event_pipeline.h). Fila comum longa (volta de uma
+ * queda) sai em lotes binários, se batch_codec ligado.
  */
-void dns_found_cb(const char *hostname, const ip_addr_t *ipaddr, void *arg) {
-    if (ipaddr != NULL) {
-        mqtt_broker_ip = *ipaddr;
-        printf("[MQTT] Broker resolvido: %s\n", ip4addr_ntoa(ipaddr));
-    } else {
-        printf("[MQTT] ERRO: Falha ao resolver hostname!\n");
+void publish_pending_events(void) {
+    uint32_t sent = event_pipeline_drain(&pipeline);
+
+    // Heartbeat somente se houve progresso ou não há nada a publicar
+    if (sent > 0 || event_queue_count() == 0 || !link_supervisor_online()) {
+        supervisor_heartbeat(SUP_TASK_PUBLISH);
     }
 }
 
 /**
- * Callback de conexão MQTT
+ * Publica o resumo de cada janela de agregação encerrada (regras 'aggregate').
+ * Sem broker, a janela segue acumulando até a próxima conexão.
  */
-void mqtt_connection_cb(mqtt_client_t *client, void *arg, mqtt_connection_status_t status) {
-    if (status == MQTT_CONNECT_ACCEPTED) {
-        mqtt_connected = true;
-        printf("[MQTT] Conectado ao broker!\n");
+void publish_rule_summaries(void) {
+    rules_summary_t s;
+
+    while (link_supervisor_online() &&
+           rules_aggregate_peek(to_ms_since_boot(get_absolute_time()), &s)) {
+        char uid_str[EVENT_JSON_UID_HEX_SIZE];
+        event_json_uid_hex(s.last_uid, s.last_uid_size, uid_str);
+
+        rfid_event_t route = { .flags = (uint8_t)(s.route << EVENT_ROUTE_SHIFT) };
+        char topic[RULES_TOPIC_LEN];
+        rules_route_topic(&route, topic, sizeof(topic));
+
+        char payload[192 + EVENT_AUTH_OVERHEAD];
+        int len = snprintf(payload, sizeof(payload) - EVENT_AUTH_OVERHEAD,
+                           "{\"aggregate\":%u,\"count\":%lu,\"timestamp\":%lu,"
+                           "\"window_ms\":%lu,\"last_tag\":\"%s\",\"reader\":\"PicoW\"}",
+                           s.rule, (unsigned long)s.count, (unsigned long)s.first_ms,
+                           (unsigned long)s.window_ms, uid_str);
+        event_auth_sign(topic, payload, len, sizeof(payload));
+
+        if (!link_supervisor_publish(topic, payload, 1)) break;
+        rules_aggregate_done(&s);
+        printf("[RULES] Resumo publicado em %s: %s\n", topic, payload);
+    }
+}
 
-        // Publica status de inicialização
-        publish_status("online");
+// ========== SINKS DE EVENTOS ==========
 
-        // LED integrado: aceso = conectado
-        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
-    } else {
-        mqtt_connected = false;
-        printf("[MQTT] Conexao falhou! Status: %d\n", status);
-        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
-    }
+/**
+ * Sink serial: log legível de cada leitura
+ */
+static bool serial_sink_deliver(const rfid_event_t *ev, void *ctx) {
+    (void)ctx;
+    char uid_str[EVENT_JSON_UID_HEX_SIZE];
+    event_json_uid_hex(ev->uid, ev->uid_size, uid_str);
+    printf("[RFID] Tag detectada: %s\n", uid_str);
+    return true;
 }
 
 /**
- * Callback de confirmação de publicação MQTT
+ * Sink MQTT: publica direto ou guarda na fila pendente, escoada por
+ * publish_pending_events() (política em lib/event_pipeline.h)
  */
-void mqtt_pub_request_cb(void *arg, err_t result) {
-    if (result == ERR_OK) {
-        printf("[MQTT] Mensagem publicada com sucesso!\n");
-
-        // Pisca LED para indicar publicação
-        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
-        sleep_ms(50);
-        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
-    } else {
-        printf("[MQTT] ERRO ao publicar! Codigo: %d\n", result);
+static bool mqtt_sink_deliver(const rfid_event_t *ev, void *ctx) {
+    (void)ctx;
+    if (!event_pipeline_deliver(&pipeline, ev)) {
+        printf("[QUEUE] AVISO: fila cheia, evento mais antigo descartado\n");
     }
+    return true;
 }
 
 /**
- * Inicializa e conecta ao broker MQTT
+ * Sink de posição: marcadores do mapa viram posição, velocidade e ETA do
+ * AGV. Tempo real: sem broker o evento de posição é descartado (a leitura
+ * em si segue pelo sink MQTT).
  */
-void mqtt_init_and_connect(void) {
-    printf("[MQTT] Inicializando cliente...\n");
-
-    // Se já existe um cliente, desconecta e libera recursos
-    if (mqtt_client != NULL) {
-        printf("[MQTT] Liberando cliente antigo...\n");
-        mqtt_disconnect(mqtt_client);
-        mqtt_client_free(mqtt_client);
-        mqtt_client = NULL;
-        mqtt_connected = false;
-        sleep_ms(500); // Aguarda liberação de recursos
-    }
-
-    mqtt_client = mqtt_client_new();
-    if (mqtt_client == NULL) {
-        printf("[MQTT] ERRO: Falha ao criar cliente!\n");
-        return;
+static bool position_sink_deliver(const rfid_event_t *ev, void *ctx) {
+    (void)ctx;
+    agv_position_t pos;
+    if (!agv_tracker_update(ev, &pos)) return true;  // Não é marcador
+
+    char payload[256 + EVENT_AUTH_OVERHEAD];
+    int len = agv_tracker_format_json(ev, &pos, payload, sizeof(payload) - EVENT_AUTH_OVERHEAD);
+    event_auth_sign(cfg->topic_position, payload, len, sizeof(payload));
+    printf("[AGV] %s\n", payload);
+
+    if (link_supervisor_online()) {
+        link_supervisor_publish(cfg->topic_position, payload, 0);
     }
+    return true;
+}
 
-    // Tenta converter IP do broker
-    if (!ip4addr_aton(MQTT_BROKER_IP, &mqtt_broker_ip)) {
-        printf("[MQTT] IP invalido, tentando resolver DNS...\n");
+static event_sink_t serial_sink = { .name = "serial", .deliver = serial_sink_deliver };
+static event_sink_t position_sink = { .name = "position", .deliver = position_sink_deliver };
+static event_sink_t mqtt_sink = { .name = "mqtt", .deliver = mqtt_sink_deliver };
 
-        // Se não for IP válido, tenta resolver via DNS
-        err_t err = dns_gethostbyname(MQTT_BROKER_IP, &mqtt_broker_ip, dns_found_cb, NULL);
+// Transporte do sink MQTT e do escoamento da fila
+static const event_pipeline_ops_t pipeline_ops = {
+    .online = link_supervisor_online,
+    .window_free = link_supervisor_window_free,
+    .publish = publish_rfid_tag,
+    .publish_batch = event_batch_publish,
+};
 
-        if (err == ERR_INPROGRESS) {
-            printf("[MQTT] Aguardando resolucao DNS...\n");
-            // Aguarda até 5 segundos pela resolução
-            for (int i = 0; i < 50; i++) {
-                sleep_ms(100);
-                cyw43_arch_poll();
-                if (mqtt_broker_ip.addr != 0) break;
-            }
-        }
+/**
+ * Registra as saídas das leituras. Para uma nova saída (UDP, log binário...),
+ * basta um event_sink_t com a função de entrega.
+ */
+void register_event_sinks(void) {
+    event_pipeline_init(&pipeline, &pipeline_ops, PUBLISH_BURST, PRIORITY_RESERVE);
+    event_bus_register(&serial_sink);
+    event_bus_register(&position_sink);
+    event_bus_register(&mqtt_sink);
+}
 
-        if (mqtt_broker_ip.addr == 0) {
-            printf("[MQTT] ERRO: Nao foi possivel resolver o broker!\n");
-            return;
-        }
+/**
+ * Publica status do leitor RFID
+ */
+void publish_status(const char *status) {
+    if (!link_supervisor_online()) return;
+
+    // Estático: a pilha do core 0 tem só 2 KB. Cabe no anel de saída do
+    // MQTT (MQTT_OUTPUT_RINGBUF_SIZE) com o cabeçalho e o tópico
+    static char payload[1200];
+    int len = snprintf(payload, sizeof(payload),
+                       "{\"status\":\"%s\",\"reader\":\"PicoW\",\"restarts\":%lu,"
+                       "\"reset_reason\":\"%s\",\"reset_phase\":\"%s\",\"queued\":%lu,"
+                       "\"queued_prio\":%lu,",
+                       status, (unsigned long)boot_info->restarts,
+                       supervisor_reason_name(boot_info->last_reason),
+                       supervisor_phase_name(boot_info->last_phase),
+                       (unsigned long)event_queue_count(),
+                       (unsigned long)event_queue_class_count(EVENT_CLASS_PRIORITY));
+
+    // Uso de memória do lwIP para dimensionar os perfis de lwipopts.h
+    len += net_stats_format_json(payload + len, sizeof(payload) - len - 1);
+    if (len >= (int)sizeof(payload) - 2) return;
+
+    // Pilhas e heap (amostrados no loop principal)
+    payload[len++] = ',';
+    len += mem_monitor_format_json(&mem_usage, payload + len, sizeof(payload) - len - 1);
+    if (len >= (int)sizeof(payload) - 2) return;
+
+    // Latência e vazão do caminho leitura -> publicação
+    payload[len++] = ',';
+    len += pipeline_stats_format_json(payload + len, sizeof(payload) - len - 1);
+    if (len >= (int)sizeof(payload) - 2) return;
+
+    // Enlace: sinal, quedas, roaming e ida e volta até o broker
+    payload[len++] = ',';
+    len += wifi_link_format_json(payload + len, sizeof(payload) - len - 1);
+    if (len >= (int)sizeof(payload) - 2) return;
+    payload[len++] = ',';
+    len += link_supervisor_format_json(payload + len, sizeof(payload) - len - 1);
+    if (len >= (int)sizeof(payload) - 2) return;
+
+    // Atraso e perdas de cada sink do barramento de eventos
+    payload[len++] = ',';
+    len += event_bus_format_json(payload + len, sizeof(payload) - len - 1);
+    if (len >= (int)sizeof(payload) - 2) return;
+
+    // Relógio comum: erro estimado e deriva
+    payload[len++] = ',';
+    len += time_sync_format_json(payload + len, sizeof(payload) - len - 1);
+    if (len >= (int)sizeof(payload) - 2) return;
+
+    // Regras de borda: descartes, agregações e custo da avaliação
+    payload[len++] = ',';
+    len += rules_format_json(payload + len, sizeof(payload) - len - 1);
+    if (len >= (int)sizeof(payload) - 2) return;
+
+    // Lotes binários da fila pendente: compressão e custo
+    payload[len++] = ',';
+    len += event_batch_format_json(payload + len, sizeof(payload) - len - 1);
+    if (len >= (int)sizeof(payload) - 2) return;
+
+    // Atualização de firmware: imagem em teste, download em andamento
+    payload[len++] = ',';
+    len += ota_format_json(payload + len, sizeof(payload) - len - 1);
+    if (len >= (int)sizeof(payload) - 1) return;
+    strcat(payload, "}");
+
+    link_supervisor_publish(cfg->topic_status, payload, 0);
+}
+
+/**
+ * Mapa de marcadores recebido por MQTT (contexto do lwIP: só troca o mapa
+ * em RAM; a gravação na flash fica para o loop principal)
+ */
+static void on_map_message(const char *topic, const char *data, uint32_t len) {
+    int markers = tag_map_parse(data, len);
+    if (markers < 0) {
+        printf("[MAP] ERRO: mapa invalido recebido em %s\n", topic);
+    } else {
+        printf("[MAP] Mapa recebido por MQTT: %d marcadores\n", markers);
     }
+}
 
-    printf("[MQTT] Conectando ao broker %s:%d...\n",
-           ip4addr_ntoa(&mqtt_broker_ip), MQTT_BROKER_PORT);
+/**
+ * Tabela de regras recebida por MQTT (contexto do lwIP; gravada na flash
+ * pelo loop principal). Mensagem vazia apaga as regras.
+ */
+static void on_rules_message(const char *topic, const char *data, uint32_t len) {
+    int n = rules_load_table((const uint8_t *)data, len);
+    if (n < 0) {
+        printf("[RULES] ERRO: tabela invalida recebida em %s (%lu bytes)\n",
+               topic, (unsigned long)len);
+    } else {
+        printf("[RULES] Tabela recebida por MQTT: %d regras para este leitor\n", n);
+    }
+}
 
-    // Configuração de conexão
-    struct mqtt_connect_client_info_t ci;
-    memset(&ci, 0, sizeof(ci));
-    ci.client_id = MQTT_CLIENT_ID;
-    ci.keep_alive = 60;  // Keep-alive de 60 segundos
+/**
+ * Comando remoto de cartão (contexto do lwIP; executado no próximo cartão
+ * pelo caminho de RF)
+ */
+static void on_card_command(const char *topic, const char *data, uint32_t len) {
+    card_ops_submit(topic, data, len);
+}
 
-    // Conecta ao broker
-    err_t err = mqtt_client_connect(mqtt_client, &mqtt_broker_ip, MQTT_BROKER_PORT,
-                                    mqtt_connection_cb, NULL, &ci);
+/**
+ * Pedido de atualização de firmware (contexto do lwIP; o download roda em
+ * ota_service no loop principal)
+ */
+static void on_ota_message(const char *topic, const char *data, uint32_t len) {
+    ota_on_message(topic, data, len);
+}
 
-    if (err != ERR_OK) {
-        printf("[MQTT] ERRO ao iniciar conexao! Codigo: %d\n", err);
-        mqtt_connected = false;
+/**
+ * Comandos 'ota' do console
+ */
+static void console_ota(void) {
+    char *arg = strtok(NULL, " ");
+    if (arg == NULL) {
+        ota_print();
+    } else if (strcmp(arg, "abort") == 0) {
+        ota_abort();
+    } else if (strcmp(arg, "confirm") == 0) {
+        if (ota_confirm() != 0) printf("[OTA] Nenhuma imagem em teste\n");
+    } else if (strcmp(arg, "rollback") == 0) {
+        if (ota_rollback() != 0) printf("[OTA] Nenhuma imagem em teste\n");
     } else {
-        printf("[MQTT] Conexao iniciada, aguardando confirmacao...\n");
+        char *size = strtok(NULL, " ");
+        char *sha256 = strtok(NULL, " ");
+        if (size == NULL || sha256 == NULL) {
+            printf("[OTA] Uso: ota <url> <bytes> <sha256> | abort | confirm | rollback\n");
+            return;
+        }
+        ota_start(arg, (uint32_t)strtoul(size, NULL, 10), sha256);
     }
 }
 
 /**
- * Converte UID para string hexadecimal (ex: "A1B2C3D4")
+ * Comandos 'map' do console
  */
-void uid_to_hex_string(const uint8_t *uid, uint8_t size, char *output) {
-    for (uint8_t i = 0; i < size; i++) {
-        sprintf(output + (i * 2), "%02X", uid[i]);
+static void console_map(void) {
+    char *arg = strtok(NULL, " ");
+    char *uid_arg = arg ? strtok(NULL, " ") : NULL;
+    char *mm_arg = uid_arg ? strtok(NULL, " ") : NULL;
+    uint8_t uid[EVENT_UID_MAX];
+    uint8_t uid_size;
+
+    if (arg == NULL) {
+        tag_map_print();
+    } else if (strcmp(arg, "set") == 0 && mm_arg != NULL &&
+               (uid_size = tag_map_parse_uid(uid_arg, strlen(uid_arg), uid)) > 0) {
+        printf(tag_map_set(uid, uid_size, strtoul(mm_arg, NULL, 10))
+               ? "[MAP] Marcador gravado\n" : "[MAP] ERRO: mapa cheio\n");
+    } else if (strcmp(arg, "del") == 0 && uid_arg != NULL &&
+               (uid_size = tag_map_parse_uid(uid_arg, strlen(uid_arg), uid)) > 0) {
+        printf(tag_map_remove(uid, uid_size)
+               ? "[MAP] Marcador removido\n" : "[MAP] Marcador nao encontrado\n");
+    } else if (strcmp(arg, "loop") == 0 && uid_arg != NULL) {
+        tag_map_set_loop(strtoul(uid_arg, NULL, 10));
+        printf("[MAP] Percurso: %lu mm\n", (unsigned long)tag_map_loop_mm());
+    } else if (strcmp(arg, "clear") == 0) {
+        tag_map_clear();
+        printf("[MAP] Mapa apagado\n");
+    } else if (strcmp(arg, "save") == 0) {
+        tag_map_persist(true);
+    } else {
+        printf("Uso: map | map set <UID> <mm> | map del <UID> | map loop <mm> | "
+               "map clear | map save\n");
     }
-    output[size * 2] = '\0';
 }
 
 /**
- * Verifica se é a mesma tag lida recentemente (debounce)
+ * Executa um comando do console de provisionamento
  */
-bool is_same_tag(const uint8_t *uid, uint8_t uid_size) {
-    // Verifica se é a mesma tag
-    if (last_uid_size != uid_size) return false;
+static void console_execute(char *line) {
+    char *cmd = strtok(line, " ");
+    if (cmd == NULL) return;
 
-    for (uint8_t i = 0; i < uid_size; i++) {
-        if (last_uid[i] != uid[i]) return false;
+    if (strcmp(cmd, "bench") == 0) {
+        if (mfrc == NULL) {
+            printf("[BENCH] Leitor ainda nao inicializado\n");
+            return;
+        }
+        char *arg = strtok(NULL, " ");
+#if MFRC522_PIO_SPI
+        if (arg != NULL && strcmp(arg, "compare") == 0) {
+            mfrc522_bench_compare_buses(mfrc, cfg->reader_bus == 1 ? spi1 : spi0,
+                                        pio0, 1000);
+            return;
+        }
+#endif
+        (void)arg;
+        mfrc522_bench_result_t result;
+        watchdog_update();
+        mfrc522_bench_register_access(mfrc, 1000, &result);
+        mfrc522_bench_print(&result);
+        return;
     }
 
-    // Verifica se passou tempo suficiente desde a última leitura
-    absolute_time_t now = get_absolute_time();
-    int64_t diff_ms = absolute_time_diff_us(last_read_time, now) / 1000;
+    if (strcmp(cmd, "net") == 0) {
+        char *arg = strtok(NULL, " ");
+        if (arg != NULL && strcmp(arg, "reset") == 0) {
+            net_stats_reset_peaks();
+            printf("[NET] Maximos zerados\n");
+        } else {
+            net_stats_print();
+        }
+        return;
+    }
 
-    return diff_ms < DEBOUNCE_TIME_MS;
-}
+    if (strcmp(cmd, "lat") == 0) {
+        char *arg = strtok(NULL, " ");
+        if (arg != NULL && strcmp(arg, "reset") == 0) {
+            pipeline_stats_reset();
+            printf("[LAT] Medidas zeradas\n");
+        } else {
+            pipeline_stats_print("bare-metal (poll)");
+        }
+        return;
+    }
 
-/**
- * Publica leitura de tag RFID no broker MQTT
- * Formato JSON: {"tag":"A1B2C3D4","timestamp":1234567890}
- */
-void publish_rfid_tag(const uint8_t *uid, uint8_t uid_size) {
-    if (!mqtt_connected) {
-        printf("[MQTT] Nao conectado, pulando publicacao...\n");
+    if (strcmp(cmd, "mem") == 0) {
+        mem_monitor_print();
+        return;
+    }
+
+    if (strcmp(cmd, "map") == 0) {
+        console_map();
+        return;
+    }
+
+    if (strcmp(cmd, "bus") == 0) {
+        event_bus_print();
         return;
     }
 
-    // Converte UID para string hexadecimal
-    char uid_str[32] = {0};
-    uid_to_hex_string(uid, uid_size, uid_str);
+    if (strcmp(cmd, "time") == 0) {
+        time_sync_print();
+        return;
+    }
 
-    // Cria payload JSON conforme especificação do projeto
-    char payload[128];
-    uint32_t timestamp = to_ms_since_boot(get_absolute_time());
+    if (strcmp(cmd, "auth") == 0) {
+        char *arg = strtok(NULL, " ");
+        if (arg != NULL && strcmp(arg, "bench") == 0) {
+            watchdog_update();
+            event_auth_bench(200);
+            return;
+        }
+        event_auth_print();
+        return;
+    }
 
-    snprintf(payload, sizeof(payload),
-             "{\"tag\":\"%s\",\"timestamp\":%lu,\"reader\":\"PicoW\"}",
-             uid_str, timestamp);
+    if (strcmp(cmd, "rules") == 0) {
+        char *arg = strtok(NULL, " ");
+        if (arg != NULL && strcmp(arg, "clear") == 0) {
+            rules_load_table(NULL, 0);
+            printf("[RULES] Regras apagadas\n");
+        } else {
+            rules_print();
+        }
+        return;
+    }
 
-    printf("[RFID] Tag detectada: %s\n", uid_str);
-    printf("[MQTT] Publicando: %s\n", payload);
+    if (strcmp(cmd, "batch") == 0) {
+        char *arg = strtok(NULL, " ");
+        if (arg != NULL && strcmp(arg, "bench") == 0) {
+            watchdog_update();
+            event_batch_bench(20);
+            return;
+        }
+        event_batch_print();
+        return;
+    }
 
-    // Publica no tópico agv/rfid
-    err_t err = mqtt_publish(mqtt_client, MQTT_TOPIC_RFID, payload, strlen(payload),
-                            1,  // QoS 1 (pelo menos uma entrega)
-                            0,  // Retain: false
-                            mqtt_pub_request_cb, NULL);
+    if (strcmp(cmd, "cards") == 0) {
+        card_ops_print();
+        return;
+    }
 
-    if (err != ERR_OK) {
-        printf("[MQTT] ERRO ao publicar! Codigo: %d\n", err);
+    if (strcmp(cmd, "ota") == 0) {
+        console_ota();
+        return;
     }
 
-    // Salva última tag lida
-    memcpy((void*)last_uid, uid, uid_size);
-    last_uid_size = uid_size;
-    last_read_time = get_absolute_time();
-}
+    if (strcmp(cmd, "crash") == 0) {
+        char *arg = strtok(NULL, " ");
+        if (arg != NULL && strcmp(arg, "test") == 0) {
+            crash_dump_test();
+        }
+        crash_dump_print();
+        return;
+    }
 
-/**
- * Publica status do leitor RFID
- */
-void publish_status(const char *status) {
-    if (!mqtt_connected) return;
+    if (strcmp(cmd, "wifi") == 0) {
+        wifi_link_print();
+        link_supervisor_print();
+        return;
+    }
 
-    char payload[64];
-    snprintf(payload, sizeof(payload),
-             "{\"status\":\"%s\",\"reader\":\"PicoW\"}", status);
+    if (strcmp(cmd, "cfg") != 0) return;
 
-    mqtt_publish(mqtt_client, MQTT_TOPIC_STATUS, payload, strlen(payload),
-                0, 0, mqtt_pub_request_cb, NULL);
+    if (rfid_config_console(strtok(NULL, ""))) {
+        supervisor_reboot(SUP_REASON_REQUESTED);
+    }
 }
 
 /**
- * Reconecta ao MQTT se desconectado
+ * Lê caracteres do serial sem bloquear e executa linhas completas
  */
-void mqtt_reconnect(void) {
-    if (mqtt_connected || !wifi_connected) return;
-
-    // Verifica se já passou tempo suficiente desde a última tentativa
-    absolute_time_t now = get_absolute_time();
-    int64_t diff_ms = absolute_time_diff_us(last_reconnect_attempt, now) / 1000;
-
-    if (diff_ms < RECONNECT_DELAY_MS) {
-        return; // Ainda não é hora de tentar reconectar
+void console_poll(void) {
+    int c;
+    while ((c = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT) {
+        if (c == '\r' || c == '\n') {
+            if (console_len > 0) {
+                console_line[console_len] = '\0';
+                console_len = 0;
+                console_execute(console_line);
+            }
+        } else if (console_len < sizeof(console_line) - 1) {
+            console_line[console_len++] = (char)c;
+        }
     }
+}
 
-    printf("[MQTT] Tentando reconectar...\n");
-    last_reconnect_attempt = now;
-    mqtt_init_and_connect();
+/**
+ * Gancho de pré-reset do supervisor: grava a fila pendente na flash
+ */
+static void save_pending_events(void) {
+    supervisor_set_phase(SUP_PHASE_FLASH_WRITE);
+    event_queue_persist(true);
 }
 
 // ========== FUNÇÃO PRINCIPAL ==========
 
+/**
+ * Sem leitor utilizável: mantém rede, fila e OTA; RF fica fora da supervisão
+ */
+static void run_without_reader(void) {
+    while (1) {
+        if (net_ready) {
+            cyw43_arch_poll();
+        }
+        link_supervisor_service();
+        publish_pending_events();
+        if (ota_service(false)) {
+            supervisor_reboot(SUP_REASON_REQUESTED);
+        }
+        supervisor_heartbeat(SUP_TASK_NET);
+        supervisor_service();
+        sleep_ms(100);
+    }
+}
+
 int main() {
+    // Pinta as pilhas antes de qualquer chamada profunda
+    mem_monitor_init();
+
     // Inicializa comunicação serial (USB)
     stdio_init_all();
-    sleep_ms(3000);  // Aguarda estabilização
+
+    // Supervisor: identifica reinício quente e liga o watchdog
+    boot_info = supervisor_init();
+    supervisor_set_pre_reset_hook(save_pending_events);
+
+    // HardFault no boot anterior: registro vai para a flash e depois ao broker
+    crash_dump_init();
+    if (!boot_info->warm) {
+        sleep_ms(3000);  // Aguarda estabilização (apenas no boot a frio)
+    }
 
     printf("\n");
     printf("========================================\n");
@@ -357,56 +710,121 @@ int main() {
     printf("  Dashboard Integration\n");
     printf("========================================\n\n");
 
-    // PASSO 1: Conectar ao WiFi
-    connect_wifi();
-    if (!wifi_connected) {
-        printf("\n[ERRO] WiFi nao conectou! Verifique credenciais.\n");
-        printf("Encerrando...\n");
-        return 1;
+    // Primeira amostra de memória (vai no status de conexão)
+    mem_monitor_sample(&mem_usage);
+
+    // PASSO 0: Carregar configuração da flash
+    rfid_config_load();
+    cfg = rfid_config();
+
+    // Situação da atualização deixada pelo bootloader (imagem em teste?)
+    ota_init();
+
+    // Eventos não publicados antes do último reset
+    event_queue_restore();
+
+    // Marcadores do trilho (posição do AGV); o mapa também chega por MQTT
+    tag_map_load();
+    mqtt_link_subscribe(cfg->topic_map, on_map_message);
+
+    // Regras de borda; a tabela também chega por MQTT
+    rules_init();
+    rules_load();
+    mqtt_link_subscribe(cfg->topic_rules, on_rules_message);
+
+    // Operações remotas em cartões (leitura, escrita, NDEF)
+    if (cfg->card_ops) {
+        card_ops_init();
+        mqtt_link_subscribe(cfg->topic_cmd, on_card_command);
+        if (cfg->card_ops == 2 && cfg->auth_mode == 0) {
+            printf("[AVISO] card_ops 2 sem auth_mode: escritas aceitas sem assinatura\n");
+        }
     }
 
-    // PASSO 2: Conectar ao broker MQTT
-    mqtt_init_and_connect();
-    sleep_ms(2000);  // Aguarda callback de conexão
+    // Atualização de firmware pela rede
+    if (cfg->ota_enabled) {
+        mqtt_link_subscribe(cfg->topic_ota, on_ota_message);
+        if (cfg->auth_mode == 0) {
+            printf("[OTA] AVISO: ota_enabled sem auth_mode: pedidos de atualizacao aceitos sem assinatura\n");
+        }
+    }
 
-    if (!mqtt_connected) {
-        printf("\n[AVISO] MQTT nao conectou! Tentando continuar...\n");
-        printf("Verifique se o broker esta rodando em: %s:%d\n",
-               MQTT_BROKER_IP, MQTT_BROKER_PORT);
+    // Saídas das leituras (serial, posição, MQTT)
+    register_event_sinks();
+    event_auth_init();
+
+    // PASSO 1: Iniciar WiFi e MQTT em segundo plano. link_supervisor_service()
+    // conecta, reconecta após quedas e retoma o MQTT sem reinício; a leitura
+    // começa sem esperar a rede
+    supervisor_set_phase(SUP_PHASE_WIFI_CONNECT);
+    pipeline_stats_reset();
+    net_ready = link_supervisor_init(on_mqtt_connected) == 0;
+    if (!net_ready) {
+        printf("\n[AVISO] WiFi indisponivel: apenas leitura e fila local.\n");
+    } else {
+        time_sync_init();
     }
 
-    // PASSO 3: Configurar hardware do leitor RFID
+    // PASSO 2: Configurar hardware do leitor RFID
     printf("\n[RFID] Configurando hardware...\n");
+    supervisor_set_phase(SUP_PHASE_RF_INIT);
     setup_gpio();
 
-    // PASSO 4: Inicializar biblioteca MFRC522
-    MFRC522Ptr_t mfrc = MFRC522_Init();
+    // PASSO 3: Inicializar biblioteca MFRC522
+    mfrc = MFRC522_Init();
     if (mfrc == NULL) {
         printf("[ERRO] Falha ao inicializar MFRC522!\n");
         printf("Verifique conexoes do modulo RFID:\n");
-        printf("  MISO -> GP%d\n", PIN_MISO);
-        printf("  MOSI -> GP%d\n", PIN_MOSI);
-        printf("  SCK  -> GP%d\n", PIN_SCK);
-        printf("  CS   -> GP%d\n", PIN_CS);
-        printf("  RST  -> GP%d\n", PIN_RST);
+        printf("  MISO -> GP%d\n", cfg->pin_miso);
+        printf("  MOSI -> GP%d\n", cfg->pin_mosi);
+        printf("  SCK  -> GP%d\n", cfg->pin_sck);
+        printf("  CS   -> GP%d\n", cfg->pin_cs);
+        printf("  RST  -> GP%d\n", cfg->pin_rst);
         printf("  VCC  -> 3.3V\n");
         printf("  GND  -> GND\n");
-        while(1) sleep_ms(1000);
+        run_without_reader();
     }
 
-    PCD_Init(mfrc, spi0);
+#if MFRC522_STATIC_CONFIG
+    if (cfg->pin_cs != MFRC522_PIN_CS || cfg->pin_rst != MFRC522_PIN_RST) {
+        printf("[RFID] AVISO: pinos fixos na compilacao (CS=GP%d RST=GP%d), "
+               "configuracao de runtime ignorada\n", MFRC522_PIN_CS, MFRC522_PIN_RST);
+    }
+#endif
+    MFRC522_SetPins(mfrc, cfg->pin_cs, cfg->pin_sck, cfg->pin_mosi,
+                    cfg->pin_miso, cfg->pin_rst);
+    if (!MFRC522_SetBus(mfrc, cfg->reader_bus)) {
+        printf("[RFID] ERRO: reader_bus %u nao suportado neste build (PIO ou barramento "
+               "fixo na compilacao), configuracao recusada\n", cfg->reader_bus);
+        run_without_reader();
+    }
+    if (cfg->reader_bus == 2) {
+        printf("[RFID] Barramento: SPI em PIO\n");
+    }
+    if (boot_info->warm) {
+        MFRC522_SetResetHold(mfrc, 1);  // NRSTPD exige apenas 100 ns
+    }
+    if (!PCD_Init(mfrc, cfg->reader_bus == 1 ? spi1 : spi0)) {
+        printf("[RFID] ERRO: nenhuma state machine PIO livre para o leitor; "
+               "use 'cfg set reader_bus 0' com os pinos de SPI\n");
+        run_without_reader();
+    }
+    uint8_t version = PCD_ReadRegister(mfrc, VersionReg);
+    rf_ok = version == 0x91 || version == 0x92;
+    if (!rf_ok) {
+        printf("[RFID] AVISO: versao do chip inesperada (0x%02X)\n", version);
+    }
     printf("[RFID] Leitor inicializado com sucesso!\n\n");
 
     printf("========================================\n");
     printf("  Sistema pronto!\n");
     printf("========================================\n");
-    printf("Topico MQTT: %s\n", MQTT_TOPIC_RFID);
+    printf("Topico MQTT: %s\n", cfg->topic_rfid);
     printf("Formato: {\"tag\":\"HEX\",\"timestamp\":MS}\n");
     printf("\nAproxime tags RFID do leitor...\n\n");
 
-    // Inicializa controle de tempo
-    last_read_time = get_absolute_time();
-    last_reconnect_attempt = get_absolute_time();
+    // Debounce das leituras
+    tag_debounce_init(&debounce, cfg->debounce_time_ms);
 
     // ========== LOOP PRINCIPAL ==========
     // Escaneia continuamente por tags RFID e publica via MQTT
@@ -416,46 +834,77 @@ int main() {
 
     while (1) {
         // Processa eventos de rede (WiFi + MQTT)
-        cyw43_arch_poll();
-
-        // Reconecta MQTT se necessário
-        if (!mqtt_connected && wifi_connected) {
-            mqtt_reconnect();
+        supervisor_set_phase(SUP_PHASE_IDLE);
+        if (net_ready) {
+            cyw43_arch_poll();
         }
+        link_supervisor_service();  // WiFi, reconexões e MQTT
+        time_sync_service(wifi_link_is_up());
+        supervisor_heartbeat(SUP_TASK_NET);
+
+        // Processa comandos do console serial
+        console_poll();
 
         // Verifica se há cartão RFID próximo
+        supervisor_set_phase(SUP_PHASE_RF_SCAN);
+        pipeline_stats_scan(time_us_32());
         if (PICC_IsNewCardPresent(mfrc)) {
             if (PICC_ReadCardSerial(mfrc)) {
 
                 // Verifica se não é a mesma tag (debounce)
-                if (!is_same_tag(mfrc->uid.uidByte, mfrc->uid.size)) {
-
-                    // PUBLICA TAG NO MQTT!
-                    publish_rfid_tag(mfrc->uid.uidByte, mfrc->uid.size);
-
-                    printf("----------------------------------------\n");
+                if (tag_debounce_accept(&debounce, mfrc->uid.uidByte, mfrc->uid.size,
+                                        to_ms_since_boot(get_absolute_time()))) {
+                    // Só registra no barramento; os sinks rodam abaixo
+                    record_rfid_tag(mfrc->uid.uidByte, mfrc->uid.size);
                 }
 
+                // Comando remoto pendente para este cartão (mesmo se repetido)
+                card_ops_on_card(mfrc);
+
                 // Finaliza comunicação com o cartão
                 PCD_StopCrypto1(mfrc);
             }
         }
+        supervisor_heartbeat(SUP_TASK_RF);
+
+        // ENTREGA AOS SINKS E PUBLICA TAGS PENDENTES NO MQTT!
+        supervisor_set_phase(SUP_PHASE_PUBLISH);
+        event_bus_dispatch(PUBLISH_BURST);
+        publish_pending_events();
+        publish_rule_summaries();
+        card_ops_publish();
+        crash_dump_publish();
+
+        // Salva a fila na flash enquanto houver mudanças (com limite de frequência)
+        supervisor_set_phase(SUP_PHASE_FLASH_WRITE);
+        event_queue_persist(false);
+        tag_map_persist(false);
+        rules_persist();
+
+        // Download da imagem nova (fatias curtas de gravação) e confirmação
+        // da imagem em teste; reinicia quando a troca de slots é necessária
+        if (ota_service(link_supervisor_online() && rf_ok)) {
+            supervisor_reboot(SUP_REASON_REQUESTED);
+        }
 
         // Publica status periodicamente (a cada 30 segundos)
         absolute_time_t now = get_absolute_time();
         if (absolute_time_diff_us(last_status, now) > 30000000) {
+            mem_monitor_sample(&mem_usage);
             publish_status("online");
             last_status = now;
             printf("[INFO] Status publicado (loop: %lu)\n", loop_count);
         }
 
         loop_count++;
-        sleep_ms(SCAN_INTERVAL_MS);
+        supervisor_set_phase(SUP_PHASE_IDLE);
+        supervisor_service();
+        sleep_ms(cfg->scan_interval_ms);
     }
 
     // Cleanup (nunca alcançado neste código)
-    if (wifi_connected) {
-        mqtt_disconnect(mqtt_client);
+    if (net_ready) {
+        mqtt_link_disconnect();
         cyw43_arch_deinit();
     }
 
@@ -0,0 +1,80 @@
+// =====================================================
+// Bootloader da atualização OTA (alvo RFID_OTA_BOOT)
+//
+// Ocupa os primeiros FLASH_OTA_BOOT_SIZE bytes da flash. A cada boot
+// confere o setor de controle (lib/ota_slots.h): troca os slots quando há
+// imagem nova preparada, conta os boots da imagem em teste, faz o
+// rollback quando pedido ou após OTA_MAX_TRIES boots sem confirmação e,
+// por fim, salta para o firmware do slot A.
+//
+// Sem stdio nem interrupções: só flash, watchdog e o salto.
+// =====================================================
+
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+#include "hardware/watchdog.h"
+#include "hardware/structs/scb.h"
+#include "flash_layout.h"
+#include "ota_slots.h"
+
+// O firmware no slot A mantém o boot2 (256 bytes) antes da tabela de vetores
+#define APP_VECTORS (XIP_BASE + FLASH_OTA_SLOT_A_OFFSET + 0x100)
+
+static const uint8_t *boot_read(uint32_t offset) {
+    return FLASH_XIP_PTR(offset);
+}
+
+static void boot_erase(uint32_t offset) {
+    flash_range_erase(offset, FLASH_SECTOR_SIZE);
+}
+
+static void boot_program(uint32_t offset, const uint8_t *page) {
+    flash_range_program(offset, page, FLASH_PAGE_SIZE);
+}
+
+static void boot_tick(void) {
+    watchdog_update();
+}
+
+static const ota_flash_t slots = {
+    .slot_a = FLASH_OTA_SLOT_A_OFFSET,
+    .slot_b = FLASH_OTA_SLOT_B_OFFSET,
+    .scratch = FLASH_OTA_SCRATCH_OFFSET,
+    .control = FLASH_OTA_CONTROL_OFFSET,
+    .read = boot_read,
+    .erase = boot_erase,
+    .program = boot_program,
+    .tick = boot_tick,
+};
+
+static void __attribute__((noreturn)) start_app(void) {
+    const uint32_t *vectors = (const uint32_t *)APP_VECTORS;
+
+    scb_hw->vtor = APP_VECTORS;
+    __asm volatile(
+        "msr msp, %0\n"
+        "bx %1\n"
+        :
+        : "r"(vectors[0]), "r"(vectors[1])
+        :);
+    __builtin_unreachable();
+}
+
+int main(void) {
+    // Cada passo da troca chama boot_tick; um passo leva bem menos que isso
+    watchdog_enable(8000, true);
+
+    ota_boot(&slots);
+
+    // Slot A apagado (primeira gravação incompleta): espera o BOOTSEL
+    const uint32_t *vectors = (const uint32_t *)APP_VECTORS;
+    if (vectors[0] == 0xFFFFFFFF) {
+        watchdog_disable();
+        while (true) tight_loop_contents();
+    }
+
+    // O firmware religa o watchdog com o próprio intervalo (supervisor.c)
+    watchdog_disable();
+    start_app();
+}
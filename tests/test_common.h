@@ -0,0 +1,50 @@
+/**
+ * test_common.h
+ *
+ * Verificações mínimas dos testes no PC: cada CHECK que falha imprime
+ * arquivo, linha e a expressão, e o teste termina com TEST_RESULT()
+ * (código de saída != 0 se algo falhou, como o ctest espera).
+ */
+
+#ifndef TEST_COMMON_H
+#define TEST_COMMON_H
+
+#include <stdio.h>
+#include <string.h>
+
+static int test_failures = 0;
+
+#define CHECK(cond) do {                                                    \
+    if (!(cond)) {                                                          \
+        printf("[FALHA] %s:%d: %s\n", __FILE__, __LINE__, #cond);           \
+        test_failures++;                                                    \
+    }                                                                       \
+} while (0)
+
+#define CHECK_EQ(a, b) do {                                                 \
+    long long check_a = (long long)(a), check_b = (long long)(b);           \
+    if (check_a != check_b) {                                               \
+        printf("[FALHA] %s:%d: %s == %s (%lld != %lld)\n",                  \
+               __FILE__, __LINE__, #a, #b, check_a, check_b);               \
+        test_failures++;                                                    \
+    }                                                                       \
+} while (0)
+
+#define CHECK_STR(a, b) do {                                                \
+    const char *check_a = (a), *check_b = (b);                              \
+    if (strcmp(check_a, check_b) != 0) {                                    \
+        printf("[FALHA] %s:%d: %s\n    obtido:   %s\n    esperado: %s\n",   \
+               __FILE__, __LINE__, #a, check_a, check_b);                   \
+        test_failures++;                                                    \
+    }                                                                       \
+} while (0)
+
+// Roda um caso e mostra o nome
+#define RUN(test) do {                                                      \
+    printf("[TESTE] %s\n", #test);                                          \
+    test();                                                                 \
+} while (0)
+
+#define TEST_RESULT() (test_failures == 0 ? 0 : (printf("[TESTE] %d falha(s)\n", test_failures), 1))
+
+#endif // TEST_COMMON_H
@@ -0,0 +1,94 @@
+// Testes do payload JSON das leituras (lib/event_json.c)
+
+#include "test_common.h"
+#include "event_json.h"
+
+static rfid_event_t make_event(uint8_t uid_size, uint8_t flags, uint32_t timestamp_ms) {
+    rfid_event_t ev = {0};
+    for (uint8_t i = 0; i < uid_size; i++) {
+        ev.uid[i] = (uint8_t)(0xA0 + i * 0x11);
+    }
+    ev.uid_size = uid_size;
+    ev.flags = flags;
+    ev.timestamp_ms = timestamp_ms;
+    return ev;
+}
+
+static void test_uid_hex(void) {
+    static const uint8_t uid[4] = { 0x04, 0xa1, 0x0f, 0xff };
+    char hex[EVENT_JSON_UID_HEX_SIZE];
+    event_json_uid_hex(uid, sizeof(uid), hex);
+    CHECK_STR(hex, "04A10FFF");
+
+    event_json_uid_hex(uid, 0, hex);
+    CHECK_STR(hex, "");
+}
+
+static void test_uid_hex_max(void) {
+    rfid_event_t ev = make_event(EVENT_UID_MAX, 0, 0);
+    char hex[EVENT_JSON_UID_HEX_SIZE];
+    event_json_uid_hex(ev.uid, ev.uid_size, hex);
+    CHECK_EQ(strlen(hex), EVENT_UID_MAX * 2);
+    CHECK_STR(hex, "A0B1C2D3E4F506172839");
+}
+
+static void test_format_basic(void) {
+    rfid_event_t ev = make_event(4, 0, 123456);
+    char buf[EVENT_JSON_MAX];
+    int n = event_json_format(&ev, NULL, buf, sizeof(buf));
+    CHECK_STR(buf, "{\"tag\":\"A0B1C2D3\",\"timestamp\":123456,\"reader\":\"PicoW\"}");
+    CHECK_EQ(n, strlen(buf));
+}
+
+static void test_format_ts_us(void) {
+    rfid_event_t ev = make_event(4, 0, 10);
+    uint64_t ts_us = 1760000000123456ull;
+    char buf[EVENT_JSON_MAX];
+    event_json_format(&ev, &ts_us, buf, sizeof(buf));
+    CHECK_STR(buf, "{\"tag\":\"A0B1C2D3\",\"timestamp\":10,\"reader\":\"PicoW\","
+                   "\"ts_us\":1760000000123456}");
+}
+
+static void test_format_restored(void) {
+    rfid_event_t ev = make_event(4, EVENT_FLAG_RESTORED | EVENT_FLAG_PRIORITY, 10);
+    char buf[EVENT_JSON_MAX];
+    event_json_format(&ev, NULL, buf, sizeof(buf));
+    CHECK_STR(buf, "{\"tag\":\"A0B1C2D3\",\"timestamp\":10,\"reader\":\"PicoW\","
+                   "\"restored\":true}");
+
+    // Só RESTORED muda o payload
+    ev.flags = EVENT_FLAG_PRIORITY;
+    event_json_format(&ev, NULL, buf, sizeof(buf));
+    CHECK_STR(buf, "{\"tag\":\"A0B1C2D3\",\"timestamp\":10,\"reader\":\"PicoW\"}");
+}
+
+static void test_format_max_fits(void) {
+    // Pior caso: UID de 10 bytes, timestamp e ts_us máximos, restored
+    rfid_event_t ev = make_event(EVENT_UID_MAX, EVENT_FLAG_RESTORED, UINT32_MAX);
+    uint64_t ts_us = UINT64_MAX;
+    char buf[EVENT_JSON_MAX];
+    int n = event_json_format(&ev, &ts_us, buf, sizeof(buf));
+    CHECK(n > 0);
+    CHECK(n < EVENT_JSON_MAX);
+    CHECK_EQ(buf[n - 1], '}');
+}
+
+static void test_format_truncated(void) {
+    rfid_event_t ev = make_event(4, 0, 123456);
+    char buf[16];
+    memset(buf, 'x', sizeof(buf));
+    int n = event_json_format(&ev, NULL, buf, sizeof(buf));
+    CHECK(n >= (int)sizeof(buf));
+    CHECK_EQ(buf[sizeof(buf) - 1], '\0');
+}
+
+int main(void) {
+    RUN(test_uid_hex);
+    RUN(test_uid_hex_max);
+    RUN(test_format_basic);
+    RUN(test_format_ts_us);
+    RUN(test_format_restored);
+    RUN(test_format_max_fits);
+    RUN(test_format_truncated);
+    return TEST_RESULT();
+}
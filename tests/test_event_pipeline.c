@@ -0,0 +1,236 @@
+// Testes da política de publicação (lib/event_pipeline.c) sobre um
+// transporte falso e a fila pendente real (lib/event_queue.c)
+
+#include "test_common.h"
+#include "event_pipeline.h"
+
+#define BURST       8
+#define RESERVE     2
+#define WINDOW      8
+
+// Transporte falso: janela de WINDOW vagas, registra a ordem publicada
+static bool fake_online;
+static uint32_t fake_in_flight;
+static bool fake_refuse;            // Recusa tudo (buffer de saída cheio)
+static uint32_t fake_batch_size;    // Eventos por lote (0: lote não se aplica)
+static uint32_t fake_batches;
+static uint8_t published[64];       // uid[0] de cada evento publicado
+static uint32_t published_count;
+
+static bool fake_is_online(void) {
+    return fake_online;
+}
+
+static uint32_t fake_window_free(void) {
+    return WINDOW - fake_in_flight;
+}
+
+static bool fake_publish(const rfid_event_t *ev) {
+    if (fake_refuse || fake_in_flight == WINDOW) return false;
+    fake_in_flight++;
+    published[published_count++] = ev->uid[0];
+    return true;
+}
+
+// Como event_batch_publish: peek do lote e remoção dos eventos publicados
+static uint32_t fake_publish_batch(void) {
+    rfid_event_t batch[EVENT_QUEUE_CAPACITY];
+    if (fake_batch_size == 0 ||
+        event_queue_peek_batch(batch, fake_batch_size) < fake_batch_size) {
+        return 0;
+    }
+    fake_in_flight++;
+    fake_batches++;
+    event_queue_pop_n(fake_batch_size);
+    return fake_batch_size;
+}
+
+static const event_pipeline_ops_t ops = {
+    .online = fake_is_online,
+    .window_free = fake_window_free,
+    .publish = fake_publish,
+    .publish_batch = NULL,
+};
+
+static const event_pipeline_ops_t batch_ops = {
+    .online = fake_is_online,
+    .window_free = fake_window_free,
+    .publish = fake_publish,
+    .publish_batch = fake_publish_batch,
+};
+
+static event_pipeline_t pipeline;
+
+// A fila é global: esvazia entre os casos
+static void setup(const event_pipeline_ops_t *o) {
+    while (event_queue_peek() != NULL) {
+        event_queue_pop();
+    }
+    fake_online = true;
+    fake_in_flight = 0;
+    fake_refuse = false;
+    fake_batch_size = 0;
+    fake_batches = 0;
+    published_count = 0;
+    event_pipeline_init(&pipeline, o, BURST, RESERVE);
+}
+
+static rfid_event_t make_event(uint8_t id, uint8_t flags) {
+    rfid_event_t ev = {0};
+    ev.uid[0] = id;
+    ev.uid_size = 4;
+    ev.flags = flags;
+    return ev;
+}
+
+static void deliver(uint8_t id, uint8_t flags) {
+    rfid_event_t ev = make_event(id, flags);
+    CHECK(event_pipeline_deliver(&pipeline, &ev));
+}
+
+static void test_direct_when_idle(void) {
+    setup(&ops);
+    deliver(1, 0);
+    CHECK_EQ(pipeline.direct, 1);
+    CHECK_EQ(pipeline.queued, 0);
+    CHECK_EQ(event_queue_count(), 0);
+    CHECK_EQ(published_count, 1);
+}
+
+static void test_offline_queues(void) {
+    setup(&ops);
+    fake_online = false;
+    deliver(1, 0);
+    deliver(2, EVENT_FLAG_PRIORITY);
+    CHECK_EQ(pipeline.queued, 2);
+    CHECK_EQ(event_queue_count(), 2);
+    CHECK_EQ(published_count, 0);
+    // Desconectado, o escoamento não envia nada
+    CHECK_EQ(event_pipeline_drain(&pipeline), 0);
+}
+
+static void test_queue_keeps_order(void) {
+    setup(&ops);
+    fake_online = false;
+    deliver(1, 0);
+    fake_online = true;
+    // Com fila pendente, um comum não passa à frente dos antigos
+    deliver(2, 0);
+    CHECK_EQ(pipeline.direct, 0);
+    CHECK_EQ(event_pipeline_drain(&pipeline), 2);
+    CHECK_EQ(published_count, 2);
+    CHECK_EQ(published[0], 1);
+    CHECK_EQ(published[1], 2);
+}
+
+static void test_reserve_left_for_priority(void) {
+    setup(&ops);
+    fake_in_flight = WINDOW - RESERVE;
+    deliver(1, 0);
+    CHECK_EQ(pipeline.queued, 1);
+    // Prioritário usa a reserva e passa à frente da fila
+    deliver(2, EVENT_FLAG_PRIORITY);
+    CHECK_EQ(pipeline.direct, 1);
+    CHECK_EQ(published[0], 2);
+    CHECK_EQ(event_pipeline_drain(&pipeline), 0);
+    CHECK_EQ(event_queue_count(), 1);
+}
+
+static void test_refused_publish_queues(void) {
+    setup(&ops);
+    fake_refuse = true;
+    deliver(1, EVENT_FLAG_PRIORITY);
+    CHECK_EQ(pipeline.direct, 0);
+    CHECK_EQ(event_queue_class_count(EVENT_CLASS_PRIORITY), 1);
+    CHECK_EQ(event_pipeline_drain(&pipeline), 0);
+    fake_refuse = false;
+    CHECK_EQ(event_pipeline_drain(&pipeline), 1);
+    CHECK_EQ(event_queue_count(), 0);
+}
+
+static void test_drain_burst_and_priority_first(void) {
+    setup(&ops);
+    fake_online = false;
+    for (uint8_t i = 0; i < 20; i++) {
+        deliver(i, 0);
+    }
+    deliver(100, EVENT_FLAG_PRIORITY);
+    fake_online = true;
+
+    // Janela de 8 com reserva de 2: prioritário + 5 comuns
+    CHECK_EQ(event_pipeline_drain(&pipeline), 6);
+    CHECK_EQ(published[0], 100);
+    CHECK_EQ(published[1], 0);
+    CHECK_EQ(fake_window_free(), RESERVE);
+
+    // Janela livre de novo: a reserva para a rodada antes do burst
+    fake_in_flight = 0;
+    CHECK_EQ(event_pipeline_drain(&pipeline), 6);
+    fake_in_flight = 0;
+    CHECK_EQ(event_pipeline_drain(&pipeline), 6);
+    CHECK_EQ(event_queue_count(), 20 - 5 - 12);
+    CHECK_EQ(pipeline.drained, 18);
+}
+
+static void test_drain_burst_limit(void) {
+    setup(&ops);
+    pipeline.burst = 3;
+    fake_online = false;
+    for (uint8_t i = 0; i < 12; i++) {
+        deliver(i, 0);
+    }
+    deliver(100, EVENT_FLAG_PRIORITY);
+    fake_online = true;
+    // O prioritário conta na rodada, mas não é barrado pelo limite
+    CHECK_EQ(event_pipeline_drain(&pipeline), 3);
+    CHECK_EQ(published[0], 100);
+    CHECK_EQ(event_queue_count(), 10);
+}
+
+static void test_drain_batch(void) {
+    setup(&batch_ops);
+    fake_online = false;
+    for (uint8_t i = 0; i < 10; i++) {
+        deliver(i, 0);
+    }
+    deliver(100, EVENT_FLAG_PRIORITY);
+    fake_online = true;
+    fake_batch_size = 4;
+
+    // Prioritário por JSON, depois 2 lotes de 4 e os 2 restantes um a um
+    CHECK_EQ(event_pipeline_drain(&pipeline), 5);
+    CHECK_EQ(fake_batches, 2);
+    CHECK_EQ(published_count, 3);
+    CHECK_EQ(published[0], 100);
+    CHECK_EQ(published[1], 8);
+    CHECK_EQ(pipeline.drained, 11);
+    CHECK_EQ(event_queue_count(), 0);
+}
+
+static void test_deliver_reports_drop(void) {
+    setup(&ops);
+    fake_online = false;
+    for (uint32_t i = 0; i < EVENT_QUEUE_CAPACITY; i++) {
+        deliver((uint8_t)i, 0);
+    }
+    rfid_event_t ev = make_event(0xEE, 0);
+    CHECK(!event_pipeline_deliver(&pipeline, &ev));
+    CHECK_EQ(pipeline.dropped, 1);
+    CHECK_EQ(event_queue_count(), EVENT_QUEUE_CAPACITY);
+    // A fila comum cheia não descarta prioritários
+    deliver(0xF0, EVENT_FLAG_PRIORITY);
+    CHECK_EQ(event_queue_class_count(EVENT_CLASS_PRIORITY), 1);
+}
+
+int main(void) {
+    RUN(test_direct_when_idle);
+    RUN(test_offline_queues);
+    RUN(test_queue_keeps_order);
+    RUN(test_reserve_left_for_priority);
+    RUN(test_refused_publish_queues);
+    RUN(test_drain_burst_and_priority_first);
+    RUN(test_drain_burst_limit);
+    RUN(test_drain_batch);
+    RUN(test_deliver_reports_drop);
+    return TEST_RESULT();
+}
@@ -0,0 +1,293 @@
+// Testes do setor de controle OTA e da troca de slots (lib/ota_slots.c)
+// sobre uma flash em RAM com a semântica real: gravar só zera bits. A
+// queda de energia interrompe uma operação ao meio e volta ao setjmp
+
+#include <setjmp.h>
+#include "test_common.h"
+#include "ota_slots.h"
+
+// Controle, rascunho e dois slots de SLOT_SECTORS setores
+#define SLOT_SECTORS    3
+#define SLOT_SIZE       (SLOT_SECTORS * OTA_SECTOR_SIZE)
+#define SCRATCH         (1 * OTA_SECTOR_SIZE)
+#define SLOT_A          (2 * OTA_SECTOR_SIZE)
+#define SLOT_B          (SLOT_A + SLOT_SIZE)
+
+static uint8_t flash[SLOT_B + SLOT_SIZE];
+static uint32_t erases;
+
+// Operações (apagar/gravar) até a queda; -1: sem queda
+static int32_t ops_left = -1;
+static uint32_t ops_done;
+static jmp_buf power_cut;
+
+// Conta a operação; na queda, só metade dela chega à flash
+static bool power_ok(void) {
+    ops_done++;
+    if (ops_left < 0) return true;
+    return ops_left-- > 0;
+}
+
+static const uint8_t *ram_read(uint32_t offset) {
+    return flash + offset;
+}
+
+static void ram_erase(uint32_t offset) {
+    if (!power_ok()) {
+        memset(flash + offset, 0xFF, OTA_SECTOR_SIZE / 2);
+        longjmp(power_cut, 1);
+    }
+    memset(flash + offset, 0xFF, OTA_SECTOR_SIZE);
+    erases++;
+}
+
+static void ram_program(uint32_t offset, const uint8_t *page) {
+    uint32_t len = OTA_PAGE_SIZE;
+    bool ok = power_ok();
+    if (!ok) len /= 2;
+    for (uint32_t i = 0; i < len; i++) {
+        flash[offset + i] &= page[i];
+    }
+    if (!ok) longjmp(power_cut, 1);
+}
+
+static const ota_flash_t fl = {
+    .slot_a = SLOT_A,
+    .slot_b = SLOT_B,
+    .scratch = SCRATCH,
+    .control = 0,
+    .read = ram_read,
+    .erase = ram_erase,
+    .program = ram_program,
+};
+
+static void setup(void) {
+    memset(flash, 0xFF, sizeof(flash));
+    erases = 0;
+    ops_left = -1;
+    ops_done = 0;
+}
+
+static void write_record(uint64_t ctr) {
+    ota_record_t rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.ctr = ctr;
+    ota_record_write(&fl, &rec);
+}
+
+static void test_no_record(void) {
+    setup();
+    ota_record_t rec;
+    CHECK(!ota_record_read(&fl, &rec));
+    // Sem registro a área não vale, mesmo com lixo
+    memset(flash + OTA_CTRL_CTR, 0x00, 8);
+    CHECK_EQ(ota_ctr_read(&fl, &rec), 0);
+}
+
+static void test_log_after_record(void) {
+    setup();
+    write_record(100);
+    ota_record_t rec;
+    CHECK(ota_record_read(&fl, &rec));
+    CHECK_EQ(ota_ctr_read(&fl, &rec), 100);
+
+    CHECK(ota_ctr_write(&fl, 101));
+    CHECK(ota_ctr_write(&fl, 250));
+    CHECK_EQ(ota_ctr_read(&fl, &rec), 250);
+    CHECK_EQ(erases, 1);
+}
+
+static void test_marks_kept(void) {
+    setup();
+    write_record(1);
+    ota_mark(&fl, OTA_CTRL_TRIES, 0);
+    ota_mark(&fl, OTA_CTRL_SWAP, 0);
+    for (uint64_t i = 2; i < 40; i++) {
+        CHECK(ota_ctr_write(&fl, i));
+    }
+    CHECK_EQ(ota_marks(&fl, OTA_CTRL_TRIES, OTA_MAX_TRIES), 1);
+    CHECK_EQ(ota_marks(&fl, OTA_CTRL_SWAP, 3), 1);
+    ota_record_t rec;
+    CHECK(ota_record_read(&fl, &rec));
+    CHECK_EQ(ota_ctr_read(&fl, &rec), 39);
+}
+
+static void test_log_full(void) {
+    setup();
+    write_record(0);
+    for (uint64_t i = 1; i <= OTA_CTR_SLOTS; i++) {
+        CHECK(ota_ctr_write(&fl, i));
+    }
+    CHECK(!ota_ctr_write(&fl, OTA_CTR_SLOTS + 1));
+
+    // Reescrever o registro com o contador esvazia a área
+    write_record(OTA_CTR_SLOTS + 1);
+    ota_record_t rec;
+    CHECK(ota_record_read(&fl, &rec));
+    CHECK_EQ(ota_ctr_read(&fl, &rec), OTA_CTR_SLOTS + 1);
+    CHECK(ota_ctr_write(&fl, OTA_CTR_SLOTS + 2));
+}
+
+static void test_record_wins_over_old_log(void) {
+    setup();
+    write_record(10);
+    CHECK(ota_ctr_write(&fl, 5));     // Valor antigo: o maior vale
+    ota_record_t rec;
+    CHECK(ota_record_read(&fl, &rec));
+    CHECK_EQ(ota_ctr_read(&fl, &rec), 10);
+}
+
+// --- Troca de slots ---
+
+// Imagens antiga (A) e nova (B) de tamanhos diferentes: o fim de cada slot
+// fica apagado, e a troca copia setores inteiros
+#define OLD_SIZE        (2 * OTA_SECTOR_SIZE + 100)
+#define NEW_SIZE        (SLOT_SIZE - 300)
+
+static uint8_t old_image[SLOT_SIZE];
+static uint8_t new_image[SLOT_SIZE];
+
+static void stage(bool corrupt) {
+    setup();
+    memset(old_image, 0xFF, sizeof(old_image));
+    memset(new_image, 0xFF, sizeof(new_image));
+    for (uint32_t i = 0; i < OLD_SIZE; i++) old_image[i] = (uint8_t)(i * 13 + 5);
+    for (uint32_t i = 0; i < NEW_SIZE; i++) new_image[i] = (uint8_t)(i * 7 + 1);
+    memcpy(flash + SLOT_A, old_image, SLOT_SIZE);
+    memcpy(flash + SLOT_B, new_image, SLOT_SIZE);
+
+    ota_record_t rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.state = OTA_REC_PENDING;
+    rec.image_size = NEW_SIZE;
+    rec.image_crc = ota_crc32(0, new_image, NEW_SIZE);
+    rec.swap_sectors = SLOT_SECTORS;
+    ota_record_write(&fl, &rec);
+    if (corrupt) flash[SLOT_B + 10] ^= 0x01;
+}
+
+// Um boot do bootloader, com queda depois de 'ops' operações (-1: sem queda)
+static bool boot(int32_t ops, ota_phase_t *phase) {
+    ops_left = ops;
+    ops_done = 0;
+    if (setjmp(power_cut) != 0) {
+        ops_left = -1;
+        return false;
+    }
+    *phase = ota_boot(&fl);
+    ops_left = -1;
+    return true;
+}
+
+static bool slots_are(const uint8_t *a, const uint8_t *b) {
+    return memcmp(flash + SLOT_A, a, SLOT_SIZE) == 0 && memcmp(flash + SLOT_B, b, SLOT_SIZE) == 0;
+}
+
+static void test_swap(void) {
+    ota_phase_t phase;
+    stage(false);
+    CHECK(boot(-1, &phase));
+    CHECK_EQ(phase, OTA_PHASE_TRIAL);
+    CHECK(slots_are(new_image, old_image));
+    CHECK_EQ(ota_marks(&fl, OTA_CTRL_SWAP, 3 * SLOT_SECTORS), 3 * SLOT_SECTORS);
+    CHECK_EQ(ota_marks(&fl, OTA_CTRL_TRIES, OTA_MAX_TRIES), 1);
+}
+
+static void test_swap_resumes_after_power_cut(void) {
+    ota_phase_t phase;
+    stage(false);
+    CHECK(boot(-1, &phase));
+    uint32_t total = ops_done;
+    CHECK(total > 3 * SLOT_SECTORS);
+
+    // Queda em cada operação da troca (cópias e marcas), depois um boot limpo
+    for (uint32_t cut = 0; cut < total; cut++) {
+        stage(false);
+        CHECK(!boot((int32_t)cut, &phase));
+        CHECK(boot(-1, &phase));
+        CHECK_EQ(phase, OTA_PHASE_TRIAL);
+        if (!slots_are(new_image, old_image)) {
+            printf("[FALHA] slots errados com queda na operacao %lu\n", (unsigned long)cut);
+            test_failures++;
+        }
+    }
+}
+
+static void test_swap_survives_repeated_cuts(void) {
+    // Cada boot cai pouco depois de um passo inteiro (apagar, até 16
+    // páginas e a marca): a troca avança pelas marcas, um ou dois passos
+    // por boot (páginas apagadas não são gravadas)
+    ota_phase_t phase;
+    stage(false);
+    uint32_t boots = 0;
+    while (!boot(OTA_SECTOR_SIZE / OTA_PAGE_SIZE + 4, &phase) && boots < 1000) boots++;
+    CHECK(boots > 2 * SLOT_SECTORS);
+    CHECK_EQ(phase, OTA_PHASE_TRIAL);
+    CHECK(slots_are(new_image, old_image));
+}
+
+static void test_rollback_resumes_after_power_cut(void) {
+    ota_phase_t phase;
+    stage(false);
+    CHECK(boot(-1, &phase));
+    ota_mark(&fl, OTA_CTRL_ROLLBACK, 0);
+    CHECK(boot(-1, &phase));
+    CHECK_EQ(phase, OTA_PHASE_ROLLED_BACK);
+    CHECK(slots_are(old_image, new_image));
+    uint32_t total = ops_done;
+
+    for (uint32_t cut = 0; cut < total; cut++) {
+        stage(false);
+        CHECK(boot(-1, &phase));
+        ota_mark(&fl, OTA_CTRL_ROLLBACK, 0);
+        CHECK(!boot((int32_t)cut, &phase));
+        // Queda na gravação da última marca pode deixá-la gravada
+        ota_record_t rec;
+        ota_phase_t after_cut = ota_phase(&fl, &rec);
+        CHECK(after_cut == OTA_PHASE_ROLLING_BACK || after_cut == OTA_PHASE_ROLLED_BACK);
+        CHECK(boot(-1, &phase));
+        CHECK_EQ(phase, OTA_PHASE_ROLLED_BACK);
+        if (!slots_are(old_image, new_image)) {
+            printf("[FALHA] slots errados com queda na operacao %lu do rollback\n",
+                   (unsigned long)cut);
+            test_failures++;
+        }
+    }
+}
+
+static void test_rollback_after_max_tries(void) {
+    ota_phase_t phase;
+    stage(false);
+    for (int i = 0; i < OTA_MAX_TRIES; i++) {
+        CHECK(boot(-1, &phase));
+        CHECK_EQ(phase, OTA_PHASE_TRIAL);
+    }
+    CHECK(boot(-1, &phase));
+    CHECK_EQ(phase, OTA_PHASE_ROLLED_BACK);
+    CHECK(slots_are(old_image, new_image));
+}
+
+static void test_rejected_image(void) {
+    ota_phase_t phase;
+    stage(true);
+    uint8_t corrupt_b[SLOT_SIZE];
+    memcpy(corrupt_b, flash + SLOT_B, SLOT_SIZE);
+    CHECK(boot(-1, &phase));
+    CHECK_EQ(phase, OTA_PHASE_REJECTED);
+    CHECK(slots_are(old_image, corrupt_b));
+}
+
+int main(void) {
+    RUN(test_no_record);
+    RUN(test_log_after_record);
+    RUN(test_marks_kept);
+    RUN(test_log_full);
+    RUN(test_record_wins_over_old_log);
+    RUN(test_swap);
+    RUN(test_swap_resumes_after_power_cut);
+    RUN(test_swap_survives_repeated_cuts);
+    RUN(test_rollback_resumes_after_power_cut);
+    RUN(test_rollback_after_max_tries);
+    RUN(test_rejected_image);
+    return TEST_RESULT();
+}
@@ -0,0 +1,96 @@
+// Testes da agenda de reconexão (lib/reconnect_sched.c)
+
+#include "test_common.h"
+#include "reconnect_sched.h"
+
+static void test_initial_wait(void) {
+    reconnect_sched_t s;
+    reconnect_sched_init(&s, 500, 5, 8000, 1000);
+    CHECK_EQ(reconnect_sched_delay_ms(&s), 500);
+    CHECK(!reconnect_sched_due(&s, 1499));
+    CHECK(reconnect_sched_due(&s, 1500));
+}
+
+static void test_reset_is_immediate(void) {
+    reconnect_sched_t s;
+    reconnect_sched_init(&s, 500, 5, 8000, 1000);
+    reconnect_sched_reset(&s);
+    CHECK(reconnect_sched_due(&s, 1000));
+    // A tentativa consome a liberação imediata
+    reconnect_sched_attempt(&s, 1000);
+    CHECK(!reconnect_sched_due(&s, 1000));
+    CHECK(reconnect_sched_due(&s, 1500));
+}
+
+static void test_backoff_doubles(void) {
+    // Mesma sequência do WiFi: 500, 500, 1000, 2000, 4000, 8000, 8000
+    static const uint32_t expected[] = { 500, 500, 1000, 2000, 4000, 8000, 8000, 8000 };
+    reconnect_sched_t s;
+    reconnect_sched_init(&s, 500, 5, 8000, 0);
+    for (uint32_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        CHECK_EQ(reconnect_sched_delay_ms(&s), expected[i]);
+        reconnect_sched_failed(&s, 0);
+    }
+}
+
+static void test_max_shift_without_cap(void) {
+    // Como o MQTT: sem teto em ms, no máximo 8x
+    reconnect_sched_t s;
+    reconnect_sched_init(&s, 5000, 3, 0, 0);
+    for (int i = 0; i < 10; i++) {
+        reconnect_sched_failed(&s, 0);
+    }
+    CHECK_EQ(reconnect_sched_delay_ms(&s), 40000);
+}
+
+static void test_failed_counts_from_failure(void) {
+    reconnect_sched_t s;
+    reconnect_sched_init(&s, 1000, 3, 0, 0);
+    reconnect_sched_attempt(&s, 100);
+    reconnect_sched_failed(&s, 400);
+    reconnect_sched_failed(&s, 400);
+    CHECK_EQ(reconnect_sched_delay_ms(&s), 2000);
+    CHECK(!reconnect_sched_due(&s, 2399));
+    CHECK(reconnect_sched_due(&s, 2400));
+}
+
+static void test_reset_clears_failures(void) {
+    reconnect_sched_t s;
+    reconnect_sched_init(&s, 1000, 3, 0, 0);
+    reconnect_sched_failed(&s, 0);
+    reconnect_sched_failed(&s, 0);
+    reconnect_sched_failed(&s, 0);
+    CHECK_EQ(s.failures, 3);
+    reconnect_sched_reset(&s);
+    CHECK_EQ(s.failures, 0);
+    CHECK_EQ(reconnect_sched_delay_ms(&s), 1000);
+}
+
+static void test_clock_wrap(void) {
+    reconnect_sched_t s;
+    reconnect_sched_init(&s, 1000, 3, 0, 0);
+    reconnect_sched_failed(&s, UINT32_MAX - 200);
+    CHECK(!reconnect_sched_due(&s, 500));
+    CHECK(reconnect_sched_due(&s, 800));
+}
+
+static void test_no_overflow(void) {
+    reconnect_sched_t s;
+    reconnect_sched_init(&s, 0x80000000u, 4, 0, 0);
+    for (int i = 0; i < 5; i++) {
+        reconnect_sched_failed(&s, 0);
+    }
+    CHECK_EQ(reconnect_sched_delay_ms(&s), UINT32_MAX);
+}
+
+int main(void) {
+    RUN(test_initial_wait);
+    RUN(test_reset_is_immediate);
+    RUN(test_backoff_doubles);
+    RUN(test_max_shift_without_cap);
+    RUN(test_failed_counts_from_failure);
+    RUN(test_reset_clears_failures);
+    RUN(test_clock_wrap);
+    RUN(test_no_overflow);
+    return TEST_RESULT();
+}
@@ -0,0 +1,81 @@
+// Testes do debounce das leituras (lib/tag_debounce.c)
+
+#include "test_common.h"
+#include "tag_debounce.h"
+
+static const uint8_t uid_a[4] = { 0x04, 0xA1, 0xB2, 0xC3 };
+static const uint8_t uid_b[4] = { 0x04, 0xA1, 0xB2, 0xC4 };
+static const uint8_t uid_7[7] = { 0x04, 0xA1, 0xB2, 0xC3, 0x11, 0x22, 0x33 };
+
+static void test_first_read_accepted(void) {
+    tag_debounce_t d;
+    tag_debounce_init(&d, 2000);
+    CHECK(!tag_debounce_is_repeat(&d, uid_a, sizeof(uid_a), 0));
+    CHECK(tag_debounce_accept(&d, uid_a, sizeof(uid_a), 0));
+}
+
+static void test_repeat_inside_window(void) {
+    tag_debounce_t d;
+    tag_debounce_init(&d, 2000);
+    CHECK(tag_debounce_accept(&d, uid_a, sizeof(uid_a), 1000));
+    CHECK(!tag_debounce_accept(&d, uid_a, sizeof(uid_a), 1000));
+    CHECK(!tag_debounce_accept(&d, uid_a, sizeof(uid_a), 2999));
+    // A janela conta do último evento aceito, não da última leitura
+    CHECK(tag_debounce_accept(&d, uid_a, sizeof(uid_a), 3000));
+    CHECK(!tag_debounce_accept(&d, uid_a, sizeof(uid_a), 4999));
+}
+
+static void test_other_tag_accepted(void) {
+    tag_debounce_t d;
+    tag_debounce_init(&d, 2000);
+    CHECK(tag_debounce_accept(&d, uid_a, sizeof(uid_a), 0));
+    CHECK(tag_debounce_accept(&d, uid_b, sizeof(uid_b), 10));
+    // Alternando, cada leitura é nova: só a última tag é lembrada
+    CHECK(tag_debounce_accept(&d, uid_a, sizeof(uid_a), 20));
+}
+
+static void test_uid_size_matters(void) {
+    tag_debounce_t d;
+    tag_debounce_init(&d, 2000);
+    CHECK(tag_debounce_accept(&d, uid_7, sizeof(uid_7), 0));
+    // Mesmo prefixo de 4 bytes, tamanho diferente
+    CHECK(tag_debounce_accept(&d, uid_a, sizeof(uid_a), 1));
+    CHECK(!tag_debounce_accept(&d, uid_a, sizeof(uid_a), 2));
+}
+
+static void test_clock_wrap(void) {
+    tag_debounce_t d;
+    tag_debounce_init(&d, 2000);
+    CHECK(tag_debounce_accept(&d, uid_a, sizeof(uid_a), UINT32_MAX - 500));
+    CHECK(!tag_debounce_accept(&d, uid_a, sizeof(uid_a), 1000));
+    CHECK(tag_debounce_accept(&d, uid_a, sizeof(uid_a), 1500));
+}
+
+static void test_zero_window(void) {
+    tag_debounce_t d;
+    tag_debounce_init(&d, 0);
+    CHECK(tag_debounce_accept(&d, uid_a, sizeof(uid_a), 0));
+    CHECK(tag_debounce_accept(&d, uid_a, sizeof(uid_a), 0));
+}
+
+static void test_record(void) {
+    tag_debounce_t d;
+    tag_debounce_init(&d, 2000);
+    tag_debounce_record(&d, uid_b, sizeof(uid_b), 100);
+    CHECK(tag_debounce_is_repeat(&d, uid_b, sizeof(uid_b), 2099));
+    CHECK(!tag_debounce_is_repeat(&d, uid_b, sizeof(uid_b), 2100));
+    // is_repeat não registra
+    CHECK(!tag_debounce_is_repeat(&d, uid_a, sizeof(uid_a), 200));
+    CHECK(tag_debounce_is_repeat(&d, uid_b, sizeof(uid_b), 200));
+}
+
+int main(void) {
+    RUN(test_first_read_accepted);
+    RUN(test_repeat_inside_window);
+    RUN(test_other_tag_accepted);
+    RUN(test_uid_size_matters);
+    RUN(test_clock_wrap);
+    RUN(test_zero_window);
+    RUN(test_record);
+    return TEST_RESULT();
+}
@@ -0,0 +1,299 @@
+/**
+ * crash_symbolize.c
+ *
+ * Traduz o registro de HardFault dos leitores (lib/crash_dump.h) para
+ * nomes de função, usando o ELF do mesmo build. Lê o JSON de
+ * agv/rfid/crash ou de GET /api/crash (um registro por linha; o prefixo
+ * de tópico do mosquitto_sub -v é ignorado):
+ *
+ *   cc -O2 -o crash_symbolize tools/crash_symbolize.c
+ *   mosquitto_sub -h BROKER -t agv/rfid/crash -v | ./crash_symbolize build/RFID_MQTT.elf
+ *   curl -s http://LEITOR/api/crash | ./crash_symbolize build/RFID_MQTT_FREERTOS.elf
+ *
+ * Mostra pc e lr como função+deslocamento, as palavras da pilha que
+ * parecem endereços de retorno (código Thumb dentro de uma função) e os
+ * últimos eventos do anel de rastreio. Com -l, pc, lr e a pilha também
+ * ganham arquivo:linha pelo arm-none-eabi-addr2line (ou $ADDR2LINE).
+ *
+ * image_size do registro é conferido com __flash_binary_end -
+ * __flash_binary_start do ELF: se diferirem, o ELF é de outro build e os
+ * nomes não valem.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LINE_MAX        8192
+#define STACK_WORDS_MAX 64
+
+// --- ELF32 (só o necessário para a tabela de símbolos) ---
+
+typedef struct {
+    uint8_t ident[16];
+    uint16_t type, machine;
+    uint32_t version, entry, phoff, shoff, flags;
+    uint16_t ehsize, phentsize, phnum, shentsize, shnum, shstrndx;
+} elf32_ehdr_t;
+
+typedef struct {
+    uint32_t name, type, flags, addr, offset, size, link, info, addralign, entsize;
+} elf32_shdr_t;
+
+typedef struct {
+    uint32_t name, value, size;
+    uint8_t info, other;
+    uint16_t shndx;
+} elf32_sym_t;
+
+#define SHT_SYMTAB  2
+#define STT_FUNC    2
+
+typedef struct {
+    uint32_t addr;
+    uint32_t size;
+    const char *name;
+} func_t;
+
+static func_t *funcs = NULL;
+static size_t func_count = 0;
+static uint32_t image_size = 0;
+static const char *elf_path = NULL;
+static int use_addr2line = 0;
+
+static int cmp_func(const void *a, const void *b) {
+    const func_t *fa = a, *fb = b;
+    return fa->addr < fb->addr ? -1 : fa->addr > fb->addr;
+}
+
+static int load_elf(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = malloc(size);
+    if (data == NULL || fread(data, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "%s: erro de leitura\n", path);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+
+    const elf32_ehdr_t *eh = (const elf32_ehdr_t *)data;
+    if (size < (long)sizeof(*eh) || memcmp(eh->ident, "\x7f" "ELF", 4) != 0 || eh->ident[4] != 1) {
+        fprintf(stderr, "%s: nao e um ELF de 32 bits\n", path);
+        return -1;
+    }
+
+    const elf32_shdr_t *sh = (const elf32_shdr_t *)(data + eh->shoff);
+    uint32_t flash_start = 0, flash_end = 0;
+    for (uint16_t i = 0; i < eh->shnum; i++) {
+        if (sh[i].type != SHT_SYMTAB) continue;
+        const elf32_sym_t *syms = (const elf32_sym_t *)(data + sh[i].offset);
+        const char *strtab = (const char *)(data + sh[sh[i].link].offset);
+        size_t n = sh[i].size / sizeof(elf32_sym_t);
+
+        funcs = calloc(n, sizeof(func_t));
+        for (size_t k = 0; k < n; k++) {
+            const char *name = strtab + syms[k].name;
+            if (strcmp(name, "__flash_binary_start") == 0) flash_start = syms[k].value;
+            if (strcmp(name, "__flash_binary_end") == 0) flash_end = syms[k].value;
+            if ((syms[k].info & 0x0F) != STT_FUNC || syms[k].size == 0) continue;
+            funcs[func_count].addr = syms[k].value & ~1u;
+            funcs[func_count].size = syms[k].size;
+            funcs[func_count].name = name;
+            func_count++;
+        }
+    }
+    if (func_count == 0) {
+        fprintf(stderr, "%s: sem tabela de simbolos (use o .elf, nao o .bin)\n", path);
+        return -1;
+    }
+    qsort(funcs, func_count, sizeof(func_t), cmp_func);
+    image_size = flash_end - flash_start;
+    return 0;
+}
+
+static const func_t *lookup(uint32_t addr) {
+    addr &= ~1u;
+    size_t lo = 0, hi = func_count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (funcs[mid].addr <= addr) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == 0) return NULL;
+    const func_t *fn = &funcs[lo - 1];
+    return addr < fn->addr + fn->size ? fn : NULL;
+}
+
+static void print_addr(const char *label, uint32_t addr, int is_return) {
+    const func_t *fn = lookup(addr);
+    printf("  %-10s 0x%08x", label, addr);
+    if (fn != NULL) printf("  %s+0x%x", fn->name, (addr & ~1u) - fn->addr);
+
+    if (use_addr2line && fn != NULL) {
+        const char *tool = getenv("ADDR2LINE") ? getenv("ADDR2LINE") : "arm-none-eabi-addr2line";
+        char cmd[1024], line[512];
+        // lr e endereços de retorno apontam para a instrução seguinte à chamada
+        snprintf(cmd, sizeof(cmd), "%s -e '%s' 0x%x", tool, elf_path,
+                 (addr & ~1u) - (is_return ? 1 : 0));
+        FILE *p = popen(cmd, "r");
+        if (p != NULL) {
+            if (fgets(line, sizeof(line), p) != NULL) {
+                line[strcspn(line, "\n")] = '\0';
+                printf("  (%s)", line);
+            }
+            pclose(p);
+        }
+    }
+    printf("\n");
+}
+
+// --- JSON do registro (formato fixo de crash_dump.c) ---
+
+static const char *find_key(const char *json, const char *key) {
+    char pattern[32];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *p = strstr(json, pattern);
+    return p != NULL ? p + strlen(pattern) : NULL;
+}
+
+static uint32_t parse_value(const char *p) {
+    if (p == NULL) return 0;
+    if (*p == '"') p++;
+    return (uint32_t)strtoul(p, NULL, 0);
+}
+
+static uint32_t get_u32(const char *json, const char *key) {
+    return parse_value(find_key(json, key));
+}
+
+static void get_string(const char *json, const char *key, char *out, size_t size) {
+    const char *p = find_key(json, key);
+    out[0] = '\0';
+    if (p == NULL || *p != '"') return;
+    size_t n = strcspn(p + 1, "\"");
+    if (n >= size) n = size - 1;
+    memcpy(out, p + 1, n);
+    out[n] = '\0';
+}
+
+static void symbolize(const char *json) {
+    char phase[32];
+    get_string(json, "phase", phase, sizeof(phase));
+    uint32_t xpsr = get_u32(json, "xpsr");
+    uint32_t sp = get_u32(json, "sp");
+
+    printf("crash #%u: core %u, fase %s, %u ms apos o boot\n", get_u32(json, "crash"),
+           get_u32(json, "core"), phase, get_u32(json, "uptime_ms"));
+    uint32_t size = get_u32(json, "image_size");
+    if (size != image_size) {
+        printf("  AVISO: imagem de %u bytes no leitor, %u no ELF: outro build?\n",
+               size, image_size);
+    }
+
+    print_addr("pc", get_u32(json, "pc"), 0);
+    print_addr("lr", get_u32(json, "lr"), 1);
+    printf("  %-10s 0x%08x\n", "sp", sp);
+    printf("  %-10s 0x%08x (IPSR %u%s)\n", "xpsr", xpsr, xpsr & 0x3F,
+           (xpsr & 0x3F) == 0 ? ": codigo de tarefa/laco" : ": dentro de uma interrupcao");
+    printf("  %-10s 0x%08x (pilha %s)\n", "exc_return", get_u32(json, "exc_return"),
+           get_u32(json, "exc_return") & 4 ? "PSP: tarefa FreeRTOS" : "MSP");
+
+    const char *r = find_key(json, "r");
+    if (r != NULL && *r == '[') {
+        r++;
+        printf("  ");
+        for (int i = 0; i < 13 && *r != ']'; i++) {
+            printf("r%-2d=0x%08x%s", i, parse_value(r), i % 4 == 3 ? "\n  " : " ");
+            r += strcspn(r, ",]");
+            if (*r == ',') r++;
+        }
+        printf("\n");
+    }
+
+    // Palavras da pilha que caem em código Thumb: candidatas a retorno
+    const char *stack = find_key(json, "stack");
+    if (stack != NULL && *stack == '"') {
+        stack++;
+        printf("  pilha (possiveis enderecos de retorno):\n");
+        for (uint32_t i = 0; i < STACK_WORDS_MAX && *stack != '"'; i++) {
+            char word[9];
+            memcpy(word, stack, 8);
+            word[8] = '\0';
+            if (strlen(word) < 8) break;
+            uint32_t value = (uint32_t)strtoul(word, NULL, 16);
+            stack += 8;
+            if ((value & 1) && lookup(value) != NULL) {
+                char label[16];
+                snprintf(label, sizeof(label), "sp+0x%02x", i * 4);
+                print_addr(label, value, 1);
+            }
+        }
+    }
+
+    const char *trace = find_key(json, "trace");
+    if (trace != NULL && *trace == '[') {
+        printf("  ultimos eventos:\n");
+        trace++;
+        while (*trace == '[') {
+            unsigned long ms = strtoul(trace + 1, (char **)&trace, 10);
+            char name[16] = "";
+            if (*trace == ',' && trace[1] == '"') {
+                size_t n = strcspn(trace + 2, "\"");
+                if (n < sizeof(name)) {
+                    memcpy(name, trace + 2, n);
+                    name[n] = '\0';
+                }
+                trace += 2 + n + 1;
+            }
+            unsigned long arg = *trace == ',' ? strtoul(trace + 1, (char **)&trace, 10) : 0;
+            if (strcmp(name, "tag") == 0) {
+                printf("    %10lu ms  tag  %08lX\n", ms, arg);
+            } else {
+                printf("    %10lu ms  %-4s %lu\n", ms, name, arg);
+            }
+            trace += strcspn(trace, "[]");
+            if (*trace == ']') trace++;
+            if (*trace == ',') trace++;
+        }
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv) {
+    int arg = 1;
+    if (arg < argc && strcmp(argv[arg], "-l") == 0) {
+        use_addr2line = 1;
+        arg++;
+    }
+    if (arg >= argc) {
+        fprintf(stderr, "uso: %s [-l] firmware.elf [registro.json]\n", argv[0]);
+        return 1;
+    }
+    elf_path = argv[arg++];
+    if (load_elf(elf_path) != 0) return 1;
+
+    FILE *in = stdin;
+    if (arg < argc && (in = fopen(argv[arg], "r")) == NULL) {
+        perror(argv[arg]);
+        return 1;
+    }
+
+    static char line[LINE_MAX];
+    int found = 0;
+    while (fgets(line, sizeof(line), in) != NULL) {
+        const char *json = strchr(line, '{');
+        if (json == NULL || strstr(json, "\"crash\":") == NULL) continue;
+        symbolize(json);
+        found++;
+    }
+    if (found == 0) fprintf(stderr, "nenhum registro de crash na entrada\n");
+    return found ? 0 : 1;
+}
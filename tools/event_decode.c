@@ -0,0 +1,265 @@
+/**
+ * event_decode.c
+ *
+ * Decodifica no PC os lotes binários da fila pendente (lib/event_codec.h)
+ * de volta para o JSON de cada leitura, como o firmware publicaria em
+ * agv/rfid. Lê linhas "tópico payload_hex" do mosquitto_sub:
+ *
+ *   cc -O2 -Ilib -o event_decode tools/event_decode.c lib/event_codec.c lib/auth_crypto.c
+ *   mosquitto_sub -h BROKER -t agv/rfid/batch -F '%t %x' | ./event_decode [-k CHAVE_HEX [-m 1|2]]
+ *
+ * Com -k, confere o MAC de cada quadro (auth_mode dos leitores: -m 1 =
+ * HMAC-SHA256, padrão; 2 = SipHash-2-4) e descarta os inválidos. O
+ * anti-replay por contador fica com tools/event_verify.c.
+ *
+ * Medição (-t): taxa de compressão e custo de codificação no PC, no traço
+ * sintético e, com -r, num traço real capturado com
+ *   mosquitto_sub -h BROKER -v -t agv/rfid > traco.txt
+ *
+ *   ./event_decode -t [-r traco.txt]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "event_codec.h"
+#include "auth_crypto.h"
+
+#define HMAC_TAG_SIZE   16
+#define TRACE_MAX       65536
+
+static int mode = 1;
+static int verify = 0;
+static hmac_sha256_key_t hmac_key;
+static siphash_key_t sip_key;
+
+static size_t compute_mac(const char *topic, const uint8_t *msg, size_t len, uint8_t *mac) {
+    if (mode == 1) {
+        uint8_t digest[SHA256_DIGEST_SIZE];
+        sha256_ctx_t ctx;
+        hmac_sha256_begin(&hmac_key, &ctx);
+        sha256_update(&ctx, topic, strlen(topic));
+        sha256_update(&ctx, "\n", 1);
+        sha256_update(&ctx, msg, len);
+        hmac_sha256_end(&hmac_key, &ctx, digest);
+        memcpy(mac, digest, HMAC_TAG_SIZE);
+        return HMAC_TAG_SIZE;
+    }
+    siphash_ctx_t ctx;
+    siphash_begin(&sip_key, &ctx);
+    siphash_update(&ctx, topic, strlen(topic));
+    siphash_update(&ctx, "\n", 1);
+    siphash_update(&ctx, msg, len);
+    uint64_t h = siphash_end(&ctx);
+    for (int i = 0; i < 8; i++) mac[i] = (uint8_t)(h >> (56 - 8 * i));
+    return 8;
+}
+
+static int parse_hex(const char *hex, uint8_t *out, size_t size) {
+    size_t len = strlen(hex);
+    if (len % 2 != 0 || len / 2 > size) return -1;
+    for (size_t i = 0; i < len / 2; i++) {
+        unsigned int byte;
+        if (sscanf(hex + 2 * i, "%2x", &byte) != 1) return -1;
+        out[i] = (uint8_t)byte;
+    }
+    return (int)(len / 2);
+}
+
+static void print_event(const event_codec_header_t *hdr, const rfid_event_t *ev) {
+    char uid[2 * EVENT_UID_MAX + 1];
+    for (int i = 0; i < ev->uid_size; i++) sprintf(uid + 2 * i, "%02X", ev->uid[i]);
+
+    char ts[32] = "";
+    uint64_t unix_us;
+    if (event_codec_unix_us(hdr, ev, &unix_us)) {
+        snprintf(ts, sizeof(ts), ",\"ts_us\":%llu", (unsigned long long)unix_us);
+    }
+    printf("{\"tag\":\"%s\",\"timestamp\":%lu,\"reader\":\"PicoW\"%s%s,\"id\":\"%s\"}\n",
+           uid, (unsigned long)ev->timestamp_ms, ts,
+           (ev->flags & EVENT_FLAG_RESTORED) ? ",\"restored\":true" : "", hdr->id);
+}
+
+static int decode_stream(void) {
+    static char line[2 * (EVENT_CODEC_FRAME_MAX + 64) + 128];
+    static uint8_t frame[EVENT_CODEC_FRAME_MAX + 64];
+    rfid_event_t events[EVENT_CODEC_BATCH_MAX];
+    unsigned long frames = 0, decoded = 0, rejected = 0;
+
+    while (fgets(line, sizeof(line), stdin) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *space = strchr(line, ' ');
+        if (space == NULL) continue;
+        *space = '\0';
+        const char *topic = line;
+
+        int len = parse_hex(space + 1, frame, sizeof(frame));
+        event_codec_header_t hdr;
+        int n = len > 0 ? event_codec_decode(frame, (size_t)len, &hdr, events,
+                                             EVENT_CODEC_BATCH_MAX) : -1;
+        if (n < 0) {
+            fprintf(stderr, "[%s] quadro invalido\n", topic);
+            rejected++;
+            continue;
+        }
+
+        if (verify) {
+            uint8_t mac[HMAC_TAG_SIZE];
+            size_t mac_len = (hdr.flags & EVENT_CODEC_FLAG_SIGNED) ?
+                             compute_mac(topic, frame, hdr.signed_len + 8, mac) : 0;
+            if (mac_len == 0 || (size_t)len != hdr.signed_len + 8 + mac_len + 1 ||
+                memcmp(mac, frame + hdr.signed_len + 8, mac_len) != 0) {
+                fprintf(stderr, "[%s] %s: MAC invalido ou ausente, %d eventos descartados\n",
+                        topic, hdr.id, n);
+                rejected++;
+                continue;
+            }
+        }
+
+        for (int i = 0; i < n; i++) print_event(&hdr, &events[i]);
+        fflush(stdout);
+        frames++;
+        decoded += (unsigned long)n;
+    }
+    fprintf(stderr, "%lu quadros, %lu eventos, %lu rejeitados\n", frames, decoded, rejected);
+    return rejected ? 1 : 0;
+}
+
+// --- Medição ---
+
+// Linhas "tópico {json}" do mosquitto_sub -v com as leituras individuais
+static uint32_t load_trace(const char *path, rfid_event_t *events, uint32_t max) {
+    FILE *in = fopen(path, "r");
+    if (in == NULL) {
+        perror(path);
+        exit(1);
+    }
+    char line[512];
+    uint32_t n = 0;
+    while (n < max && fgets(line, sizeof(line), in) != NULL) {
+        const char *tag = strstr(line, "\"tag\":\"");
+        const char *ts = strstr(line, "\"timestamp\":");
+        if (tag == NULL || ts == NULL) continue;
+
+        rfid_event_t *ev = &events[n];
+        memset(ev, 0, sizeof(*ev));
+        tag += 7;
+        while (ev->uid_size < EVENT_UID_MAX && tag[0] != '"' && tag[1] != '"' &&
+               sscanf(tag, "%2hhx", &ev->uid[ev->uid_size]) == 1) {
+            ev->uid_size++;
+            tag += 2;
+        }
+        if (ev->uid_size == 0) continue;
+        ev->timestamp_ms = (uint32_t)strtoul(ts + 12, NULL, 10);
+        if (strstr(line, "\"restored\":true") != NULL) ev->flags = EVENT_FLAG_RESTORED;
+        n++;
+    }
+    fclose(in);
+    return n;
+}
+
+static void measure(const char *name, const rfid_event_t *events, uint32_t count, int with_ts) {
+    uint8_t frame[EVENT_CODEC_FRAME_MAX];
+    printf("%s: %u eventos\n", name, (unsigned)count);
+    printf("  %-28s %10s %10s %8s %10s %10s\n", "modo", "JSON", "lotes", "taxa", "bytes/ev", "ns/ev");
+
+    size_t json = 0;
+    for (uint32_t i = 0; i < count; i++) json += event_codec_json_size(&events[i], with_ts);
+
+    for (uint8_t m = EVENT_CODEC_DELTA; m <= EVENT_CODEC_LZ; m++) {
+        size_t bytes = 0;
+        uint32_t frames = 0;
+        clock_t start = clock();
+        int rounds = 0;
+        do {
+            bytes = 0;
+            frames = 0;
+            for (uint32_t done = 0; done < count; frames++) {
+                size_t len;
+                uint32_t left = count - done;
+                uint32_t n = event_codec_encode(&events[done],
+                                                left < EVENT_CODEC_BATCH_MAX ? left : EVENT_CODEC_BATCH_MAX,
+                                                m, with_ts ? 1 : 0, 0, "PicoW-RFID-Reader", false,
+                                                frame, &len);
+                if (n == 0) return;
+                done += n;
+                bytes += len;
+            }
+            rounds++;
+        } while (clock() - start < CLOCKS_PER_SEC / 4);
+        double ns = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / ((double)count * rounds);
+
+        printf("  %-28s %10zu %10zu %7.1fx %10.1f %10.0f\n",
+               m == EVENT_CODEC_DELTA ? "delta + dicionario" : "delta + dicionario + LZSS",
+               json, bytes, (double)json / bytes, (double)bytes / count, ns);
+    }
+}
+
+static void run_measurements(const char *trace_path) {
+    static rfid_event_t events[TRACE_MAX];
+
+    // Fila de uma queda (restaurada: sem ts_us) e fila ao vivo (com ts_us)
+    event_codec_synth_trace(events, 4096, 12, 1);
+    measure("sintetico, 12 marcadores, restaurado", events, 4096, 0);
+    for (uint32_t i = 0; i < 4096; i++) events[i].flags = 0;
+    measure("sintetico, 12 marcadores, ao vivo", events, 4096, 1);
+    event_codec_synth_trace(events, 4096, 40, 2);
+    measure("sintetico, 40 marcadores, restaurado", events, 4096, 0);
+
+    if (trace_path != NULL) {
+        uint32_t n = load_trace(trace_path, events, TRACE_MAX);
+        if (n == 0) {
+            fprintf(stderr, "%s: nenhuma leitura encontrada\n", trace_path);
+            return;
+        }
+        measure(trace_path, events, n, 1);
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *trace_path = NULL;
+    int bench = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "k:m:tr:")) != -1) {
+        switch (opt) {
+            case 'k': {
+                uint8_t key[32];
+                int len = parse_hex(optarg, key, sizeof(key));
+                if (len < 16) {
+                    fprintf(stderr, "chave invalida: 16 a 32 bytes em hexadecimal\n");
+                    return 1;
+                }
+                hmac_sha256_setkey(&hmac_key, key, (size_t)len);
+                siphash_setkey(&sip_key, key);
+                verify = 1;
+                break;
+            }
+            case 'm':
+                mode = atoi(optarg);
+                break;
+            case 't':
+                bench = 1;
+                break;
+            case 'r':
+                trace_path = optarg;
+                break;
+            default:
+                fprintf(stderr, "uso: %s [-k CHAVE_HEX [-m 1|2]] | -t [-r traco.txt]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (mode != 1 && mode != 2) {
+        fprintf(stderr, "-m deve ser 1 (HMAC-SHA256) ou 2 (SipHash-2-4)\n");
+        return 1;
+    }
+
+    if (bench) {
+        run_measurements(trace_path);
+        return 0;
+    }
+    return decode_stream();
+}
@@ -0,0 +1,195 @@
+/**
+ * event_verify.c
+ *
+ * Confere os eventos assinados pelos leitores (lib/event_auth.c) no PC:
+ * MAC com a chave compartilhada e contador por leitor e tópico (replay).
+ * Lê linhas "tópico payload", no formato do mosquitto_sub -v:
+ *
+ *   cc -O2 -Ilib -o event_verify tools/event_verify.c lib/auth_crypto.c
+ *   mosquitto_sub -h BROKER -v -t 'agv/#' | ./event_verify -k CHAVE_HEX [-m 1|2] [-q]
+ *
+ * -m 1 = HMAC-SHA256 (padrão), 2 = SipHash-2-4 (o mesmo auth_mode dos
+ * leitores). Mensagens sem "mac" (status, mapa) são ignoradas. -q imprime
+ * só as rejeitadas. Ao final (EOF) imprime o resumo.
+ *
+ * Anti-replay em janela (como no IPsec): aceita contadores até WINDOW
+ * abaixo do maior já visto, uma vez cada, porque uma retransmissão QoS 1
+ * pode chegar depois de mensagens mais novas. Duplicatas de QoS 1 (mesmo
+ * ctr) aparecem como REPLAY.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "auth_crypto.h"
+
+#define MAX_READERS     64
+#define HMAC_TAG_SIZE   16
+#define WINDOW          64
+
+// Um por leitor e tópico: cada tópico chega por um caminho (fila, QoS)
+typedef struct {
+    char id[32];
+    char topic[64];
+    unsigned long long max_ctr;
+    uint64_t seen;              // Bit i: max_ctr - i já aceito
+} reader_t;
+
+static reader_t readers[MAX_READERS];
+static int reader_count;
+
+static int mode = 1;
+static hmac_sha256_key_t hmac_key;
+static siphash_key_t sip_key;
+
+static void compute_mac(const char *topic, const char *msg, size_t len, char *hex) {
+    if (mode == 1) {
+        uint8_t mac[SHA256_DIGEST_SIZE];
+        sha256_ctx_t ctx;
+        hmac_sha256_begin(&hmac_key, &ctx);
+        sha256_update(&ctx, topic, strlen(topic));
+        sha256_update(&ctx, "\n", 1);
+        sha256_update(&ctx, msg, len);
+        hmac_sha256_end(&hmac_key, &ctx, mac);
+        for (int i = 0; i < HMAC_TAG_SIZE; i++) sprintf(hex + 2 * i, "%02x", mac[i]);
+    } else {
+        siphash_ctx_t ctx;
+        siphash_begin(&sip_key, &ctx);
+        siphash_update(&ctx, topic, strlen(topic));
+        siphash_update(&ctx, "\n", 1);
+        siphash_update(&ctx, msg, len);
+        sprintf(hex, "%016llx", (unsigned long long)siphash_end(&ctx));
+    }
+}
+
+static reader_t *find_reader(const char *id, const char *topic) {
+    for (int i = 0; i < reader_count; i++) {
+        if (strcmp(readers[i].id, id) == 0 && strcmp(readers[i].topic, topic) == 0) {
+            return &readers[i];
+        }
+    }
+    if (reader_count == MAX_READERS) return NULL;
+    reader_t *r = &readers[reader_count++];
+    snprintf(r->id, sizeof(r->id), "%s", id);
+    snprintf(r->topic, sizeof(r->topic), "%s", topic);
+    r->max_ctr = 0;
+    r->seen = 0;
+    return r;
+}
+
+// Retorna 0 se o contador é novo (e o marca), -1 se repetido ou antigo demais
+static int accept_ctr(reader_t *r, unsigned long long ctr) {
+    if (ctr > r->max_ctr) {
+        unsigned long long shift = ctr - r->max_ctr;
+        r->seen = shift >= WINDOW ? 0 : r->seen << shift;
+        r->seen |= 1;
+        r->max_ctr = ctr;
+        return 0;
+    }
+    unsigned long long age = r->max_ctr - ctr;
+    if (age >= WINDOW || (r->seen & (1ull << age))) return -1;
+    r->seen |= 1ull << age;
+    return 0;
+}
+
+// Valor de texto de "campo":"valor" antes de 'end'
+static int field_string(const char *msg, const char *end, const char *key, char *out, size_t size) {
+    const char *p = strstr(msg, key);
+    if (p == NULL || p >= end) return -1;
+    p += strlen(key);
+    const char *q = strchr(p, '"');
+    if (q == NULL || q > end || (size_t)(q - p) >= size) return -1;
+    memcpy(out, p, q - p);
+    out[q - p] = '\0';
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *key_hex = NULL;
+    int quiet = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "k:m:q")) != -1) {
+        switch (opt) {
+            case 'k': key_hex = optarg; break;
+            case 'm': mode = atoi(optarg); break;
+            case 'q': quiet = 1; break;
+            default: key_hex = NULL; optind = argc; break;
+        }
+    }
+
+    uint8_t key[32];
+    size_t key_len = key_hex ? strlen(key_hex) / 2 : 0;
+    if (key_hex == NULL || strlen(key_hex) % 2 != 0 || key_len < 16 || key_len > 32 ||
+        (mode != 1 && mode != 2)) {
+        fprintf(stderr, "uso: %s -k chave_hex(16 a 32 bytes) [-m 1|2] [-q]\n", argv[0]);
+        return 1;
+    }
+    for (size_t i = 0; i < key_len; i++) {
+        unsigned int byte;
+        if (sscanf(key_hex + 2 * i, "%2x", &byte) != 1) {
+            fprintf(stderr, "chave invalida\n");
+            return 1;
+        }
+        key[i] = (uint8_t)byte;
+    }
+    hmac_sha256_setkey(&hmac_key, key, key_len);
+    siphash_setkey(&sip_key, key);
+
+    unsigned long ok = 0, bad_mac = 0, replay = 0, malformed = 0;
+    char line[2048];
+
+    while (fgets(line, sizeof(line), stdin) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *msg = strchr(line, ' ');
+        if (msg == NULL) continue;
+        *msg++ = '\0';
+        const char *topic = line;
+
+        char *mac_field = strstr(msg, ",\"mac\":\"");
+        if (mac_field == NULL) continue;
+
+        char id[32], mac_rx[2 * HMAC_TAG_SIZE + 1], mac[2 * HMAC_TAG_SIZE + 1];
+        const char *ctr_field = strstr(msg, ",\"ctr\":");
+        if (field_string(msg, mac_field, "\"id\":\"", id, sizeof(id)) != 0 ||
+            ctr_field == NULL || ctr_field > mac_field ||
+            field_string(mac_field, mac_field + strlen(mac_field), "\"mac\":\"",
+                         mac_rx, sizeof(mac_rx)) != 0) {
+            malformed++;
+            printf("MALFORMADA %s %s\n", topic, msg);
+            continue;
+        }
+        unsigned long long ctr = strtoull(ctr_field + 7, NULL, 10);
+
+        compute_mac(topic, msg, mac_field - msg, mac);
+        if (strcmp(mac, mac_rx) != 0) {
+            bad_mac++;
+            printf("MAC INVALIDO %s id=%s ctr=%llu\n", topic, id, ctr);
+            continue;
+        }
+
+        // Só depois do MAC: um atacante não consegue adiantar o contador
+        reader_t *r = find_reader(id, topic);
+        if (r == NULL) {
+            malformed++;
+            printf("LEITORES DEMAIS (%d), ignorado: %s\n", MAX_READERS, id);
+            continue;
+        }
+        if (accept_ctr(r, ctr) != 0) {
+            replay++;
+            printf("REPLAY %s id=%s ctr=%llu (maior %llu)\n", topic, id, ctr, r->max_ctr);
+            continue;
+        }
+        ok++;
+        if (!quiet) {
+            printf("OK %s id=%s epoca=%llu seq=%llu\n", topic, id, ctr >> 32, ctr & 0xFFFFFFFFull);
+        }
+        fflush(stdout);
+    }
+
+    printf("Resumo: %lu validas, %lu MAC invalido, %lu replay, %lu malformadas, %d leitor/topico\n",
+           ok, bad_mac, replay, malformed, reader_count);
+    return bad_mac || replay ? 2 : 0;
+}
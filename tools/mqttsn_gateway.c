@@ -0,0 +1,259 @@
+/**
+ * mqttsn_gateway.c
+ *
+ * Gateway MQTT-SN mínimo para testar o transporte UDP dos leitores
+ * (lib/mqttsn_link.c) sem um gateway real. Roda no PC:
+ *
+ *   cc -O2 -o mqttsn_gateway tools/mqttsn_gateway.c
+ *   ./mqttsn_gateway [-p porta] [-l perda_%] [-q]
+ *
+ * Responde CONNACK, REGACK, PUBACK e PINGRESP e imprime cada publicação.
+ * Não repassa nada ao broker: serve para medir o leitor. Por cliente, conta
+ * duplicatas (retransmissões cuja PUBACK se perdeu) e lacunas no MsgId.
+ * A cada 5 s imprime mensagens/s e bytes/s recebidos.
+ *
+ * -l descarta a fração indicada dos datagramas recebidos, para exercitar
+ * as retransmissões do leitor.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MSG_CONNECT     0x04
+#define MSG_CONNACK     0x05
+#define MSG_REGISTER    0x0A
+#define MSG_REGACK      0x0B
+#define MSG_PUBLISH     0x0C
+#define MSG_PUBACK      0x0D
+#define MSG_PINGREQ     0x16
+#define MSG_PINGRESP    0x17
+#define MSG_DISCONNECT  0x18
+
+#define FLAG_DUP        0x80
+#define QOS_MASK        0x60
+
+#define MAX_CLIENTS     64
+#define MAX_TOPICS      16
+#define REPORT_S        5
+
+typedef struct {
+    struct sockaddr_in addr;
+    char id[24];
+    uint16_t last_msg_id;
+    unsigned long received;
+    unsigned long dups;
+    unsigned long gaps;
+} client_t;
+
+static client_t clients[MAX_CLIENTS];
+static int client_count;
+static char topics[MAX_TOPICS][64];
+static int topic_count;
+static int quiet;
+
+static uint16_t get16(const uint8_t *p) {
+    return (uint16_t)(p[0] << 8) | p[1];
+}
+
+static void put16(uint8_t *p, uint16_t v) {
+    p[0] = v >> 8;
+    p[1] = v & 0xFF;
+}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static client_t *find_client(const struct sockaddr_in *addr, int create) {
+    for (int i = 0; i < client_count; i++) {
+        if (clients[i].addr.sin_addr.s_addr == addr->sin_addr.s_addr &&
+            clients[i].addr.sin_port == addr->sin_port) {
+            return &clients[i];
+        }
+    }
+    if (!create || client_count == MAX_CLIENTS) return NULL;
+
+    client_t *c = &clients[client_count++];
+    memset(c, 0, sizeof(*c));
+    c->addr = *addr;
+    return c;
+}
+
+static uint16_t topic_id(const char *name, size_t len) {
+    for (int i = 0; i < topic_count; i++) {
+        if (strlen(topics[i]) == len && memcmp(topics[i], name, len) == 0) return i + 1;
+    }
+    if (topic_count == MAX_TOPICS || len >= sizeof(topics[0])) return 0;
+    memcpy(topics[topic_count], name, len);
+    topics[topic_count][len] = '\0';
+    return ++topic_count;
+}
+
+static void reply(int fd, const struct sockaddr_in *to, uint8_t type,
+                  const uint8_t *body, size_t body_len) {
+    uint8_t out[16];
+    out[0] = (uint8_t)(body_len + 2);
+    out[1] = type;
+    memcpy(out + 2, body, body_len);
+    sendto(fd, out, body_len + 2, 0, (const struct sockaddr *)to, sizeof(*to));
+}
+
+static void on_publish(int fd, const struct sockaddr_in *from, client_t *c,
+                       const uint8_t *b, size_t len) {
+    if (len < 5) return;
+    uint8_t flags = b[0];
+    uint16_t tid = get16(b + 1);
+    uint16_t msg_id = get16(b + 3);
+    int qos = (flags & QOS_MASK) >> 5;
+
+    if (qos == 1) {
+        if (c->received > 0 && msg_id == c->last_msg_id) {
+            c->dups++;          // PUBACK anterior perdida: reconfirma sem contar de novo
+        } else {
+            if (c->received > 0 && msg_id != (uint16_t)(c->last_msg_id + 1) &&
+                !(c->last_msg_id == 0xFFFF && msg_id == 1)) {
+                // Retransmissões podem chegar fora de ordem (janela > 1)
+                if (flags & FLAG_DUP) c->dups++;
+                else c->gaps++;
+            }
+            c->last_msg_id = msg_id;
+        }
+        uint8_t ack[5];
+        put16(ack, tid);
+        put16(ack + 2, msg_id);
+        ack[4] = (tid >= 1 && tid <= topic_count) ? 0x00 : 0x02;  // 0x02: tópico inválido
+        reply(fd, from, MSG_PUBACK, ack, sizeof(ack));
+    }
+    c->received++;
+
+    if (!quiet) {
+        const char *topic = (tid >= 1 && tid <= topic_count) ? topics[tid - 1] : "?";
+        printf("%s %s q%d #%u%s %.*s\n", c->id, topic, qos, msg_id,
+               (flags & FLAG_DUP) ? " DUP" : "", (int)(len - 5), (const char *)(b + 5));
+    }
+}
+
+int main(int argc, char **argv) {
+    int port = 1884;
+    int loss = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "p:l:q")) != -1) {
+        switch (opt) {
+            case 'p': port = atoi(optarg); break;
+            case 'l': loss = atoi(optarg); break;
+            case 'q': quiet = 1; break;
+            default:
+                fprintf(stderr, "uso: %s [-p porta] [-l perda_%%] [-q]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in local = { 0 };
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(port);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&local, sizeof(local)) < 0) {
+        perror("bind");
+        return 1;
+    }
+    struct timeval tv = { 1, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    printf("Gateway MQTT-SN (teste) na porta %d, perda simulada %d%%\n", port, loss);
+    srand((unsigned)time(NULL));
+
+    double window_start = now_s();
+    unsigned long window_msgs = 0, window_bytes = 0;
+    uint8_t buf[2048];
+
+    for (;;) {
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        ssize_t n = recvfrom(fd, buf, sizeof(buf), 0, (struct sockaddr *)&from, &from_len);
+
+        double t = now_s();
+        if (t - window_start >= REPORT_S) {
+            printf("[taxa] %.1f msg/s, %.0f bytes/s", window_msgs / (t - window_start),
+                   window_bytes / (t - window_start));
+            for (int i = 0; i < client_count; i++) {
+                printf(" | %s: %lu msgs, %lu dup, %lu lacunas", clients[i].id,
+                       clients[i].received, clients[i].dups, clients[i].gaps);
+            }
+            printf("\n");
+            fflush(stdout);
+            window_start = t;
+            window_msgs = window_bytes = 0;
+        }
+
+        if (n < 2) continue;
+        if (loss > 0 && rand() % 100 < loss) continue;
+
+        size_t len = buf[0];
+        size_t hdr = 2;
+        if (buf[0] == 0x01) {
+            if (n < 4) continue;
+            len = get16(buf + 1);
+            hdr = 4;
+        }
+        if (len < hdr || len > (size_t)n) continue;
+
+        uint8_t type = buf[hdr - 1];
+        const uint8_t *b = buf + hdr;
+        size_t body_len = len - hdr;
+        client_t *c = find_client(&from, type == MSG_CONNECT);
+        if (c == NULL) continue;
+
+        window_bytes += n;
+
+        switch (type) {
+            case MSG_CONNECT: {
+                if (body_len < 4) break;
+                size_t id_len = body_len - 4;
+                if (id_len >= sizeof(c->id)) id_len = sizeof(c->id) - 1;
+                memcpy(c->id, b + 4, id_len);
+                c->id[id_len] = '\0';
+                printf("CONNECT %s de %s:%u\n", c->id, inet_ntoa(from.sin_addr),
+                       ntohs(from.sin_port));
+                uint8_t rc = 0x00;
+                reply(fd, &from, MSG_CONNACK, &rc, 1);
+                break;
+            }
+            case MSG_REGISTER: {
+                if (body_len < 4) break;
+                uint16_t tid = topic_id((const char *)b + 4, body_len - 4);
+                c->last_msg_id = get16(b + 2);  // O leitor usa a mesma sequência
+                uint8_t ack[5];
+                put16(ack, tid);
+                put16(ack + 2, get16(b + 2));
+                ack[4] = tid ? 0x00 : 0x03;     // 0x03: sem espaço para tópicos
+                reply(fd, &from, MSG_REGACK, ack, sizeof(ack));
+                break;
+            }
+            case MSG_PUBLISH:
+                window_msgs++;
+                on_publish(fd, &from, c, b, body_len);
+                break;
+            case MSG_PINGREQ:
+                reply(fd, &from, MSG_PINGRESP, NULL, 0);
+                break;
+            case MSG_DISCONNECT:
+                printf("DISCONNECT %s\n", c->id);
+                reply(fd, &from, MSG_DISCONNECT, NULL, 0);
+                break;
+            default:
+                break;
+        }
+        fflush(stdout);
+    }
+}
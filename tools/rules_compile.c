@@ -0,0 +1,282 @@
+/**
+ * rules_compile.c
+ *
+ * Compila as regras de borda (lib/rules.h) de texto para a tabela binária
+ * publicada no tópico 'topic_rules' dos leitores:
+ *
+ *   cc -O2 -Ilib -o rules_compile tools/rules_compile.c
+ *   ./rules_compile regras.txt regras.bin
+ *   mosquitto_pub -h BROKER -t agv/rules -r -f regras.bin
+ *
+ * Uma regra por linha, condições e ações em qualquer ordem; '#' comenta.
+ * A primeira regra que casa decide; sem regra, a leitura segue normal.
+ *
+ *   uid 04AA*                   prefixo dos 4 primeiros bytes do UID
+ *   uid 04AA0000-04ABFFFF       faixa; uid 04AABBCC = exato; uid * = qualquer
+ *   reader PicoW-RFID-Reader    só no leitor com este mqtt_client_id
+ *   time 06:00-22:00            horário UTC (leitor sincronizado; pode
+ *                               atravessar a meia-noite: 22:00-06:00)
+ *   dwell 2.5                   tag parada no campo há pelo menos 2,5 s
+ *
+ *   drop                        descarta a leitura
+ *   pass                        publica normal (exceção antes de um drop)
+ *   priority                    publica na frente da fila pendente
+ *   route agv/rfid/doca         publica neste tópico (no máximo 4 rotas)
+ *   aggregate 30                um resumo por janela de 30 s, no lugar das
+ *                               leituras (vai para a rota, se houver)
+ *
+ * Exemplo:
+ *   uid 04AA* drop                                   # crachás de teste
+ *   uid 04BB* time 06:00-22:00 route agv/rfid/doca priority
+ *   dwell 10 route agv/rfid/parado                   # AGV parado no marcador
+ *   uid * reader PicoW-Patio aggregate 60
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rules.h"
+
+static rule_t rules[RULES_MAX];
+static int rule_count;
+static char routes[RULES_ROUTES_MAX][RULES_TOPIC_LEN];
+static int route_count;
+
+// CRC-32 (IEEE 802.3), o mesmo de rfid_crc32 no firmware
+static uint32_t crc32(const void *data, size_t len) {
+    const uint8_t *p = data;
+    uint32_t crc = 0xFFFFFFFFu;
+    while (len--) {
+        crc ^= *p++;
+        for (int b = 0; b < 8; b++) crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+    }
+    return ~crc;
+}
+
+// Até 8 dígitos hexadecimais; completa à direita com 'fill' (0 ou F)
+static int parse_uid_bound(const char *s, size_t len, int fill, uint32_t *out) {
+    if (len == 0 || len > 8) return -1;
+    uint32_t v = 0;
+    for (size_t i = 0; i < 8; i++) {
+        int d;
+        if (i >= len) {
+            d = fill;
+        } else if (s[i] >= '0' && s[i] <= '9') {
+            d = s[i] - '0';
+        } else if (s[i] >= 'a' && s[i] <= 'f') {
+            d = s[i] - 'a' + 10;
+        } else if (s[i] >= 'A' && s[i] <= 'F') {
+            d = s[i] - 'A' + 10;
+        } else {
+            return -1;
+        }
+        v = (v << 4) | (uint32_t)d;
+    }
+    *out = v;
+    return 0;
+}
+
+static int parse_uid(const char *s, rule_t *r) {
+    size_t len = strlen(s);
+    const char *dash = strchr(s, '-');
+
+    if (strcmp(s, "*") == 0) {
+        r->uid_lo = 0;
+        r->uid_hi = 0xFFFFFFFFu;
+        return 0;
+    }
+    if (dash != NULL) {
+        if (parse_uid_bound(s, dash - s, 0x0, &r->uid_lo) != 0 ||
+            parse_uid_bound(dash + 1, strlen(dash + 1), 0xF, &r->uid_hi) != 0) {
+            return -1;
+        }
+        return r->uid_lo <= r->uid_hi ? 0 : -1;
+    }
+    if (s[len - 1] == '*') {
+        if (parse_uid_bound(s, len - 1, 0x0, &r->uid_lo) != 0) return -1;
+        return parse_uid_bound(s, len - 1, 0xF, &r->uid_hi);
+    }
+    // UID exato: 4 bytes, ou mais (só os 4 primeiros são comparados)
+    if (len < 8 || len % 2 != 0) return -1;
+    for (size_t i = 8; i < len; i++) {
+        if (strchr("0123456789abcdefABCDEF", s[i]) == NULL) return -1;
+    }
+    if (parse_uid_bound(s, 8, 0x0, &r->uid_lo) != 0) return -1;
+    r->uid_hi = r->uid_lo;
+    return 0;
+}
+
+static int parse_minute(const char *s, uint16_t *out) {
+    unsigned h, m;
+    char extra;
+    if (sscanf(s, "%u:%u%c", &h, &m, &extra) != 2 || h > 23 || m > 59) return -1;
+    *out = (uint16_t)(h * 60 + m);
+    return 0;
+}
+
+static int parse_seconds(const char *s, double max, double *out) {
+    char *end;
+    double v = strtod(s, &end);
+    if (*end != '\0' || v < 0 || v > max) return -1;
+    *out = v;
+    return 0;
+}
+
+static int add_route(const char *topic) {
+    if (strlen(topic) >= RULES_TOPIC_LEN) return -1;
+    for (int i = 0; i < route_count; i++) {
+        if (strcmp(routes[i], topic) == 0) return i + 1;
+    }
+    if (route_count == RULES_ROUTES_MAX) return -1;
+    strcpy(routes[route_count++], topic);
+    return route_count;
+}
+
+static int compile_line(char *line, int lineno) {
+    char *hash = strchr(line, '#');
+    if (hash != NULL) *hash = '\0';
+
+    rule_t r = {
+        .uid_lo = 0, .uid_hi = 0xFFFFFFFFu, .reader = 0, .window_ms = 0,
+        .time_from = RULES_NO_TIME, .time_to = RULES_NO_TIME, .dwell_ds = 0,
+        .actions = 0, .route = 0
+    };
+    bool has_action = false;
+    char *tok = strtok(line, " \t\r\n");
+    if (tok == NULL) return 0;
+
+    for (; tok != NULL; tok = strtok(NULL, " \t\r\n")) {
+        char *arg = NULL;
+        if (strcmp(tok, "uid") == 0 || strcmp(tok, "reader") == 0 || strcmp(tok, "time") == 0 ||
+            strcmp(tok, "dwell") == 0 || strcmp(tok, "route") == 0 ||
+            strcmp(tok, "aggregate") == 0) {
+            arg = strtok(NULL, " \t\r\n");
+            if (arg == NULL) {
+                fprintf(stderr, "linha %d: '%s' sem valor\n", lineno, tok);
+                return -1;
+            }
+        }
+
+        if (strcmp(tok, "uid") == 0) {
+            if (parse_uid(arg, &r) != 0) {
+                fprintf(stderr, "linha %d: UID invalido '%s'\n", lineno, arg);
+                return -1;
+            }
+        } else if (strcmp(tok, "reader") == 0) {
+            r.reader = crc32(arg, strlen(arg));
+        } else if (strcmp(tok, "time") == 0) {
+            char *dash = strchr(arg, '-');
+            if (dash == NULL) {
+                fprintf(stderr, "linha %d: horario deve ser HH:MM-HH:MM\n", lineno);
+                return -1;
+            }
+            *dash = '\0';
+            if (parse_minute(arg, &r.time_from) != 0 || parse_minute(dash + 1, &r.time_to) != 0 ||
+                r.time_from == r.time_to) {
+                fprintf(stderr, "linha %d: horario invalido\n", lineno);
+                return -1;
+            }
+        } else if (strcmp(tok, "dwell") == 0) {
+            double s;
+            if (parse_seconds(arg, 6553.5, &s) != 0) {
+                fprintf(stderr, "linha %d: dwell invalido (segundos, ate 6553.5)\n", lineno);
+                return -1;
+            }
+            r.dwell_ds = (uint16_t)(s * 10 + 0.5);
+        } else if (strcmp(tok, "drop") == 0) {
+            r.actions |= RULE_ACT_DROP;
+            has_action = true;
+        } else if (strcmp(tok, "pass") == 0) {
+            has_action = true;
+        } else if (strcmp(tok, "priority") == 0) {
+            r.actions |= RULE_ACT_PRIORITY;
+            has_action = true;
+        } else if (strcmp(tok, "route") == 0) {
+            int route = add_route(arg);
+            if (route < 0) {
+                fprintf(stderr, "linha %d: rota invalida ou rotas demais (max %d, %d caracteres)\n",
+                        lineno, RULES_ROUTES_MAX, RULES_TOPIC_LEN - 1);
+                return -1;
+            }
+            r.actions |= RULE_ACT_ROUTE;
+            r.route = (uint8_t)route;
+            has_action = true;
+        } else if (strcmp(tok, "aggregate") == 0) {
+            double s;
+            if (parse_seconds(arg, 86400, &s) != 0 || s * 1000 < 1) {
+                fprintf(stderr, "linha %d: janela invalida (segundos, ate 86400)\n", lineno);
+                return -1;
+            }
+            r.actions |= RULE_ACT_AGGREGATE;
+            r.window_ms = (uint32_t)(s * 1000 + 0.5);
+            has_action = true;
+        } else {
+            fprintf(stderr, "linha %d: palavra desconhecida '%s'\n", lineno, tok);
+            return -1;
+        }
+    }
+
+    if (!has_action) {
+        fprintf(stderr, "linha %d: regra sem acao (drop, pass, priority, route, aggregate)\n", lineno);
+        return -1;
+    }
+    if ((r.actions & RULE_ACT_DROP) && r.actions != RULE_ACT_DROP) {
+        fprintf(stderr, "linha %d: drop nao combina com outras acoes\n", lineno);
+        return -1;
+    }
+    if ((r.actions & RULE_ACT_AGGREGATE) && (r.actions & RULE_ACT_PRIORITY)) {
+        fprintf(stderr, "linha %d: aggregate nao combina com priority\n", lineno);
+        return -1;
+    }
+    if (rule_count == RULES_MAX) {
+        fprintf(stderr, "linha %d: regras demais (max %d)\n", lineno, RULES_MAX);
+        return -1;
+    }
+    rules[rule_count++] = r;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "uso: %s regras.txt regras.bin\n", argv[0]);
+        return 1;
+    }
+
+    FILE *in = fopen(argv[1], "r");
+    if (in == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    char line[512];
+    int lineno = 0, errors = 0;
+    while (fgets(line, sizeof(line), in) != NULL) {
+        if (compile_line(line, ++lineno) != 0) errors++;
+    }
+    fclose(in);
+    if (errors) return 1;
+
+    // Regras e rotas seguidas, como o firmware as lê
+    uint8_t table[RULES_TABLE_MAX];
+    rules_header_t hdr = {
+        .magic = RULES_MAGIC,
+        .version = RULES_VERSION,
+        .count = (uint8_t)rule_count,
+        .route_count = (uint8_t)route_count
+    };
+    size_t len = sizeof(hdr);
+    memcpy(table + len, rules, rule_count * sizeof(rule_t));
+    len += rule_count * sizeof(rule_t);
+    memcpy(table + len, routes, route_count * RULES_TOPIC_LEN);
+    len += route_count * RULES_TOPIC_LEN;
+    hdr.crc = crc32(table + sizeof(hdr), len - sizeof(hdr));
+    memcpy(table, &hdr, sizeof(hdr));
+
+    FILE *out = fopen(argv[2], "wb");
+    if (out == NULL || fwrite(table, 1, len, out) != len || fclose(out) != 0) {
+        perror(argv[2]);
+        return 1;
+    }
+    printf("%d regras, %d rotas, %zu bytes -> %s\n", rule_count, route_count, len, argv[2]);
+    return 0;
+}